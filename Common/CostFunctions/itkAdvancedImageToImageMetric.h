@@ -36,7 +36,10 @@
 #include "itkAdvancedBSplineDeformableTransform.h"
 #include "itkAdvancedCombinationTransform.h"
 
-#include "itkPlatformMultiThreader.h"
+#include "itkSharedPoolMultiThreader.h"
+
+#include <atomic>
+#include <vector>
 
 namespace itk
 {
@@ -144,6 +147,8 @@ public:
   typedef typename ImageSamplerType::Pointer                      ImageSamplerPointer;
   typedef typename ImageSamplerType::OutputVectorContainerType    ImageSampleContainerType;
   typedef typename ImageSamplerType::OutputVectorContainerPointer ImageSampleContainerPointer;
+  typedef typename ImageSamplerType::ImageSampleArrayContainerType ImageSampleArrayContainerType;
+  typedef typename ImageSampleArrayContainerType::ConstPointer     ImageSampleArrayContainerConstPointer;
 
   /** Typedefs for Limiter support. */
   typedef LimiterFunctionBase< RealType, FixedImageDimension >  FixedImageLimiterType;
@@ -173,7 +178,7 @@ public:
   typedef vnl_sparse_matrix< HessianValueType > HessianType;
 
   /** Typedefs for multi-threading. */
-  typedef itk::PlatformMultiThreader                      ThreaderType;
+  typedef itk::SharedPoolMultiThreader                    ThreaderType;
   typedef typename ThreaderType::WorkUnitInfo ThreadInfoType;
 
   /** Public methods ********************/
@@ -264,6 +269,16 @@ public:
    */
   void Initialize( void ) override;
 
+  /** Create a copy of this metric, for example to evaluate it at several
+   * parameter vectors concurrently. The clone shares the images, the masks,
+   * the interpolator and the limiters, which are only read by an evaluation,
+   * and gets clones of the transform and of the image sampler. Call Initialize()
+   * on the clone before using it. Only the metrics that override InternalClone()
+   * support this. For the others, and when the transform or the image sampler
+   * cannot be cloned, Clone() returns a null pointer.
+   */
+  itkCloneMacro( Self );
+
   /** Experimental feature: compute SelfHessian.
    * This base class just returns an identity matrix of the right size.
    */
@@ -283,6 +298,48 @@ public:
   itkGetConstReferenceMacro( UseMultiThread, bool );
   itkBooleanMacro( UseMultiThread );
 
+  /** Set/Get the number of samples a thread claims at once from the sample
+   * scheduler. The default, 0, selects a chunk size based on the number of
+   * samples and the number of threads.
+   */
+  itkSetMacro( NumberOfSamplesPerChunk, SizeValueType );
+  itkGetConstMacro( NumberOfSamplesPerChunk, SizeValueType );
+
+  /** Select whether threads that finished their own samples steal chunks of
+   * samples from the other threads. This balances the load, but which thread
+   * accumulates which samples then depends on the timing, so the value and
+   * derivative may differ in the last bits between runs. Default: false,
+   * which gives each thread a fixed contiguous range of samples.
+   */
+  itkSetMacro( UseSampleChunkStealing, bool );
+  itkGetConstMacro( UseSampleChunkStealing, bool );
+  itkBooleanMacro( UseSampleChunkStealing );
+
+  /** Select the use of the evaluation cache. If true, the metric remembers
+   * the value, and the derivative if computed, of its last evaluation. The
+   * cache is discarded whenever the metric, the images, the interpolator, the
+   * masks, or the image sampler are modified. Default: false.
+   * What is reused at exactly the same parameters:
+   * \li GetValue() after GetValue() or GetValueAndDerivative(): the value.
+   * \li GetValueAndDerivative() or GetDerivative() after GetValueAndDerivative():
+   *   the value and the derivative.
+   * \li GetValueAndDerivative() after GetValue(): only the
+   *   ParzenWindowMutualInformationImageToImageMetric reuses the joint histogram
+   *   of GetValue(), and skips its first pass over the samples; the derivative
+   *   pass is still done. The other metrics evaluate everything again.
+   * Nothing is reused at other parameters, however close, and per-sample
+   * moving image values are not kept.
+   */
+  itkSetMacro( UseEvaluationCache, bool );
+  itkGetConstReferenceMacro( UseEvaluationCache, bool );
+  itkBooleanMacro( UseEvaluationCache );
+
+  /** Inheriting classes can specify whether they register the derivative entries
+   * that each thread updates, which allows a sparse accumulation of the per-thread
+   * derivatives. This method allows the user to inspect this setting.
+   */
+  itkGetConstMacro( SupportsSparseDerivativeAccumulation, bool );
+
   /** Contains calls from GetValueAndDerivative that are thread-unsafe,
    * together with preparation for multi-threading.
    * Note that the only reason why this function is not protected, is
@@ -291,6 +348,38 @@ public:
   virtual void BeforeThreadedGetValueAndDerivative(
     const TransformParametersType & parameters ) const;
 
+  /** The results of the transform at all samples of an image sampler.
+   * Metrics that use the same image sampler and transform, such as the
+   * sub-metrics of the CombinationImageToImageMetric, can share them,
+   * instead of each transforming the same samples. Only the mapped points
+   * are shared: storing the transform Jacobians of all samples costs far more
+   * memory than it saves, compared to the fused
+   * AdvancedTransform::EvaluateJacobianWithImageGradientProduct().
+   */
+  struct SharedTransformResultsType
+  {
+    std::vector< typename TransformType::OutputPointType > m_MappedPoints;
+  };
+
+  /** Compute the mapped points at all samples of the image sampler,
+   * multi-threaded. Call after BeforeThreadedGetValueAndDerivative().
+   * The results stay empty if they would take more than 256 MB.
+   */
+  virtual void ComputeSharedTransformResults( SharedTransformResultsType & results ) const;
+
+  /** Set results of the transform that were computed by ComputeSharedTransformResults()
+   * of a metric with the same image sampler and transform. They are then used instead
+   * of transforming the samples again. Set to nullptr to transform the samples in this
+   * metric again. The results are not owned, and must stay valid while they are set.
+   */
+  virtual void SetSharedTransformResults( const SharedTransformResultsType * results );
+
+  virtual const SharedTransformResultsType * GetSharedTransformResults( void ) const
+  {
+    return this->m_SharedTransformResults;
+  }
+
+
 protected:
 
   /** Constructor. */
@@ -302,6 +391,15 @@ protected:
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Returns a null pointer, see Clone(). */
+  LightObject::Pointer InternalClone( void ) const override;
+
+  /** Copy the components and the settings of this metric to a clone, for
+   * InternalClone() of a subclass. Returns false if the transform or the
+   * image sampler cannot be cloned.
+   */
+  bool CopySettingsToClone( Self * clone ) const;
+
   /** Protected Typedefs ******************/
 
   /** Typedefs for indices and points. */
@@ -419,6 +517,19 @@ protected:
   };
   mutable MultiThreaderParameterType m_ThreaderMetricParameters;
 
+  /** Threader callback of ComputeSharedTransformResults(). */
+  static ITK_THREAD_RETURN_TYPE ComputeSharedTransformResultsThreaderCallback( void * arg );
+
+  struct SharedTransformResultsMultiThreaderParameterType
+  {
+    const AdvancedImageToImageMetric * st_Metric;
+    SharedTransformResultsType *       st_Results;
+  };
+
+  /** Sparse version of AccumulateDerivativesThreaderCallback, see m_UseSparseDerivativeAccumulation. */
+  static void AccumulateSparseDerivatives( MultiThreaderParameterType * temp,
+    const ThreadIdType threadID, const ThreadIdType nrOfThreads );
+
   /** Most metrics will perform multi-threading by letting
    * each thread compute a part of the value and derivative.
    *
@@ -444,9 +555,10 @@ protected:
   // test per thread struct with padding and alignment
   struct GetValueAndDerivativePerThreadStruct
   {
-    SizeValueType  st_NumberOfPixelsCounted;
-    MeasureType    st_Value;
-    DerivativeType st_Derivative;
+    SizeValueType                st_NumberOfPixelsCounted;
+    MeasureType                  st_Value;
+    DerivativeType               st_Derivative;
+    std::vector< unsigned char > st_UpdatedDerivativeBlocks;
   };
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, GetValueAndDerivativePerThreadStruct,
     PaddedGetValueAndDerivativePerThreadStruct );
@@ -458,6 +570,72 @@ protected:
   /** Initialize some multi-threading related parameters. */
   virtual void InitializeThreadingParameters( void ) const;
 
+  /** Sparse accumulation of the per-thread derivatives.
+   *
+   * For transforms with a compact support, such as the B-spline transform, each
+   * thread only updates a small part of its derivative when the number of
+   * parameters is large compared to the number of samples per thread. The
+   * derivative is therefore divided in blocks of 2^DerivativeBlockShift entries,
+   * and each thread records which blocks it updated. The accumulation then only
+   * visits (and resets) the updated blocks, instead of the full derivative of
+   * every thread.
+   *
+   * The mode is selected automatically per iteration by
+   * InitializeDerivativeAccumulation(), and only for metrics that call
+   * RegisterDerivativeIndices() for every update of their per-thread derivative.
+   */
+  itkStaticConstMacro( DerivativeBlockShift, unsigned int, 6 );
+  mutable bool m_UseSparseDerivativeAccumulation;
+
+  /** Select the dense or sparse accumulation for the next threaded pass; not thread-safe. */
+  virtual void InitializeDerivativeAccumulation( const SizeValueType numberOfSamples ) const;
+
+  /** Register that this thread updated the derivative entries nzji. Thread-safe. */
+  inline void RegisterDerivativeIndices( const ThreadIdType threadId,
+    const NonZeroJacobianIndicesType & nzji ) const;
+
+  /** Work-stealing scheduler for the samples of the image sampler.
+   *
+   * The sample container is divided in chunks, and every thread initially
+   * owns a contiguous range of chunks. If UseSampleChunkStealing is true, a
+   * thread that has processed its own chunks steals chunks from the ranges of
+   * the other threads. This way, threads whose samples are cheap (e.g. masked
+   * out or mapping outside the moving image) help the threads that lag behind,
+   * instead of waiting for them. Otherwise each thread processes exactly its
+   * own range, by default one chunk, so the result is reproducible.
+   *
+   * The scheduler is reset by InitializeSampleChunkScheduler(), which is called
+   * by the Launch*ThreaderCallback functions. Inside a threaded function,
+   * loop over the samples as follows:
+   *   unsigned long pos_begin, pos_end;
+   *   while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
+   *   {
+   *     // process the samples in [ pos_begin, pos_end [
+   *   }
+   */
+  struct SampleChunkSchedulerPerThreadStruct
+  {
+    std::atomic< SizeValueType > st_NextChunk;
+    SizeValueType                st_EndChunk;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, SampleChunkSchedulerPerThreadStruct,
+    PaddedSampleChunkSchedulerPerThreadStruct );
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT, PaddedSampleChunkSchedulerPerThreadStruct,
+    AlignedSampleChunkSchedulerPerThreadStruct );
+  mutable AlignedSampleChunkSchedulerPerThreadStruct * m_SampleChunkSchedulerPerThreadVariables;
+  mutable ThreadIdType                                 m_SampleChunkSchedulerPerThreadVariablesSize;
+  mutable SizeValueType                                m_SampleChunkSize;
+  mutable SizeValueType                                m_NumberOfScheduledSamples;
+
+  /** Distribute numberOfSamples over the threads; not thread-safe. */
+  virtual void InitializeSampleChunkScheduler( const SizeValueType numberOfSamples ) const;
+
+  /** Get the next range of samples [ pos_begin, pos_end [ for this thread.
+   * Returns false when all samples have been handed out. Thread-safe.
+   */
+  bool GetNextSampleChunk( const ThreadIdType threadId,
+    unsigned long & pos_begin, unsigned long & pos_end ) const;
+
   /** Protected methods ************** */
 
   /** Methods for image sampler support **********/
@@ -469,6 +647,64 @@ protected:
    * Make sure to set it before calling Initialize; default: false. */
   itkSetMacro( UseImageSampler, bool );
 
+  /** Inheriting classes can specify whether they call RegisterDerivativeIndices()
+   * for every update of their per-thread derivative; default: false. */
+  itkSetMacro( SupportsSparseDerivativeAccumulation, bool );
+
+  /** Inheriting classes can specify whether they use the samples in the
+   * structure-of-arrays layout, see m_ImageSampleArrays; default: false. */
+  itkSetMacro( UseImageSampleArrays, bool );
+  itkGetConstMacro( UseImageSampleArrays, bool );
+
+  /** The samples of the image sampler in the structure-of-arrays layout.
+   * Only available when UseImageSampleArrays is true; it is refreshed by
+   * BeforeThreadedGetValueAndDerivative(), after updating the sampler.
+   */
+  mutable ImageSampleArrayContainerConstPointer m_ImageSampleArrays;
+
+  /** The number of samples that the batch functions process at once. */
+  itkStaticConstMacro( SampleBatchSize, unsigned int, 64 );
+
+  /** Compute the moving image values of the samples [ begin, end [ of
+   * m_ImageSampleArrays, with end - begin <= SampleBatchSize. For every sample
+   * this transforms the fixed point, checks the moving mask and interpolates
+   * the moving image. Advanced transforms transform the whole batch at once,
+   * see AdvancedTransform::TransformPoints(). sampleOk[ i ] is set to 0 for samples that fail these
+   * checks, in which case movingImageValues[ i ] is set to zero. This way the
+   * metrics can do their arithmetic in tight (vectorisable) loops over the batch.
+   * If movingImageDerivatives is given, the moving image gradients are computed
+   * as well; the linear interpolator then interpolates the whole batch at once,
+   * see AdvancedLinearInterpolateImageFunction::EvaluateValueAndDerivativeAtContinuousIndices().
+   * Returns the number of valid samples. Thread-safe.
+   */
+  virtual SizeValueType EvaluateMovingImageValuesBatch(
+    const SizeValueType begin, const SizeValueType end,
+    RealType * movingImageValues, unsigned char * sampleOk,
+    MovingImageDerivativeType * movingImageDerivatives = nullptr ) const;
+
+  /** Methods for the evaluation cache, see SetUseEvaluationCache().
+   * GetCachedValue() and GetCachedValueAndDerivative() return true if the
+   * metric was last evaluated at exactly these parameters and nothing changed
+   * since; the stored results are then copied to value and derivative, and the
+   * transform parameters are set, as a real evaluation would have done, unless
+   * the transform already has them. The latter is the case for the sub-metrics
+   * of a combination metric, which may get here concurrently, after the
+   * combination metric has set the parameters; the transform is then only read.
+   * The Set methods store the result of an evaluation. Both do nothing when
+   * UseEvaluationCache is false. Not thread-safe otherwise.
+   */
+  bool GetCachedValue( const TransformParametersType & parameters,
+    MeasureType & value ) const;
+  bool GetCachedValueAndDerivative( const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const;
+  void SetCachedValue( const TransformParametersType & parameters,
+    const MeasureType & value ) const;
+  void SetCachedValueAndDerivative( const TransformParametersType & parameters,
+    const MeasureType & value, const DerivativeType & derivative ) const;
+
+  /** Discard the result stored in the evaluation cache. */
+  void ClearEvaluationCache( void ) const;
+
   /** Check if enough samples have been found to compute a reliable
    * estimate of the value/derivative; throws an exception if not. */
   virtual void CheckNumberOfSamples(
@@ -493,6 +729,11 @@ protected:
     RealType & movingImageValue,
     MovingImageDerivativeType * gradient ) const;
 
+  /** Multiplies the moving image gradient with the MovingImageDerivativeScales,
+   * if UseMovingImageDerivativeScales is set.
+   */
+  void ApplyMovingImageDerivativeScales( MovingImageDerivativeType & gradient ) const;
+
   /** Computes the inner product of transform Jacobian with moving image gradient.
    * The results are stored in imageJacobian, which is supposed
    * to have the right size (same length as Jacobian's number of columns).
@@ -521,6 +762,15 @@ protected:
     const FixedImagePointType & fixedImagePoint,
     MovingImagePointType & mappedPoint ) const;
 
+  /** Transform the sample with index sampleIndex in the image sampler output.
+   * This takes the mapped point from the shared transform results when these
+   * are set, see SetSharedTransformResults(), and calls TransformPoint() otherwise.
+   */
+  bool TransformPoint(
+    const SizeValueType sampleIndex,
+    const FixedImagePointType & fixedImagePoint,
+    MovingImagePointType & mappedPoint ) const;
+
   /** This function returns a reference to the transform Jacobians.
    * This is either a reference to the full TransformJacobian or
    * a reference to a sparse Jacobians.
@@ -552,6 +802,16 @@ private:
   AdvancedImageToImageMetric( const Self & ); // purposely not implemented
   void operator=( const Self & );             // purposely not implemented
 
+  /** Get the latest modification time of everything that affects the value of
+   * the metric, except for the transform parameters. */
+  ModifiedTimeType GetEvaluationCacheTimeStamp( void ) const;
+
+  /** Check if the evaluation cache holds a result for these parameters. */
+  bool IsInEvaluationCache( const TransformParametersType & parameters ) const;
+
+  /** Set the transform parameters, unless the transform already has exactly these. */
+  void SetTransformParametersIfChanged( const TransformParametersType & parameters ) const;
+
   /** Private member variables. */
   bool   m_UseImageSampler;
   bool   m_UseFixedImageLimiter;
@@ -560,8 +820,25 @@ private:
   bool   m_UseMovingImageDerivativeScales;
   bool   m_ScaleGradientWithRespectToMovingImageOrientation;
 
+  SizeValueType m_NumberOfSamplesPerChunk;
+  bool          m_UseSampleChunkStealing;
+  bool          m_SupportsSparseDerivativeAccumulation;
+  bool          m_UseImageSampleArrays;
+
   MovingImageDerivativeScalesType m_MovingImageDerivativeScales;
 
+  /** Variables for the evaluation cache. */
+  bool                            m_UseEvaluationCache;
+  mutable TransformParametersType m_CachedParameters;
+  mutable MeasureType             m_CachedValue;
+  mutable DerivativeType          m_CachedDerivative;
+  mutable ModifiedTimeType        m_CachedTimeStamp;
+  mutable bool                    m_CachedValueIsValid;
+  mutable bool                    m_CachedDerivativeIsValid;
+
+  /** The transform results shared with other metrics, not owned. */
+  const SharedTransformResultsType * m_SharedTransformResults;
+
 };
 
 } // end namespace itk
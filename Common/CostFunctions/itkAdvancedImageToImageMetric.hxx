@@ -29,6 +29,8 @@
 
 #include "itkTimeProbe.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -50,6 +52,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 
   this->m_ImageSampler                = 0;
   this->m_UseImageSampler             = false;
+  this->m_UseImageSampleArrays        = false;
+  this->m_ImageSampleArrays           = 0;
   this->m_RequiredRatioOfValidSamples = 0.25;
 
   this->m_LinearInterpolator              = 0;
@@ -107,6 +111,28 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   this->m_GetValueAndDerivativePerThreadVariables     = nullptr;
   this->m_GetValueAndDerivativePerThreadVariablesSize = 0;
 
+  // Sample scheduler
+  this->m_NumberOfSamplesPerChunk                    = 0;
+  this->m_UseSampleChunkStealing                     = false;
+  this->m_SampleChunkSchedulerPerThreadVariables     = nullptr;
+  this->m_SampleChunkSchedulerPerThreadVariablesSize = 0;
+  this->m_SampleChunkSize                            = 1;
+  this->m_NumberOfScheduledSamples                   = 0;
+
+  // Sparse derivative accumulation
+  this->m_SupportsSparseDerivativeAccumulation = false;
+  this->m_UseSparseDerivativeAccumulation      = false;
+
+  // Evaluation cache
+  this->m_UseEvaluationCache      = false;
+  this->m_CachedValue             = NumericTraits< MeasureType >::Zero;
+  this->m_CachedTimeStamp         = 0;
+  this->m_CachedValueIsValid      = false;
+  this->m_CachedDerivativeIsValid = false;
+
+  // Shared transform results
+  this->m_SharedTransformResults = nullptr;
+
 } // end Constructor
 
 
@@ -120,6 +146,7 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 {
   delete[] this->m_GetValuePerThreadVariables;
   delete[] this->m_GetValueAndDerivativePerThreadVariables;
+  delete[] this->m_SampleChunkSchedulerPerThreadVariables;
 } // end Destructor
 
 
@@ -176,9 +203,106 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
     this->InitializeThreadingParameters();
   }
 
+  /** A result of the previous resolution should not be reused. */
+  this->ClearEvaluationCache();
+
 } // end Initialize()
 
 
+/**
+ * ********************* InternalClone ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+LightObject::Pointer
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InternalClone( void ) const
+{
+  /** A clone of a subclass would lose the settings of the subclass,
+   * so cloning is only supported by the subclasses that copy them.
+   */
+  return LightObject::Pointer();
+
+} // end InternalClone()
+
+
+/**
+ * ********************* CopySettingsToClone ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::CopySettingsToClone( Self * clone ) const
+{
+  /** The transform and the image sampler are changed by an evaluation,
+   * so the clone gets its own. The setters are called non-virtually, such
+   * that a subclass that forwards them, like a combination of metrics,
+   * only gets the components of this class.
+   */
+  if( this->m_AdvancedTransform.IsNull() )
+  {
+    return false;
+  }
+  typename AdvancedTransformType::Pointer transform;
+  ImageSamplerPointer                     sampler;
+  try
+  {
+    transform = dynamic_cast< AdvancedTransformType * >(
+      this->m_AdvancedTransform->Clone().GetPointer() );
+    if( this->m_ImageSampler.IsNotNull() )
+    {
+      sampler = this->m_ImageSampler->Clone();
+    }
+  }
+  catch( ExceptionObject & )
+  {
+    return false;
+  }
+  if( transform.IsNull() || ( this->m_ImageSampler.IsNotNull() && sampler.IsNull() ) )
+  {
+    return false;
+  }
+  clone->Self::SetTransform( transform );
+  clone->Self::SetImageSampler( sampler );
+
+  /** The other components are only read, and are shared. */
+  clone->m_FixedImage      = this->m_FixedImage;
+  clone->m_MovingImage     = this->m_MovingImage;
+  clone->m_FixedImageMask  = this->m_FixedImageMask;
+  clone->m_MovingImageMask = this->m_MovingImageMask;
+  clone->Self::SetInterpolator( this->m_Interpolator );
+  clone->Self::SetFixedImageRegion( this->Self::GetFixedImageRegion() );
+  clone->Self::SetComputeGradient( this->GetComputeGradient() );
+  clone->m_FixedImageLimiter     = this->m_FixedImageLimiter;
+  clone->m_MovingImageLimiter    = this->m_MovingImageLimiter;
+  clone->m_UseFixedImageLimiter  = this->m_UseFixedImageLimiter;
+  clone->m_UseMovingImageLimiter = this->m_UseMovingImageLimiter;
+  clone->m_FixedLimitRangeRatio  = this->m_FixedLimitRangeRatio;
+  clone->m_MovingLimitRangeRatio = this->m_MovingLimitRangeRatio;
+
+  /** The settings. */
+  clone->m_UseImageSampler                                  = this->m_UseImageSampler;
+  clone->m_UseImageSampleArrays                             = this->m_UseImageSampleArrays;
+  clone->m_RequiredRatioOfValidSamples                      = this->m_RequiredRatioOfValidSamples;
+  clone->m_UseMovingImageDerivativeScales                   = this->m_UseMovingImageDerivativeScales;
+  clone->m_ScaleGradientWithRespectToMovingImageOrientation = this->m_ScaleGradientWithRespectToMovingImageOrientation;
+  clone->m_MovingImageDerivativeScales                      = this->m_MovingImageDerivativeScales;
+  clone->m_UseMetricSingleThreaded                          = this->m_UseMetricSingleThreaded;
+  clone->m_UseMultiThread                                   = this->m_UseMultiThread;
+  clone->m_UseOpenMP                                        = this->m_UseOpenMP;
+  clone->m_NumberOfSamplesPerChunk                          = this->m_NumberOfSamplesPerChunk;
+  clone->m_UseSampleChunkStealing                           = this->m_UseSampleChunkStealing;
+  clone->m_SupportsSparseDerivativeAccumulation             = this->m_SupportsSparseDerivativeAccumulation;
+  clone->m_UseEvaluationCache                               = this->m_UseEvaluationCache;
+  clone->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  clone->Modified();
+
+  return true;
+
+} // end CopySettingsToClone()
+
+
 /**
  * ********************* InitializeThreadingParameters ****************************
  */
@@ -216,6 +340,11 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
     this->m_GetValueAndDerivativePerThreadVariablesSize = numberOfThreads;
   }
 
+  /** The number of blocks for the sparse derivative accumulation. */
+  const SizeValueType numberOfParameters = this->GetNumberOfParameters();
+  const SizeValueType numberOfBlocks
+    = ( numberOfParameters + ( 1 << Self::DerivativeBlockShift ) - 1 ) >> Self::DerivativeBlockShift;
+
   /** Some initialization. */
   for( ThreadIdType i = 0; i < numberOfThreads; ++i )
   {
@@ -226,11 +355,181 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
     this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value                 = NumericTraits< MeasureType >::Zero;
     this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.SetSize( this->GetNumberOfParameters() );
     this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    this->m_GetValueAndDerivativePerThreadVariables[ i ].st_UpdatedDerivativeBlocks.assign( numberOfBlocks, 0 );
   }
+  this->m_UseSparseDerivativeAccumulation = false;
 
 } // end InitializeThreadingParameters()
 
 
+/**
+ * ********************* InitializeSampleChunkScheduler ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeSampleChunkScheduler( const SizeValueType numberOfSamples ) const
+{
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Only resize the array of structs when needed. */
+  if( this->m_SampleChunkSchedulerPerThreadVariablesSize != numberOfThreads )
+  {
+    delete[] this->m_SampleChunkSchedulerPerThreadVariables;
+    this->m_SampleChunkSchedulerPerThreadVariables     = new AlignedSampleChunkSchedulerPerThreadStruct[ numberOfThreads ];
+    this->m_SampleChunkSchedulerPerThreadVariablesSize = numberOfThreads;
+  }
+
+  /** Determine the chunk size. Without stealing, by default each thread
+   * gets one chunk, which is the classic static division of the samples.
+   * With stealing, by default each thread owns about 8 chunks, which is
+   * enough to balance the load, while the chunks stay large enough to keep
+   * the overhead of claiming them negligible.
+   */
+  SizeValueType chunkSize = this->m_NumberOfSamplesPerChunk;
+  if( chunkSize == 0 && !this->m_UseSampleChunkStealing )
+  {
+    chunkSize = std::max< SizeValueType >(
+      ( numberOfSamples + numberOfThreads - 1 ) / numberOfThreads, 1 );
+  }
+  else if( chunkSize == 0 )
+  {
+    const SizeValueType numberOfChunksPerThread = 8;
+    const SizeValueType minimumChunkSize        = 16;
+    chunkSize = ( numberOfSamples + numberOfThreads * numberOfChunksPerThread - 1 )
+      / ( numberOfThreads * numberOfChunksPerThread );
+    chunkSize = std::max( chunkSize, minimumChunkSize );
+  }
+  this->m_SampleChunkSize          = chunkSize;
+  this->m_NumberOfScheduledSamples = numberOfSamples;
+
+  /** Give each thread a contiguous range of chunks, to preserve locality. */
+  const SizeValueType numberOfChunks          = ( numberOfSamples + chunkSize - 1 ) / chunkSize;
+  const SizeValueType numberOfChunksPerThread = ( numberOfChunks + numberOfThreads - 1 ) / numberOfThreads;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    const SizeValueType beginChunk = std::min( i * numberOfChunksPerThread, numberOfChunks );
+    const SizeValueType endChunk   = std::min( ( i + 1 ) * numberOfChunksPerThread, numberOfChunks );
+    this->m_SampleChunkSchedulerPerThreadVariables[ i ].st_NextChunk.store( beginChunk, std::memory_order_relaxed );
+    this->m_SampleChunkSchedulerPerThreadVariables[ i ].st_EndChunk = endChunk;
+  }
+
+} // end InitializeSampleChunkScheduler()
+
+
+/**
+ * ********************* GetNextSampleChunk ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetNextSampleChunk( const ThreadIdType threadId,
+  unsigned long & pos_begin, unsigned long & pos_end ) const
+{
+  /** First take chunks from the own range, then steal from the other threads,
+   * starting with the neighbouring thread, if that is allowed.
+   */
+  const ThreadIdType numberOfThreads = this->m_SampleChunkSchedulerPerThreadVariablesSize;
+  const ThreadIdType numberOfQueues  = this->m_UseSampleChunkStealing ? numberOfThreads : 1;
+  for( ThreadIdType i = 0; i < numberOfQueues; ++i )
+  {
+    AlignedSampleChunkSchedulerPerThreadStruct & queue
+      = this->m_SampleChunkSchedulerPerThreadVariables[ ( threadId + i ) % numberOfThreads ];
+
+    /** Skip exhausted ranges without writing to their cache line. */
+    if( queue.st_NextChunk.load( std::memory_order_relaxed ) >= queue.st_EndChunk )
+    {
+      continue;
+    }
+
+    const SizeValueType chunk = queue.st_NextChunk.fetch_add( 1, std::memory_order_relaxed );
+    if( chunk < queue.st_EndChunk )
+    {
+      const SizeValueType begin = chunk * this->m_SampleChunkSize;
+      const SizeValueType end   = std::min( begin + this->m_SampleChunkSize, this->m_NumberOfScheduledSamples );
+      pos_begin = static_cast< unsigned long >( begin );
+      pos_end   = static_cast< unsigned long >( end );
+      return true;
+    }
+  }
+
+  return false;
+
+} // end GetNextSampleChunk()
+
+
+/**
+ * ********************* InitializeDerivativeAccumulation ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeDerivativeAccumulation( const SizeValueType numberOfSamples ) const
+{
+  /** Switching modes is safe at this point: after a dense accumulation all
+   * per-thread derivatives are zero, and after a sparse accumulation also all
+   * block flags are reset.
+   */
+  this->m_UseSparseDerivativeAccumulation = false;
+  if( !this->m_SupportsSparseDerivativeAccumulation
+    || this->m_GetValueAndDerivativePerThreadVariablesSize != Self::GetNumberOfWorkUnits() )
+  {
+    return;
+  }
+
+  /** Use the sparse mode when the number of derivative entries that a thread can
+   * possibly update is smaller than the number of parameters.
+   */
+  const SizeValueType numberOfParameters = this->GetNumberOfParameters();
+  const SizeValueType nnzji              = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  const SizeValueType numberOfThreads    = Self::GetNumberOfWorkUnits();
+  const SizeValueType samplesPerThread   = ( numberOfSamples + numberOfThreads - 1 ) / numberOfThreads;
+  if( nnzji < numberOfParameters && samplesPerThread * nnzji < numberOfParameters )
+  {
+    this->m_UseSparseDerivativeAccumulation = true;
+  }
+
+} // end InitializeDerivativeAccumulation()
+
+
+/**
+ * ********************* RegisterDerivativeIndices ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::RegisterDerivativeIndices( const ThreadIdType threadId,
+  const NonZeroJacobianIndicesType & nzji ) const
+{
+  if( !this->m_UseSparseDerivativeAccumulation )
+  {
+    return;
+  }
+
+  /** The non-zero Jacobian indices come in runs of consecutive entries,
+   * so we skip writing the same flag repeatedly.
+   */
+  unsigned char *     updatedBlocks = &( this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_UpdatedDerivativeBlocks[ 0 ] );
+  const std::size_t   nnzji         = nzji.size();
+  const unsigned long invalidBlock  = NumericTraits< unsigned long >::max();
+  unsigned long       previousBlock = invalidBlock;
+  for( std::size_t i = 0; i < nnzji; ++i )
+  {
+    const unsigned long block = static_cast< unsigned long >( nzji[ i ] ) >> Self::DerivativeBlockShift;
+    if( block != previousBlock )
+    {
+      updatedBlocks[ block ] = 1;
+      previousBlock          = block;
+    }
+  }
+
+} // end RegisterDerivativeIndices()
+
+
 /**
  * ****************** InitializeLimiters *****************************
  */
@@ -636,44 +935,7 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
       }
 
       /** The moving image gradient is multiplied with its scales, when requested. */
-      if( this->m_UseMovingImageDerivativeScales )
-      {
-        if( !this->m_ScaleGradientWithRespectToMovingImageOrientation )
-        {
-          for( unsigned int i = 0; i < MovingImageDimension; ++i )
-          {
-            ( *gradient )[ i ] *= this->m_MovingImageDerivativeScales[ i ];
-          }
-        }
-        else
-        {
-          /** Optionally, the scales are applied with respect to the moving image orientation.
-           * The above default option implicitly applies the scales with respect to the
-           * orientation of the transformation axis. In some cases you may want to restrict
-           * moving image motion with respect to its own axes. This is achieved below by pre
-           * and post rotation by the direction cosines of the moving image.
-           * First the gradient is rotated backwards to a standardized axis.
-           */
-          typedef typename MovingImageType::DirectionType::InternalMatrixType InternalMatrixType;
-          const InternalMatrixType M                    = this->GetMovingImage()->GetDirection().GetVnlMatrix();
-          vnl_vector< double >     rotated_gradient_vnl = M.transpose() * gradient->GetVnlVector();
-
-          /** Then scales are applied. */
-          for( unsigned int i = 0; i < MovingImageDimension; ++i )
-          {
-            rotated_gradient_vnl[ i ] *= this->m_MovingImageDerivativeScales[ i ];
-          }
-
-          /** The scaled gradient is then rotated forwards again. */
-          rotated_gradient_vnl = M * rotated_gradient_vnl;
-
-          /** Copy the vnl version back to the original. */
-          for( unsigned int i = 0; i < MovingImageDimension; ++i )
-          {
-            ( *gradient )[ i ] = rotated_gradient_vnl[ i ];
-          }
-        }
-      } // end if m_UseMovingImageDerivativeScales
+      this->ApplyMovingImageDerivativeScales( *gradient );
     } // end if gradient
     else
     {
@@ -686,6 +948,57 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end EvaluateMovingImageValueAndDerivative()
 
 
+/**
+ * ******************* ApplyMovingImageDerivativeScales ******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ApplyMovingImageDerivativeScales( MovingImageDerivativeType & gradient ) const
+{
+  if( this->m_UseMovingImageDerivativeScales )
+  {
+    if( !this->m_ScaleGradientWithRespectToMovingImageOrientation )
+    {
+      for( unsigned int i = 0; i < MovingImageDimension; ++i )
+      {
+        gradient[ i ] *= this->m_MovingImageDerivativeScales[ i ];
+      }
+    }
+    else
+    {
+      /** Optionally, the scales are applied with respect to the moving image orientation.
+       * The above default option implicitly applies the scales with respect to the
+       * orientation of the transformation axis. In some cases you may want to restrict
+       * moving image motion with respect to its own axes. This is achieved below by pre
+       * and post rotation by the direction cosines of the moving image.
+       * First the gradient is rotated backwards to a standardized axis.
+       */
+      typedef typename MovingImageType::DirectionType::InternalMatrixType InternalMatrixType;
+      const InternalMatrixType M                    = this->GetMovingImage()->GetDirection().GetVnlMatrix();
+      vnl_vector< double >     rotated_gradient_vnl = M.transpose() * gradient.GetVnlVector();
+
+      /** Then scales are applied. */
+      for( unsigned int i = 0; i < MovingImageDimension; ++i )
+      {
+        rotated_gradient_vnl[ i ] *= this->m_MovingImageDerivativeScales[ i ];
+      }
+
+      /** The scaled gradient is then rotated forwards again. */
+      rotated_gradient_vnl = M * rotated_gradient_vnl;
+
+      /** Copy the vnl version back to the original. */
+      for( unsigned int i = 0; i < MovingImageDimension; ++i )
+      {
+        gradient[ i ] = rotated_gradient_vnl[ i ];
+      }
+    }
+  } // end if m_UseMovingImageDerivativeScales
+
+} // end ApplyMovingImageDerivativeScales()
+
+
 /**
  * *************** EvaluateTransformJacobianInnerProduct ****************
  */
@@ -792,6 +1105,232 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end EvaluateTransformJacobian()
 
 
+/**
+ * ********************** TransformPoint ************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::TransformPoint(
+  const SizeValueType sampleIndex,
+  const FixedImagePointType & fixedImagePoint,
+  MovingImagePointType & mappedPoint ) const
+{
+  const SharedTransformResultsType * shared = this->m_SharedTransformResults;
+  if( shared != nullptr && sampleIndex < shared->m_MappedPoints.size() )
+  {
+    mappedPoint = shared->m_MappedPoints[ sampleIndex ];
+    return true;
+  }
+
+  return this->TransformPoint( fixedImagePoint, mappedPoint );
+
+} // end TransformPoint()
+
+
+/**
+ * *************** SetSharedTransformResults ****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SetSharedTransformResults( const SharedTransformResultsType * results )
+{
+  /** Not a modification of the metric, so Modified() is not called. */
+  this->m_SharedTransformResults = results;
+
+} // end SetSharedTransformResults()
+
+
+/**
+ * *************** ComputeSharedTransformResults ****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeSharedTransformResults( SharedTransformResultsType & results ) const
+{
+  /** The mapped points are not stored if they would take more than 256 MB,
+   * for example when all voxels of a large image are sampled. The metrics
+   * then transform the samples themselves.
+   */
+  const SizeValueType numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+  const double        pointsSize      = static_cast< double >( numberOfSamples )
+    * sizeof( typename TransformType::OutputPointType );
+  if( pointsSize > 256.0 * 1024.0 * 1024.0 )
+  {
+    results.m_MappedPoints.clear();
+    return;
+  }
+  results.m_MappedPoints.resize( numberOfSamples );
+
+  /** Compute the results, multi-threaded. */
+  SharedTransformResultsMultiThreaderParameterType parameters;
+  parameters.st_Metric  = this;
+  parameters.st_Results = &results;
+  this->m_Threader->SetSingleMethod( this->ComputeSharedTransformResultsThreaderCallback,
+    static_cast< void * >( &parameters ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end ComputeSharedTransformResults()
+
+
+/**
+ * *************** ComputeSharedTransformResultsThreaderCallback ****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeSharedTransformResultsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID    = infoStruct->WorkUnitID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfWorkUnits;
+
+  SharedTransformResultsMultiThreaderParameterType * temp
+    = static_cast< SharedTransformResultsMultiThreaderParameterType * >( infoStruct->UserData );
+  const Self *                 metric  = temp->st_Metric;
+  SharedTransformResultsType * results = temp->st_Results;
+
+  /** Get the range of samples of this thread. */
+  ImageSampleContainerPointer sampleContainer = metric->GetImageSampler()->GetOutput();
+  const SizeValueType         numberOfSamples = sampleContainer->Size();
+  const SizeValueType         pos_begin       = numberOfSamples * threadID / nrOfThreads;
+  const SizeValueType         pos_end         = numberOfSamples * ( threadID + 1 ) / nrOfThreads;
+
+  for( SizeValueType pos = pos_begin; pos < pos_end; ++pos )
+  {
+    const FixedImagePointType & fixedPoint = sampleContainer->ElementAt( pos ).m_ImageCoordinates;
+    metric->TransformPoint( fixedPoint, results->m_MappedPoints[ pos ] );
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeSharedTransformResultsThreaderCallback()
+
+
+/**
+ * *************** EvaluateMovingImageValuesBatch ****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+SizeValueType
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateMovingImageValuesBatch(
+  const SizeValueType begin, const SizeValueType end,
+  RealType * movingImageValues, unsigned char * sampleOk,
+  MovingImageDerivativeType * movingImageDerivatives ) const
+{
+  const ImageSampleArrayContainerType * samples   = this->m_ImageSampleArrays.GetPointer();
+  const SizeValueType                   batchSize = end - begin;
+
+  /** Gather the fixed points of the batch. */
+  FixedImagePointType fixedPoints[ SampleBatchSize ];
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    const typename ImageSampleArrayContainerType::CoordinateValueType * coordinates
+      = samples->GetCoordinates( d ) + begin;
+    for( SizeValueType i = 0; i < batchSize; ++i )
+    {
+      fixedPoints[ i ][ d ] = coordinates[ i ];
+    }
+  }
+
+  /** Transform the batch of points. Advanced transforms do this in one call.
+   * Points that were already transformed for another metric are copied.
+   */
+  MovingImagePointType mappedPoints[ SampleBatchSize ];
+  const SharedTransformResultsType * shared = this->m_SharedTransformResults;
+  if( shared != nullptr && end <= shared->m_MappedPoints.size() )
+  {
+    std::copy( shared->m_MappedPoints.begin() + begin,
+      shared->m_MappedPoints.begin() + end, mappedPoints );
+  }
+  else if( this->m_TransformIsAdvanced )
+  {
+    this->m_AdvancedTransform->TransformPoints( fixedPoints, mappedPoints, batchSize );
+  }
+  else
+  {
+    for( SizeValueType i = 0; i < batchSize; ++i )
+    {
+      this->TransformPoint( fixedPoints[ i ], mappedPoints[ i ] );
+    }
+  }
+
+  /** The linear interpolator computes the values and gradients of the whole
+   * batch at once, from the samples that are inside the mask and the buffer.
+   */
+  if( movingImageDerivatives && this->m_InterpolatorIsLinear && !this->GetComputeGradient() )
+  {
+    MovingImageContinuousIndexType cindices[ SampleBatchSize ];
+    SizeValueType                  validIndices[ SampleBatchSize ];
+    SizeValueType                  numberOfValidSamples = 0;
+    for( SizeValueType i = 0; i < batchSize; ++i )
+    {
+      sampleOk[ i ]          = 0;
+      movingImageValues[ i ] = NumericTraits< RealType >::ZeroValue();
+      if( !this->IsInsideMovingMask( mappedPoints[ i ] ) )
+      {
+        continue;
+      }
+      MovingImageContinuousIndexType & cindex = cindices[ numberOfValidSamples ];
+      this->m_Interpolator->ConvertPointToContinuousIndex( mappedPoints[ i ], cindex );
+      if( this->m_Interpolator->IsInsideBuffer( cindex ) )
+      {
+        validIndices[ numberOfValidSamples ] = i;
+        ++numberOfValidSamples;
+      }
+    }
+
+    RealType                  validValues[ SampleBatchSize ];
+    MovingImageDerivativeType validDerivatives[ SampleBatchSize ];
+    this->m_LinearInterpolator->EvaluateValueAndDerivativeAtContinuousIndices(
+      cindices, validValues, validDerivatives, numberOfValidSamples );
+
+    /** Scatter the results back to the samples of the batch. */
+    for( SizeValueType k = 0; k < numberOfValidSamples; ++k )
+    {
+      const SizeValueType i = validIndices[ k ];
+      movingImageValues[ i ]      = validValues[ k ];
+      movingImageDerivatives[ i ] = validDerivatives[ k ];
+      this->ApplyMovingImageDerivativeScales( movingImageDerivatives[ i ] );
+      sampleOk[ i ] = 1;
+    }
+
+    return numberOfValidSamples;
+  }
+
+  SizeValueType numberOfValidSamples = 0;
+  for( SizeValueType i = 0; i < batchSize; ++i )
+  {
+    /** Check if point is inside mask. */
+    RealType movingImageValue = NumericTraits< RealType >::ZeroValue();
+    bool     valid            = this->IsInsideMovingMask( mappedPoints[ i ] );
+
+    /** Compute the moving image value M(T(x)) and check if
+     * the point is inside the moving image buffer.
+     */
+    if( valid )
+    {
+      valid = this->EvaluateMovingImageValueAndDerivative( mappedPoints[ i ], movingImageValue,
+        movingImageDerivatives ? &movingImageDerivatives[ i ] : 0 );
+    }
+
+    movingImageValues[ i ] = valid ? movingImageValue : NumericTraits< RealType >::ZeroValue();
+    sampleOk[ i ]          = valid ? 1 : 0;
+    numberOfValidSamples  += valid ? 1 : 0;
+  }
+
+  return numberOfValidSamples;
+
+} // end EvaluateMovingImageValuesBatch()
+
+
 /**
  * ************************** IsInsideMovingMask *************************
  */
@@ -855,6 +1394,12 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
     if( this->m_UseImageSampler )
     {
       this->GetImageSampler()->Update();
+
+      /** Refresh the structure-of-arrays version of the samples. */
+      if( this->m_UseImageSampleArrays )
+      {
+        this->m_ImageSampleArrays = this->GetImageSampler()->GetOutputSampleArrays();
+      }
     }
   }
 
@@ -892,6 +1437,12 @@ void
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 ::LaunchGetValueThreaderCallback( void ) const
 {
+  /** Distribute the samples over the threads. */
+  if( this->m_UseImageSampler )
+  {
+    this->InitializeSampleChunkScheduler( this->GetImageSampler()->GetOutput()->Size() );
+  }
+
   /** Setup threader. */
   this->m_Threader->SetSingleMethod( this->GetValueThreaderCallback,
     const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
@@ -933,6 +1484,16 @@ void
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 ::LaunchGetValueAndDerivativeThreaderCallback( void ) const
 {
+  /** Distribute the samples over the threads, and select the way
+   * the per-thread derivatives are accumulated.
+   */
+  if( this->m_UseImageSampler )
+  {
+    const SizeValueType numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+    this->InitializeSampleChunkScheduler( numberOfSamples );
+    this->InitializeDerivativeAccumulation( numberOfSamples );
+  }
+
   /** Setup threader. */
   this->m_Threader->SetSingleMethod( this->GetValueAndDerivativeThreaderCallback,
     const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
@@ -959,7 +1520,15 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   MultiThreaderParameterType * temp
     = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
 
-  const unsigned int numPar  = temp->st_Metric->GetNumberOfParameters();
+  const unsigned int numPar = temp->st_Metric->GetNumberOfParameters();
+
+  /** In the sparse mode only the updated blocks are visited. */
+  if( temp->st_Metric->m_UseSparseDerivativeAccumulation )
+  {
+    Self::AccumulateSparseDerivatives( temp, threadID, nrOfThreads );
+    return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+  }
+
   const unsigned int subSize = static_cast< unsigned int >(
     std::ceil( static_cast< double >( numPar )
     / static_cast< double >( nrOfThreads ) ) );
@@ -990,6 +1559,63 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end AccumulateDerivativesThreaderCallback()
 
 
+/**
+ *********** AccumulateSparseDerivatives *************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::AccumulateSparseDerivatives( MultiThreaderParameterType * temp,
+  const ThreadIdType threadID, const ThreadIdType nrOfThreads )
+{
+  const unsigned int numPar    = temp->st_Metric->GetNumberOfParameters();
+  const unsigned int blockSize = 1 << Self::DerivativeBlockShift;
+  const unsigned int numBlocks = ( numPar + blockSize - 1 ) >> Self::DerivativeBlockShift;
+  const unsigned int subSize   = ( numBlocks + nrOfThreads - 1 ) / nrOfThreads;
+  const unsigned int bmin      = std::min( threadID * subSize, numBlocks );
+  const unsigned int bmax      = std::min( ( threadID + 1 ) * subSize, numBlocks );
+
+  /** This thread accumulates all sub-derivatives into a single one, for the
+   * blocks [ bmin, bmax [. Blocks that a thread did not update are zero and
+   * are skipped. Additionally, the updated sub-derivatives and flags are reset.
+   */
+  const DerivativeValueType zero          = NumericTraits< DerivativeValueType >::Zero;
+  const DerivativeValueType normalization = 1.0 / temp->st_NormalizationFactor;
+  DerivativeValueType *     derivative    = temp->st_DerivativePointer;
+  for( unsigned int b = bmin; b < bmax; ++b )
+  {
+    const unsigned int jmin = b << Self::DerivativeBlockShift;
+    const unsigned int jmax = std::min( jmin + blockSize, numPar );
+    std::fill( derivative + jmin, derivative + jmax, zero );
+
+    for( ThreadIdType i = 0; i < nrOfThreads; ++i )
+    {
+      AlignedGetValueAndDerivativePerThreadStruct & perThread
+        = temp->st_Metric->m_GetValueAndDerivativePerThreadVariables[ i ];
+      if( !perThread.st_UpdatedDerivativeBlocks[ b ] )
+      {
+        continue;
+      }
+
+      DerivativeValueType * subDerivative = perThread.st_Derivative.data_block();
+      for( unsigned int j = jmin; j < jmax; ++j )
+      {
+        derivative[ j ]   += subDerivative[ j ];
+        subDerivative[ j ] = zero;
+      }
+      perThread.st_UpdatedDerivativeBlocks[ b ] = 0;
+    }
+
+    for( unsigned int j = jmin; j < jmax; ++j )
+    {
+      derivative[ j ] *= normalization;
+    }
+  }
+
+} // end AccumulateSparseDerivatives()
+
+
 /**
  * *********************** CheckNumberOfSamples ***********************
  */
@@ -1010,6 +1636,205 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end CheckNumberOfSamples()
 
 
+/**
+ * *********************** GetEvaluationCacheTimeStamp ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ModifiedTimeType
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetEvaluationCacheTimeStamp( void ) const
+{
+  /** The transform is not included: its time stamp changes with every call
+   * to SetParameters(), while its parameters are compared explicitly.
+   */
+  ModifiedTimeType latestTime = this->GetMTime();
+  if( this->m_FixedImage.IsNotNull() )
+  {
+    latestTime = std::max( latestTime, this->m_FixedImage->GetMTime() );
+  }
+  if( this->m_MovingImage.IsNotNull() )
+  {
+    latestTime = std::max( latestTime, this->m_MovingImage->GetMTime() );
+  }
+  if( this->m_Interpolator.IsNotNull() )
+  {
+    latestTime = std::max( latestTime, this->m_Interpolator->GetMTime() );
+  }
+  if( this->m_FixedImageMask.IsNotNull() )
+  {
+    latestTime = std::max( latestTime, this->m_FixedImageMask->GetMTime() );
+  }
+  if( this->m_MovingImageMask.IsNotNull() )
+  {
+    latestTime = std::max( latestTime, this->m_MovingImageMask->GetMTime() );
+  }
+
+  /** The image sampler is modified when new samples are requested. */
+  if( this->m_UseImageSampler && this->m_ImageSampler.IsNotNull() )
+  {
+    latestTime = std::max( latestTime, this->m_ImageSampler->GetMTime() );
+  }
+
+  return latestTime;
+
+} // end GetEvaluationCacheTimeStamp()
+
+
+/**
+ * *********************** IsInEvaluationCache ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::IsInEvaluationCache( const TransformParametersType & parameters ) const
+{
+  /** Compare the parameters exactly: the result of a nearby point is not good enough. */
+  const SizeValueType numberOfParameters = parameters.GetSize();
+  return this->m_UseEvaluationCache
+         && this->m_CachedParameters.GetSize() == numberOfParameters
+         && this->m_CachedTimeStamp == this->GetEvaluationCacheTimeStamp()
+         && std::equal( parameters.data_block(), parameters.data_block() + numberOfParameters,
+           this->m_CachedParameters.data_block() );
+
+} // end IsInEvaluationCache()
+
+
+/**
+ * *********************** SetTransformParametersIfChanged ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SetTransformParametersIfChanged( const TransformParametersType & parameters ) const
+{
+  /** Some transforms keep a pointer to the parameters they were given. */
+  const TransformParametersType & current = this->m_Transform->GetParameters();
+  const SizeValueType numberOfParameters  = parameters.GetSize();
+  if( &current == &parameters
+    || ( current.GetSize() == numberOfParameters
+    && std::equal( parameters.data_block(), parameters.data_block() + numberOfParameters,
+    current.data_block() ) ) )
+  {
+    return;
+  }
+
+  this->SetTransformParameters( parameters );
+
+} // end SetTransformParametersIfChanged()
+
+
+/**
+ * *********************** GetCachedValue ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetCachedValue( const TransformParametersType & parameters, MeasureType & value ) const
+{
+  if( !this->m_CachedValueIsValid || !this->IsInEvaluationCache( parameters ) )
+  {
+    return false;
+  }
+
+  this->SetTransformParametersIfChanged( parameters );
+  value = this->m_CachedValue;
+  return true;
+
+} // end GetCachedValue()
+
+
+/**
+ * *********************** GetCachedValueAndDerivative ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetCachedValueAndDerivative( const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  if( !this->m_CachedDerivativeIsValid || !this->IsInEvaluationCache( parameters ) )
+  {
+    return false;
+  }
+
+  this->SetTransformParametersIfChanged( parameters );
+  value      = this->m_CachedValue;
+  derivative = this->m_CachedDerivative;
+  return true;
+
+} // end GetCachedValueAndDerivative()
+
+
+/**
+ * *********************** SetCachedValue ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SetCachedValue( const TransformParametersType & parameters, const MeasureType & value ) const
+{
+  if( !this->m_UseEvaluationCache )
+  {
+    return;
+  }
+
+  /** Take the time stamp after the evaluation, since updating
+   * the image sampler may have modified it.
+   */
+  this->m_CachedParameters        = parameters;
+  this->m_CachedValue             = value;
+  this->m_CachedTimeStamp         = this->GetEvaluationCacheTimeStamp();
+  this->m_CachedValueIsValid      = true;
+  this->m_CachedDerivativeIsValid = false;
+
+} // end SetCachedValue()
+
+
+/**
+ * *********************** SetCachedValueAndDerivative ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SetCachedValueAndDerivative( const TransformParametersType & parameters,
+  const MeasureType & value, const DerivativeType & derivative ) const
+{
+  if( !this->m_UseEvaluationCache )
+  {
+    return;
+  }
+
+  this->SetCachedValue( parameters, value );
+  this->m_CachedDerivative        = derivative;
+  this->m_CachedDerivativeIsValid = true;
+
+} // end SetCachedValueAndDerivative()
+
+
+/**
+ * *********************** ClearEvaluationCache ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::ClearEvaluationCache( void ) const
+{
+  this->m_CachedParameters.SetSize( 0 );
+  this->m_CachedDerivative.SetSize( 0 );
+  this->m_CachedValueIsValid      = false;
+  this->m_CachedDerivativeIsValid = false;
+
+} // end ClearEvaluationCache()
+
+
 /**
  * ********************* PrintSelf ****************************
  */
@@ -1087,6 +1912,12 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
      << this->m_UseMovingImageDerivativeScales << std::endl;
   os << indent.GetNextIndent() << "MovingImageDerivativeScales: "
      << this->m_MovingImageDerivativeScales << std::endl;
+  os << indent.GetNextIndent() << "NumberOfSamplesPerChunk: "
+     << this->m_NumberOfSamplesPerChunk << std::endl;
+  os << indent.GetNextIndent() << "UseSampleChunkStealing: "
+     << this->m_UseSampleChunkStealing << std::endl;
+  os << indent.GetNextIndent() << "UseEvaluationCache: "
+     << this->m_UseEvaluationCache << std::endl;
 
 } // end PrintSelf()
 
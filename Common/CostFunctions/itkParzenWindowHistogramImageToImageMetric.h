@@ -21,6 +21,9 @@
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkKernelFunctionBase2.h"
 
+#include <atomic>
+#include <memory> // For unique_ptr.
+
 
 namespace itk
 {
@@ -121,6 +124,7 @@ public:
   typedef typename Superclass::ImageSamplerPointer             ImageSamplerPointer;
   typedef typename Superclass::ImageSampleContainerType        ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer     ImageSampleContainerPointer;
+  typedef typename Superclass::ImageSampleArrayContainerType   ImageSampleArrayContainerType;
   typedef typename Superclass::FixedImageLimiterType           FixedImageLimiterType;
   typedef typename Superclass::MovingImageLimiterType          MovingImageLimiterType;
   typedef typename Superclass::FixedImageLimiterOutputType     FixedImageLimiterOutputType;
@@ -189,6 +193,26 @@ public:
   itkSetClampMacro( MovingKernelBSplineOrder, unsigned int, 0, 3 );
   itkGetConstMacro( MovingKernelBSplineOrder, unsigned int );
 
+  /** Option to evaluate the Parzen windows by a lookup table with linear
+   * interpolation (see TabulatedKernelFunction), instead of evaluating the
+   * B-spline polynomials for every sample. Only used for the cubic kernels,
+   * not for their derivative. Default: false.
+   */
+  itkSetMacro( UseTabulatedKernels, bool );
+  itkGetConstReferenceMacro( UseTabulatedKernels, bool );
+  itkBooleanMacro( UseTabulatedKernels );
+
+  /** Option to let the threads share a few joint histograms, updated with
+   * atomic additions, when there are fewer samples per thread than histogram
+   * bins. Zeroing and merging one private histogram per thread then costs more
+   * than computing the histogram itself. Note that the order of the atomic
+   * additions varies, so the results are not bitwise reproducible.
+   * Only used by the multi-threaded ComputePDFs(). Default: false.
+   */
+  itkSetMacro( UseSharedJointPDFs, bool );
+  itkGetConstReferenceMacro( UseSharedJointPDFs, bool );
+  itkBooleanMacro( UseSharedJointPDFs );
+
   /** Option to use explicit PDF derivatives, which requires a lot
    * of memory in case of many parameters.
    */
@@ -226,6 +250,11 @@ protected:
   /** Print Self. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Copy the components and the settings of this metric to a clone,
+   * see AdvancedImageToImageMetric::CopySettingsToClone().
+   */
+  bool CopySettingsToClone( Self * clone ) const;
+
   /** Protected Typedefs ******************/
 
   /** Typedefs inherited from superclass. */
@@ -313,6 +342,7 @@ protected:
   {
     SizeValueType   st_NumberOfPixelsCounted;
     JointPDFPointer st_JointPDF;
+    bool            st_JointPDFIsZero;
   };
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, ParzenWindowHistogramGetValueAndDerivativePerThreadStruct,
     PaddedParzenWindowHistogramGetValueAndDerivativePerThreadStruct );
@@ -327,7 +357,7 @@ protected:
   /** Multi-threaded versions of the ComputePDF function. */
   inline void ThreadedComputePDFs( ThreadIdType threadId );
 
-  /** Single-threadedly accumulate results. */
+  /** Accumulate results, merging the joint histograms with MergeJointPDFs. */
   inline void AfterThreadedComputePDFs( void ) const;
 
   /** Helper function to launch the threads. */
@@ -336,6 +366,53 @@ protected:
   /** Helper function to launch the threads. */
   void LaunchComputePDFsThreaderCallback( void ) const;
 
+  /** Sum the joint histograms of the threads into m_JointPDF, and zero them.
+   * Every thread merges a range of bins, in blocks of JointPDFMergeBlockSize
+   * bins; within a block the histograms are added pairwise, in a tree.
+   */
+  inline void ThreadedMergeJointPDFs( ThreadIdType threadId, ThreadIdType numberOfThreads ) const;
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_TYPE MergeJointPDFsThreaderCallback( void * arg );
+
+  /** Helper function to launch the threads. */
+  void LaunchMergeJointPDFsThreaderCallback( void ) const;
+
+  /** The number of bins that is merged at once: 4 kB of doubles. */
+  itkStaticConstMacro( JointPDFMergeBlockSize, unsigned int, 512 );
+
+  /** Decide on and allocate the shared joint histograms, see UseSharedJointPDFs. */
+  void InitializeSharedJointPDFs( const SizeValueType numberOfSamples ) const;
+
+  /** The shared joint histograms, each one padded to a whole number of cache lines.
+   * m_NumberOfSharedJointPDFs == 0 means that every thread has its own histogram.
+   */
+  typedef std::atomic< PDFValueType > SharedJointPDFValueType;
+  mutable std::unique_ptr< SharedJointPDFValueType[] > m_SharedJointPDFs;
+  mutable SizeValueType                                m_SharedJointPDFsSize;
+  mutable SizeValueType                                m_SharedJointPDFStride;
+  mutable ThreadIdType                                 m_NumberOfSharedJointPDFs;
+  mutable bool                                         m_SharedJointPDFsAreZero;
+
+  /** Add a pixel pair to a shared joint histogram, using atomic additions. */
+  void UpdateSharedJointPDF(
+    const RealType & fixedImageValue,
+    const RealType & movingImageValue,
+    SharedJointPDFValueType * sharedJointPDF ) const;
+
+  /** Get the joint histogram that a thread of ComputePDFs() adds its samples to:
+   * its own one, which is zeroed if needed, or a shared one, which is returned
+   * in sharedJointPDF (and then the function returns nullptr).
+   */
+  JointPDFType * GetThreaderJointPDF( ThreadIdType threadId, SharedJointPDFValueType * & sharedJointPDF ) const;
+
+  /** Add a pixel pair to the joint histogram returned by GetThreaderJointPDF(). */
+  inline void UpdateThreaderJointPDF(
+    const RealType & fixedImageValue,
+    const RealType & movingImageValue,
+    JointPDFType * jointPDF,
+    SharedJointPDFValueType * sharedJointPDF ) const;
+
   /** Compute the Parzen values given an image value and a starting histogram index
    * Compute the values at (parzenWindowIndex - parzenWindowTerm + k) for
    * k = 0 ... kernelsize-1
@@ -463,6 +540,10 @@ protected:
 
   virtual void InitializeKernels( void );
 
+  /** Create a TabulatedKernelFunction for a kernel, used by InitializeKernels(). */
+  KernelFunctionPointer CreateTabulatedKernel( const KernelFunctionType * kernel,
+    const unsigned int supportSize, const double domainStart ) const;
+
   /** Get the value and analytic derivatives for single valued optimizers.
    * Called by GetValueAndDerivative if UseFiniteDifferenceDerivative == false
    * Implement this method in subclasses.
@@ -495,6 +576,8 @@ private:
   unsigned int  m_MovingKernelBSplineOrder;
   bool          m_UseDerivative;
   bool          m_UseExplicitPDFDerivatives;
+  bool          m_UseTabulatedKernels;
+  bool          m_UseSharedJointPDFs;
   bool          m_UseFiniteDifferenceDerivative;
   double        m_FiniteDifferencePerturbation;
 
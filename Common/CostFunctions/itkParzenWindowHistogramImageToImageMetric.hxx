@@ -22,9 +22,11 @@
 
 #include "itkBSplineKernelFunction2.h"
 #include "itkBSplineDerivativeKernelFunction2.h"
+#include "itkTabulatedKernelFunction.h"
 #include "itkImageLinearIteratorWithIndex.h"
 #include "itkImageScanlineIterator.h"
 #include "vnl/vnl_math.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -64,10 +66,13 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   this->m_FiniteDifferencePerturbation  = 1.0;
 
   this->SetUseImageSampler( true );
+  this->SetUseImageSampleArrays( true );
   this->SetUseFixedImageLimiter( true );
   this->SetUseMovingImageLimiter( true );
 
   this->m_UseExplicitPDFDerivatives = true;
+  this->m_UseTabulatedKernels       = false;
+  this->m_UseSharedJointPDFs        = false;
 
   /** Initialize the m_ParzenWindowHistogramThreaderParameters */
   this->m_ParzenWindowHistogramThreaderParameters.m_Metric = this;
@@ -75,6 +80,10 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   // Multi-threading structs
   this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables     = nullptr;
   this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariablesSize = 0;
+  this->m_SharedJointPDFsSize                                              = 0;
+  this->m_SharedJointPDFStride                                             = 0;
+  this->m_NumberOfSharedJointPDFs                                          = 0;
+  this->m_SharedJointPDFsAreZero                                           = false;
 
 } // end Constructor
 
@@ -112,6 +121,10 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
      << this->m_FixedKernelBSplineOrder << std::endl;
   os << indent << "MovingKernelBSplineOrder: "
      << this->m_MovingKernelBSplineOrder << std::endl;
+  os << indent << "UseTabulatedKernels: "
+     << this->m_UseTabulatedKernels << std::endl;
+  os << indent << "UseSharedJointPDFs: "
+     << this->m_UseSharedJointPDFs << std::endl;
 
   /*double m_MovingImageNormalizedMin;
   double m_FixedImageNormalizedMin;
@@ -129,6 +142,35 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 } // end PrintSelf()
 
 
+/**
+ * ********************* CopySettingsToClone ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::CopySettingsToClone( Self * clone ) const
+{
+  if( !this->Superclass::CopySettingsToClone( clone ) )
+  {
+    return false;
+  }
+
+  clone->m_NumberOfFixedHistogramBins    = this->m_NumberOfFixedHistogramBins;
+  clone->m_NumberOfMovingHistogramBins   = this->m_NumberOfMovingHistogramBins;
+  clone->m_FixedKernelBSplineOrder       = this->m_FixedKernelBSplineOrder;
+  clone->m_MovingKernelBSplineOrder      = this->m_MovingKernelBSplineOrder;
+  clone->m_UseDerivative                 = this->m_UseDerivative;
+  clone->m_UseExplicitPDFDerivatives     = this->m_UseExplicitPDFDerivatives;
+  clone->m_UseTabulatedKernels           = this->m_UseTabulatedKernels;
+  clone->m_UseSharedJointPDFs            = this->m_UseSharedJointPDFs;
+  clone->m_UseFiniteDifferenceDerivative = this->m_UseFiniteDifferenceDerivative;
+  clone->m_FiniteDifferencePerturbation  = this->m_FiniteDifferencePerturbation;
+  return true;
+
+} // end CopySettingsToClone()
+
+
 /**
  * ********************* Initialize *****************************
  */
@@ -438,9 +480,47 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   this->m_MovingParzenTermToIndexOffset
     = 0.5 - static_cast< double >( this->m_MovingKernelBSplineOrder ) / 2.0;
 
+  /** Optionally replace the kernels by lookup tables. EvaluateParzenValues()
+   * evaluates a kernel at u = ParzenIndex - ParzenTerm, which lies in
+   * ( ParzenTermToIndexOffset - 1, ParzenTermToIndexOffset ]. On that interval
+   * the weights of the cubic B-spline are smooth. Only the cubic kernels are
+   * tabulated: the lower order kernels and the derivative of the cubic kernel
+   * are (piecewise) quadratic at most, and cheaper to evaluate directly.
+   */
+  if( this->m_UseTabulatedKernels )
+  {
+    if( this->m_FixedKernelBSplineOrder == 3 )
+    {
+      this->m_FixedKernel = this->CreateTabulatedKernel( this->m_FixedKernel,
+        this->m_FixedKernelBSplineOrder + 1, this->m_FixedParzenTermToIndexOffset - 1.0 );
+    }
+    if( this->m_MovingKernelBSplineOrder == 3 )
+    {
+      this->m_MovingKernel = this->CreateTabulatedKernel( this->m_MovingKernel,
+        this->m_MovingKernelBSplineOrder + 1, this->m_MovingParzenTermToIndexOffset - 1.0 );
+    }
+  }
+
 } // end InitializeKernels()
 
 
+/**
+ * ****************** CreateTabulatedKernel *****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >::KernelFunctionPointer
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::CreateTabulatedKernel( const KernelFunctionType * kernel,
+  const unsigned int supportSize, const double domainStart ) const
+{
+  TabulatedKernelFunction::Pointer tabulatedKernel = TabulatedKernelFunction::New();
+  tabulatedKernel->Initialize( kernel, supportSize, domainStart );
+  return tabulatedKernel.GetPointer();
+
+} // end CreateTabulatedKernel()
+
+
 /**
  * ********************* InitializeThreadingParameters ****************************
  */
@@ -479,6 +559,10 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables
       = new AlignedParzenWindowHistogramGetValueAndDerivativePerThreadStruct[
       numberOfThreads ];
+    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+    {
+      this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDFIsZero = false;
+    }
     this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariablesSize = numberOfThreads;
   }
 
@@ -487,13 +571,14 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   {
     this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
 
-    // Initialize the joint pdf
+    // Initialize the joint pdf; it is zeroed in the thread that first uses it.
     JointPDFPointer & jointPDF = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF;
     if( jointPDF.IsNull() ) { jointPDF = JointPDFType::New(); }
     if( jointPDF->GetLargestPossibleRegion() != jointPDFRegion )
     {
       jointPDF->SetRegions( jointPDFRegion );
       jointPDF->Allocate();
+      this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDFIsZero = false;
     }
   }
 
@@ -528,6 +613,12 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValueAndDerivative( const ParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
+  /** Reuse the result of a previous evaluation at the same parameters. */
+  if( this->GetCachedValueAndDerivative( parameters, value, derivative ) )
+  {
+    return;
+  }
+
   if( this->GetUseFiniteDifferenceDerivative() )
   {
     this->GetValueAndFiniteDifferenceDerivative( parameters, value, derivative );
@@ -536,6 +627,8 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   {
     this->GetValueAndAnalyticDerivative( parameters, value, derivative );
   }
+  this->SetCachedValueAndDerivative( parameters, value, derivative );
+
 } // end GetValueAndDerivative()
 
 
@@ -1108,6 +1201,118 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 } // end ComputePDFsSingleThreaded()
 
 
+/**
+ * ******************* InitializeSharedJointPDFs *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeSharedJointPDFs( const SizeValueType numberOfSamples ) const
+{
+  const ThreadIdType  numberOfThreads = Self::GetNumberOfWorkUnits();
+  const SizeValueType numberOfBins
+    = this->m_NumberOfFixedHistogramBins * this->m_NumberOfMovingHistogramBins;
+
+  /** Private histograms cost numberOfThreads * numberOfBins to zero and merge.
+   * Share the histograms when that exceeds the number of samples, and choose
+   * their number such that zeroing and merging costs about numberOfSamples.
+   */
+  this->m_NumberOfSharedJointPDFs = 0;
+  if( !this->m_UseSharedJointPDFs || numberOfThreads < 2
+    || numberOfSamples >= numberOfThreads * numberOfBins )
+  {
+    return;
+  }
+  this->m_NumberOfSharedJointPDFs = static_cast< ThreadIdType >(
+    std::max( numberOfSamples / numberOfBins, static_cast< SizeValueType >( 1 ) ) );
+
+  /** Pad the histograms to whole cache lines, to prevent false sharing. */
+  const SizeValueType valuesPerCacheLine = ITK_CACHE_LINE_ALIGNMENT / sizeof( PDFValueType );
+  this->m_SharedJointPDFStride
+    = ( ( numberOfBins + valuesPerCacheLine - 1 ) / valuesPerCacheLine ) * valuesPerCacheLine;
+
+  /** Only reallocate when the histograms grow. They are zeroed by every
+   * merge, so they only need to be initialized here after (re)allocation,
+   * or after an aborted iteration.
+   */
+  const SizeValueType size = this->m_NumberOfSharedJointPDFs * this->m_SharedJointPDFStride;
+  if( size > this->m_SharedJointPDFsSize )
+  {
+    this->m_SharedJointPDFs.reset( new SharedJointPDFValueType[ size ] );
+    this->m_SharedJointPDFsSize    = size;
+    this->m_SharedJointPDFsAreZero = false;
+  }
+  if( !this->m_SharedJointPDFsAreZero )
+  {
+    for( SizeValueType i = 0; i < this->m_SharedJointPDFsSize; ++i )
+    {
+      this->m_SharedJointPDFs[ i ].store( NumericTraits< PDFValueType >::ZeroValue(), std::memory_order_relaxed );
+    }
+  }
+  this->m_SharedJointPDFsAreZero = false;
+
+} // end InitializeSharedJointPDFs()
+
+
+/**
+ * ********************** UpdateSharedJointPDF ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateSharedJointPDF(
+  const RealType & fixedImageValue,
+  const RealType & movingImageValue,
+  SharedJointPDFValueType * sharedJointPDF ) const
+{
+  /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
+  const double fixedImageParzenWindowTerm
+    = fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
+  const double movingImageParzenWindowTerm
+    = movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
+
+  /** The lowest bin numbers affected by this pixel: */
+  const OffsetValueType fixedImageParzenWindowIndex
+    = static_cast< OffsetValueType >( std::floor(
+    fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset ) );
+  const OffsetValueType movingImageParzenWindowIndex
+    = static_cast< OffsetValueType >( std::floor(
+    movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
+
+  /** The Parzen values; the kernels have a support of at most 4 bins. */
+  const unsigned int fixedParzenWindowSize  = this->m_JointPDFWindow.GetSize()[ 1 ];
+  const unsigned int movingParzenWindowSize = this->m_JointPDFWindow.GetSize()[ 0 ];
+  PDFValueType       fixedParzenValues[ 4 ];
+  PDFValueType       movingParzenValues[ 4 ];
+  this->m_FixedKernel->Evaluate( static_cast< double >( fixedImageParzenWindowIndex )
+    - fixedImageParzenWindowTerm, fixedParzenValues );
+  this->m_MovingKernel->Evaluate( static_cast< double >( movingImageParzenWindowIndex )
+    - movingImageParzenWindowTerm, movingParzenValues );
+
+  /** Loop over the Parzen window region and increment the values. The joint
+   * histogram is stored with the moving image bins along the rows.
+   */
+  const OffsetValueType     rowSize = this->m_NumberOfMovingHistogramBins;
+  SharedJointPDFValueType * row     = sharedJointPDF
+    + fixedImageParzenWindowIndex * rowSize + movingImageParzenWindowIndex;
+  for( unsigned int f = 0; f < fixedParzenWindowSize; ++f, row += rowSize )
+  {
+    const PDFValueType fv = fixedParzenValues[ f ];
+    for( unsigned int m = 0; m < movingParzenWindowSize; ++m )
+    {
+      const PDFValueType increment = fv * movingParzenValues[ m ];
+      PDFValueType       current   = row[ m ].load( std::memory_order_relaxed );
+      while( !row[ m ].compare_exchange_weak( current, current + increment, std::memory_order_relaxed ) )
+      {
+      }
+    }
+  }
+
+} // end UpdateSharedJointPDF()
+
+
 /**
  * ************************ ComputePDFs **************************
  */
@@ -1148,88 +1353,125 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 
 
 /**
- * ******************* ThreadedComputePDFs *******************
+ * ******************* GetThreaderJointPDF *******************
  */
 
 template< class TFixedImage, class TMovingImage >
-void
+typename ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >::JointPDFType *
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
-::ThreadedComputePDFs( ThreadIdType threadId )
+::GetThreaderJointPDF( ThreadIdType threadId, SharedJointPDFValueType * & sharedJointPDF ) const
 {
-  /** Get a handle to the pre-allocated joint PDF for the current thread.
-   * The initialization is performed here, so that it is done multi-threadedly
+  /** With shared joint histograms, this thread adds to one of those. */
+  if( this->m_NumberOfSharedJointPDFs > 0 )
+  {
+    sharedJointPDF = this->m_SharedJointPDFs.get()
+      + ( threadId % this->m_NumberOfSharedJointPDFs ) * this->m_SharedJointPDFStride;
+    return nullptr;
+  }
+
+  /** Otherwise it uses its pre-allocated joint PDF. The histograms are zeroed
+   * by ThreadedMergeJointPDFs(), so they only need to be initialized here after
+   * (re)allocation, or after an aborted iteration. This is done multi-threadedly
    * instead of sequentially in InitializeThreadingParameters().
    */
-  JointPDFPointer & jointPDF = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ].st_JointPDF;
-  jointPDF->FillBuffer( NumericTraits< PDFValueType >::ZeroValue() );
+  sharedJointPDF = nullptr;
+  AlignedParzenWindowHistogramGetValueAndDerivativePerThreadStruct & threaderVariables
+    = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ];
+  if( !threaderVariables.st_JointPDFIsZero )
+  {
+    threaderVariables.st_JointPDF->FillBuffer( NumericTraits< PDFValueType >::ZeroValue() );
+  }
+  threaderVariables.st_JointPDFIsZero = false;
+  return threaderVariables.st_JointPDF.GetPointer();
 
-  /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
+} // end GetThreaderJointPDF()
 
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
 
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+/**
+ * ******************* UpdateThreaderJointPDF *******************
+ */
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->Begin();
-  fbegin                                                 += (int)pos_begin;
-  fend                                                   += (int)pos_end;
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateThreaderJointPDF(
+  const RealType & fixedImageValue,
+  const RealType & movingImageValue,
+  JointPDFType * jointPDF,
+  SharedJointPDFValueType * sharedJointPDF ) const
+{
+  if( sharedJointPDF )
+  {
+    this->UpdateSharedJointPDF( fixedImageValue, movingImageValue, sharedJointPDF );
+  }
+  else
+  {
+    this->UpdateJointPDFAndDerivatives(
+      fixedImageValue, movingImageValue, 0, 0, jointPDF );
+  }
 
-  /** Create variables to store intermediate results. circumvent false sharing */
-  unsigned long numberOfPixelsCounted = 0;
+} // end UpdateThreaderJointPDF()
 
-  /** Loop over sample container and compute contribution of each sample to pdfs. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+/**
+ * ******************* ThreadedComputePDFs *******************
+ */
 
-    /** Check if point is inside mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputePDFs( ThreadIdType threadId )
+{
+  /** Get a handle to the joint PDF that this thread adds to. */
+  SharedJointPDFValueType * sharedJointPDF = nullptr;
+  JointPDFType *            jointPDF       = this->GetThreaderJointPDF( threadId, sharedJointPDF );
 
-    /** Compute the moving image value and check if the point is
-     * inside the moving image buffer.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, 0 );
-    }
+  /** Get a handle to the samples in the structure-of-arrays layout. */
+  typedef typename ImageSampleArrayContainerType::ImageValueType FixedImageValueType;
+  const ImageSampleArrayContainerType * sampleArrays     = this->m_ImageSampleArrays.GetPointer();
+  const FixedImageValueType *           fixedImageValues = sampleArrays->GetImageValues();
 
-    if( sampleOk )
+  /** Create variables to store intermediate results. circumvent false sharing */
+  unsigned long numberOfPixelsCounted = 0;
+
+  /** Buffers for one batch of samples. */
+  RealType      movingImageValues[ Superclass::SampleBatchSize ];
+  unsigned char sampleOk[ Superclass::SampleBatchSize ];
+
+  /** Loop over the chunks of samples handed out by the scheduler. */
+  unsigned long pos_begin, pos_end;
+  while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
+  {
+    /** Loop over the chunk in batches and compute the contribution of each sample to pdfs. */
+    for( unsigned long batch_begin = pos_begin; batch_begin < pos_end; batch_begin += Superclass::SampleBatchSize )
     {
-      numberOfPixelsCounted++;
+      const unsigned long batch_end = std::min( batch_begin + Superclass::SampleBatchSize, pos_end );
+      const unsigned long batchSize = batch_end - batch_begin;
 
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+      /** Compute the moving image values M(T(x)) of the batch. */
+      numberOfPixelsCounted += this->EvaluateMovingImageValuesBatch(
+        batch_begin, batch_end, movingImageValues, sampleOk );
 
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
-      movingImageValue = this->GetMovingImageLimiter()->Evaluate( movingImageValue );
+      /** Add the valid samples of the batch to the joint pdf. */
+      const FixedImageValueType * fixedBatch = fixedImageValues + batch_begin;
+      for( unsigned long i = 0; i < batchSize; ++i )
+      {
+        if( !sampleOk[ i ] )
+        {
+          continue;
+        }
 
-      /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateJointPDFAndDerivatives(
-        fixedImageValue, movingImageValue, 0, 0,
-        jointPDF.GetPointer() );
-    }
-  } // end iterating over fixed image spatial sample container for loop
+        /** Make sure the values fall within the histogram range. */
+        const RealType fixedImageValue = this->GetFixedImageLimiter()->Evaluate(
+          static_cast< RealType >( fixedBatch[ i ] ) );
+        const RealType movingImageValue = this->GetMovingImageLimiter()->Evaluate(
+          movingImageValues[ i ] );
+
+        /** Compute this sample's contribution to the joint distributions. */
+        this->UpdateThreaderJointPDF( fixedImageValue, movingImageValue, jointPDF, sharedJointPDF );
+      }
+    } // end for loop over the batches
+  } // end while over the sample chunks
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -1248,6 +1490,11 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 {
   const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
 
+  /** Accumulate the joint histograms. This is done first, since it also
+   * resets the histograms of the threads for the next iteration.
+   */
+  this->LaunchMergeJointPDFsThreaderCallback();
+
   /** Accumulate the number of pixels. */
   this->m_NumberOfPixelsCounted
     = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ 0 ].st_NumberOfPixelsCounted;
@@ -1268,82 +1515,191 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Compute alpha. */
   this->m_Alpha = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
 
-  /** Accumulate joint histogram. */
-  // could be multi-threaded too, by each thread updating only a part of the JointPDF.
-  typedef ImageScanlineIterator< JointPDFType > JointPDFIteratorType;
-  JointPDFIteratorType                it( this->m_JointPDF, this->m_JointPDF->GetBufferedRegion() );
-  std::vector< JointPDFIteratorType > itT( numberOfThreads );
-  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+} // end AfterThreadedComputePDFs()
+
+
+/**
+ * **************** ComputePDFsThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePDFsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  ParzenWindowHistogramMultiThreaderParameterType * temp
+    = static_cast< ParzenWindowHistogramMultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedComputePDFs( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputePDFsThreaderCallback()
+
+
+/**
+ * *********************** LaunchComputePDFsThreaderCallback***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::LaunchComputePDFsThreaderCallback( void ) const
+{
+  const SizeValueType numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+
+  /** Decide whether the threads share their joint histograms. */
+  this->InitializeSharedJointPDFs( numberOfSamples );
+
+  /** Distribute the samples over the threads. */
+  this->InitializeSampleChunkScheduler( numberOfSamples );
+
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( this->ComputePDFsThreaderCallback,
+    const_cast< void * >( static_cast< const void * >(
+      &this->m_ParzenWindowHistogramThreaderParameters ) ) );
+
+  /** Launch. */
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchComputePDFsThreaderCallback()
+
+
+/**
+ * ******************* ThreadedMergeJointPDFs *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedMergeJointPDFs( ThreadIdType threadId, ThreadIdType numberOfThreads ) const
+{
+  /** The range of bins of this thread, in whole cache lines. */
+  const SizeValueType numberOfBins       = this->m_JointPDF->GetPixelContainer()->Size();
+  const SizeValueType valuesPerCacheLine = ITK_CACHE_LINE_ALIGNMENT / sizeof( PDFValueType );
+  const SizeValueType numberOfLines      = ( numberOfBins + valuesPerCacheLine - 1 ) / valuesPerCacheLine;
+  const SizeValueType subSize            = ( ( numberOfLines + numberOfThreads - 1 ) / numberOfThreads ) * valuesPerCacheLine;
+  const SizeValueType binBegin           = std::min( threadId * subSize, numberOfBins );
+  const SizeValueType binEnd             = std::min( binBegin + subSize, numberOfBins );
+
+  const PDFValueType zero     = NumericTraits< PDFValueType >::ZeroValue();
+  PDFValueType *     jointPDF = this->m_JointPDF->GetBufferPointer();
+
+  /** Shared histograms: just add the few histograms, and reset them. */
+  if( this->m_NumberOfSharedJointPDFs > 0 )
   {
-    itT[ i ] = JointPDFIteratorType(
-      this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF,
-      this->m_JointPDF->GetBufferedRegion() );
+    for( SizeValueType b = binBegin; b < binEnd; ++b )
+    {
+      PDFValueType sum = zero;
+      for( ThreadIdType i = 0; i < this->m_NumberOfSharedJointPDFs; ++i )
+      {
+        SharedJointPDFValueType & value = this->m_SharedJointPDFs[ i * this->m_SharedJointPDFStride + b ];
+        sum += value.load( std::memory_order_relaxed );
+        value.store( zero, std::memory_order_relaxed );
+      }
+      jointPDF[ b ] = sum;
+    }
+    return;
   }
 
-  PDFValueType sum;
-  while( !it.IsAtEnd() )
+  /** Private histograms: add them pairwise, block by block, so that the
+   * blocks of all histograms stay in cache. Every addition also zeroes the
+   * added block, and the final copy zeroes the first histogram, so that the
+   * histograms are ready for the next iteration.
+   */
+  const ThreadIdType numberOfHistograms
+    = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariablesSize;
+  std::vector< PDFValueType * > histograms( numberOfHistograms );
+  for( ThreadIdType i = 0; i < numberOfHistograms; ++i )
   {
-    while( !it.IsAtEndOfLine() )
+    histograms[ i ] = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF->GetBufferPointer();
+  }
+
+  for( SizeValueType blockBegin = binBegin; blockBegin < binEnd; blockBegin += Self::JointPDFMergeBlockSize )
+  {
+    const SizeValueType blockEnd = std::min( blockBegin + Self::JointPDFMergeBlockSize, binEnd );
+    for( ThreadIdType stride = 1; stride < numberOfHistograms; stride *= 2 )
     {
-      sum = NumericTraits< PDFValueType >::Zero;
-      for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+      for( ThreadIdType i = 0; i + stride < numberOfHistograms; i += 2 * stride )
       {
-        sum += itT[ i ].Value();
-        ++itT[ i ];
+        PDFValueType * target = histograms[ i ];
+        PDFValueType * source = histograms[ i + stride ];
+        for( SizeValueType b = blockBegin; b < blockEnd; ++b )
+        {
+          target[ b ] += source[ b ];
+          source[ b ]  = zero;
+        }
       }
-      it.Set( sum );
-      ++it;
     }
-    it.NextLine();
-    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+
+    PDFValueType * result = histograms[ 0 ];
+    for( SizeValueType b = blockBegin; b < blockEnd; ++b )
     {
-      itT[ i ].NextLine();
+      jointPDF[ b ] = result[ b ];
+      result[ b ]   = zero;
     }
   }
 
-} // end AfterThreadedComputePDFs()
+} // end ThreadedMergeJointPDFs()
 
 
 /**
- * **************** ComputePDFsThreaderCallback *******
+ * **************** MergeJointPDFsThreaderCallback *******
  */
 
 template< class TFixedImage, class TMovingImage >
 ITK_THREAD_RETURN_TYPE
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
-::ComputePDFsThreaderCallback( void * arg )
+::MergeJointPDFsThreaderCallback( void * arg )
 {
-  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
-  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+  ThreadInfoType * infoStruct      = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId        = infoStruct->WorkUnitID;
+  ThreadIdType     numberOfThreads = infoStruct->NumberOfWorkUnits;
 
   ParzenWindowHistogramMultiThreaderParameterType * temp
     = static_cast< ParzenWindowHistogramMultiThreaderParameterType * >( infoStruct->UserData );
 
-  temp->m_Metric->ThreadedComputePDFs( threadId );
+  temp->m_Metric->ThreadedMergeJointPDFs( threadId, numberOfThreads );
 
   return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
 
-} // end ComputePDFsThreaderCallback()
+} // end MergeJointPDFsThreaderCallback()
 
 
 /**
- * *********************** LaunchComputePDFsThreaderCallback***************
+ * *********************** LaunchMergeJointPDFsThreaderCallback***************
  */
 
 template< class TFixedImage, class TMovingImage >
 void
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
-::LaunchComputePDFsThreaderCallback( void ) const
+::LaunchMergeJointPDFsThreaderCallback( void ) const
 {
   /** Setup threader. */
-  this->m_Threader->SetSingleMethod( this->ComputePDFsThreaderCallback,
+  this->m_Threader->SetSingleMethod( this->MergeJointPDFsThreaderCallback,
     const_cast< void * >( static_cast< const void * >(
       &this->m_ParzenWindowHistogramThreaderParameters ) ) );
 
   /** Launch. */
   this->m_Threader->SingleMethodExecute();
 
-} // end LaunchComputePDFsThreaderCallback()
+  /** All histograms that were used have been reset. */
+  if( this->m_NumberOfSharedJointPDFs > 0 )
+  {
+    this->m_SharedJointPDFsAreZero = true;
+  }
+  else
+  {
+    for( ThreadIdType i = 0; i < this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariablesSize; ++i )
+    {
+      this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDFIsZero = true;
+    }
+  }
+
+} // end LaunchMergeJointPDFsThreaderCallback()
 
 
 /**
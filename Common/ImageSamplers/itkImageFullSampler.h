@@ -96,6 +96,9 @@ protected:
   /** The destructor. */
   ~ImageFullSampler() override {}
 
+  /** Clone this sampler, see ImageSamplerBase::Clone(). */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
@@ -25,6 +25,22 @@
 namespace itk
 {
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template< class TInputImage >
+LightObject::Pointer
+ImageFullSampler< TInputImage >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  this->CopySettingsToClone( clone );
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
 /**
  * ******************* GenerateData *******************
  */
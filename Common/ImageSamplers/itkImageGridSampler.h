@@ -139,6 +139,9 @@ protected:
   /** The destructor. */
   ~ImageGridSampler() override {}
 
+  /** Clone this sampler, see ImageSamplerBase::Clone(). */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
@@ -57,6 +57,24 @@ ImageGridSampler< TInputImage >
 } // end SetSampleGridSpacing()
 
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template< class TInputImage >
+LightObject::Pointer
+ImageGridSampler< TInputImage >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  this->CopySettingsToClone( clone );
+  clone->m_SampleGridSpacing        = this->m_SampleGridSpacing;
+  clone->m_RequestedNumberOfSamples = this->m_RequestedNumberOfSamples;
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
 /**
  * ******************* GenerateData *******************
  */
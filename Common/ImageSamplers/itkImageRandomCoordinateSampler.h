@@ -33,6 +33,10 @@ namespace itk
  * This image sampler generates not only samples that correspond with
  * pixel locations, but selects points in physical space.
  *
+ * The multi-threaded version also supports a mask: every sample then draws
+ * its coordinates from its own counter-based random stream, until the point
+ * is inside the mask. See ImageRandomSamplerBase.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -114,6 +118,12 @@ protected:
   /** The destructor. */
   ~ImageRandomCoordinateSampler() override {}
 
+  /** Clone this sampler, see ImageSamplerBase::Clone(). The clone shares the
+   * interpolator, which is set up for the input image here, since setting up an
+   * interpolator while another sampler evaluates it is not thread-safe.
+   */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
@@ -137,6 +147,15 @@ protected:
   RandomGeneratorPointer m_RandomGenerator;
   InputImageSpacingType  m_SampleRegionSize;
 
+  /** Whether the interpolator is shared with the sampler that this one was
+   * cloned from, and already set up for the input image.
+   */
+  bool m_InterpolatorIsShared;
+
+  /** The corners of the sample region, used when threading. */
+  InputImageContinuousIndexType m_ThreaderSmallestContIndex;
+  InputImageContinuousIndexType m_ThreaderLargestContIndex;
+
   /** Generate the two corners of a sampling region, given the two corners
   * of an image. If UseRandomSampleRegion=false, the smallesPoint and largestPoint
   * are just copies of the smallestImagePoint and largestImagePoint
@@ -43,10 +43,37 @@ ImageRandomCoordinateSampler< TInputImage >
 
   this->m_UseRandomSampleRegion = false;
   this->m_SampleRegionSize.Fill( 1.0 );
+  this->m_InterpolatorIsShared = false;
 
 } // end Constructor
 
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template< class TInputImage >
+LightObject::Pointer
+ImageRandomCoordinateSampler< TInputImage >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  this->CopySettingsToClone( clone );
+  clone->m_SampleRegionSize      = this->m_SampleRegionSize;
+  clone->m_UseRandomSampleRegion = this->m_UseRandomSampleRegion;
+
+  /** Share the interpolator, which is only read while sampling. */
+  clone->m_Interpolator = this->m_Interpolator;
+  if( this->GetInput() )
+  {
+    clone->m_Interpolator->SetInputImage( this->GetInput() );
+    clone->m_InterpolatorIsShared = true;
+  }
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
 /**
  * ******************* GenerateData *******************
  */
@@ -56,9 +83,11 @@ void
 ImageRandomCoordinateSampler< TInputImage >
 ::GenerateData( void )
 {
-  /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version. */
+  /** Get a handle to the mask. The multi-threaded version supports masks
+   * by rejection sampling, see ThreadedGenerateData().
+   */
   typename MaskType::ConstPointer mask = this->GetMask();
-  if( mask.IsNull() && this->m_UseMultiThread )
+  if( this->m_UseMultiThread )
   {
     /** Calls ThreadedGenerateData(). */
     return Superclass::GenerateData();
@@ -70,7 +99,10 @@ ImageRandomCoordinateSampler< TInputImage >
   typename InterpolatorType::Pointer interpolator            = this->GetModifiableInterpolator();
 
   /** Set up the interpolator. */
-  interpolator->SetInputImage( inputImage ); // only once?
+  if( !this->m_InterpolatorIsShared )
+  {
+    interpolator->SetInputImage( inputImage ); // only once?
+  }
 
   /** Convert inputImageRegion to bounding box in physical space. */
   InputImageSizeType unitSize;
@@ -179,12 +211,11 @@ ImageRandomCoordinateSampler< TInputImage >
 ::BeforeThreadedGenerateData( void )
 {
   /** Set up the interpolator. */
-  typename InterpolatorType::Pointer interpolator = this->GetModifiableInterpolator();
-  interpolator->SetInputImage( this->GetInput() ); // only once per resolution?
-
-  /** Clear the random number list. */
-  this->m_RandomNumberList.resize( 0 );
-  this->m_RandomNumberList.reserve( this->m_NumberOfSamples * InputImageDimension );
+  if( !this->m_InterpolatorIsShared )
+  {
+    typename InterpolatorType::Pointer interpolator = this->GetModifiableInterpolator();
+    interpolator->SetInputImage( this->GetInput() ); // only once per resolution?
+  }
 
   /** Convert inputImageRegion to bounding box in physical space. */
   InputImageSizeType  unitSize; unitSize.Fill( 1 );
@@ -194,19 +225,15 @@ ImageRandomCoordinateSampler< TInputImage >
     = smallestIndex + this->GetCroppedInputImageRegion().GetSize() - unitSize;
   InputImageContinuousIndexType smallestImageCIndex( smallestIndex );
   InputImageContinuousIndexType largestImageCIndex( largestIndex );
-  InputImageContinuousIndexType smallestCIndex, largestCIndex, randomCIndex;
   this->GenerateSampleRegion( smallestImageCIndex, largestImageCIndex,
-    smallestCIndex, largestCIndex );
+    this->m_ThreaderSmallestContIndex, this->m_ThreaderLargestContIndex );
 
-  /** Fill the list with random numbers. */
-  for( unsigned long i = 0; i < this->m_NumberOfSamples; i++ )
+  /** The threads generate their own random coordinates. */
+  if( this->GetMask() )
   {
-    this->GenerateRandomCoordinate( smallestCIndex, largestCIndex, randomCIndex );
-    for( unsigned int j = 0; j < InputImageDimension; ++j )
-    {
-      this->m_RandomNumberList.push_back( randomCIndex[ j ] );
-    }
+    this->InitializeMaskedSampling();
   }
+  this->InitializeRandomStreams();
 
   /** Initialize variables needed for threads. */
   this->m_ThreaderSampleContainer.clear();
@@ -228,19 +255,14 @@ void
 ImageRandomCoordinateSampler< TInputImage >
 ::ThreadedGenerateData( const InputImageRegionType &, ThreadIdType threadId )
 {
-  /** Sanity check. */
+  /** Get handles to the mask, the input image and the interpolator. */
   typename MaskType::ConstPointer mask = this->GetMask();
-  if( mask.IsNotNull() )
-  {
-    itkExceptionMacro( << "ERROR: do not call this function when a mask is supplied." );
-  }
-
-  /** Get handle to the input image. */
-  InputImageConstPointer inputImage = this->GetInput();
+  InputImageConstPointer inputImage    = this->GetInput();
+  const InterpolatorType * interpolator = this->m_Interpolator.GetPointer();
 
   /** Figure out which samples to process. */
   unsigned long chunkSize   = this->GetNumberOfSamples() / this->GetNumberOfWorkUnits();
-  unsigned long sampleStart = threadId * chunkSize * InputImageDimension;
+  unsigned long sampleStart = threadId * chunkSize;
   if( threadId == this->GetNumberOfWorkUnits() - 1 )
   {
     chunkSize = this->GetNumberOfSamples()
@@ -256,23 +278,55 @@ ImageRandomCoordinateSampler< TInputImage >
   typename ImageSampleContainerType::Iterator iter;
   typename ImageSampleContainerType::ConstIterator end = sampleContainerThisThread->End();
 
+  /** Every sample draws its coordinates from its own counter-based random
+   * stream, so the result does not depend on the number of threads. With a
+   * mask, a sample draws new coordinates until the point is inside the mask.
+   */
+  const unsigned long maximumNumberOfSamplesToTry = 10 * this->GetNumberOfSamples();
+  unsigned long       numberOfSamplesTried        = 0;
+  const InputImageContinuousIndexType & smallestCIndex = this->m_ThreaderSmallestContIndex;
+  const InputImageContinuousIndexType & largestCIndex  = this->m_ThreaderLargestContIndex;
+
   /** Fill the local sample container. */
   InputImageContinuousIndexType sampleCIndex;
   unsigned long                 sampleId = sampleStart;
-  for( iter = sampleContainerThisThread->Begin(); iter != end; ++iter )
+  for( iter = sampleContainerThisThread->Begin(); iter != end; ++iter, ++sampleId )
   {
-    /** Create a random point out of InputImageDimension random numbers. */
-    for( unsigned int j = 0; j < InputImageDimension; ++j, sampleId++ )
-    {
-      sampleCIndex[ j ] = this->m_RandomNumberList[ sampleId ];
-    }
-
     /** Make a reference to the current sample in the container. */
     InputImagePointType &  samplePoint = ( *iter ).Value().m_ImageCoordinates;
     ImageSampleValueType & sampleValue = ( *iter ).Value().m_ImageValue;
 
-    /** Convert to point */
-    inputImage->TransformContinuousIndexToPhysicalPoint( sampleCIndex, samplePoint );
+    /** Walk over the image until we find a valid point. */
+    unsigned int counter = 0;
+    do
+    {
+      if( mask.IsNotNull() )
+      {
+        /** Check if we are not trying eternally to find a valid point. */
+        ++numberOfSamplesTried;
+        if( numberOfSamplesTried > maximumNumberOfSamplesToTry )
+        {
+          /** Squeeze the sample container to the size that is still valid. */
+          sampleContainerThisThread->erase(
+            sampleContainerThisThread->begin() + iter.Index(), sampleContainerThisThread->end() );
+          this->m_ThreaderNumberOfSamplesTried[ threadId ] = numberOfSamplesTried;
+          return;
+        }
+      }
+
+      /** Generate a point in the input image region. */
+      for( unsigned int j = 0; j < InputImageDimension; ++j )
+      {
+        const double randomVariate = this->GetSampleVariate( sampleId, counter++ );
+        sampleCIndex[ j ] = static_cast< InputImagePointValueType >( smallestCIndex[ j ]
+          + randomVariate * ( largestCIndex[ j ] - smallestCIndex[ j ] ) );
+      }
+
+      /** Convert to point */
+      inputImage->TransformContinuousIndexToPhysicalPoint( sampleCIndex, samplePoint );
+    }
+    while( mask.IsNotNull() && ( !interpolator->IsInsideBuffer( sampleCIndex )
+      || !mask->IsInsideInWorldSpace( samplePoint ) ) );
 
     /** Compute the value at the contindex. */
     sampleValue = static_cast< ImageSampleValueType >(
@@ -280,6 +334,11 @@ ImageRandomCoordinateSampler< TInputImage >
 
   } // end for loop
 
+  if( mask.IsNotNull() )
+  {
+    this->m_ThreaderNumberOfSamplesTried[ threadId ] = numberOfSamplesTried;
+  }
+
 } // end ThreadedGenerateData()
 
 
@@ -32,6 +32,11 @@ namespace itk
  * mask. If the mask is very sparse, this may take some time. In this case,
  * consider using the ImageRandomSamplerSparseMask.
  *
+ * The multi-threaded version also supports a mask. Every sample then draws a
+ * voxel from the list of voxels inside the mask (see ImageSamplerMaskIndex),
+ * using its own counter-based random stream, so the result is the same for
+ * any number of threads. See ImageRandomSamplerBase.
+ *
  * \ingroup ImageSamplers
  */
 
@@ -67,6 +72,7 @@ public:
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::MaskType                     MaskType;
+  typedef typename Superclass::MaskIndexType                MaskIndexType;
   typedef typename Superclass::InputImageSizeType           InputImageSizeType;
 
   /** The input image dimension. */
@@ -84,6 +90,9 @@ protected:
   /** The destructor. */
   ~ImageRandomSampler() override {}
 
+  /** Clone this sampler, see ImageSamplerBase::Clone(). */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** Functions that do the work. */
   void GenerateData( void ) override;
 
@@ -23,9 +23,27 @@
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkImageRandomConstIteratorWithIndex.h"
 
+#include <algorithm> // For min.
+
 namespace itk
 {
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template< class TInputImage >
+LightObject::Pointer
+ImageRandomSampler< TInputImage >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  this->CopySettingsToClone( clone );
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
 /**
  * ******************* GenerateData *******************
  */
@@ -35,10 +53,18 @@ void
 ImageRandomSampler< TInputImage >
 ::GenerateData( void )
 {
-  /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version. */
+  /** Get a handle to the mask. The multi-threaded version supports masks
+   * by drawing from the list of voxels inside the mask, see ThreadedGenerateData().
+   */
   typename MaskType::ConstPointer mask = this->GetMask();
-  if( mask.IsNull() && this->m_UseMultiThread )
+  if( this->m_UseMultiThread )
   {
+    if( mask.IsNotNull() && this->GetUpdatedMaskIndex()->Size() == 0 )
+    {
+      itkExceptionMacro( << "Could not find enough image samples within "
+                         << "reasonable time. Probably the mask is too small" );
+    }
+
     /** Calls ThreadedGenerateData(). */
     return Superclass::GenerateData();
   }
@@ -142,14 +168,8 @@ void
 ImageRandomSampler< TInputImage >
 ::ThreadedGenerateData( const InputImageRegionType &, ThreadIdType threadId )
 {
-  /** Sanity check. */
+  /** Get handles to the mask and the input image. */
   typename MaskType::ConstPointer mask = this->GetMask();
-  if( mask.IsNotNull() )
-  {
-    itkExceptionMacro( << "ERROR: do not call this function when a mask is supplied." );
-  }
-
-  /** Get handle to the input image. */
   InputImageConstPointer inputImage = this->GetInput();
 
   /** Figure out which samples to process. */
@@ -174,20 +194,39 @@ ImageRandomSampler< TInputImage >
   unsigned long       sampleId    = sampleStart;
   InputImageSizeType  regionSize  = this->GetCroppedInputImageRegion().GetSize();
   InputImageIndexType regionIndex = this->GetCroppedInputImageRegion().GetIndex();
+  const unsigned long numPixels   = this->GetCroppedInputImageRegion().GetNumberOfPixels();
+
+  /** Every sample draws its position from its own counter-based random stream,
+   * so the result does not depend on the number of threads. With a mask, the
+   * position is drawn from the list of voxels inside the mask.
+   */
+  const MaskIndexType * maskIndex = mask.IsNotNull() ? this->GetMaskIndex() : nullptr;
+
   for( iter = sampleContainerThisThread->Begin(); iter != end; ++iter, sampleId++ )
   {
-    unsigned long randomPosition = static_cast< unsigned long >( this->m_RandomNumberList[ sampleId ] );
-
-    /** Translate randomPosition to an index, copied from ImageRandomConstIteratorWithIndex. */
-    unsigned long       residual;
+    const double        randomVariate = this->GetSampleVariate( sampleId, 0 );
     InputImageIndexType positionIndex;
-    for( unsigned int dim = 0; dim < InputImageDimension; dim++ )
+    if( maskIndex )
+    {
+      const unsigned long numberOfValidSamples = maskIndex->Size();
+      maskIndex->GetIndex( std::min( static_cast< unsigned long >(
+        randomVariate * numberOfValidSamples ), numberOfValidSamples - 1 ), positionIndex );
+    }
+    else
     {
-      const unsigned long sizeInThisDimension = regionSize[ dim ];
-      residual             = randomPosition % sizeInThisDimension;
-      positionIndex[ dim ] = residual + regionIndex[ dim ];
-      randomPosition      -= residual;
-      randomPosition      /= sizeInThisDimension;
+      unsigned long randomPosition = std::min(
+        static_cast< unsigned long >( randomVariate * numPixels ), numPixels - 1 );
+
+      /** Translate randomPosition to an index, copied from ImageRandomConstIteratorWithIndex. */
+      unsigned long residual;
+      for( unsigned int dim = 0; dim < InputImageDimension; dim++ )
+      {
+        const unsigned long sizeInThisDimension = regionSize[ dim ];
+        residual             = randomPosition % sizeInThisDimension;
+        positionIndex[ dim ] = residual + regionIndex[ dim ];
+        randomPosition      -= residual;
+        randomPosition      /= sizeInThisDimension;
+      }
     }
 
     /** Transform index to the physical coordinates and put it in the sample. */
@@ -19,6 +19,7 @@
 #define __ImageRandomSamplerBase_h
 
 #include "itkImageSamplerBase.h"
+#include "itkPhiloxRandomVariateGenerator.h"
 
 namespace itk
 {
@@ -29,6 +30,14 @@ namespace itk
  *
  * It adds the Set/GetNumberOfSamples function.
  *
+ * In the multi-threaded version every sample draws its random numbers from
+ * its own counter-based random stream, see GetSampleVariate(). The stream of
+ * a sample only depends on a seed, the iteration and the sample number, so
+ * every thread generates its own samples directly, and the result is
+ * bit-identical for any number of threads. With a mask, a sample is drawn
+ * from the list of voxels inside the mask (ImageRandomSampler), or rejected
+ * until it falls inside the mask (ImageRandomCoordinateSampler).
+ *
  * \ingroup ImageSamplers
  */
 
@@ -63,11 +72,19 @@ public:
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::MaskType                     MaskType;
+  typedef typename Superclass::MaskIndexType                MaskIndexType;
 
   /** The input image dimension. */
   itkStaticConstMacro( InputImageDimension, unsigned int,
     Superclass::InputImageDimension );
 
+  /** Set the seed of the random streams of the multi-threaded version. The
+   * next run then starts the streams of this seed, instead of drawing a seed
+   * from the global random generator. This makes the samples of a clone of
+   * a sampler independent of the order in which the clones run.
+   */
+  virtual void SetRandomSeed( const uint64_t seed );
+
 protected:
 
   /** The constructor. */
@@ -79,11 +96,45 @@ protected:
   /** Multi-threaded function that does the work. */
   void BeforeThreadedGenerateData( void ) override;
 
+  /** Combines the thread results, and checks that all threads with a mask
+   * found their samples.
+   */
+  void AfterThreadedGenerateData( void ) override;
+
+  /** Prepares the multi-threaded masked sampling: updates the mask and
+   * resets the counters of the tried samples.
+   */
+  virtual void InitializeMaskedSampling( void );
+
+  /** Prepares the random streams of the samples for the next run: draws the
+   * seed from the global random generator on the first run, and increments
+   * the iteration on every next run. After SetRandomSeed() the streams of
+   * that seed are started instead.
+   */
+  virtual void InitializeRandomStreams( void );
+
+  /** The counter-th random number in [0,1) of sample sampleId, in the current
+   * iteration. Only depends on the seed, the iteration, the sample id and the
+   * counter, see PhiloxRandomVariateGenerator. Thread-safe.
+   */
+  double GetSampleVariate( const unsigned long sampleId, const unsigned int counter ) const
+  {
+    return PhiloxRandomVariateGenerator::GetUniformVariate(
+      this->m_ThreaderRandomSeed, sampleId, counter, this->m_ThreaderIteration );
+  }
+
+
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
-  /** Member variable used when threading. */
-  std::vector< double > m_RandomNumberList;
+  /** Member variables used when threading. */
+  uint64_t m_ThreaderRandomSeed;
+  uint32_t m_ThreaderIteration;
+  bool     m_ThreaderRandomStreamsInitialized;
+  bool     m_ThreaderRandomSeedIsSet;
+
+  /** Member variables used when threading with a mask. */
+  std::vector< unsigned long > m_ThreaderNumberOfSamplesTried;
 
 private:
 
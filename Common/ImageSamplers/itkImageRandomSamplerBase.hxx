@@ -34,39 +34,46 @@ template< class TInputImage >
 ImageRandomSamplerBase< TInputImage >
 ::ImageRandomSamplerBase()
 {
-  this->m_NumberOfSamples = 1000;
+  this->m_NumberOfSamples                  = 1000;
+  this->m_ThreaderRandomSeed               = 0;
+  this->m_ThreaderIteration                = 0;
+  this->m_ThreaderRandomStreamsInitialized = false;
+  this->m_ThreaderRandomSeedIsSet          = false;
 
 } // end Constructor
 
 
 /**
- * ******************* BeforeThreadedGenerateData *******************
+ * ******************* SetRandomSeed *******************
  */
 
 template< class TInputImage >
 void
 ImageRandomSamplerBase< TInputImage >
-::BeforeThreadedGenerateData( void )
+::SetRandomSeed( const uint64_t seed )
 {
-  /** Create a random number generator. Also used in the ImageRandomConstIteratorWithIndex. */
-  typedef typename Statistics::MersenneTwisterRandomVariateGenerator::Pointer GeneratorPointer;
-  GeneratorPointer localGenerator = Statistics::MersenneTwisterRandomVariateGenerator::GetInstance();
-  // \todo: should probably be global?
+  this->m_ThreaderRandomSeed      = seed;
+  this->m_ThreaderRandomSeedIsSet = true;
+  this->Modified();
 
-  /** Clear the random number list. */
-  this->m_RandomNumberList.resize( 0 );
-  this->m_RandomNumberList.reserve( this->m_NumberOfSamples );
+} // end SetRandomSeed()
 
-  /** Fill the list with random numbers. */
-  const double numPixels = static_cast< double >( this->GetCroppedInputImageRegion().GetNumberOfPixels() );
-  localGenerator->GetVariateWithOpenRange( numPixels - 0.5 ); // dummy jump
-  for( unsigned long i = 0; i < this->m_NumberOfSamples; i++ )
+
+/**
+ * ******************* BeforeThreadedGenerateData *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomSamplerBase< TInputImage >
+::BeforeThreadedGenerateData( void )
+{
+  /** The threads generate their own random positions. */
+  if( this->GetMask() )
   {
-    const double randomPosition
-      = localGenerator->GetVariateWithOpenRange( numPixels - 0.5 );
-    this->m_RandomNumberList.push_back( randomPosition );
+    this->InitializeMaskedSampling();
   }
-  localGenerator->GetVariateWithOpenRange( numPixels - 0.5 ); // dummy jump
+  this->InitializeRandomStreams();
 
   /** Initialize variables needed for threads. */
   Superclass::BeforeThreadedGenerateData();
@@ -74,6 +81,102 @@ ImageRandomSamplerBase< TInputImage >
 } // end BeforeThreadedGenerateData()
 
 
+/**
+ * ******************* AfterThreadedGenerateData *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomSamplerBase< TInputImage >
+::AfterThreadedGenerateData( void )
+{
+  /** Combine the results of all threads. */
+  const unsigned long numberOfSamplesRequested = this->m_NumberOfSamples;
+  Superclass::AfterThreadedGenerateData();
+
+  if( !this->GetMask() ) { return; }
+
+  /** Check if we were not trying eternally to find valid points. The number
+   * of samples tried is summed over all samples, so this check gives the same
+   * outcome for any number of threads.
+   */
+  const unsigned long maximumNumberOfSamplesToTry = 10 * numberOfSamplesRequested;
+  unsigned long       numberOfSamplesTried        = 0;
+  for( std::size_t i = 0; i < this->m_ThreaderNumberOfSamplesTried.size(); ++i )
+  {
+    numberOfSamplesTried += this->m_ThreaderNumberOfSamplesTried[ i ];
+  }
+
+  if( this->m_NumberOfSamples < numberOfSamplesRequested
+    || numberOfSamplesTried > maximumNumberOfSamplesToTry )
+  {
+    /** Restore the requested number of samples for the next run. */
+    this->m_NumberOfSamples = numberOfSamplesRequested;
+    itkExceptionMacro( << "Could not find enough image samples within "
+                       << "reasonable time. Probably the mask is too small" );
+  }
+
+} // end AfterThreadedGenerateData()
+
+
+/**
+ * ******************* InitializeMaskedSampling *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomSamplerBase< TInputImage >
+::InitializeMaskedSampling( void )
+{
+  /** Update the mask. */
+  typename MaskType::ConstPointer mask = this->GetMask();
+  if( mask->GetSource() )
+  {
+    mask->GetSource()->Update();
+  }
+
+  /** Reset the number of samples tried by each thread. */
+  this->m_ThreaderNumberOfSamplesTried.assign( this->GetNumberOfWorkUnits(), 0 );
+
+} // end InitializeMaskedSampling()
+
+
+/**
+ * ******************* InitializeRandomStreams *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomSamplerBase< TInputImage >
+::InitializeRandomStreams( void )
+{
+  if( this->m_ThreaderRandomSeedIsSet )
+  {
+    this->m_ThreaderIteration                = 0;
+    this->m_ThreaderRandomStreamsInitialized = true;
+    this->m_ThreaderRandomSeedIsSet          = false;
+    return;
+  }
+  if( this->m_ThreaderRandomStreamsInitialized )
+  {
+    ++this->m_ThreaderIteration;
+    return;
+  }
+
+  /** Draw the seed from the global generator, so that the sampling is
+   * reproducible given the seed of that generator.
+   */
+  typedef typename Statistics::MersenneTwisterRandomVariateGenerator::Pointer GeneratorPointer;
+  GeneratorPointer localGenerator = Statistics::MersenneTwisterRandomVariateGenerator::GetInstance();
+  const uint64_t   high           = localGenerator->GetIntegerVariate();
+  const uint64_t   low            = localGenerator->GetIntegerVariate();
+  this->m_ThreaderRandomSeed               = ( high << 32 ) | low;
+  this->m_ThreaderIteration                = 0;
+  this->m_ThreaderRandomStreamsInitialized = true;
+
+} // end InitializeRandomStreams()
+
+
 /**
  * ******************* PrintSelf *******************
  */
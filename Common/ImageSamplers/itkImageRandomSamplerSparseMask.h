@@ -20,7 +20,6 @@
 
 #include "itkImageRandomSamplerBase.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
-#include "itkImageFullSampler.h"
 
 namespace itk
 {
@@ -30,7 +29,9 @@ namespace itk
  *
  * This version takes into account that the mask may be very small.
  * Also, it may be more efficient when very many different sample sets
- * of the same input image are required, because it does some precomputation.
+ * of the same input image are required, because it does some precomputation:
+ * the list of voxels inside the mask is built once, see ImageSamplerMaskIndex,
+ * after which every sample is a single random draw from that list.
  * \ingroup ImageSamplers
  */
 
@@ -65,6 +66,8 @@ public:
   typedef typename Superclass::ImageSampleContainerType     ImageSampleContainerType;
   typedef typename Superclass::ImageSampleContainerPointer  ImageSampleContainerPointer;
   typedef typename Superclass::MaskType                     MaskType;
+  typedef typename Superclass::MaskIndexType                MaskIndexType;
+  typedef typename Superclass::ImageSampleValueType         ImageSampleValueType;
 
   /** The input image dimension. */
   itkStaticConstMacro( InputImageDimension, unsigned int,
@@ -80,14 +83,14 @@ public:
 
 protected:
 
-  typedef itk::ImageFullSampler< InputImageType >   InternalFullSamplerType;
-  typedef typename InternalFullSamplerType::Pointer InternalFullSamplerPointer;
-
   /** The constructor. */
   ImageRandomSamplerSparseMask();
   /** The destructor. */
   ~ImageRandomSamplerSparseMask() override {}
 
+  /** Clone this sampler, see ImageSamplerBase::Clone(). */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
@@ -101,8 +104,7 @@ protected:
     const InputImageRegionType & inputRegionForThread,
     ThreadIdType threadId ) override;
 
-  RandomGeneratorPointer     m_RandomGenerator;
-  InternalFullSamplerPointer m_InternalFullSampler;
+  RandomGeneratorPointer m_RandomGenerator;
 
 private:
 
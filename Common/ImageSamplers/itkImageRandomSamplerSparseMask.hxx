@@ -20,6 +20,8 @@
 
 #include "itkImageRandomSamplerSparseMask.h"
 
+#include <algorithm> // For min.
+
 namespace itk
 {
 
@@ -34,11 +36,25 @@ ImageRandomSamplerSparseMask< TInputImage >
   /** Setup random generator. */
   this->m_RandomGenerator = RandomGeneratorType::GetInstance();
 
-  this->m_InternalFullSampler = InternalFullSamplerType::New();
-
 } // end Constructor
 
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template< class TInputImage >
+LightObject::Pointer
+ImageRandomSamplerSparseMask< TInputImage >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  this->CopySettingsToClone( clone );
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
 /**
  * ******************* GenerateData *******************
  */
@@ -64,35 +80,13 @@ ImageRandomSamplerSparseMask< TInputImage >
   /** Clear the container. */
   sampleContainer->Initialize();
 
-  /** Make sure the internal full sampler is up-to-date. */
-  this->m_InternalFullSampler->SetInput( inputImage );
-  this->m_InternalFullSampler->SetMask( mask );
-  this->m_InternalFullSampler->SetInputImageRegion( this->GetCroppedInputImageRegion() );
-
-  /** Use try/catch, since the full sampler may crash, due to insufficient memory. */
-  try
-  {
-    this->m_InternalFullSampler->Update();
-  }
-  catch( ExceptionObject & err )
+  /** Make sure the list of voxels inside the mask is up-to-date.
+   * It is only rebuilt when the image, the mask or the region changed.
+   */
+  const MaskIndexType * maskIndex = this->GetUpdatedMaskIndex();
+  if( maskIndex->Size() == 0 )
   {
-    std::string message = "ERROR: This ImageSampler internally uses the "
-      "ImageFullSampler. Updating of this internal sampler raised the "
-      "exception:\n";
-    message += err.GetDescription();
-
-    std::string            fullSamplerMessage = err.GetDescription();
-    std::string::size_type loc                = fullSamplerMessage.find(
-      "ERROR: failed to allocate memory for the sample container", 0 );
-    if( loc != std::string::npos && this->GetMask() == 0 )
-    {
-      message += "\nYou are using the ImageRandomSamplerSparseMask sampler, "
-        "but you did not set a mask. The internal ImageFullSampler therefore "
-        "requires a lot of memory. Consider using the ImageRandomSampler "
-        "instead.";
-    }
-    const char * message2 = message.c_str();
-    itkExceptionMacro( << message2 );
+    itkExceptionMacro( << "ERROR: the mask does not contain any voxel of the InputImageRegion." );
   }
 
   /** If desired we exercise a multi-threaded version. */
@@ -102,17 +96,18 @@ ImageRandomSamplerSparseMask< TInputImage >
     return Superclass::GenerateData();
   }
 
-  /** Get a handle to the full sampler output. */
-  typename ImageSampleContainerType::Pointer allValidSamples
-    = this->m_InternalFullSampler->GetOutput();
-  unsigned long numberOfValidSamples = allValidSamples->Size();
-
-  /** Take random samples from the allValidSamples-container. */
+  /** Take random samples from the voxels inside the mask. */
+  const unsigned long numberOfValidSamples = maskIndex->Size();
+  sampleContainer->Reserve( this->GetNumberOfSamples() );
+  InputImageIndexType index;
   for( unsigned int i = 0; i < this->GetNumberOfSamples(); ++i )
   {
     unsigned long randomIndex
       = this->m_RandomGenerator->GetIntegerVariate( numberOfValidSamples - 1 );
-    sampleContainer->push_back( allValidSamples->ElementAt( randomIndex ) );
+    ImageSampleType & sample = sampleContainer->ElementAt( i );
+    maskIndex->GetIndex( randomIndex, index );
+    inputImage->TransformIndexToPhysicalPoint( index, sample.m_ImageCoordinates );
+    sample.m_ImageValue = static_cast< ImageSampleValueType >( inputImage->GetPixel( index ) );
   }
 
 } // end GenerateData()
@@ -127,21 +122,8 @@ void
 ImageRandomSamplerSparseMask< TInputImage >
 ::BeforeThreadedGenerateData( void )
 {
-  /** Clear the random number list. */
-  this->m_RandomNumberList.resize( 0 );
-  this->m_RandomNumberList.reserve( this->m_NumberOfSamples );
-
-  /** Get a handle to the full sampler output size. */
-  const unsigned long numberOfValidSamples
-    = this->m_InternalFullSampler->GetOutput()->Size();
-
-  /** Fill the list with random numbers. */
-  for( unsigned int i = 0; i < this->GetNumberOfSamples(); ++i )
-  {
-    unsigned long randomIndex
-      = this->m_RandomGenerator->GetIntegerVariate( numberOfValidSamples - 1 );
-    this->m_RandomNumberList.push_back( randomIndex );
-  }
+  /** The threads draw their own random indices. */
+  this->InitializeRandomStreams();
 
   /** Initialize variables needed for threads. */
   this->m_ThreaderSampleContainer.clear();
@@ -163,9 +145,10 @@ void
 ImageRandomSamplerSparseMask< TInputImage >
 ::ThreadedGenerateData( const InputImageRegionType &, ThreadIdType threadId )
 {
-  /** Get a handle to the full sampler output. */
-  typename ImageSampleContainerType::Pointer allValidSamples
-    = this->m_InternalFullSampler->GetOutput();
+  /** Get handles to the input image and the voxels inside the mask. */
+  InputImageConstPointer inputImage           = this->GetInput();
+  const MaskIndexType *  maskIndex            = this->GetMaskIndex();
+  const unsigned long    numberOfValidSamples = maskIndex->Size();
 
   /** Figure out which samples to process. */
   unsigned long chunkSize   = this->GetNumberOfSamples() / this->GetNumberOfWorkUnits();
@@ -185,12 +168,16 @@ ImageRandomSamplerSparseMask< TInputImage >
   typename ImageSampleContainerType::Iterator iter;
   typename ImageSampleContainerType::ConstIterator end = sampleContainerThisThread->End();
 
-  /** Take random samples from the allValidSamples-container. */
-  unsigned long sampleId = sampleStart;
+  /** Take random samples from the voxels inside the mask. */
+  unsigned long       sampleId = sampleStart;
+  InputImageIndexType index;
   for( iter = sampleContainerThisThread->Begin(); iter != end; ++iter, sampleId++ )
   {
-    unsigned long randomIndex = static_cast< unsigned long >( this->m_RandomNumberList[ sampleId ] );
-    ( *iter ).Value() = allValidSamples->ElementAt( randomIndex );
+    const unsigned long randomIndex = std::min( static_cast< unsigned long >(
+      this->GetSampleVariate( sampleId, 0 ) * numberOfValidSamples ), numberOfValidSamples - 1 );
+    maskIndex->GetIndex( randomIndex, index );
+    inputImage->TransformIndexToPhysicalPoint( index, ( *iter ).Value().m_ImageCoordinates );
+    ( *iter ).Value().m_ImageValue = static_cast< ImageSampleValueType >( inputImage->GetPixel( index ) );
   }
 
 } // end ThreadedGenerateData()
@@ -207,7 +194,7 @@ ImageRandomSamplerSparseMask< TInputImage >
 {
   Superclass::PrintSelf( os, indent );
 
-  os << indent << "InternalFullSampler: " << this->m_InternalFullSampler.GetPointer() << std::endl;
+  os << indent << "MaskIndex: " << this->m_MaskIndex.GetPointer() << std::endl;
   os << indent << "RandomGenerator: " << this->m_RandomGenerator.GetPointer() << std::endl;
 
 } // end PrintSelf()
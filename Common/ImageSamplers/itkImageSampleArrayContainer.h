@@ -0,0 +1,224 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageSampleArrayContainer_h
+#define __itkImageSampleArrayContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImageSample.h"
+#include "itkVectorDataContainer.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class ImageSampleArrayContainer
+ *
+ * \brief A structure-of-arrays version of the image sample container.
+ *
+ * The ImageSampleContainer stores the coordinates and the value of each sample
+ * together, i.e. interleaved. This class stores the same samples as one contiguous
+ * array per coordinate dimension, plus an array with the image values. Every array
+ * starts at a SIMD-friendly (cache line) aligned address, and is padded with zeros
+ * up to a multiple of the alignment. This is the layout that batched (vectorised)
+ * transformation, interpolation and metric loops need.
+ *
+ * The arrays are filled from an ImageSampleContainer by SetSamples(). The
+ * ImageSamplerBase uses this to expose its output in this layout, see
+ * ImageSamplerBase::GetOutputSampleArrays().
+ *
+ * \ingroup ImageSamplers
+ */
+
+template< class TImage >
+class ImageSampleArrayContainer : public Object
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef ImageSampleArrayContainer  Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ImageSampleArrayContainer, Object );
+
+  /** The image dimension. */
+  itkStaticConstMacro( ImageDimension, unsigned int, TImage::ImageDimension );
+
+  /** Typedefs. */
+  typedef TImage                                                ImageType;
+  typedef ImageSample< ImageType >                              ImageSampleType;
+  typedef VectorDataContainer< std::size_t, ImageSampleType >   ImageSampleContainerType;
+  typedef typename ImageSampleType::PointType                   PointType;
+  typedef typename PointType::ValueType                         CoordinateValueType;
+  typedef typename ImageSampleType::RealType                    ImageValueType;
+
+  /** The alignment in bytes of the start of every array. */
+  itkStaticConstMacro( Alignment, unsigned int, 64 );
+
+  /** Copy the samples of an ImageSampleContainer to the arrays. */
+  void SetSamples( const ImageSampleContainerType * samples )
+  {
+    const std::size_t numberOfSamples = samples->Size();
+    this->Allocate( numberOfSamples );
+
+    CoordinateValueType * coordinates[ ImageDimension ];
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      coordinates[ d ] = this->GetCoordinates( d );
+    }
+    ImageValueType * values = this->GetImageValues();
+
+    for( std::size_t i = 0; i < numberOfSamples; ++i )
+    {
+      const ImageSampleType & sample = samples->ElementAt( i );
+      for( unsigned int d = 0; d < ImageDimension; ++d )
+      {
+        coordinates[ d ][ i ] = sample.m_ImageCoordinates[ d ];
+      }
+      values[ i ] = sample.m_ImageValue;
+    }
+
+    this->Modified();
+  }
+
+
+  /** The number of samples. */
+  std::size_t Size( void ) const
+  {
+    return this->m_NumberOfSamples;
+  }
+
+
+  /** The allocated length of every array; a multiple of the alignment. */
+  std::size_t GetPaddedSize( void ) const
+  {
+    return this->m_CoordinateStride;
+  }
+
+
+  /** Get the aligned array with the coordinates of all samples in dimension d. */
+  const CoordinateValueType * GetCoordinates( const unsigned int d ) const
+  {
+    return this->m_AlignedCoordinates + d * this->m_CoordinateStride;
+  }
+
+
+  CoordinateValueType * GetCoordinates( const unsigned int d )
+  {
+    return this->m_AlignedCoordinates + d * this->m_CoordinateStride;
+  }
+
+
+  /** Get the aligned array with the image values of all samples. */
+  const ImageValueType * GetImageValues( void ) const
+  {
+    return this->m_AlignedImageValues;
+  }
+
+
+  ImageValueType * GetImageValues( void )
+  {
+    return this->m_AlignedImageValues;
+  }
+
+
+  /** Convenience function to get the coordinates of sample i as a point. */
+  void GetPoint( const std::size_t i, PointType & point ) const
+  {
+    for( unsigned int d = 0; d < ImageDimension; ++d )
+    {
+      point[ d ] = this->GetCoordinates( d )[ i ];
+    }
+  }
+
+
+protected:
+
+  ImageSampleArrayContainer() :
+    m_NumberOfSamples( 0 ),
+    m_CoordinateStride( 0 ),
+    m_AlignedCoordinates( nullptr ),
+    m_AlignedImageValues( nullptr )
+  {}
+
+  ~ImageSampleArrayContainer() override {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const override
+  {
+    Superclass::PrintSelf( os, indent );
+    os << indent << "NumberOfSamples: " << this->m_NumberOfSamples << std::endl;
+    os << indent << "PaddedSize: " << this->m_CoordinateStride << std::endl;
+  }
+
+
+  /** Allocate the arrays for numberOfSamples samples. Memory is only
+   * reallocated when the arrays grow.
+   */
+  void Allocate( const std::size_t numberOfSamples )
+  {
+    /** Round the array length up to a multiple of the alignment. */
+    const std::size_t perLine = Alignment / sizeof( CoordinateValueType ) > 0
+      ? Alignment / sizeof( CoordinateValueType ) : 1;
+    const std::size_t stride = ( ( numberOfSamples + perLine - 1 ) / perLine ) * perLine;
+
+    this->m_NumberOfSamples  = numberOfSamples;
+    this->m_CoordinateStride = stride;
+
+    /** Over-allocate, so that the arrays can start at an aligned address. */
+    this->m_CoordinateBuffer.assign( ImageDimension * stride + Alignment / sizeof( CoordinateValueType ) + 1, 0 );
+    this->m_ImageValueBuffer.assign( stride + Alignment / sizeof( ImageValueType ) + 1, 0 );
+    this->m_AlignedCoordinates = Self::AlignPointer( &this->m_CoordinateBuffer[ 0 ] );
+    this->m_AlignedImageValues = Self::AlignPointer( &this->m_ImageValueBuffer[ 0 ] );
+  }
+
+
+  /** Round a pointer up to the next multiple of the alignment. */
+  template< class T >
+  static T * AlignPointer( T * p )
+  {
+    const std::size_t address = reinterpret_cast< std::size_t >( p );
+    const std::size_t aligned = ( address + Alignment - 1 ) & ~static_cast< std::size_t >( Alignment - 1 );
+    return reinterpret_cast< T * >( aligned );
+  }
+
+
+private:
+
+  ImageSampleArrayContainer( const Self & ); // purposely not implemented
+  void operator=( const Self & );            // purposely not implemented
+
+  std::size_t                        m_NumberOfSamples;
+  std::size_t                        m_CoordinateStride;
+  std::vector< CoordinateValueType > m_CoordinateBuffer;
+  std::vector< ImageValueType >      m_ImageValueBuffer;
+  CoordinateValueType *              m_AlignedCoordinates;
+  ImageValueType *                   m_AlignedImageValues;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkImageSampleArrayContainer_h
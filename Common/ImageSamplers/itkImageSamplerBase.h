@@ -20,6 +20,8 @@
 
 #include "itkImageToVectorContainerFilter.h"
 #include "itkImageSample.h"
+#include "itkImageSampleArrayContainer.h"
+#include "itkImageSamplerMaskIndex.h"
 #include "itkVectorDataContainer.h"
 #include "itkSpatialObject.h"
 
@@ -87,6 +89,10 @@ public:
   typedef typename MaskType::ConstPointer                       MaskConstPointer;
   typedef std::vector< MaskConstPointer >                       MaskVectorType;
   typedef std::vector< InputImageRegionType >                   InputImageRegionVectorType;
+  typedef ImageSampleArrayContainer< InputImageType >           ImageSampleArrayContainerType;
+  typedef typename ImageSampleArrayContainerType::Pointer       ImageSampleArrayContainerPointer;
+  typedef ImageSamplerMaskIndex< InputImageType >               MaskIndexType;
+  typedef typename MaskIndexType::Pointer                       MaskIndexPointer;
 
   /** ******************** Masks ******************** */
 
@@ -171,13 +177,34 @@ public:
   /** \todo: Temporary, should think about interface. */
   itkSetMacro( UseMultiThread, bool );
 
+  /** Get the output samples in a structure-of-arrays layout: one aligned array
+   * per coordinate dimension plus an array of image values. The arrays are
+   * copied from GetOutput() when the output has been regenerated since the
+   * previous call, so call Update() first. Not thread-safe.
+   */
+  virtual const ImageSampleArrayContainerType * GetOutputSampleArrays( void );
+
+  /** Create a copy of this sampler, with the same input, masks, input image
+   * regions and settings, but with an output of its own, for example to sample
+   * in another thread. Only the samplers that override InternalClone() support
+   * this; for the others Clone() returns a null pointer.
+   */
+  itkCloneMacro( Self );
+
+  /** Get the list of the voxels inside the first mask, used by samplers
+   * that draw voxels inside the mask. It is shared by all samplers with the
+   * same input image, mask and cropped input image region, and rebuilt only
+   * when one of these changed, see ImageSamplerMaskIndex::GetSharedIndex().
+   */
+  itkGetModifiableObjectMacro( MaskIndex, MaskIndexType );
+
 protected:
 
   /** The constructor. */
   ImageSamplerBase();
 
   /** The destructor. */
-  ~ImageSamplerBase() override {}
+  ~ImageSamplerBase() override;
 
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
@@ -204,6 +231,20 @@ protected:
 
   void AfterThreadedGenerateData( void ) override;
 
+  /** Returns a null pointer, see Clone(). */
+  LightObject::Pointer InternalClone( void ) const override;
+
+  /** Copy the input, the masks, the input image regions, the number of samples
+   * and the threading settings to a clone, for InternalClone() of a subclass.
+   */
+  void CopySettingsToClone( Self * clone ) const;
+
+  /** Get the mask index, brought up-to-date with the input image, the first
+   * mask and the cropped input image region. The masks are updated first.
+   * Requires a mask.
+   */
+  const MaskIndexType * GetUpdatedMaskIndex( void );
+
   /***/
   unsigned long                              m_NumberOfSamples;
   std::vector< ImageSampleContainerPointer > m_ThreaderSampleContainer;
@@ -211,6 +252,13 @@ protected:
   //tmp?
   bool m_UseMultiThread;
 
+  /** The output in the structure-of-arrays layout, see GetOutputSampleArrays(). */
+  ImageSampleArrayContainerPointer m_OutputSampleArrays;
+  ModifiedTimeType                 m_OutputSampleArraysUpdateMTime;
+
+  /** The voxels inside the mask, see GetUpdatedMaskIndex(). */
+  MaskIndexPointer m_MaskIndex;
+
 private:
 
   /** The private constructor. */
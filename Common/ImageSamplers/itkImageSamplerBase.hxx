@@ -39,9 +39,28 @@ ImageSamplerBase< TInputImage >
   //tmp?
   this->m_UseMultiThread = false;
 
+  this->m_OutputSampleArrays            = 0;
+  this->m_OutputSampleArraysUpdateMTime = 0;
+  this->m_MaskIndex                     = 0;
+
 } // end Constructor()
 
 
+/**
+ * ******************* Destructor *******************
+ */
+
+template< class TInputImage >
+ImageSamplerBase< TInputImage >
+::~ImageSamplerBase()
+{
+  /** Release the mask index if no other sampler uses it anymore. */
+  this->m_MaskIndex = 0;
+  MaskIndexType::ReleaseUnusedSharedIndices();
+
+} // end Destructor
+
+
 /**
  * ******************* SetMask *******************
  */
@@ -254,6 +273,102 @@ ImageSamplerBase< TInputImage >
 } // end SelectNewSamplesOnUpdate()
 
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template< class TInputImage >
+LightObject::Pointer
+ImageSamplerBase< TInputImage >
+::InternalClone( void ) const
+{
+  /** A sampler of a subclass would lose the settings of the subclass,
+   * so cloning is only supported by the subclasses that copy them.
+   */
+  return LightObject::Pointer();
+
+} // end InternalClone()
+
+
+/**
+ * ******************* CopySettingsToClone *******************
+ */
+
+template< class TInputImage >
+void
+ImageSamplerBase< TInputImage >
+::CopySettingsToClone( Self * clone ) const
+{
+  clone->SetInput( this->GetInput() );
+  clone->m_Mask                      = this->m_Mask;
+  clone->m_MaskVector                = this->m_MaskVector;
+  clone->m_NumberOfMasks             = this->m_NumberOfMasks;
+  clone->m_InputImageRegion          = this->m_InputImageRegion;
+  clone->m_InputImageRegionVector    = this->m_InputImageRegionVector;
+  clone->m_NumberOfInputImageRegions = this->m_NumberOfInputImageRegions;
+  clone->m_NumberOfSamples           = this->m_NumberOfSamples;
+  clone->m_UseMultiThread            = this->m_UseMultiThread;
+  clone->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  clone->Modified();
+
+} // end CopySettingsToClone()
+
+
+/**
+ * ******************* GetOutputSampleArrays *******************
+ */
+
+template< class TInputImage >
+const typename ImageSamplerBase< TInputImage >::ImageSampleArrayContainerType *
+ImageSamplerBase< TInputImage >
+::GetOutputSampleArrays( void )
+{
+  if( this->m_OutputSampleArrays.IsNull() )
+  {
+    this->m_OutputSampleArrays = ImageSampleArrayContainerType::New();
+  }
+
+  /** Only copy the samples when the output has been regenerated. The update
+   * time of the output is set by the pipeline after every GenerateData().
+   */
+  const OutputVectorContainerType * output = this->GetOutput();
+  if( output->GetUpdateMTime() != this->m_OutputSampleArraysUpdateMTime
+    || output->Size() != this->m_OutputSampleArrays->Size() )
+  {
+    this->m_OutputSampleArrays->SetSamples( output );
+    this->m_OutputSampleArraysUpdateMTime = output->GetUpdateMTime();
+  }
+
+  return this->m_OutputSampleArrays.GetPointer();
+
+} // end GetOutputSampleArrays()
+
+
+/**
+ * ******************* GetUpdatedMaskIndex *******************
+ */
+
+template< class TInputImage >
+const typename ImageSamplerBase< TInputImage >::MaskIndexType *
+ImageSamplerBase< TInputImage >
+::GetUpdatedMaskIndex( void )
+{
+  /** The mask should be up-to-date before the voxels inside it are listed. */
+  this->UpdateAllMasks();
+
+  /** Get the index shared by the samplers with the same input image, mask and
+   * region. Update() does nothing if the index is still up-to-date.
+   */
+  this->m_MaskIndex = MaskIndexType::GetSharedIndex( this->GetInput(),
+    this->GetMask(), this->GetCroppedInputImageRegion() );
+  this->m_MaskIndex->Update( this->GetInput(), this->GetMask(),
+    this->GetCroppedInputImageRegion() );
+
+  return this->m_MaskIndex.GetPointer();
+
+} // end GetUpdatedMaskIndex()
+
+
 /**
  * ******************* IsInsideAllMasks *******************
  */
@@ -0,0 +1,185 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageSamplerMaskIndex_h
+#define __itkImageSamplerMaskIndex_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSpatialObject.h"
+
+#include <mutex>
+#include <vector>
+
+namespace itk
+{
+
+/** \class ImageSamplerMaskIndex
+ *
+ * \brief A list of the voxels of an image region that are inside a mask.
+ *
+ * Samplers that draw voxels inside a mask either check the mask for every
+ * candidate (rejection sampling), or visit the complete image region. This
+ * class visits the region once, and stores the position in the region of
+ * every voxel whose physical point is inside the mask, in raster order.
+ * Drawing a random voxel inside the mask is then a lookup in this list,
+ * see GetIndex().
+ *
+ * Update() only rebuilds the list when the image, the mask or the region
+ * changed, typically once per resolution. The list is shared by all samplers
+ * with the same input image, mask and region, see GetSharedIndex(), so that
+ * the region is only visited once for all of them. Update() is thread-safe.
+ *
+ * \ingroup ImageSamplers
+ */
+
+template< class TInputImage >
+class ImageSamplerMaskIndex : public Object
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef ImageSamplerMaskIndex      Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ImageSamplerMaskIndex, Object );
+
+  /** The image dimension. */
+  itkStaticConstMacro( InputImageDimension, unsigned int, TInputImage::ImageDimension );
+
+  /** Typedefs. */
+  typedef TInputImage                                InputImageType;
+  typedef typename InputImageType::IndexType         InputImageIndexType;
+  typedef typename InputImageType::PointType         InputImagePointType;
+  typedef typename InputImageType::RegionType        InputImageRegionType;
+  typedef SpatialObject< Self::InputImageDimension > MaskType;
+  typedef std::vector< SizeValueType >               PositionContainerType;
+
+  /** Get the list for the region of the image and the mask, shared by all
+   * callers that ask for the same image, mask and region. Lists that are no
+   * longer used by anyone are released. The returned list still has to be
+   * brought up-to-date with Update(), which rebuilds it when the image or the
+   * mask was modified. Thread-safe.
+   */
+  static Pointer GetSharedIndex( const InputImageType * image, const MaskType * mask,
+    const InputImageRegionType & region );
+
+  /** Release the shared lists that are no longer used by anyone. Thread-safe. */
+  static void ReleaseUnusedSharedIndices( void );
+
+  /** Build the list for the voxels of the region of the image, whose
+   * physical point is inside the mask. Nothing is done if the list was
+   * built for the same image, mask and region, and these were not modified.
+   */
+  void Update( const InputImageType * image, const MaskType * mask,
+    const InputImageRegionType & region );
+
+  /** The number of voxels inside the mask. */
+  SizeValueType Size( void ) const
+  {
+    return this->m_Positions.size();
+  }
+
+
+  /** The positions of the voxels inside the mask, in the region, in raster order. */
+  const PositionContainerType & GetPositions( void ) const
+  {
+    return this->m_Positions;
+  }
+
+
+  /** The region for which the list was built. */
+  const InputImageRegionType & GetRegion( void ) const
+  {
+    return this->m_Region;
+  }
+
+
+  /** The image index of the i-th voxel inside the mask. */
+  void GetIndex( const SizeValueType i, InputImageIndexType & index ) const
+  {
+    SizeValueType position = this->m_Positions[ i ];
+    for( unsigned int d = 0; d < InputImageDimension; ++d )
+    {
+      const SizeValueType size     = this->m_Region.GetSize()[ d ];
+      const SizeValueType residual = position % size;
+      index[ d ] = this->m_Region.GetIndex()[ d ] + static_cast< IndexValueType >( residual );
+      position   = ( position - residual ) / size;
+    }
+  }
+
+
+protected:
+
+  /** The constructor. */
+  ImageSamplerMaskIndex();
+
+  /** The destructor. */
+  ~ImageSamplerMaskIndex() override {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  ImageSamplerMaskIndex( const Self & ); // purposely not implemented
+  void operator=( const Self & );        // purposely not implemented
+
+  PositionContainerType m_Positions;
+  InputImageRegionType  m_Region;
+
+  /** What the list was built for. The pointers are only compared, never used. */
+  const InputImageType * m_Image;
+  const MaskType *       m_Mask;
+  ModifiedTimeType       m_ImageMTime;
+  ModifiedTimeType       m_MaskMTime;
+
+  std::mutex m_Mutex;
+
+  /** The shared lists, see GetSharedIndex(). The key pointers are only
+   * compared, never used.
+   */
+  struct SharedIndexType
+  {
+    const InputImageType * m_Image;
+    const MaskType *       m_Mask;
+    InputImageRegionType   m_Region;
+    Pointer                m_Index;
+  };
+  static std::mutex &                     GetSharedIndicesMutex( void );
+  static std::vector< SharedIndexType > & GetSharedIndices( void );
+
+  /** Remove the shared lists that only the container itself refers to.
+   * The mutex of the shared lists must be locked.
+   */
+  static void RemoveUnusedSharedIndices( void );
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageSamplerMaskIndex.hxx"
+#endif
+
+#endif // end #ifndef __itkImageSamplerMaskIndex_h
@@ -0,0 +1,222 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageSamplerMaskIndex_hxx
+#define __itkImageSamplerMaskIndex_hxx
+
+#include "itkImageSamplerMaskIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TInputImage >
+ImageSamplerMaskIndex< TInputImage >
+::ImageSamplerMaskIndex()
+{
+  this->m_Image      = nullptr;
+  this->m_Mask       = nullptr;
+  this->m_ImageMTime = 0;
+  this->m_MaskMTime  = 0;
+
+} // end Constructor
+
+
+/**
+ * ******************* GetSharedIndicesMutex *******************
+ */
+
+template< class TInputImage >
+std::mutex &
+ImageSamplerMaskIndex< TInputImage >
+::GetSharedIndicesMutex( void )
+{
+  static std::mutex mutex;
+  return mutex;
+
+} // end GetSharedIndicesMutex()
+
+
+/**
+ * ******************* GetSharedIndices *******************
+ */
+
+template< class TInputImage >
+std::vector< typename ImageSamplerMaskIndex< TInputImage >::SharedIndexType > &
+ImageSamplerMaskIndex< TInputImage >
+::GetSharedIndices( void )
+{
+  static std::vector< SharedIndexType > sharedIndices;
+  return sharedIndices;
+
+} // end GetSharedIndices()
+
+
+/**
+ * ******************* RemoveUnusedSharedIndices *******************
+ */
+
+template< class TInputImage >
+void
+ImageSamplerMaskIndex< TInputImage >
+::RemoveUnusedSharedIndices( void )
+{
+  /** A list that is only referred to by the container cannot be picked up
+   * by anyone else while the mutex is locked, so it is safe to release it.
+   */
+  std::vector< SharedIndexType > & sharedIndices = GetSharedIndices();
+  for( std::size_t i = 0; i < sharedIndices.size(); )
+  {
+    if( sharedIndices[ i ].m_Index->GetReferenceCount() == 1 )
+    {
+      sharedIndices.erase( sharedIndices.begin() + i );
+    }
+    else
+    {
+      ++i;
+    }
+  }
+
+} // end RemoveUnusedSharedIndices()
+
+
+/**
+ * ******************* GetSharedIndex *******************
+ */
+
+template< class TInputImage >
+typename ImageSamplerMaskIndex< TInputImage >::Pointer
+ImageSamplerMaskIndex< TInputImage >
+::GetSharedIndex( const InputImageType * image, const MaskType * mask,
+  const InputImageRegionType & region )
+{
+  std::lock_guard< std::mutex > mutexHolder( GetSharedIndicesMutex() );
+  RemoveUnusedSharedIndices();
+
+  /** Look for a list of the same image, mask and region. */
+  std::vector< SharedIndexType > & sharedIndices = GetSharedIndices();
+  for( std::size_t i = 0; i < sharedIndices.size(); ++i )
+  {
+    if( sharedIndices[ i ].m_Image == image && sharedIndices[ i ].m_Mask == mask
+      && sharedIndices[ i ].m_Region == region )
+    {
+      return sharedIndices[ i ].m_Index;
+    }
+  }
+
+  /** Create a new one, which is built by the first call of Update(). */
+  SharedIndexType sharedIndex;
+  sharedIndex.m_Image  = image;
+  sharedIndex.m_Mask   = mask;
+  sharedIndex.m_Region = region;
+  sharedIndex.m_Index  = Self::New();
+  sharedIndices.push_back( sharedIndex );
+  return sharedIndex.m_Index;
+
+} // end GetSharedIndex()
+
+
+/**
+ * ******************* ReleaseUnusedSharedIndices *******************
+ */
+
+template< class TInputImage >
+void
+ImageSamplerMaskIndex< TInputImage >
+::ReleaseUnusedSharedIndices( void )
+{
+  std::lock_guard< std::mutex > mutexHolder( GetSharedIndicesMutex() );
+  RemoveUnusedSharedIndices();
+
+} // end ReleaseUnusedSharedIndices()
+
+
+/**
+ * ******************* Update *******************
+ */
+
+template< class TInputImage >
+void
+ImageSamplerMaskIndex< TInputImage >
+::Update( const InputImageType * image, const MaskType * mask,
+  const InputImageRegionType & region )
+{
+  std::lock_guard< std::mutex > mutexHolder( this->m_Mutex );
+
+  /** Check if the list is still valid. */
+  if( image == this->m_Image && mask == this->m_Mask
+    && region == this->m_Region
+    && image->GetMTime() == this->m_ImageMTime
+    && mask->GetMTime() == this->m_MaskMTime )
+  {
+    return;
+  }
+
+  /** Loop over the region, in raster order, and store the position of every
+   * voxel inside the mask.
+   */
+  this->m_Positions.clear();
+  typedef ImageRegionConstIteratorWithIndex< InputImageType > IteratorType;
+  IteratorType        it( image, region );
+  InputImagePointType point;
+  SizeValueType       position = 0;
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it, ++position )
+  {
+    image->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    if( mask->IsInsideInWorldSpace( point ) )
+    {
+      this->m_Positions.push_back( position );
+    }
+  }
+
+  /** Release the memory that is not needed. */
+  PositionContainerType( this->m_Positions ).swap( this->m_Positions );
+
+  this->m_Image      = image;
+  this->m_Mask       = mask;
+  this->m_Region     = region;
+  this->m_ImageMTime = image->GetMTime();
+  this->m_MaskMTime  = mask->GetMTime();
+  this->Modified();
+
+} // end Update()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TInputImage >
+void
+ImageSamplerMaskIndex< TInputImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Size: " << this->m_Positions.size() << std::endl;
+  os << indent << "Region: " << this->m_Region << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkImageSamplerMaskIndex_hxx
@@ -41,6 +41,9 @@ ImageToVectorContainerFilter< TInputImage, TOutputVectorContainer >
   this->ProcessObject::SetNumberOfRequiredOutputs( 1 );
   this->ProcessObject::SetNthOutput( 0, output.GetPointer() );
 
+  /** Execute the threads on the persistent threads of the shared pool. */
+  this->ProcessObject::SetMultiThreader( SharedPoolMultiThreader::New() );
+
 } // end Constructor
 
 
@@ -275,10 +278,10 @@ ImageToVectorContainerFilter< TInputImage, TOutputVectorContainer >
 ::ThreaderCallback( void * arg )
 {
   ThreadStruct * str;
-  ThreadIdType   threadId    = ( (PlatformMultiThreader::WorkUnitInfo *)( arg ) )->WorkUnitID;
-  ThreadIdType   threadCount = ( (PlatformMultiThreader::WorkUnitInfo *)( arg ) )->NumberOfWorkUnits;
+  ThreadIdType   threadId    = ( (MultiThreaderBase::WorkUnitInfo *)( arg ) )->WorkUnitID;
+  ThreadIdType   threadCount = ( (MultiThreaderBase::WorkUnitInfo *)( arg ) )->NumberOfWorkUnits;
 
-  str = (ThreadStruct *)( ( (PlatformMultiThreader::WorkUnitInfo *)( arg ) )->UserData );
+  str = (ThreadStruct *)( ( (MultiThreaderBase::WorkUnitInfo *)( arg ) )->UserData );
 
   // execute the actual method with appropriate output region
   // first find out how many pieces extent can be split into.
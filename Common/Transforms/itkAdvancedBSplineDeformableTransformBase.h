@@ -152,7 +152,7 @@ public:
    *  parameter array has been passed to the transform on a 'const' basis but
    *  the values get modified when the user invokes SetIdentity().
    */
-  void SetIdentity( void );
+  virtual void SetIdentity( void );
 
   /** Get the Transformation Parameters. */
   const ParametersType & GetParameters( void ) const override;
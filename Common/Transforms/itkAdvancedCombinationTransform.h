@@ -251,6 +251,29 @@ public:
     DerivativeType & imageJacobian,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const override;
 
+  /** Batched versions of TransformPoint(), GetJacobian() and
+   * EvaluateJacobianWithImageGradientProduct(). The combination method is
+   * selected once per batch, after which the batch is forwarded to the batch
+   * functions of the initial and current transforms.
+   */
+  void TransformPoints(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const SizeValueType numberOfPoints ) const override;
+
+  void GetJacobians(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const SizeValueType numberOfPoints ) const override;
+
+  void EvaluateJacobianWithImageGradientProducts(
+    const InputPointType * inputPoints,
+    const MovingImageGradientType * movingImageGradients,
+    DerivativeType * imageJacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const SizeValueType numberOfPoints ) const override;
+
   /** Compute the spatial Jacobian of the transformation. */
   void GetSpatialJacobian(
     const InputPointType & ipp,
@@ -335,6 +358,11 @@ protected:
   /** Destructor. */
   ~AdvancedCombinationTransform() override{}
 
+  /** Clone this transform. The clone shares the initial transform, which is
+   * only read, and gets a clone of the current transform.
+   */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** Declaration of members. */
   InitialTransformPointer m_InitialTransform;
   CurrentTransformPointer m_CurrentTransform;
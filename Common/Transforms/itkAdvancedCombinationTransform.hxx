@@ -64,6 +64,37 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end Constructor
 
 
+/**
+ * ************************ InternalClone *************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+LightObject::Pointer
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  clone->SetUseComposition( this->m_UseComposition );
+  clone->SetUseAddition( this->m_UseAddition );
+  clone->SetInitialTransform( this->m_InitialTransform );
+
+  if( this->m_CurrentTransform.IsNotNull() )
+  {
+    CurrentTransformPointer currentTransform = dynamic_cast< CurrentTransformType * >(
+      this->m_CurrentTransform->Clone().GetPointer() );
+    if( currentTransform.IsNull() )
+    {
+      itkExceptionMacro( << "The current transform, a "
+                         << this->m_CurrentTransform->GetNameOfClass() << ", cannot be cloned." );
+    }
+    clone->SetCurrentTransform( currentTransform );
+  }
+
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
 /**
  *
  * ***********************************************************
@@ -1652,6 +1683,112 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ****************** TransformPoints ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const SizeValueType numberOfPoints ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  else if( this->m_InitialTransform.IsNull() )
+  {
+    this->m_CurrentTransform->TransformPoints( inputPoints, outputPoints, numberOfPoints );
+  }
+  else if( this->m_UseAddition )
+  {
+    for( SizeValueType i = 0; i < numberOfPoints; ++i )
+    {
+      outputPoints[ i ] = this->TransformPointUseAddition( inputPoints[ i ] );
+    }
+  }
+  else
+  {
+    /** COMPOSITION: transform the batch in place by the current transform. */
+    this->m_InitialTransform->TransformPoints( inputPoints, outputPoints, numberOfPoints );
+    this->m_CurrentTransform->TransformPoints( outputPoints, outputPoints, numberOfPoints );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ****************** GetJacobians ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::GetJacobians(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const SizeValueType numberOfPoints ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  else if( this->m_InitialTransform.IsNull() || this->m_UseAddition )
+  {
+    this->m_CurrentTransform->GetJacobians(
+      inputPoints, jacobians, nonZeroJacobianIndices, numberOfPoints );
+  }
+  else
+  {
+    /** COMPOSITION: evaluate the current transform at T_0(x). */
+    std::vector< InputPointType > mappedPoints( numberOfPoints );
+    this->m_InitialTransform->TransformPoints( inputPoints, mappedPoints.data(), numberOfPoints );
+    this->m_CurrentTransform->GetJacobians(
+      mappedPoints.data(), jacobians, nonZeroJacobianIndices, numberOfPoints );
+  }
+
+} // end GetJacobians()
+
+
+/**
+ * ****************** EvaluateJacobianWithImageGradientProducts ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::EvaluateJacobianWithImageGradientProducts(
+  const InputPointType * inputPoints,
+  const MovingImageGradientType * movingImageGradients,
+  DerivativeType * imageJacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const SizeValueType numberOfPoints ) const
+{
+  if( this->m_CurrentTransform.IsNull() )
+  {
+    this->NoCurrentTransformSet();
+  }
+  else if( this->m_InitialTransform.IsNull() || this->m_UseAddition )
+  {
+    this->m_CurrentTransform->EvaluateJacobianWithImageGradientProducts(
+      inputPoints, movingImageGradients, imageJacobians, nonZeroJacobianIndices, numberOfPoints );
+  }
+  else
+  {
+    /** COMPOSITION: evaluate the current transform at T_0(x). */
+    std::vector< InputPointType > mappedPoints( numberOfPoints );
+    this->m_InitialTransform->TransformPoints( inputPoints, mappedPoints.data(), numberOfPoints );
+    this->m_CurrentTransform->EvaluateJacobianWithImageGradientProducts(
+      mappedPoints.data(), movingImageGradients, imageJacobians, nonZeroJacobianIndices, numberOfPoints );
+  }
+
+} // end EvaluateJacobianWithImageGradientProducts()
+
+
 /**
  * ****************** GetSpatialJacobian ****************************
  */
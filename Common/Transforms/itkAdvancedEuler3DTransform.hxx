@@ -403,6 +403,27 @@ AdvancedEuler3DTransform< TScalarType >::PrintSelf( std::ostream & os, Indent in
 }
 
 
+// Clone
+template< class TScalarType >
+LightObject::Pointer
+AdvancedEuler3DTransform< TScalarType >::InternalClone( void ) const
+{
+  LightObject::Pointer loPtr = Superclass::InternalClone();
+  Self *               clone = dynamic_cast< Self * >( loPtr.GetPointer() );
+  if( clone == nullptr )
+  {
+    itkExceptionMacro( << "Downcast to type " << this->GetNameOfClass() << " failed." );
+  }
+
+  /** The angles depend on the order of the rotations, so set the
+   * parameters again after setting it.
+   */
+  clone->SetComputeZYX( m_ComputeZYX );
+  clone->SetParameters( this->GetParameters() );
+  return loPtr;
+}
+
+
 } // namespace
 
 #endif
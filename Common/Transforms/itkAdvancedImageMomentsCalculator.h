@@ -30,7 +30,7 @@
 #include "vnl/vnl_matrix_fixed.h"
 #include "vnl/vnl_diag_matrix.h"
 
-#include "itkPlatformMultiThreader.h"
+#include "itkSharedPoolMultiThreader.h"
 
 namespace itk
 {
@@ -241,7 +241,7 @@ protected:
   void PrintSelf(std::ostream & os, Indent indent) const override;
 
   /** Typedefs for multi-threading. */
-  typedef itk::PlatformMultiThreader             ThreaderType;
+  typedef itk::SharedPoolMultiThreader           ThreaderType;
   typedef ThreaderType::WorkUnitInfo ThreadInfoType;
   ThreaderType::Pointer                   m_Threader;
 
@@ -146,6 +146,9 @@ public:
   typedef typename Superclass
     ::JacobianOfSpatialHessianType JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType InternalMatrixType;
+  typedef typename Superclass::DerivativeType     DerivativeType;
+  typedef typename Superclass
+    ::MovingImageGradientType MovingImageGradientType;
 
   /** Standard matrix type for this class. */
   typedef Matrix< TScalarType,
@@ -343,6 +346,12 @@ public:
    */
   OutputPointType     TransformPoint( const InputPointType & point ) const override;
 
+  /** Transform a batch of points, in a tight loop over the matrix elements. */
+  void TransformPoints(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const SizeValueType numberOfPoints ) const override;
+
   OutputVectorType    TransformVector( const InputVectorType & vector ) const override;
 
   OutputVnlVectorType TransformVector( const InputVnlVectorType & vector ) const override;
@@ -400,6 +409,25 @@ public:
     JacobianType &,
     NonZeroJacobianIndicesType & ) const override;
 
+  /** Batched versions of GetJacobian() and EvaluateJacobianWithImageGradientProduct().
+   * For this family of transforms the Jacobian is an affine function of the
+   * point, whatever the parametrisation of the subclass. The batch versions
+   * therefore evaluate GetJacobian() only InputSpaceDimension + 1 times per batch,
+   * and compute the Jacobian of every point from these, see GetJacobians().
+   */
+  void GetJacobians(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const SizeValueType numberOfPoints ) const override;
+
+  void EvaluateJacobianWithImageGradientProducts(
+    const InputPointType * inputPoints,
+    const MovingImageGradientType * movingImageGradients,
+    DerivativeType * imageJacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const SizeValueType numberOfPoints ) const override;
+
   /** Compute the spatial Jacobian of the transformation. */
   void GetSpatialJacobian(
     const InputPointType &,
@@ -455,6 +483,14 @@ protected:
   /** Called by constructors: */
   virtual void PrecomputeJacobians( unsigned int paramDims );
 
+  /** Compute the Jacobian at the center, and the change of the Jacobian per
+   * unit step in every input dimension. Used by the batched Jacobian functions.
+   */
+  void ComputeJacobianAffineMap(
+    JacobianType & jacobianAtCenter,
+    JacobianType * jacobianSlopes,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
+
   /** Destroy an AdvancedMatrixOffsetTransformBase object. */
   ~AdvancedMatrixOffsetTransformBase() override {}
 
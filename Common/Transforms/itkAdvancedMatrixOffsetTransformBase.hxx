@@ -264,6 +264,34 @@ AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensi
 }
 
 
+// Transform a batch of points
+template< class TScalarType, unsigned int NInputDimensions,
+unsigned int NOutputDimensions >
+void
+AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const SizeValueType numberOfPoints ) const
+{
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    /** Copy the point, since the input and output arrays may be the same. */
+    const InputPointType point = inputPoints[ i ];
+    for( unsigned int r = 0; r < NOutputDimensions; ++r )
+    {
+      ScalarType value = this->m_Offset[ r ];
+      for( unsigned int c = 0; c < NInputDimensions; ++c )
+      {
+        value += this->m_Matrix[ r ][ c ] * point[ c ];
+      }
+      outputPoints[ i ][ r ] = value;
+    }
+  }
+
+} // end TransformPoints()
+
+
 // Transform a vector
 template< class TScalarType, unsigned int NInputDimensions,
 unsigned int NOutputDimensions >
@@ -607,6 +635,152 @@ AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensi
 } // end GetJacobian()
 
 
+/**
+ * ********************* ComputeJacobianAffineMap ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions,
+unsigned int NOutputDimensions >
+void
+AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensions >
+::ComputeJacobianAffineMap(
+  JacobianType & jacobianAtCenter,
+  JacobianType * jacobianSlopes,
+  NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+{
+  /** The transformation is T(p) = A(mu) ( p - c ) + c + t(mu), so its
+   * derivative to mu is affine in p:
+   *   J(p) = J(c) + sum_d ( p_d - c_d ) ( J(c + e_d) - J(c) ).
+   * The virtual GetJacobian() is used, so that the parametrisation of the
+   * subclass is respected.
+   */
+  const InputPointType       center = this->GetCenter();
+  NonZeroJacobianIndicesType dummyIndices;
+  this->GetJacobian( center, jacobianAtCenter, nonZeroJacobianIndices );
+  for( unsigned int d = 0; d < NInputDimensions; ++d )
+  {
+    InputPointType shiftedCenter = center;
+    shiftedCenter[ d ] += 1.0;
+    this->GetJacobian( shiftedCenter, jacobianSlopes[ d ], dummyIndices );
+    jacobianSlopes[ d ] -= jacobianAtCenter;
+  }
+
+} // end ComputeJacobianAffineMap()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions,
+unsigned int NOutputDimensions >
+void
+AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensions >
+::GetJacobians(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const SizeValueType numberOfPoints ) const
+{
+  /** Get the Jacobian as an affine function of the point. */
+  JacobianType               jacobianAtCenter;
+  JacobianType               jacobianSlopes[ NInputDimensions ];
+  NonZeroJacobianIndicesType nzji;
+  this->ComputeJacobianAffineMap( jacobianAtCenter, jacobianSlopes, nzji );
+
+  const unsigned int numberOfColumns  = jacobianAtCenter.cols();
+  const unsigned int numberOfElements = NOutputDimensions * numberOfColumns;
+  const InputPointType center         = this->GetCenter();
+
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    /** Resizing is only performed when needed. */
+    jacobians[ i ].SetSize( NOutputDimensions, numberOfColumns );
+
+    /** J(p) = J(c) + sum_d ( p_d - c_d ) S_d. */
+    typename JacobianType::element_type * jac = jacobians[ i ].data_block();
+    const typename JacobianType::element_type * jac0 = jacobianAtCenter.data_block();
+    for( unsigned int e = 0; e < numberOfElements; ++e )
+    {
+      jac[ e ] = jac0[ e ];
+    }
+    for( unsigned int d = 0; d < NInputDimensions; ++d )
+    {
+      const ScalarType v = inputPoints[ i ][ d ] - center[ d ];
+      const typename JacobianType::element_type * slope = jacobianSlopes[ d ].data_block();
+      for( unsigned int e = 0; e < numberOfElements; ++e )
+      {
+        jac[ e ] += v * slope[ e ];
+      }
+    }
+
+    /** Copy the constant nonZeroJacobianIndices. */
+    nonZeroJacobianIndices[ i ] = nzji;
+  }
+
+} // end GetJacobians()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProducts ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions,
+unsigned int NOutputDimensions >
+void
+AdvancedMatrixOffsetTransformBase< TScalarType, NInputDimensions, NOutputDimensions >
+::EvaluateJacobianWithImageGradientProducts(
+  const InputPointType * inputPoints,
+  const MovingImageGradientType * movingImageGradients,
+  DerivativeType * imageJacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const SizeValueType numberOfPoints ) const
+{
+  /** Get the Jacobian as an affine function of the point. */
+  JacobianType               jacobianAtCenter;
+  JacobianType               jacobianSlopes[ NInputDimensions ];
+  NonZeroJacobianIndicesType nzji;
+  this->ComputeJacobianAffineMap( jacobianAtCenter, jacobianSlopes, nzji );
+
+  const unsigned int   numberOfColumns = jacobianAtCenter.cols();
+  const InputPointType center          = this->GetCenter();
+
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    DerivativeType & imageJacobian = imageJacobians[ i ];
+    if( imageJacobian.GetSize() != numberOfColumns )
+    {
+      imageJacobian.SetSize( numberOfColumns );
+    }
+    imageJacobian.Fill( 0.0 );
+
+    /** imageJacobian = g^T J(p) = g^T J(c) + sum_d ( p_d - c_d ) g^T S_d. */
+    for( unsigned int r = 0; r < NOutputDimensions; ++r )
+    {
+      const double g = movingImageGradients[ i ][ r ];
+      const typename JacobianType::element_type * jac0 = jacobianAtCenter[ r ];
+      for( unsigned int mu = 0; mu < numberOfColumns; ++mu )
+      {
+        imageJacobian[ mu ] += g * jac0[ mu ];
+      }
+      for( unsigned int d = 0; d < NInputDimensions; ++d )
+      {
+        const double gv = g * ( inputPoints[ i ][ d ] - center[ d ] );
+        const typename JacobianType::element_type * slope = jacobianSlopes[ d ][ r ];
+        for( unsigned int mu = 0; mu < numberOfColumns; ++mu )
+        {
+          imageJacobian[ mu ] += gv * slope[ mu ];
+        }
+      }
+    }
+
+    /** Copy the constant nonZeroJacobianIndices. */
+    nonZeroJacobianIndices[ i ] = nzji;
+  }
+
+} // end EvaluateJacobianWithImageGradientProducts()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -205,6 +205,34 @@ public:
     DerivativeType & imageJacobian,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const;
 
+  /** Batched versions of TransformPoint(), GetJacobian() and
+   * EvaluateJacobianWithImageGradientProduct(). They process numberOfPoints
+   * points in one call and write the result for the i-th point to the i-th
+   * element of the output arrays. This way the virtual call is paid once per
+   * batch instead of once per point, and subclasses can hoist their setup out
+   * of a tight loop over the batch.
+   *
+   * The default implementations loop over the per-point functions. Input and
+   * output point arrays of TransformPoints() may be the same array.
+   */
+  virtual void TransformPoints(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const SizeValueType numberOfPoints ) const;
+
+  virtual void GetJacobians(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const SizeValueType numberOfPoints ) const;
+
+  virtual void EvaluateJacobianWithImageGradientProducts(
+    const InputPointType * inputPoints,
+    const MovingImageGradientType * movingImageGradients,
+    DerivativeType * imageJacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const SizeValueType numberOfPoints ) const;
+
   /** Compute the spatial Jacobian of the transformation.
    *
    * The spatial Jacobian is expressed as a vector of partial derivatives of the
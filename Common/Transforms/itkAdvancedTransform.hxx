@@ -107,6 +107,70 @@ AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const SizeValueType numberOfPoints ) const
+{
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    outputPoints[ i ] = this->TransformPoint( inputPoints[ i ] );
+  }
+
+} // end TransformPoints()
+
+
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::GetJacobians(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const SizeValueType numberOfPoints ) const
+{
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    this->GetJacobian( inputPoints[ i ], jacobians[ i ], nonZeroJacobianIndices[ i ] );
+  }
+
+} // end GetJacobians()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProducts ****************************
+ */
+
+template< class TScalarType, unsigned int NInputDimensions, unsigned int NOutputDimensions >
+void
+AdvancedTransform< TScalarType, NInputDimensions, NOutputDimensions >
+::EvaluateJacobianWithImageGradientProducts(
+  const InputPointType * inputPoints,
+  const MovingImageGradientType * movingImageGradients,
+  DerivativeType * imageJacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const SizeValueType numberOfPoints ) const
+{
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    this->EvaluateJacobianWithImageGradientProduct( inputPoints[ i ],
+      movingImageGradients[ i ], imageJacobians[ i ], nonZeroJacobianIndices[ i ] );
+  }
+
+} // end EvaluateJacobianWithImageGradientProducts()
+
+
 /**
  * ********************* GetNumberOfNonZeroJacobianIndices ****************************
  */
@@ -22,6 +22,10 @@
 
 #include "itkRecursiveBSplineInterpolationWeightFunction.h"
 
+#include <atomic>
+#include <mutex>
+#include <vector>
+
 namespace itk
 {
 /** \class RecursiveBSplineTransform
@@ -30,6 +34,14 @@ namespace itk
  * The class is templated coordinate representation type (float or double),
  * the space dimension and the spline order.
  *
+ * With SetUseSinglePrecision( true ) a double transform keeps a float copy
+ * of its coefficients, and evaluates TransformPoint() and GetSpatialJacobian()
+ * on that copy with float weights. This halves the memory traffic for the
+ * coefficients, at the cost of single precision results. The float copy only
+ * exists while single precision is used. It is refreshed at the first evaluation
+ * after the transform was modified, e.g. by SetParameters() or SetIdentity(),
+ * so the parameters should not be changed in place without calling SetParameters().
+ *
  * \ingroup ITKTransform
  */
 
@@ -114,6 +126,9 @@ public:
   /** Parameter index array type. */
   typedef typename Superclass::ParameterIndexArrayType ParameterIndexArrayType;
 
+  /** The type of the single precision coefficients. */
+  typedef float SinglePrecisionType;
+
   typedef typename itk::RecursiveBSplineInterpolationWeightFunction<
     TScalarType, NDimensions, VSplineOrder >                      RecursiveBSplineWeightFunctionType; //TODO: get rid of this and use the kernels directly.
 
@@ -127,12 +142,36 @@ public:
   typename DerivativeKernelType::Pointer m_DerivativeKernel;
   typename SecondOrderDerivativeKernelType::Pointer m_SecondOrderDerivativeKernel;
 
+  /** Set the coefficient images. Marks the transform as modified, so that the
+   * single precision coefficients are refreshed, if used.
+   */
+  void SetCoefficientImages( ImagePointer images[] ) override;
+
+  /** Set the parameters to zero, in place. Marks the transform as modified, so
+   * that the single precision coefficients are refreshed, if used.
+   */
+  void SetIdentity( void ) override;
+
+  /** Use a float copy of the coefficients in TransformPoint() and GetSpatialJacobian(). */
+  virtual void SetUseSinglePrecision( const bool _arg );
+
+  itkGetConstMacro( UseSinglePrecision, bool );
+
   /** Compute point transformation. This one is commonly used.
    * It calls RecursiveBSplineTransformImplementation2::InterpolateTransformPoint
    * for a recursive implementation.
    */
   OutputPointType TransformPoint( const InputPointType & point ) const override;
 
+  /** Compute the transformation of a batch of points. The setup that does not
+   * depend on the point, such as fetching the coefficient buffers, is done once
+   * for the whole batch.
+   */
+  void TransformPoints(
+    const InputPointType * inputPoints,
+    OutputPointType * outputPoints,
+    const SizeValueType numberOfPoints ) const override;
+
   /** Compute the Jacobian of the transformation. */
   void GetJacobian(
     const InputPointType & ipp,
@@ -148,6 +187,22 @@ public:
     DerivativeType & imageJacobian,
     NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const override;
 
+  /** Batched versions of GetJacobian() and EvaluateJacobianWithImageGradientProduct(),
+   * which call the functions of this class directly instead of through the vtable.
+   */
+  void GetJacobians(
+    const InputPointType * inputPoints,
+    JacobianType * jacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const SizeValueType numberOfPoints ) const override;
+
+  void EvaluateJacobianWithImageGradientProducts(
+    const InputPointType * inputPoints,
+    const MovingImageGradientType * movingImageGradients,
+    DerivativeType * imageJacobians,
+    NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+    const SizeValueType numberOfPoints ) const override;
+
   /** Compute the spatial Jacobian of the transformation. */
   void GetSpatialJacobian(
     const InputPointType & ipp,
@@ -203,11 +258,39 @@ protected:
     NonZeroJacobianIndicesType & nonZeroJacobianIndices,
     const RegionType & supportRegion ) const override;
 
+  /** Copy the coefficients to m_SinglePrecisionCoefficients, if the transform
+   * was modified since the last copy. Called by the evaluation methods, so it
+   * is thread-safe; only the first caller after a modification copies.
+   */
+  void UpdateSinglePrecisionCoefficients( void ) const;
+
+  /** Get the start of the single precision coefficients of dimension j. */
+  SinglePrecisionType * GetSinglePrecisionCoefficients( const unsigned int j ) const
+  {
+    return const_cast< SinglePrecisionType * >( &this->m_SinglePrecisionCoefficients[ 0 ] )
+           + j * this->m_CoefficientImages[ 0 ]->GetBufferedRegion().GetNumberOfPixels();
+  }
+
+
+  /** Single precision implementations of TransformPoint() and GetSpatialJacobian(). */
+  void TransformPointSinglePrecision(
+    const ContinuousIndexType & cindex,
+    ScalarType * displacement ) const;
+
+  void GetSpatialJacobianSinglePrecision(
+    const ContinuousIndexType & cindex,
+    double * spatialJacobian ) const;
+
 private:
 
   RecursiveBSplineTransform( const Self & ); // purposely not implemented
   void operator=( const Self & );            // purposely not implemented
 
+  bool                                       m_UseSinglePrecision;
+  mutable std::vector< SinglePrecisionType > m_SinglePrecisionCoefficients;
+  mutable std::atomic< ModifiedTimeType >    m_SinglePrecisionCoefficientsMTime;
+  mutable std::mutex                         m_SinglePrecisionCoefficientsMutex;
+
 };
 
 } // end namespace itk
@@ -32,7 +32,9 @@ namespace itk
 
 template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
 RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
-::RecursiveBSplineTransform() : Superclass()
+::RecursiveBSplineTransform() : Superclass(),
+  m_UseSinglePrecision( false ),
+  m_SinglePrecisionCoefficientsMTime( 0 )
 {
   this->m_RecursiveBSplineWeightFunction = RecursiveBSplineWeightFunctionType::New();
   this->m_Kernel                         = KernelType::New();
@@ -41,6 +43,221 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 } // end Constructor()
 
 
+/**
+ * ********************* SetCoefficientImages ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::SetCoefficientImages( ImagePointer images[] )
+{
+  this->Superclass::SetCoefficientImages( images );
+  this->Modified();
+
+} // end SetCoefficientImages()
+
+
+/**
+ * ********************* SetIdentity ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::SetIdentity( void )
+{
+  /** The superclass zeroes the parameters in place; make sure the
+   * single precision coefficients follow.
+   */
+  this->Superclass::SetIdentity();
+  this->Modified();
+
+} // end SetIdentity()
+
+
+/**
+ * ********************* SetUseSinglePrecision ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::SetUseSinglePrecision( const bool _arg )
+{
+  if( this->m_UseSinglePrecision != _arg )
+  {
+    this->m_UseSinglePrecision = _arg;
+    if( !_arg )
+    {
+      std::vector< SinglePrecisionType >().swap( this->m_SinglePrecisionCoefficients );
+    }
+    this->Modified();
+  }
+
+} // end SetUseSinglePrecision()
+
+
+/**
+ * ********************* UpdateSinglePrecisionCoefficients ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::UpdateSinglePrecisionCoefficients( void ) const
+{
+  /** Nothing to do if the copy is still up-to-date. */
+  const ModifiedTimeType mtime = this->GetMTime();
+  if( this->m_SinglePrecisionCoefficientsMTime.load( std::memory_order_acquire ) == mtime )
+  {
+    return;
+  }
+
+  /** Only one thread copies; the others wait and then find it up-to-date. */
+  std::lock_guard< std::mutex > mutexHolder( this->m_SinglePrecisionCoefficientsMutex );
+  if( this->m_SinglePrecisionCoefficientsMTime.load( std::memory_order_relaxed ) == mtime )
+  {
+    return;
+  }
+  if( !this->m_CoefficientImages[ 0 ] )
+  {
+    return;
+  }
+
+  /** Store the coefficient images one after the other. They all have the
+   * same region, so the offset table of the first image applies to all.
+   */
+  const SizeValueType numberOfPixels
+    = this->m_CoefficientImages[ 0 ]->GetBufferedRegion().GetNumberOfPixels();
+  this->m_SinglePrecisionCoefficients.resize( SpaceDimension * numberOfPixels );
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    const ScalarType *    source      = this->m_CoefficientImages[ j ]->GetBufferPointer();
+    SinglePrecisionType * destination = this->GetSinglePrecisionCoefficients( j );
+    for( SizeValueType i = 0; i < numberOfPixels; ++i )
+    {
+      destination[ i ] = static_cast< SinglePrecisionType >( source[ i ] );
+    }
+  }
+  this->m_SinglePrecisionCoefficientsMTime.store( mtime, std::memory_order_release );
+
+} // end UpdateSinglePrecisionCoefficients()
+
+
+/**
+ * ********************* TransformPointSinglePrecision ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::TransformPointSinglePrecision(
+  const ContinuousIndexType & cindex,
+  ScalarType * displacement ) const
+{
+  /** Refresh the float copy of the coefficients, if the transform was modified. */
+  this->UpdateSinglePrecisionCoefficients();
+
+  /** Compute the interpolation weights, and convert them to float. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+
+  SinglePrecisionType singleWeights1D[ numberOfWeights ];
+  for( unsigned int i = 0; i < numberOfWeights; ++i )
+  {
+    singleWeights1D[ i ] = static_cast< SinglePrecisionType >( weightsArray1D[ i ] );
+  }
+
+  /** Get handles to the float mu's. */
+  const OffsetValueType * bsplineOffsetTable        = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  OffsetValueType         totalOffsetToSupportIndex = 0;
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    totalOffsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
+  }
+
+  SinglePrecisionType * mu[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    mu[ j ] = this->GetSinglePrecisionCoefficients( j ) + totalOffsetToSupportIndex;
+  }
+
+  /** Call the recursive TransformPoint function in single precision. */
+  SinglePrecisionType singleDisplacement[ SpaceDimension ];
+  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, SinglePrecisionType >
+    ::TransformPoint( singleDisplacement, mu, bsplineOffsetTable, singleWeights1D );
+
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    displacement[ j ] = singleDisplacement[ j ];
+  }
+
+} // end TransformPointSinglePrecision()
+
+
+/**
+ * ********************* GetSpatialJacobianSinglePrecision ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::GetSpatialJacobianSinglePrecision(
+  const ContinuousIndexType & cindex,
+  double * spatialJacobian ) const
+{
+  /** Refresh the float copy of the coefficients, if the transform was modified. */
+  this->UpdateSinglePrecisionCoefficients();
+
+  /** Compute the interpolation weights, and convert them to float. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+  typename WeightsType::ValueType derivativeWeightsArray1D[ numberOfWeights ];
+  WeightsType derivativeWeights1D( derivativeWeightsArray1D, numberOfWeights, false );
+  IndexType   supportIndex;
+  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+  this->m_RecursiveBSplineWeightFunction->EvaluateDerivative( cindex, derivativeWeights1D, supportIndex );
+
+  SinglePrecisionType singleWeights1D[ numberOfWeights ];
+  SinglePrecisionType singleDerivativeWeights1D[ numberOfWeights ];
+  for( unsigned int i = 0; i < numberOfWeights; ++i )
+  {
+    singleWeights1D[ i ]           = static_cast< SinglePrecisionType >( weightsArray1D[ i ] );
+    singleDerivativeWeights1D[ i ] = static_cast< SinglePrecisionType >( derivativeWeightsArray1D[ i ] );
+  }
+
+  /** Get handles to the float mu's. */
+  const OffsetValueType * bsplineOffsetTable        = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  OffsetValueType         totalOffsetToSupportIndex = 0;
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    totalOffsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
+  }
+
+  SinglePrecisionType * mu[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    mu[ j ] = this->GetSinglePrecisionCoefficients( j ) + totalOffsetToSupportIndex;
+  }
+
+  /** Recursively compute the spatial Jacobian in single precision. */
+  SinglePrecisionType singleSpatialJacobian[ SpaceDimension * ( SpaceDimension + 1 ) ];
+  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, SinglePrecisionType >
+    ::GetSpatialJacobian( singleSpatialJacobian, mu, bsplineOffsetTable, singleWeights1D, singleDerivativeWeights1D );
+
+  for( unsigned int n = 0; n < SpaceDimension * ( SpaceDimension + 1 ); ++n )
+  {
+    spatialJacobian[ n ] = singleSpatialJacobian[ n ];
+  }
+
+} // end GetSpatialJacobianSinglePrecision()
+
+
 /**
  * ********************* TransformPoint ****************************
  */
@@ -82,6 +299,18 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
     return outputPoint;
   }
 
+  /** Evaluate on the single precision coefficients, if requested. */
+  if( this->m_UseSinglePrecision )
+  {
+    ScalarType displacement[ SpaceDimension ];
+    this->TransformPointSinglePrecision( cindex, displacement );
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      outputPoint[ j ] = displacement[ j ] + point[ j ];
+    }
+    return outputPoint;
+  }
+
   // Compute interpolation weighs and store them in weights1D
   IndexType supportIndex;
   this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
@@ -115,6 +344,99 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 } // end TransformPoint()
 
 
+/**
+ * ********************* TransformPoints ****************************
+ */
+
+template< typename TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::TransformPoints(
+  const InputPointType * inputPoints,
+  OutputPointType * outputPoints,
+  const SizeValueType numberOfPoints ) const
+{
+  /** Check if the coefficient image has been set. */
+  if( !this->m_CoefficientImages[ 0 ] )
+  {
+    itkWarningMacro( << "B-spline coefficients have not been set" );
+    for( SizeValueType i = 0; i < numberOfPoints; ++i )
+    {
+      outputPoints[ i ] = inputPoints[ i ];
+    }
+    return;
+  }
+
+  /** Allocate weights on the stack. */
+  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+
+  /** Initialize the helper variables that are the same for all points. */
+  const OffsetValueType * bsplineOffsetTable = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+  ScalarType *            coefficients[ SpaceDimension ];
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    coefficients[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer();
+  }
+
+  ContinuousIndexType cindex;
+  IndexType           supportIndex;
+  ScalarType *        mu[ SpaceDimension ];
+  ScalarType          displacement[ SpaceDimension ];
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    /** Copy the point, since the input and output arrays may be the same. */
+    const InputPointType point = inputPoints[ i ];
+
+    /** Convert to continuous index. If the support region does not lie
+     * totally within the grid we assume zero displacement.
+     */
+    this->TransformPointToContinuousGridIndex( point, cindex );
+    if( !this->InsideValidRegion( cindex ) )
+    {
+      outputPoints[ i ] = point;
+      continue;
+    }
+
+    /** Evaluate on the single precision coefficients, if requested. */
+    if( this->m_UseSinglePrecision )
+    {
+      this->TransformPointSinglePrecision( cindex, displacement );
+      for( unsigned int j = 0; j < SpaceDimension; ++j )
+      {
+        outputPoints[ i ][ j ] = displacement[ j ] + point[ j ];
+      }
+      continue;
+    }
+
+    /** Compute interpolation weighs and store them in weights1D. */
+    this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+
+    OffsetValueType totalOffsetToSupportIndex = 0;
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      totalOffsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
+    }
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      mu[ j ] = coefficients[ j ] + totalOffsetToSupportIndex;
+    }
+
+    /** Call the recursive TransformPoint function. */
+    RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+      ::TransformPoint( displacement, mu, bsplineOffsetTable, weightsArray1D );
+
+    /** The output point is the start point + displacement. */
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      outputPoints[ i ][ j ] = displacement[ j ] + point[ j ];
+    }
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ********************* GetJacobian ****************************
  */
@@ -250,6 +572,50 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
 } // end EvaluateJacobianWithImageGradientProduct()
 
 
+/**
+ * ********************* GetJacobians ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::GetJacobians(
+  const InputPointType * inputPoints,
+  JacobianType * jacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const SizeValueType numberOfPoints ) const
+{
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    this->Self::GetJacobian( inputPoints[ i ], jacobians[ i ], nonZeroJacobianIndices[ i ] );
+  }
+
+} // end GetJacobians()
+
+
+/**
+ * ********************* EvaluateJacobianWithImageGradientProducts ****************************
+ */
+
+template< class TScalar, unsigned int NDimensions, unsigned int VSplineOrder >
+void
+RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
+::EvaluateJacobianWithImageGradientProducts(
+  const InputPointType * inputPoints,
+  const MovingImageGradientType * movingImageGradients,
+  DerivativeType * imageJacobians,
+  NonZeroJacobianIndicesType * nonZeroJacobianIndices,
+  const SizeValueType numberOfPoints ) const
+{
+  for( SizeValueType i = 0; i < numberOfPoints; ++i )
+  {
+    this->Self::EvaluateJacobianWithImageGradientProduct( inputPoints[ i ],
+      movingImageGradients[ i ], imageJacobians[ i ], nonZeroJacobianIndices[ i ] );
+  }
+
+} // end EvaluateJacobianWithImageGradientProducts()
+
+
 /**
  * ********************* GetSpatialJacobian ****************************
  */
@@ -275,43 +641,51 @@ RecursiveBSplineTransform< TScalar, NDimensions, VSplineOrder >
     return;
   }
 
-  /** Create storage for the B-spline interpolation weights. */
-  const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
-  typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
-  WeightsType weights1D( weightsArray1D, numberOfWeights, false );
-  typename WeightsType::ValueType derivativeWeightsArray1D[ numberOfWeights ];
-  WeightsType derivativeWeights1D( derivativeWeightsArray1D, numberOfWeights, false );
-
-  double * weightsPointer           = &( weights1D[ 0 ] );
-  double * derivativeWeightsPointer = &( derivativeWeights1D[ 0 ] );
-
-  /** Compute the interpolation weights.
-   * In contrast to the normal B-spline weights function, the recursive version
-   * returns the individual weights instead of the multiplied ones.
-   */
-  IndexType supportIndex;
-  this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
-  this->m_RecursiveBSplineWeightFunction->EvaluateDerivative( cindex, derivativeWeights1D, supportIndex );
-
-  /** Compute the offset to the start index. */
-  const OffsetValueType * bsplineOffsetTable        = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
-  OffsetValueType         totalOffsetToSupportIndex = 0;
-  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  /** Compute the spatial Jacobian, on the single precision coefficients if requested. */
+  double spatialJacobian[ SpaceDimension * ( SpaceDimension + 1 ) ]; //double
+  if( this->m_UseSinglePrecision )
   {
-    totalOffsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
+    this->GetSpatialJacobianSinglePrecision( cindex, spatialJacobian );
   }
-
-  /** Get handles to the mu's. */
-  ScalarType * mu[ SpaceDimension ];
-  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  else
   {
-    mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + totalOffsetToSupportIndex;
-  }
+    /** Create storage for the B-spline interpolation weights. */
+    const unsigned int numberOfWeights = RecursiveBSplineWeightFunctionType::NumberOfWeights;
+    typename WeightsType::ValueType weightsArray1D[ numberOfWeights ];
+    WeightsType weights1D( weightsArray1D, numberOfWeights, false );
+    typename WeightsType::ValueType derivativeWeightsArray1D[ numberOfWeights ];
+    WeightsType derivativeWeights1D( derivativeWeightsArray1D, numberOfWeights, false );
+
+    double * weightsPointer           = &( weights1D[ 0 ] );
+    double * derivativeWeightsPointer = &( derivativeWeights1D[ 0 ] );
+
+    /** Compute the interpolation weights.
+     * In contrast to the normal B-spline weights function, the recursive version
+     * returns the individual weights instead of the multiplied ones.
+     */
+    IndexType supportIndex;
+    this->m_RecursiveBSplineWeightFunction->Evaluate( cindex, weights1D, supportIndex );
+    this->m_RecursiveBSplineWeightFunction->EvaluateDerivative( cindex, derivativeWeights1D, supportIndex );
+
+    /** Compute the offset to the start index. */
+    const OffsetValueType * bsplineOffsetTable        = this->m_CoefficientImages[ 0 ]->GetOffsetTable();
+    OffsetValueType         totalOffsetToSupportIndex = 0;
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      totalOffsetToSupportIndex += supportIndex[ j ] * bsplineOffsetTable[ j ];
+    }
 
-  /** Recursively compute the spatial Jacobian. */
-  double spatialJacobian[ SpaceDimension * ( SpaceDimension + 1 ) ]; //double
-  RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
-    ::GetSpatialJacobian( spatialJacobian, mu, bsplineOffsetTable, weightsPointer, derivativeWeightsPointer );
+    /** Get handles to the mu's. */
+    ScalarType * mu[ SpaceDimension ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      mu[ j ] = this->m_CoefficientImages[ j ]->GetBufferPointer() + totalOffsetToSupportIndex;
+    }
+
+    /** Recursively compute the spatial Jacobian. */
+    RecursiveBSplineTransformImplementation< SpaceDimension, SpaceDimension, SplineOrder, TScalar >
+      ::GetSpatialJacobian( spatialJacobian, mu, bsplineOffsetTable, weightsPointer, derivativeWeightsPointer );
+  }
 
   /** Copy the correct elements to the spatial Jacobian.
    * The first SpaceDimension elements are actually the displacement, i.e. the recursive
@@ -19,10 +19,103 @@
 #define __itkRecursiveBSplineTransformImplementation_h
 
 #include "itkRecursiveBSplineInterpolationWeightFunction.h"
+#include "itkRecursiveBSplineTransformSIMD.h"
 
 namespace itk
 {
 
+/** \class RecursiveBSplineTransformSIMDKernels
+ *
+ * \brief Selects the vectorised kernels of RecursiveBSplineTransformSIMD
+ * for the template arguments for which they exist.
+ *
+ * In general no kernels are available, and the recursive implementation is used.
+ */
+
+template< unsigned int OutputDimension, unsigned int SpaceDimension, unsigned int SplineOrder, class TScalar >
+class RecursiveBSplineTransformSIMDKernels
+{
+public:
+
+  /** Whether TransformPoint() and GetSpatialJacobian() are available. */
+  itkStaticConstMacro( Available, bool, false );
+
+  /** Whether EvaluateJacobianWithImageGradientProduct() is available. */
+  itkStaticConstMacro( JacobianAvailable, bool, false );
+
+  static inline void TransformPoint( TScalar *, TScalar * const *, const OffsetValueType *, const TScalar * ) {}
+  static inline void EvaluateJacobianWithImageGradientProduct( TScalar *, const TScalar *, const TScalar * ) {}
+  static inline void GetSpatialJacobian( TScalar *, TScalar * const *, const OffsetValueType *, const TScalar *, const TScalar * ) {}
+};
+
+/** \class RecursiveBSplineTransformSIMDKernels
+ *
+ * \brief Specialisation for the 3D cubic B-spline with double coefficients.
+ */
+
+template< >
+class RecursiveBSplineTransformSIMDKernels< 3, 3, 3, double >
+{
+public:
+
+  itkStaticConstMacro( Available, bool, true );
+  itkStaticConstMacro( JacobianAvailable, bool, true );
+
+  static inline void TransformPoint( double * opp, double * const * mu,
+    const OffsetValueType * gridOffsetTable, const double * weights1D )
+  {
+    RecursiveBSplineTransformSIMD::TransformPoint( opp, mu, gridOffsetTable, weights1D );
+  }
+
+
+  static inline void EvaluateJacobianWithImageGradientProduct( double * imageJacobian,
+    const double * movingImageGradient, const double * weights1D )
+  {
+    RecursiveBSplineTransformSIMD::EvaluateJacobianWithImageGradientProduct( imageJacobian, movingImageGradient, weights1D );
+  }
+
+
+  static inline void GetSpatialJacobian( double * sj, double * const * mu,
+    const OffsetValueType * gridOffsetTable, const double * weights1D, const double * derivativeWeights1D )
+  {
+    RecursiveBSplineTransformSIMD::GetSpatialJacobian( sj, mu, gridOffsetTable, weights1D, derivativeWeights1D );
+  }
+
+
+};
+
+/** \class RecursiveBSplineTransformSIMDKernels
+ *
+ * \brief Specialisation for the 3D cubic B-spline with float coefficients.
+ * Only the functions that read the coefficients are vectorised.
+ */
+
+template< >
+class RecursiveBSplineTransformSIMDKernels< 3, 3, 3, float >
+{
+public:
+
+  itkStaticConstMacro( Available, bool, true );
+  itkStaticConstMacro( JacobianAvailable, bool, false );
+
+  static inline void TransformPoint( float * opp, float * const * mu,
+    const OffsetValueType * gridOffsetTable, const float * weights1D )
+  {
+    RecursiveBSplineTransformSIMD::TransformPoint( opp, mu, gridOffsetTable, weights1D );
+  }
+
+
+  static inline void EvaluateJacobianWithImageGradientProduct( float *, const float *, const float * ) {}
+
+  static inline void GetSpatialJacobian( float * sj, float * const * mu,
+    const OffsetValueType * gridOffsetTable, const float * weights1D, const float * derivativeWeights1D )
+  {
+    RecursiveBSplineTransformSIMD::GetSpatialJacobian( sj, mu, gridOffsetTable, weights1D, derivativeWeights1D );
+  }
+
+
+};
+
 /** \class RecursiveBSplineTransformImplementation
  *
  * \brief This helper class contains the actual implementation of the
@@ -34,19 +127,26 @@ namespace itk
  *
  * Note: More optimized code can be found in itkRecursiveBSplineImplementation.h
  *
+ * Where RecursiveBSplineTransformSIMDKernels provides vectorised kernels they
+ * replace the recursion. Set UseSIMDKernels to false to always use the generic
+ * recursion, e.g. as a reference for the kernels.
+ *
  * \ingroup ITKTransform
  */
 
-template< unsigned int OutputDimension, unsigned int SpaceDimension, unsigned int SplineOrder, class TScalar >
+template< unsigned int OutputDimension, unsigned int SpaceDimension, unsigned int SplineOrder, class TScalar,
+bool UseSIMDKernels = true >
 class RecursiveBSplineTransformImplementation
 {
 public:
 
   /** Typedef related to the coordinate representation type and the weights type.
-   * Usually double, but can be float as well. <Not tested very well for float>
+   * Usually double, but can be float as well. The weights and the intermediate
+   * results have the precision of the coefficients, so that a float transform
+   * does all its arithmetic in single precision.
    */
   typedef TScalar ScalarType;
-  typedef double  InternalFloatType;
+  typedef TScalar InternalFloatType;
 
   /** Helper constant variable. */
   itkStaticConstMacro( HelperConstVariable, unsigned int,
@@ -61,12 +161,23 @@ public:
   typedef ScalarType *  OutputPointType;
   typedef ScalarType ** CoefficientPointerVectorType;
 
+  /** Vectorised kernels, only available for some template arguments. */
+  typedef RecursiveBSplineTransformSIMDKernels<
+    OutputDimension, SpaceDimension, SplineOrder, TScalar > SIMDKernelsType;
+
   /** TransformPoint recursive implementation. */
   static inline void TransformPoint(
     OutputPointType opp, const CoefficientPointerVectorType mu,
     const OffsetValueType * gridOffsetTable,
-    const double * weights1D )
+    const InternalFloatType * weights1D )
   {
+    /** Use the vectorised kernel if there is one. */
+    if( UseSIMDKernels && SIMDKernelsType::Available )
+    {
+      SIMDKernelsType::TransformPoint( opp, mu, gridOffsetTable, weights1D );
+      return;
+    }
+
     /** Make a copy of the pointers to mu. The pointer will move later. */
     ScalarType * tmp_mu[ OutputDimension ];
     for( unsigned int j = 0; j < OutputDimension; ++j )
@@ -85,7 +196,7 @@ public:
     for( unsigned int k = 0; k <= SplineOrder; ++k )
     {
       /** Recurse. */
-      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar, UseSIMDKernels >
         ::TransformPoint( tmp_opp, tmp_mu, gridOffsetTable, weights1D );
 
       /** Accumulate the weights. */
@@ -102,12 +213,12 @@ public:
 
   /** GetJacobian recursive implementation. */
   static inline void GetJacobian(
-    ScalarType * & jacobians, const double * weights1D, double value )
+    ScalarType * & jacobians, const InternalFloatType * weights1D, double value )
   {
     for( unsigned int k = 0; k <= SplineOrder; ++k )
     {
       /** Recurse. */
-      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar, UseSIMDKernels >
         ::GetJacobian( jacobians, weights1D, value * weights1D[ k + HelperConstVariable ] );
     }
   } // end GetJacobian()
@@ -116,12 +227,22 @@ public:
   /** EvaluateJacobianWithImageGradientProduct recursive implementation. */
   static inline void EvaluateJacobianWithImageGradientProduct(
     ScalarType * & imageJacobian, const InternalFloatType * movingImageGradient,
-    const double * weights1D, double value )
+    const InternalFloatType * weights1D, double value )
   {
+    /** Use the vectorised kernel if there is one. It writes all
+     * BSplineNumberOfIndices elements, so advance the pointer likewise.
+     */
+    if( UseSIMDKernels && SIMDKernelsType::JacobianAvailable && value == 1.0 )
+    {
+      SIMDKernelsType::EvaluateJacobianWithImageGradientProduct( imageJacobian, movingImageGradient, weights1D );
+      imageJacobian += BSplineNumberOfIndices;
+      return;
+    }
+
     for( unsigned int k = 0; k <= SplineOrder; ++k )
     {
       /** Recurse. */
-      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar, UseSIMDKernels >
         ::EvaluateJacobianWithImageGradientProduct( imageJacobian, movingImageGradient, weights1D,
         value * weights1D[ k + HelperConstVariable ] );
     }
@@ -139,7 +260,7 @@ public:
     for( unsigned int k = 0; k <= SplineOrder; ++k )
     {
       /** Recurse. */
-      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar, UseSIMDKernels >
         ::ComputeNonZeroJacobianIndices( nzji, parametersPerDim, currentIndex, gridOffsetTable );
 
       currentIndex += bot;
@@ -155,9 +276,16 @@ public:
     InternalFloatType * sj,
     const CoefficientPointerVectorType mu,
     const OffsetValueType * gridOffsetTable,
-    const double * weights1D,                    // normal B-spline weights
-    const double * derivativeWeights1D )         // 1st derivative of B-spline
+    const InternalFloatType * weights1D,                    // normal B-spline weights
+    const InternalFloatType * derivativeWeights1D )         // 1st derivative of B-spline
   {
+    /** Use the vectorised kernel if there is one. */
+    if( UseSIMDKernels && SIMDKernelsType::Available )
+    {
+      SIMDKernelsType::GetSpatialJacobian( sj, mu, gridOffsetTable, weights1D, derivativeWeights1D );
+      return;
+    }
+
     /** Make a copy of the pointers to mu. The pointer will move later. */
     ScalarType * tmp_mu[ OutputDimension ];
     for( unsigned int j = 0; j < OutputDimension; ++j )
@@ -176,7 +304,7 @@ public:
     for( unsigned int k = 0; k <= SplineOrder; ++k )
     {
       /** Recurse. */
-      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar, UseSIMDKernels >
         ::GetSpatialJacobian( tmp_sj, tmp_mu, gridOffsetTable, weights1D, derivativeWeights1D );
 
       /** Accumulate the weights part. */
@@ -221,9 +349,9 @@ public:
     InternalFloatType * sh,
     const CoefficientPointerVectorType mu,
     const OffsetValueType * gridOffsetTable,
-    const double * weights1D,                   // normal B-spline weights
-    const double * derivativeWeights1D,         // 1st derivative of B-spline
-    const double * hessianWeights1D )           // 2nd derivative of B-spline
+    const InternalFloatType * weights1D,                   // normal B-spline weights
+    const InternalFloatType * derivativeWeights1D,         // 1st derivative of B-spline
+    const InternalFloatType * hessianWeights1D )           // 2nd derivative of B-spline
   {
     const unsigned int helperDim1 = OutputDimension * SpaceDimension * ( SpaceDimension + 1 ) / 2;
     const unsigned int helperDim2 = OutputDimension * ( SpaceDimension + 1 ) * ( SpaceDimension + 2 ) / 2;
@@ -246,7 +374,7 @@ public:
     for( unsigned int k = 0; k <= SplineOrder; ++k )
     {
       /** Recurse. */
-      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar, UseSIMDKernels >
         ::GetSpatialHessian( tmp_sh, tmp_mu, gridOffsetTable, weights1D, derivativeWeights1D, hessianWeights1D );
 
       /** Accumulate the weights part. */
@@ -283,8 +411,8 @@ public:
    */
   static inline void GetJacobianOfSpatialJacobian(
     InternalFloatType * & jsj_out,
-    const double * weights1D,                   // normal B-spline weights
-    const double * derivativeWeights1D,         // 1st derivative of B-spline
+    const InternalFloatType * weights1D,                   // normal B-spline weights
+    const InternalFloatType * derivativeWeights1D,         // 1st derivative of B-spline
     const double * directionCosines,
     InternalFloatType * jsj )
   {
@@ -308,7 +436,7 @@ public:
       tmp_jsj[ helperDim ] = jsj[ 0 ] * dw;
 
       /** Recurse. */
-      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar, UseSIMDKernels >
         ::GetJacobianOfSpatialJacobian( jsj_out, weights1D, derivativeWeights1D, directionCosines, tmp_jsj );
     }
   } // end GetJacobianOfSpatialJacobian()
@@ -319,9 +447,9 @@ public:
    */
   static inline void GetJacobianOfSpatialHessian(
     InternalFloatType * & jsh_out,
-    const double * weights1D,                   // normal B-spline weights
-    const double * derivativeWeights1D,         // 1st derivative of B-spline
-    const double * hessianWeights1D,            // 2nd derivative of B-spline
+    const InternalFloatType * weights1D,                   // normal B-spline weights
+    const InternalFloatType * derivativeWeights1D,         // 1st derivative of B-spline
+    const InternalFloatType * hessianWeights1D,            // 2nd derivative of B-spline
     const double * directionCosines,
     InternalFloatType * jsh )
   {
@@ -356,7 +484,7 @@ public:
       tmp_jsh[ helperDimW + helperDimDW ] = jsh[ 0 ] * hw;
 
       /** Recurse. */
-      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar >
+      RecursiveBSplineTransformImplementation< OutputDimension, SpaceDimension - 1, SplineOrder, TScalar, UseSIMDKernels >
         ::GetJacobianOfSpatialHessian( jsh_out, weights1D, derivativeWeights1D, hessianWeights1D, directionCosines, tmp_jsh );
     }
   } // end GetJacobianOfSpatialHessian()
@@ -370,16 +498,18 @@ public:
  * \brief Define the end case for SpaceDimension = 0.
  */
 
-template< unsigned int OutputDimension, unsigned int SplineOrder, class TScalar >
-class RecursiveBSplineTransformImplementation< OutputDimension, 0, SplineOrder, TScalar >
+template< unsigned int OutputDimension, unsigned int SplineOrder, class TScalar, bool UseSIMDKernels >
+class RecursiveBSplineTransformImplementation< OutputDimension, 0, SplineOrder, TScalar, UseSIMDKernels >
 {
 public:
 
   /** Typedef related to the coordinate representation type and the weights type.
-   * Usually double, but can be float as well. <Not tested very well for float>
+   * Usually double, but can be float as well. The weights and the intermediate
+   * results have the precision of the coefficients, so that a float transform
+   * does all its arithmetic in single precision.
    */
   typedef TScalar ScalarType;
-  typedef double  InternalFloatType;
+  typedef TScalar InternalFloatType;
 
   /** Typedef to know the number of indices at compile time. */
   typedef itk::RecursiveBSplineInterpolationWeightFunction<
@@ -394,7 +524,7 @@ public:
   static inline void TransformPoint(
     OutputPointType opp, const CoefficientPointerVectorType mu,
     const OffsetValueType * gridOffsetTable,
-    const double * weights1D )
+    const InternalFloatType * weights1D )
   {
     for( unsigned int j = 0; j < OutputDimension; ++j )
     {
@@ -405,7 +535,7 @@ public:
 
   /** GetJacobian recursive implementation. */
   static inline void GetJacobian(
-    ScalarType * & jacobians, const double * weights1D, double value )
+    ScalarType * & jacobians, const InternalFloatType * weights1D, double value )
   {
     unsigned long offset = 0;
     for( unsigned int j = 0; j < OutputDimension; ++j )
@@ -420,7 +550,7 @@ public:
   /** EvaluateJacobianWithImageGradientProduct recursive implementation. */
   static inline void EvaluateJacobianWithImageGradientProduct(
     ScalarType * & imageJacobian, const InternalFloatType * movingImageGradient,
-    const double * weights1D, double value )
+    const InternalFloatType * weights1D, double value )
   {
     for( unsigned int j = 0; j < OutputDimension; ++j )
     {
@@ -450,8 +580,8 @@ public:
     InternalFloatType * sj,
     const CoefficientPointerVectorType mu,
     const OffsetValueType * gridOffsetTable,
-    const double * weights1D,                    // normal B-spline weights
-    const double * derivativeWeights1D )         // 1st derivative of B-spline
+    const InternalFloatType * weights1D,                    // normal B-spline weights
+    const InternalFloatType * derivativeWeights1D )         // 1st derivative of B-spline
   {
     for( unsigned int j = 0; j < OutputDimension; ++j )
     {
@@ -465,9 +595,9 @@ public:
     InternalFloatType * sh,
     const CoefficientPointerVectorType mu,
     const OffsetValueType * gridOffsetTable,
-    const double * weights1D,                   // normal B-spline weights
-    const double * derivativeWeights1D,         // 1st derivative of B-spline
-    const double * hessianWeights1D )           // 2nd derivative of B-spline
+    const InternalFloatType * weights1D,                   // normal B-spline weights
+    const InternalFloatType * derivativeWeights1D,         // 1st derivative of B-spline
+    const InternalFloatType * hessianWeights1D )           // 2nd derivative of B-spline
   {
     for( unsigned int j = 0; j < OutputDimension; ++j )
     {
@@ -479,8 +609,8 @@ public:
   /** GetJacobianOfSpatialJacobian recursive implementation. */
   static inline void GetJacobianOfSpatialJacobian(
     InternalFloatType * & jsj_out,
-    const double * weights1D,                   // normal B-spline weights
-    const double * derivativeWeights1D,         // 1st derivative of B-spline
+    const InternalFloatType * weights1D,                   // normal B-spline weights
+    const InternalFloatType * derivativeWeights1D,         // 1st derivative of B-spline
     const double * directionCosines,
     InternalFloatType * jsj )
   {
@@ -518,9 +648,9 @@ public:
   /** GetJacobianOfSpatialHessian recursive implementation. */
   static inline void GetJacobianOfSpatialHessian(
     InternalFloatType * & jsh_out,
-    const double * weights1D,                   // normal B-spline weights
-    const double * derivativeWeights1D,         // 1st derivative of B-spline
-    const double * hessianWeights1D,            // 2nd derivative of B-spline
+    const InternalFloatType * weights1D,                   // normal B-spline weights
+    const InternalFloatType * derivativeWeights1D,         // 1st derivative of B-spline
+    const InternalFloatType * hessianWeights1D,            // 2nd derivative of B-spline
     const double * directionCosines,
     InternalFloatType * jsh )
   {
@@ -0,0 +1,1083 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRecursiveBSplineTransformSIMD_cxx
+#define __itkRecursiveBSplineTransformSIMD_cxx
+
+#include "itkRecursiveBSplineTransformSIMD.h"
+
+/** The SIMD kernels are compiled for x86 only. With GCC and Clang every kernel
+ * gets a target attribute, so that the rest of elastix does not need to be
+ * compiled with e.g. -mavx2. MSVC allows all intrinsics without flags.
+ */
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define ELX_RBS_SIMD 1
+#define ELX_RBS_TARGET( isa ) __attribute__( ( target( isa ) ) )
+#include <immintrin.h>
+#elif defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#define ELX_RBS_SIMD 1
+#define ELX_RBS_TARGET( isa )
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace itk
+{
+
+namespace
+{
+
+/** Function pointer types of the kernels. */
+typedef void (* TransformPointFunctionType)(
+  double *, double * const *, const OffsetValueType *, const double * );
+typedef void (* EvaluateJacobianWithImageGradientProductFunctionType)(
+  double *, const double *, const double * );
+typedef void (* GetSpatialJacobianFunctionType)(
+  double *, double * const *, const OffsetValueType *, const double *, const double * );
+typedef void (* TransformPointFloatFunctionType)(
+  float *, float * const *, const OffsetValueType *, const float * );
+typedef void (* GetSpatialJacobianFloatFunctionType)(
+  float *, float * const *, const OffsetValueType *, const float *, const float * );
+
+/**
+ * ********************* Scalar kernels ****************************
+ *
+ * These have the same loop structure as the SIMD kernels: the innermost loop
+ * runs over the 4 contiguous coefficients along x. TransformPoint and
+ * GetSpatialJacobian are templated over the precision.
+ */
+
+template< class T >
+void
+TransformPointScalar(
+  T * opp, T * const * mu,
+  const OffsetValueType * gridOffsetTable, const T * weights1D )
+{
+  const T * wx = weights1D;
+  const T * wy = weights1D + 4;
+  const T * wz = weights1D + 8;
+
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    T acc[ 4 ] = { 0, 0, 0, 0 };
+    for( unsigned int c = 0; c < 4; ++c )
+    {
+      for( unsigned int b = 0; b < 4; ++b )
+      {
+        const T   wzy = wz[ c ] * wy[ b ];
+        const T * row = mu[ j ] + b * gridOffsetTable[ 1 ] + c * gridOffsetTable[ 2 ];
+        for( unsigned int a = 0; a < 4; ++a )
+        {
+          acc[ a ] += wzy * row[ a ];
+        }
+      }
+    }
+    opp[ j ] = acc[ 0 ] * wx[ 0 ] + acc[ 1 ] * wx[ 1 ] + acc[ 2 ] * wx[ 2 ] + acc[ 3 ] * wx[ 3 ];
+  }
+
+} // end TransformPointScalar()
+
+
+void
+EvaluateJacobianWithImageGradientProductScalar(
+  double * imageJacobian, const double * movingImageGradient, const double * weights1D )
+{
+  const double * wx = weights1D;
+  const double * wy = weights1D + 4;
+  const double * wz = weights1D + 8;
+
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; ++b )
+    {
+      const double       wzy = wz[ c ] * wy[ b ];
+      const unsigned int idx = 16 * c + 4 * b;
+      for( unsigned int a = 0; a < 4; ++a )
+      {
+        const double w = wzy * wx[ a ];
+        for( unsigned int j = 0; j < 3; ++j )
+        {
+          imageJacobian[ j * 64 + idx + a ] = w * movingImageGradient[ j ];
+        }
+      }
+    }
+  }
+
+} // end EvaluateJacobianWithImageGradientProductScalar()
+
+
+template< class T >
+void
+GetSpatialJacobianScalar(
+  T * sj, T * const * mu,
+  const OffsetValueType * gridOffsetTable,
+  const T * weights1D, const T * derivativeWeights1D )
+{
+  const T * wx  = weights1D;
+  const T * wy  = weights1D + 4;
+  const T * wz  = weights1D + 8;
+  const T * dwx = derivativeWeights1D;
+  const T * dwy = derivativeWeights1D + 4;
+  const T * dwz = derivativeWeights1D + 8;
+
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    T accW[ 4 ]  = { 0, 0, 0, 0 };
+    T accDY[ 4 ] = { 0, 0, 0, 0 };
+    T accDZ[ 4 ] = { 0, 0, 0, 0 };
+    for( unsigned int c = 0; c < 4; ++c )
+    {
+      for( unsigned int b = 0; b < 4; ++b )
+      {
+        const T   w_zy  = wz[ c ] * wy[ b ];
+        const T   w_zdy = wz[ c ] * dwy[ b ];
+        const T   w_dzy = dwz[ c ] * wy[ b ];
+        const T * row   = mu[ j ] + b * gridOffsetTable[ 1 ] + c * gridOffsetTable[ 2 ];
+        for( unsigned int a = 0; a < 4; ++a )
+        {
+          accW[ a ]  += w_zy * row[ a ];
+          accDY[ a ] += w_zdy * row[ a ];
+          accDZ[ a ] += w_dzy * row[ a ];
+        }
+      }
+    }
+
+    T value = 0, dx = 0, dy = 0, dz = 0;
+    for( unsigned int a = 0; a < 4; ++a )
+    {
+      value += accW[ a ] * wx[ a ];
+      dx    += accW[ a ] * dwx[ a ];
+      dy    += accDY[ a ] * wx[ a ];
+      dz    += accDZ[ a ] * wx[ a ];
+    }
+    sj[ j ]     = value;
+    sj[ 3 + j ] = dx;
+    sj[ 6 + j ] = dy;
+    sj[ 9 + j ] = dz;
+  }
+
+} // end GetSpatialJacobianScalar()
+
+
+#ifdef ELX_RBS_SIMD
+
+/**
+ * ********************* SSE4.2 kernels ****************************
+ *
+ * A row of 4 coefficients is held in two 128-bit registers.
+ */
+
+ELX_RBS_TARGET( "sse4.2" ) inline double
+Dot4SSE( const __m128d lo, const __m128d hi, const double * w )
+{
+  const __m128d s = _mm_add_pd( _mm_mul_pd( lo, _mm_loadu_pd( w ) ), _mm_mul_pd( hi, _mm_loadu_pd( w + 2 ) ) );
+  return _mm_cvtsd_f64( _mm_hadd_pd( s, s ) );
+}
+
+
+ELX_RBS_TARGET( "sse4.2" ) void
+TransformPointSSE42(
+  double * opp, double * const * mu,
+  const OffsetValueType * gridOffsetTable, const double * weights1D )
+{
+  const double * wy = weights1D + 4;
+  const double * wz = weights1D + 8;
+
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    __m128d lo = _mm_setzero_pd();
+    __m128d hi = _mm_setzero_pd();
+    for( unsigned int c = 0; c < 4; ++c )
+    {
+      for( unsigned int b = 0; b < 4; ++b )
+      {
+        const __m128d  wzy = _mm_set1_pd( wz[ c ] * wy[ b ] );
+        const double * row = mu[ j ] + b * gridOffsetTable[ 1 ] + c * gridOffsetTable[ 2 ];
+        lo = _mm_add_pd( lo, _mm_mul_pd( wzy, _mm_loadu_pd( row ) ) );
+        hi = _mm_add_pd( hi, _mm_mul_pd( wzy, _mm_loadu_pd( row + 2 ) ) );
+      }
+    }
+    opp[ j ] = Dot4SSE( lo, hi, weights1D );
+  }
+
+} // end TransformPointSSE42()
+
+
+ELX_RBS_TARGET( "sse4.2" ) void
+EvaluateJacobianWithImageGradientProductSSE42(
+  double * imageJacobian, const double * movingImageGradient, const double * weights1D )
+{
+  const double * wy   = weights1D + 4;
+  const double * wz   = weights1D + 8;
+  const __m128d  wxlo = _mm_loadu_pd( weights1D );
+  const __m128d  wxhi = _mm_loadu_pd( weights1D + 2 );
+  const __m128d  g0   = _mm_set1_pd( movingImageGradient[ 0 ] );
+  const __m128d  g1   = _mm_set1_pd( movingImageGradient[ 1 ] );
+  const __m128d  g2   = _mm_set1_pd( movingImageGradient[ 2 ] );
+
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; ++b )
+    {
+      const __m128d  wzy = _mm_set1_pd( wz[ c ] * wy[ b ] );
+      const __m128d  lo  = _mm_mul_pd( wzy, wxlo );
+      const __m128d  hi  = _mm_mul_pd( wzy, wxhi );
+      double *       out = imageJacobian + 16 * c + 4 * b;
+      _mm_storeu_pd( out, _mm_mul_pd( lo, g0 ) );
+      _mm_storeu_pd( out + 2, _mm_mul_pd( hi, g0 ) );
+      _mm_storeu_pd( out + 64, _mm_mul_pd( lo, g1 ) );
+      _mm_storeu_pd( out + 66, _mm_mul_pd( hi, g1 ) );
+      _mm_storeu_pd( out + 128, _mm_mul_pd( lo, g2 ) );
+      _mm_storeu_pd( out + 130, _mm_mul_pd( hi, g2 ) );
+    }
+  }
+
+} // end EvaluateJacobianWithImageGradientProductSSE42()
+
+
+ELX_RBS_TARGET( "sse4.2" ) void
+GetSpatialJacobianSSE42(
+  double * sj, double * const * mu,
+  const OffsetValueType * gridOffsetTable,
+  const double * weights1D, const double * derivativeWeights1D )
+{
+  const double * wy  = weights1D + 4;
+  const double * wz  = weights1D + 8;
+  const double * dwy = derivativeWeights1D + 4;
+  const double * dwz = derivativeWeights1D + 8;
+
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    __m128d wlo = _mm_setzero_pd(), whi = _mm_setzero_pd();
+    __m128d ylo = _mm_setzero_pd(), yhi = _mm_setzero_pd();
+    __m128d zlo = _mm_setzero_pd(), zhi = _mm_setzero_pd();
+    for( unsigned int c = 0; c < 4; ++c )
+    {
+      for( unsigned int b = 0; b < 4; ++b )
+      {
+        const double * row   = mu[ j ] + b * gridOffsetTable[ 1 ] + c * gridOffsetTable[ 2 ];
+        const __m128d  rlo   = _mm_loadu_pd( row );
+        const __m128d  rhi   = _mm_loadu_pd( row + 2 );
+        const __m128d  w_zy  = _mm_set1_pd( wz[ c ] * wy[ b ] );
+        const __m128d  w_zdy = _mm_set1_pd( wz[ c ] * dwy[ b ] );
+        const __m128d  w_dzy = _mm_set1_pd( dwz[ c ] * wy[ b ] );
+        wlo = _mm_add_pd( wlo, _mm_mul_pd( w_zy, rlo ) );
+        whi = _mm_add_pd( whi, _mm_mul_pd( w_zy, rhi ) );
+        ylo = _mm_add_pd( ylo, _mm_mul_pd( w_zdy, rlo ) );
+        yhi = _mm_add_pd( yhi, _mm_mul_pd( w_zdy, rhi ) );
+        zlo = _mm_add_pd( zlo, _mm_mul_pd( w_dzy, rlo ) );
+        zhi = _mm_add_pd( zhi, _mm_mul_pd( w_dzy, rhi ) );
+      }
+    }
+    sj[ j ]     = Dot4SSE( wlo, whi, weights1D );
+    sj[ 3 + j ] = Dot4SSE( wlo, whi, derivativeWeights1D );
+    sj[ 6 + j ] = Dot4SSE( ylo, yhi, weights1D );
+    sj[ 9 + j ] = Dot4SSE( zlo, zhi, weights1D );
+  }
+
+} // end GetSpatialJacobianSSE42()
+
+
+/**
+ * ********************* AVX2 kernels ****************************
+ *
+ * A row of 4 coefficients is one 256-bit register. The three output
+ * dimensions are accumulated in independent registers, so that the fused
+ * multiply-adds of the output dimensions can be issued in parallel.
+ */
+
+ELX_RBS_TARGET( "avx2,fma" ) inline double
+Dot4AVX( const __m256d v, const double * w )
+{
+  const __m256d p = _mm256_mul_pd( v, _mm256_loadu_pd( w ) );
+  const __m128d s = _mm_add_pd( _mm256_castpd256_pd128( p ), _mm256_extractf128_pd( p, 1 ) );
+  return _mm_cvtsd_f64( _mm_add_sd( s, _mm_unpackhi_pd( s, s ) ) );
+}
+
+
+ELX_RBS_TARGET( "avx2,fma" ) void
+TransformPointAVX2(
+  double * opp, double * const * mu,
+  const OffsetValueType * gridOffsetTable, const double * weights1D )
+{
+  const double * wy = weights1D + 4;
+  const double * wz = weights1D + 8;
+
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  __m256d acc2 = _mm256_setzero_pd();
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; ++b )
+    {
+      const OffsetValueType offset = b * gridOffsetTable[ 1 ] + c * gridOffsetTable[ 2 ];
+      const __m256d         wzy    = _mm256_set1_pd( wz[ c ] * wy[ b ] );
+      acc0 = _mm256_fmadd_pd( wzy, _mm256_loadu_pd( mu[ 0 ] + offset ), acc0 );
+      acc1 = _mm256_fmadd_pd( wzy, _mm256_loadu_pd( mu[ 1 ] + offset ), acc1 );
+      acc2 = _mm256_fmadd_pd( wzy, _mm256_loadu_pd( mu[ 2 ] + offset ), acc2 );
+    }
+  }
+  opp[ 0 ] = Dot4AVX( acc0, weights1D );
+  opp[ 1 ] = Dot4AVX( acc1, weights1D );
+  opp[ 2 ] = Dot4AVX( acc2, weights1D );
+
+} // end TransformPointAVX2()
+
+
+ELX_RBS_TARGET( "avx2,fma" ) void
+EvaluateJacobianWithImageGradientProductAVX2(
+  double * imageJacobian, const double * movingImageGradient, const double * weights1D )
+{
+  const double * wy = weights1D + 4;
+  const double * wz = weights1D + 8;
+  const __m256d  wx = _mm256_loadu_pd( weights1D );
+  const __m256d  g0 = _mm256_set1_pd( movingImageGradient[ 0 ] );
+  const __m256d  g1 = _mm256_set1_pd( movingImageGradient[ 1 ] );
+  const __m256d  g2 = _mm256_set1_pd( movingImageGradient[ 2 ] );
+
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; ++b )
+    {
+      const __m256d w   = _mm256_mul_pd( _mm256_set1_pd( wz[ c ] * wy[ b ] ), wx );
+      double *      out = imageJacobian + 16 * c + 4 * b;
+      _mm256_storeu_pd( out, _mm256_mul_pd( w, g0 ) );
+      _mm256_storeu_pd( out + 64, _mm256_mul_pd( w, g1 ) );
+      _mm256_storeu_pd( out + 128, _mm256_mul_pd( w, g2 ) );
+    }
+  }
+
+} // end EvaluateJacobianWithImageGradientProductAVX2()
+
+
+ELX_RBS_TARGET( "avx2,fma" ) void
+GetSpatialJacobianAVX2(
+  double * sj, double * const * mu,
+  const OffsetValueType * gridOffsetTable,
+  const double * weights1D, const double * derivativeWeights1D )
+{
+  const double * wy  = weights1D + 4;
+  const double * wz  = weights1D + 8;
+  const double * dwy = derivativeWeights1D + 4;
+  const double * dwz = derivativeWeights1D + 8;
+
+  __m256d accW[ 3 ], accDY[ 3 ], accDZ[ 3 ];
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    accW[ j ]  = _mm256_setzero_pd();
+    accDY[ j ] = _mm256_setzero_pd();
+    accDZ[ j ] = _mm256_setzero_pd();
+  }
+
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; ++b )
+    {
+      const OffsetValueType offset = b * gridOffsetTable[ 1 ] + c * gridOffsetTable[ 2 ];
+      const __m256d         w_zy   = _mm256_set1_pd( wz[ c ] * wy[ b ] );
+      const __m256d         w_zdy  = _mm256_set1_pd( wz[ c ] * dwy[ b ] );
+      const __m256d         w_dzy  = _mm256_set1_pd( dwz[ c ] * wy[ b ] );
+      for( unsigned int j = 0; j < 3; ++j )
+      {
+        const __m256d row = _mm256_loadu_pd( mu[ j ] + offset );
+        accW[ j ]  = _mm256_fmadd_pd( w_zy, row, accW[ j ] );
+        accDY[ j ] = _mm256_fmadd_pd( w_zdy, row, accDY[ j ] );
+        accDZ[ j ] = _mm256_fmadd_pd( w_dzy, row, accDZ[ j ] );
+      }
+    }
+  }
+
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    sj[ j ]     = Dot4AVX( accW[ j ], weights1D );
+    sj[ 3 + j ] = Dot4AVX( accW[ j ], derivativeWeights1D );
+    sj[ 6 + j ] = Dot4AVX( accDY[ j ], weights1D );
+    sj[ 9 + j ] = Dot4AVX( accDZ[ j ], weights1D );
+  }
+
+} // end GetSpatialJacobianAVX2()
+
+
+/**
+ * ********************* AVX-512 kernels ****************************
+ *
+ * Two consecutive rows ( b, b + 1 ) of 4 coefficients are packed in one
+ * 512-bit register, halving the number of fused multiply-adds.
+ */
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) inline __m512d
+LoadTwoRows512( const double * row0, const double * row1 )
+{
+  /** Masked loads: lanes 0-3 from row0, lanes 4-7 from row1. Note that
+   * row1 - 4 >= row0, since the grid has at least 4 points along x.
+   */
+  return _mm512_mask_loadu_pd( _mm512_maskz_loadu_pd( 0x0F, row0 ), 0xF0, row1 - 4 );
+}
+
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) inline __m512d
+SetTwoWeights512( const double w0, const double w1 )
+{
+  return _mm512_set_pd( w1, w1, w1, w1, w0, w0, w0, w0 );
+}
+
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) inline double
+Dot4AVX512( const __m512d v, const double * w )
+{
+  /** Fold the two halves, then take the dot product with the 4 x-weights. */
+  double halves[ 8 ];
+  _mm512_storeu_pd( halves, v );
+  return Dot4AVX( _mm256_add_pd( _mm256_loadu_pd( halves ), _mm256_loadu_pd( halves + 4 ) ), w );
+}
+
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) void
+TransformPointAVX512(
+  double * opp, double * const * mu,
+  const OffsetValueType * gridOffsetTable, const double * weights1D )
+{
+  const double *        wy  = weights1D + 4;
+  const double *        wz  = weights1D + 8;
+  const OffsetValueType oy  = gridOffsetTable[ 1 ];
+
+  __m512d acc0 = _mm512_setzero_pd();
+  __m512d acc1 = _mm512_setzero_pd();
+  __m512d acc2 = _mm512_setzero_pd();
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; b += 2 )
+    {
+      const OffsetValueType offset = b * oy + c * gridOffsetTable[ 2 ];
+      const __m512d         wzy    = SetTwoWeights512( wz[ c ] * wy[ b ], wz[ c ] * wy[ b + 1 ] );
+      acc0 = _mm512_fmadd_pd( wzy, LoadTwoRows512( mu[ 0 ] + offset, mu[ 0 ] + offset + oy ), acc0 );
+      acc1 = _mm512_fmadd_pd( wzy, LoadTwoRows512( mu[ 1 ] + offset, mu[ 1 ] + offset + oy ), acc1 );
+      acc2 = _mm512_fmadd_pd( wzy, LoadTwoRows512( mu[ 2 ] + offset, mu[ 2 ] + offset + oy ), acc2 );
+    }
+  }
+  opp[ 0 ] = Dot4AVX512( acc0, weights1D );
+  opp[ 1 ] = Dot4AVX512( acc1, weights1D );
+  opp[ 2 ] = Dot4AVX512( acc2, weights1D );
+
+} // end TransformPointAVX512()
+
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) void
+EvaluateJacobianWithImageGradientProductAVX512(
+  double * imageJacobian, const double * movingImageGradient, const double * weights1D )
+{
+  const double * wy = weights1D + 4;
+  const double * wz = weights1D + 8;
+  const __m512d  wx = _mm512_set_pd( weights1D[ 3 ], weights1D[ 2 ], weights1D[ 1 ], weights1D[ 0 ],
+    weights1D[ 3 ], weights1D[ 2 ], weights1D[ 1 ], weights1D[ 0 ] );
+  const __m512d  g0 = _mm512_set1_pd( movingImageGradient[ 0 ] );
+  const __m512d  g1 = _mm512_set1_pd( movingImageGradient[ 1 ] );
+  const __m512d  g2 = _mm512_set1_pd( movingImageGradient[ 2 ] );
+
+  /** Rows b and b + 1 are consecutive in the output, so 8 values are stored at once. */
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; b += 2 )
+    {
+      const __m512d w   = _mm512_mul_pd( SetTwoWeights512( wz[ c ] * wy[ b ], wz[ c ] * wy[ b + 1 ] ), wx );
+      double *      out = imageJacobian + 16 * c + 4 * b;
+      _mm512_storeu_pd( out, _mm512_mul_pd( w, g0 ) );
+      _mm512_storeu_pd( out + 64, _mm512_mul_pd( w, g1 ) );
+      _mm512_storeu_pd( out + 128, _mm512_mul_pd( w, g2 ) );
+    }
+  }
+
+} // end EvaluateJacobianWithImageGradientProductAVX512()
+
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) void
+GetSpatialJacobianAVX512(
+  double * sj, double * const * mu,
+  const OffsetValueType * gridOffsetTable,
+  const double * weights1D, const double * derivativeWeights1D )
+{
+  const double *        wy  = weights1D + 4;
+  const double *        wz  = weights1D + 8;
+  const double *        dwy = derivativeWeights1D + 4;
+  const double *        dwz = derivativeWeights1D + 8;
+  const OffsetValueType oy  = gridOffsetTable[ 1 ];
+
+  __m512d accW[ 3 ], accDY[ 3 ], accDZ[ 3 ];
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    accW[ j ]  = _mm512_setzero_pd();
+    accDY[ j ] = _mm512_setzero_pd();
+    accDZ[ j ] = _mm512_setzero_pd();
+  }
+
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; b += 2 )
+    {
+      const OffsetValueType offset = b * oy + c * gridOffsetTable[ 2 ];
+      const __m512d         w_zy   = SetTwoWeights512( wz[ c ] * wy[ b ], wz[ c ] * wy[ b + 1 ] );
+      const __m512d         w_zdy  = SetTwoWeights512( wz[ c ] * dwy[ b ], wz[ c ] * dwy[ b + 1 ] );
+      const __m512d         w_dzy  = SetTwoWeights512( dwz[ c ] * wy[ b ], dwz[ c ] * wy[ b + 1 ] );
+      for( unsigned int j = 0; j < 3; ++j )
+      {
+        const __m512d rows = LoadTwoRows512( mu[ j ] + offset, mu[ j ] + offset + oy );
+        accW[ j ]  = _mm512_fmadd_pd( w_zy, rows, accW[ j ] );
+        accDY[ j ] = _mm512_fmadd_pd( w_zdy, rows, accDY[ j ] );
+        accDZ[ j ] = _mm512_fmadd_pd( w_dzy, rows, accDZ[ j ] );
+      }
+    }
+  }
+
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    sj[ j ]     = Dot4AVX512( accW[ j ], weights1D );
+    sj[ 3 + j ] = Dot4AVX512( accW[ j ], derivativeWeights1D );
+    sj[ 6 + j ] = Dot4AVX512( accDY[ j ], weights1D );
+    sj[ 9 + j ] = Dot4AVX512( accDZ[ j ], weights1D );
+  }
+
+} // end GetSpatialJacobianAVX512()
+
+
+/**
+ * ********************* Single precision SSE4.2 kernels ****************************
+ *
+ * In single precision a row of 4 coefficients is one 128-bit register.
+ */
+
+ELX_RBS_TARGET( "sse4.2" ) inline float
+Dot4SSEFloat( const __m128 v, const float * w )
+{
+  __m128 s = _mm_mul_ps( v, _mm_loadu_ps( w ) );
+  s = _mm_hadd_ps( s, s );
+  return _mm_cvtss_f32( _mm_hadd_ps( s, s ) );
+}
+
+
+ELX_RBS_TARGET( "sse4.2" ) void
+TransformPointFloatSSE42(
+  float * opp, float * const * mu,
+  const OffsetValueType * gridOffsetTable, const float * weights1D )
+{
+  const float * wy = weights1D + 4;
+  const float * wz = weights1D + 8;
+
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  __m128 acc2 = _mm_setzero_ps();
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; ++b )
+    {
+      const OffsetValueType offset = b * gridOffsetTable[ 1 ] + c * gridOffsetTable[ 2 ];
+      const __m128          wzy    = _mm_set1_ps( wz[ c ] * wy[ b ] );
+      acc0 = _mm_add_ps( acc0, _mm_mul_ps( wzy, _mm_loadu_ps( mu[ 0 ] + offset ) ) );
+      acc1 = _mm_add_ps( acc1, _mm_mul_ps( wzy, _mm_loadu_ps( mu[ 1 ] + offset ) ) );
+      acc2 = _mm_add_ps( acc2, _mm_mul_ps( wzy, _mm_loadu_ps( mu[ 2 ] + offset ) ) );
+    }
+  }
+  opp[ 0 ] = Dot4SSEFloat( acc0, weights1D );
+  opp[ 1 ] = Dot4SSEFloat( acc1, weights1D );
+  opp[ 2 ] = Dot4SSEFloat( acc2, weights1D );
+
+} // end TransformPointFloatSSE42()
+
+
+ELX_RBS_TARGET( "sse4.2" ) void
+GetSpatialJacobianFloatSSE42(
+  float * sj, float * const * mu,
+  const OffsetValueType * gridOffsetTable,
+  const float * weights1D, const float * derivativeWeights1D )
+{
+  const float * wy  = weights1D + 4;
+  const float * wz  = weights1D + 8;
+  const float * dwy = derivativeWeights1D + 4;
+  const float * dwz = derivativeWeights1D + 8;
+
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    __m128 accW  = _mm_setzero_ps();
+    __m128 accDY = _mm_setzero_ps();
+    __m128 accDZ = _mm_setzero_ps();
+    for( unsigned int c = 0; c < 4; ++c )
+    {
+      for( unsigned int b = 0; b < 4; ++b )
+      {
+        const __m128 row = _mm_loadu_ps( mu[ j ] + b * gridOffsetTable[ 1 ] + c * gridOffsetTable[ 2 ] );
+        accW  = _mm_add_ps( accW, _mm_mul_ps( _mm_set1_ps( wz[ c ] * wy[ b ] ), row ) );
+        accDY = _mm_add_ps( accDY, _mm_mul_ps( _mm_set1_ps( wz[ c ] * dwy[ b ] ), row ) );
+        accDZ = _mm_add_ps( accDZ, _mm_mul_ps( _mm_set1_ps( dwz[ c ] * wy[ b ] ), row ) );
+      }
+    }
+    sj[ j ]     = Dot4SSEFloat( accW, weights1D );
+    sj[ 3 + j ] = Dot4SSEFloat( accW, derivativeWeights1D );
+    sj[ 6 + j ] = Dot4SSEFloat( accDY, weights1D );
+    sj[ 9 + j ] = Dot4SSEFloat( accDZ, weights1D );
+  }
+
+} // end GetSpatialJacobianFloatSSE42()
+
+
+/**
+ * ********************* Single precision AVX2 kernels ****************************
+ *
+ * Two consecutive rows ( b, b + 1 ) of 4 coefficients are packed in one
+ * 256-bit register, i.e. twice the work per instruction of double precision.
+ */
+
+ELX_RBS_TARGET( "avx2,fma" ) inline __m256
+LoadTwoRowsFloat256( const float * row0, const float * row1 )
+{
+  return _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( row0 ) ), _mm_loadu_ps( row1 ), 1 );
+}
+
+
+ELX_RBS_TARGET( "avx2,fma" ) inline __m256
+SetTwoWeightsFloat256( const float w0, const float w1 )
+{
+  return _mm256_set_ps( w1, w1, w1, w1, w0, w0, w0, w0 );
+}
+
+
+ELX_RBS_TARGET( "avx2,fma" ) inline float
+Dot4AVXFloat( const __m256 v, const float * w )
+{
+  /** Fold the two halves, then take the dot product with the 4 x-weights. */
+  return Dot4SSEFloat( _mm_add_ps( _mm256_castps256_ps128( v ), _mm256_extractf128_ps( v, 1 ) ), w );
+}
+
+
+ELX_RBS_TARGET( "avx2,fma" ) void
+TransformPointFloatAVX2(
+  float * opp, float * const * mu,
+  const OffsetValueType * gridOffsetTable, const float * weights1D )
+{
+  const float *         wy = weights1D + 4;
+  const float *         wz = weights1D + 8;
+  const OffsetValueType oy = gridOffsetTable[ 1 ];
+
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  __m256 acc2 = _mm256_setzero_ps();
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; b += 2 )
+    {
+      const OffsetValueType offset = b * oy + c * gridOffsetTable[ 2 ];
+      const __m256          wzy    = SetTwoWeightsFloat256( wz[ c ] * wy[ b ], wz[ c ] * wy[ b + 1 ] );
+      acc0 = _mm256_fmadd_ps( wzy, LoadTwoRowsFloat256( mu[ 0 ] + offset, mu[ 0 ] + offset + oy ), acc0 );
+      acc1 = _mm256_fmadd_ps( wzy, LoadTwoRowsFloat256( mu[ 1 ] + offset, mu[ 1 ] + offset + oy ), acc1 );
+      acc2 = _mm256_fmadd_ps( wzy, LoadTwoRowsFloat256( mu[ 2 ] + offset, mu[ 2 ] + offset + oy ), acc2 );
+    }
+  }
+  opp[ 0 ] = Dot4AVXFloat( acc0, weights1D );
+  opp[ 1 ] = Dot4AVXFloat( acc1, weights1D );
+  opp[ 2 ] = Dot4AVXFloat( acc2, weights1D );
+
+} // end TransformPointFloatAVX2()
+
+
+ELX_RBS_TARGET( "avx2,fma" ) void
+GetSpatialJacobianFloatAVX2(
+  float * sj, float * const * mu,
+  const OffsetValueType * gridOffsetTable,
+  const float * weights1D, const float * derivativeWeights1D )
+{
+  const float *         wy  = weights1D + 4;
+  const float *         wz  = weights1D + 8;
+  const float *         dwy = derivativeWeights1D + 4;
+  const float *         dwz = derivativeWeights1D + 8;
+  const OffsetValueType oy  = gridOffsetTable[ 1 ];
+
+  __m256 accW[ 3 ], accDY[ 3 ], accDZ[ 3 ];
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    accW[ j ]  = _mm256_setzero_ps();
+    accDY[ j ] = _mm256_setzero_ps();
+    accDZ[ j ] = _mm256_setzero_ps();
+  }
+
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    for( unsigned int b = 0; b < 4; b += 2 )
+    {
+      const OffsetValueType offset = b * oy + c * gridOffsetTable[ 2 ];
+      const __m256          w_zy   = SetTwoWeightsFloat256( wz[ c ] * wy[ b ], wz[ c ] * wy[ b + 1 ] );
+      const __m256          w_zdy  = SetTwoWeightsFloat256( wz[ c ] * dwy[ b ], wz[ c ] * dwy[ b + 1 ] );
+      const __m256          w_dzy  = SetTwoWeightsFloat256( dwz[ c ] * wy[ b ], dwz[ c ] * wy[ b + 1 ] );
+      for( unsigned int j = 0; j < 3; ++j )
+      {
+        const __m256 rows = LoadTwoRowsFloat256( mu[ j ] + offset, mu[ j ] + offset + oy );
+        accW[ j ]  = _mm256_fmadd_ps( w_zy, rows, accW[ j ] );
+        accDY[ j ] = _mm256_fmadd_ps( w_zdy, rows, accDY[ j ] );
+        accDZ[ j ] = _mm256_fmadd_ps( w_dzy, rows, accDZ[ j ] );
+      }
+    }
+  }
+
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    sj[ j ]     = Dot4AVXFloat( accW[ j ], weights1D );
+    sj[ 3 + j ] = Dot4AVXFloat( accW[ j ], derivativeWeights1D );
+    sj[ 6 + j ] = Dot4AVXFloat( accDY[ j ], weights1D );
+    sj[ 9 + j ] = Dot4AVXFloat( accDZ[ j ], weights1D );
+  }
+
+} // end GetSpatialJacobianFloatAVX2()
+
+
+/**
+ * ********************* Single precision AVX-512 kernels ****************************
+ *
+ * All 4 rows ( b = 0..3 ) of a slice c are packed in one 512-bit register.
+ */
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) inline __m512
+LoadFourRowsFloat512( const float * row0, const OffsetValueType oy )
+{
+  /** Masked loads: lanes 4b-4b+3 from row b. Since the grid has at least
+   * 4 points along x, row0 + b * ( oy - 4 ) >= row0.
+   */
+  __m512 v = _mm512_maskz_loadu_ps( 0x000F, row0 );
+  v = _mm512_mask_loadu_ps( v, 0x00F0, row0 + oy - 4 );
+  v = _mm512_mask_loadu_ps( v, 0x0F00, row0 + 2 * oy - 8 );
+  return _mm512_mask_loadu_ps( v, 0xF000, row0 + 3 * oy - 12 );
+}
+
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) inline __m512
+SetFourWeightsFloat512( const float wc, const float * w )
+{
+  const float w0 = wc * w[ 0 ], w1 = wc * w[ 1 ], w2 = wc * w[ 2 ], w3 = wc * w[ 3 ];
+  return _mm512_set_ps( w3, w3, w3, w3, w2, w2, w2, w2, w1, w1, w1, w1, w0, w0, w0, w0 );
+}
+
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) inline float
+Dot4AVX512Float( const __m512 v, const float * w )
+{
+  /** Fold the four rows, then take the dot product with the 4 x-weights. */
+  float rows[ 16 ];
+  _mm512_storeu_ps( rows, v );
+  const __m128 f = _mm_add_ps( _mm_add_ps( _mm_loadu_ps( rows ), _mm_loadu_ps( rows + 4 ) ),
+    _mm_add_ps( _mm_loadu_ps( rows + 8 ), _mm_loadu_ps( rows + 12 ) ) );
+  return Dot4SSEFloat( f, w );
+}
+
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) void
+TransformPointFloatAVX512(
+  float * opp, float * const * mu,
+  const OffsetValueType * gridOffsetTable, const float * weights1D )
+{
+  const float *         wy = weights1D + 4;
+  const float *         wz = weights1D + 8;
+  const OffsetValueType oy = gridOffsetTable[ 1 ];
+
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+  __m512 acc2 = _mm512_setzero_ps();
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    const OffsetValueType offset = c * gridOffsetTable[ 2 ];
+    const __m512          wzy    = SetFourWeightsFloat512( wz[ c ], wy );
+    acc0 = _mm512_fmadd_ps( wzy, LoadFourRowsFloat512( mu[ 0 ] + offset, oy ), acc0 );
+    acc1 = _mm512_fmadd_ps( wzy, LoadFourRowsFloat512( mu[ 1 ] + offset, oy ), acc1 );
+    acc2 = _mm512_fmadd_ps( wzy, LoadFourRowsFloat512( mu[ 2 ] + offset, oy ), acc2 );
+  }
+  opp[ 0 ] = Dot4AVX512Float( acc0, weights1D );
+  opp[ 1 ] = Dot4AVX512Float( acc1, weights1D );
+  opp[ 2 ] = Dot4AVX512Float( acc2, weights1D );
+
+} // end TransformPointFloatAVX512()
+
+
+ELX_RBS_TARGET( "avx512f,avx2,fma" ) void
+GetSpatialJacobianFloatAVX512(
+  float * sj, float * const * mu,
+  const OffsetValueType * gridOffsetTable,
+  const float * weights1D, const float * derivativeWeights1D )
+{
+  const float *         wy  = weights1D + 4;
+  const float *         wz  = weights1D + 8;
+  const float *         dwy = derivativeWeights1D + 4;
+  const float *         dwz = derivativeWeights1D + 8;
+  const OffsetValueType oy  = gridOffsetTable[ 1 ];
+
+  __m512 accW[ 3 ], accDY[ 3 ], accDZ[ 3 ];
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    accW[ j ]  = _mm512_setzero_ps();
+    accDY[ j ] = _mm512_setzero_ps();
+    accDZ[ j ] = _mm512_setzero_ps();
+  }
+
+  for( unsigned int c = 0; c < 4; ++c )
+  {
+    const OffsetValueType offset = c * gridOffsetTable[ 2 ];
+    const __m512          w_zy   = SetFourWeightsFloat512( wz[ c ], wy );
+    const __m512          w_zdy  = SetFourWeightsFloat512( wz[ c ], dwy );
+    const __m512          w_dzy  = SetFourWeightsFloat512( dwz[ c ], wy );
+    for( unsigned int j = 0; j < 3; ++j )
+    {
+      const __m512 rows = LoadFourRowsFloat512( mu[ j ] + offset, oy );
+      accW[ j ]  = _mm512_fmadd_ps( w_zy, rows, accW[ j ] );
+      accDY[ j ] = _mm512_fmadd_ps( w_zdy, rows, accDY[ j ] );
+      accDZ[ j ] = _mm512_fmadd_ps( w_dzy, rows, accDZ[ j ] );
+    }
+  }
+
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    sj[ j ]     = Dot4AVX512Float( accW[ j ], weights1D );
+    sj[ 3 + j ] = Dot4AVX512Float( accW[ j ], derivativeWeights1D );
+    sj[ 6 + j ] = Dot4AVX512Float( accDY[ j ], weights1D );
+    sj[ 9 + j ] = Dot4AVX512Float( accDZ[ j ], weights1D );
+  }
+
+} // end GetSpatialJacobianFloatAVX512()
+
+
+/**
+ * ********************* DetectInstructionSet ****************************
+ */
+
+RecursiveBSplineTransformSIMD::InstructionSetType
+DetectInstructionSet( void )
+{
+#if defined( __GNUC__ )
+  __builtin_cpu_init();
+  const bool sse42  = __builtin_cpu_supports( "sse4.2" );
+  const bool avx2   = __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "fma" );
+  const bool avx512 = avx2 && __builtin_cpu_supports( "avx512f" );
+#else
+  /** Query cpuid, and check with xgetbv that the OS saves the AVX(-512) registers. */
+  int info[ 4 ];
+  __cpuid( info, 0 );
+  const int maxLeaf = info[ 0 ];
+
+  __cpuid( info, 1 );
+  const bool sse42   = ( info[ 2 ] & ( 1 << 20 ) ) != 0;
+  const bool fma     = ( info[ 2 ] & ( 1 << 12 ) ) != 0;
+  const bool osxsave = ( info[ 2 ] & ( 1 << 27 ) ) != 0;
+  const bool avx     = ( info[ 2 ] & ( 1 << 28 ) ) != 0;
+
+  unsigned long long xcr0 = 0;
+  if( osxsave )
+  {
+    xcr0 = _xgetbv( 0 );
+  }
+  const bool osAVX    = ( xcr0 & 0x06 ) == 0x06;
+  const bool osAVX512 = ( xcr0 & 0xE6 ) == 0xE6;
+
+  bool avx2Flag = false, avx512Flag = false;
+  if( maxLeaf >= 7 )
+  {
+    __cpuidex( info, 7, 0 );
+    avx2Flag   = ( info[ 1 ] & ( 1 << 5 ) ) != 0;
+    avx512Flag = ( info[ 1 ] & ( 1 << 16 ) ) != 0;
+  }
+  const bool avx2   = avx && fma && avx2Flag && osAVX;
+  const bool avx512 = avx2 && avx512Flag && osAVX512;
+#endif
+
+  if( avx512 ) { return RecursiveBSplineTransformSIMD::AVX512; }
+  if( avx2 ) { return RecursiveBSplineTransformSIMD::AVX2; }
+  if( sse42 ) { return RecursiveBSplineTransformSIMD::SSE42; }
+  return RecursiveBSplineTransformSIMD::Scalar;
+
+} // end DetectInstructionSet()
+
+
+#else // ELX_RBS_SIMD
+
+RecursiveBSplineTransformSIMD::InstructionSetType
+DetectInstructionSet( void )
+{
+  return RecursiveBSplineTransformSIMD::Scalar;
+}
+
+
+#endif // ELX_RBS_SIMD
+
+/**
+ * ********************* KernelTable ****************************
+ *
+ * The kernels of the selected instruction set. Created on first use.
+ */
+
+struct KernelTable
+{
+  RecursiveBSplineTransformSIMD::InstructionSetType    m_InstructionSet;
+  TransformPointFunctionType                           m_TransformPoint;
+  EvaluateJacobianWithImageGradientProductFunctionType m_EvaluateJacobianWithImageGradientProduct;
+  GetSpatialJacobianFunctionType                       m_GetSpatialJacobian;
+  TransformPointFloatFunctionType                      m_TransformPointFloat;
+  GetSpatialJacobianFloatFunctionType                  m_GetSpatialJacobianFloat;
+
+  void Select( const RecursiveBSplineTransformSIMD::InstructionSetType instructionSet )
+  {
+    this->m_InstructionSet                           = instructionSet;
+    this->m_TransformPoint                           = &TransformPointScalar< double >;
+    this->m_EvaluateJacobianWithImageGradientProduct = &EvaluateJacobianWithImageGradientProductScalar;
+    this->m_GetSpatialJacobian                       = &GetSpatialJacobianScalar< double >;
+    this->m_TransformPointFloat                      = &TransformPointScalar< float >;
+    this->m_GetSpatialJacobianFloat                  = &GetSpatialJacobianScalar< float >;
+#ifdef ELX_RBS_SIMD
+    switch( instructionSet )
+    {
+      case RecursiveBSplineTransformSIMD::AVX512:
+        this->m_TransformPoint                           = &TransformPointAVX512;
+        this->m_EvaluateJacobianWithImageGradientProduct = &EvaluateJacobianWithImageGradientProductAVX512;
+        this->m_GetSpatialJacobian                       = &GetSpatialJacobianAVX512;
+        this->m_TransformPointFloat                      = &TransformPointFloatAVX512;
+        this->m_GetSpatialJacobianFloat                  = &GetSpatialJacobianFloatAVX512;
+        break;
+      case RecursiveBSplineTransformSIMD::AVX2:
+        this->m_TransformPoint                           = &TransformPointAVX2;
+        this->m_EvaluateJacobianWithImageGradientProduct = &EvaluateJacobianWithImageGradientProductAVX2;
+        this->m_GetSpatialJacobian                       = &GetSpatialJacobianAVX2;
+        this->m_TransformPointFloat                      = &TransformPointFloatAVX2;
+        this->m_GetSpatialJacobianFloat                  = &GetSpatialJacobianFloatAVX2;
+        break;
+      case RecursiveBSplineTransformSIMD::SSE42:
+        this->m_TransformPoint                           = &TransformPointSSE42;
+        this->m_EvaluateJacobianWithImageGradientProduct = &EvaluateJacobianWithImageGradientProductSSE42;
+        this->m_GetSpatialJacobian                       = &GetSpatialJacobianSSE42;
+        this->m_TransformPointFloat                      = &TransformPointFloatSSE42;
+        this->m_GetSpatialJacobianFloat                  = &GetSpatialJacobianFloatSSE42;
+        break;
+      default:
+        break;
+    }
+#endif
+  }
+
+
+};
+
+RecursiveBSplineTransformSIMD::InstructionSetType
+GetDetectedInstructionSet( void )
+{
+  static const RecursiveBSplineTransformSIMD::InstructionSetType detected = DetectInstructionSet();
+  return detected;
+}
+
+
+KernelTable &
+GetKernelTable( void )
+{
+  struct Initializer
+  {
+    KernelTable m_Table;
+    Initializer() { this->m_Table.Select( GetDetectedInstructionSet() ); }
+  };
+  static Initializer initializer;
+  return initializer.m_Table;
+}
+
+
+} // end anonymous namespace
+
+/**
+ * ********************* Public interface ****************************
+ */
+
+RecursiveBSplineTransformSIMD::InstructionSetType
+RecursiveBSplineTransformSIMD::GetInstructionSet( void )
+{
+  return GetKernelTable().m_InstructionSet;
+}
+
+
+RecursiveBSplineTransformSIMD::InstructionSetType
+RecursiveBSplineTransformSIMD::GetSupportedInstructionSet( void )
+{
+  return GetDetectedInstructionSet();
+}
+
+
+void
+RecursiveBSplineTransformSIMD::SetInstructionSet( InstructionSetType instructionSet )
+{
+  const InstructionSetType supported = GetDetectedInstructionSet();
+  GetKernelTable().Select( instructionSet < supported ? instructionSet : supported );
+}
+
+
+const char *
+RecursiveBSplineTransformSIMD::GetInstructionSetName( InstructionSetType instructionSet )
+{
+  switch( instructionSet )
+  {
+    case AVX512: return "AVX-512";
+    case AVX2: return "AVX2";
+    case SSE42: return "SSE4.2";
+    default: return "Scalar";
+  }
+}
+
+
+void
+RecursiveBSplineTransformSIMD::TransformPoint(
+  double * opp, double * const * mu,
+  const OffsetValueType * gridOffsetTable, const double * weights1D )
+{
+  GetKernelTable().m_TransformPoint( opp, mu, gridOffsetTable, weights1D );
+}
+
+
+void
+RecursiveBSplineTransformSIMD::EvaluateJacobianWithImageGradientProduct(
+  double * imageJacobian, const double * movingImageGradient, const double * weights1D )
+{
+  GetKernelTable().m_EvaluateJacobianWithImageGradientProduct( imageJacobian, movingImageGradient, weights1D );
+}
+
+
+void
+RecursiveBSplineTransformSIMD::GetSpatialJacobian(
+  double * sj, double * const * mu,
+  const OffsetValueType * gridOffsetTable,
+  const double * weights1D, const double * derivativeWeights1D )
+{
+  GetKernelTable().m_GetSpatialJacobian( sj, mu, gridOffsetTable, weights1D, derivativeWeights1D );
+}
+
+
+void
+RecursiveBSplineTransformSIMD::TransformPoint(
+  float * opp, float * const * mu,
+  const OffsetValueType * gridOffsetTable, const float * weights1D )
+{
+  GetKernelTable().m_TransformPointFloat( opp, mu, gridOffsetTable, weights1D );
+}
+
+
+void
+RecursiveBSplineTransformSIMD::GetSpatialJacobian(
+  float * sj, float * const * mu,
+  const OffsetValueType * gridOffsetTable,
+  const float * weights1D, const float * derivativeWeights1D )
+{
+  GetKernelTable().m_GetSpatialJacobianFloat( sj, mu, gridOffsetTable, weights1D, derivativeWeights1D );
+}
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkRecursiveBSplineTransformSIMD_cxx
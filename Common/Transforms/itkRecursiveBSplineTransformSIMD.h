@@ -0,0 +1,126 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRecursiveBSplineTransformSIMD_h
+#define __itkRecursiveBSplineTransformSIMD_h
+
+#include "itkIntTypes.h"
+
+namespace itk
+{
+
+/** \class RecursiveBSplineTransformSIMD
+ *
+ * \brief Explicitly vectorised kernels for the 3D cubic recursive B-spline transform.
+ *
+ * The generic RecursiveBSplineTransformImplementation recurses over the
+ * dimensions with scalar arithmetic. For the by far most common case, a 3D
+ * transform with cubic B-splines and double coefficients, this class provides
+ * non-recursive kernels that process the 4 B-spline weights of the innermost
+ * dimension in one SIMD register. Along the innermost dimension the coefficients
+ * are contiguous in memory, so every 4 coefficients are a single vector load.
+ *
+ * Several versions of every kernel are compiled: scalar, SSE4.2, AVX2 (+FMA)
+ * and AVX-512. The best version that the CPU supports is selected at run-time,
+ * once, on first use. The SIMD versions are only compiled for x86 with GCC,
+ * Clang or MSVC; on other platforms the scalar version is used.
+ *
+ * TransformPoint and GetSpatialJacobian also have a single precision version,
+ * used when the transform works on float coefficients. In single precision two
+ * (AVX2) or four (AVX-512) rows of coefficients fit in one register.
+ *
+ * The data layouts are those of the generic implementation, so the kernels can
+ * be used as drop-in replacements in RecursiveBSplineTransformImplementation:
+ * - weights1D holds 4 weights per dimension: [ x0..x3, y0..y3, z0..z3 ];
+ * - mu holds, per output dimension, a pointer to the first coefficient of the
+ *   support region; gridOffsetTable is the offset table of the coefficient image.
+ *
+ * \ingroup Transforms
+ */
+
+class RecursiveBSplineTransformSIMD
+{
+public:
+
+  /** The instruction sets for which the kernels are compiled. */
+  typedef enum {
+    Scalar = 0,
+    SSE42  = 1,
+    AVX2   = 2,
+    AVX512 = 3
+  } InstructionSetType;
+
+  /** The instruction set that is currently used by the kernels. */
+  static InstructionSetType GetInstructionSet( void );
+
+  /** The best instruction set supported by this CPU (and build). */
+  static InstructionSetType GetSupportedInstructionSet( void );
+
+  /** Select the instruction set, e.g. to compare against the scalar version.
+   * The request is clamped to GetSupportedInstructionSet(). Not thread-safe:
+   * do not call this while kernels are being evaluated.
+   */
+  static void SetInstructionSet( InstructionSetType instructionSet );
+
+  /** A name for printing, e.g. "AVX2". */
+  static const char * GetInstructionSetName( InstructionSetType instructionSet );
+
+  /** The displacement at a point: opp[ j ] = sum_{abc} w_z[c] w_y[b] w_x[a] mu_j[a,b,c]. */
+  static void TransformPoint(
+    double * opp,
+    double * const * mu,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D );
+
+  /** The inner product of the Jacobian with the moving image gradient. The
+   * output has the layout of the generic implementation:
+   *   imageJacobian[ j * 64 + 16 c + 4 b + a ] = w_z[c] w_y[b] w_x[a] g[ j ].
+   */
+  static void EvaluateJacobianWithImageGradientProduct(
+    double * imageJacobian,
+    const double * movingImageGradient,
+    const double * weights1D );
+
+  /** The spatial Jacobian in grid index space, with the displacement as a by-product:
+   *   sj[ j ] = displacement, sj[ 3 ( d + 1 ) + j ] = d displacement_j / d x_d.
+   */
+  static void GetSpatialJacobian(
+    double * sj,
+    double * const * mu,
+    const OffsetValueType * gridOffsetTable,
+    const double * weights1D,
+    const double * derivativeWeights1D );
+
+  /** Single precision versions of TransformPoint() and GetSpatialJacobian(). */
+  static void TransformPoint(
+    float * opp,
+    float * const * mu,
+    const OffsetValueType * gridOffsetTable,
+    const float * weights1D );
+
+  static void GetSpatialJacobian(
+    float * sj,
+    float * const * mu,
+    const OffsetValueType * gridOffsetTable,
+    const float * weights1D,
+    const float * derivativeWeights1D );
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkRecursiveBSplineTransformSIMD_h
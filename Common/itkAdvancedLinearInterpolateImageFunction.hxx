@@ -20,8 +20,11 @@
 
 #include "itkAdvancedLinearInterpolateImageFunction.h"
 
+#include "itkImageRegionConstIteratorWithIndex.h"
 #include "vnl/vnl_math.h"
 
+#include <algorithm> // For min.
+
 namespace itk
 {
 
@@ -32,7 +35,125 @@ namespace itk
 template< class TInputImage, class TCoordRep >
 AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
 ::AdvancedLinearInterpolateImageFunction()
-{}
+{
+  this->m_UseBrickedLayout = false;
+
+} // end Constructor
+
+
+/**
+ * ***************** SetInputImage ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::SetInputImage( const InputImageType * ptr )
+{
+  this->Superclass::SetInputImage( ptr );
+  this->UpdateBrickedLayout();
+
+} // end SetInputImage()
+
+
+/**
+ * ***************** SetUseBrickedLayout ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::SetUseBrickedLayout( const bool _arg )
+{
+  if( this->m_UseBrickedLayout != _arg )
+  {
+    this->m_UseBrickedLayout = _arg;
+    this->UpdateBrickedLayout();
+    this->Modified();
+  }
+
+} // end SetUseBrickedLayout()
+
+
+/**
+ * ***************** UpdateBrickedLayout ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::UpdateBrickedLayout( void )
+{
+  /** Release the memory of the copy when it is not used. */
+  const InputImageType * inputImage = this->GetInputImage();
+  if( !this->m_UseBrickedLayout || inputImage == nullptr )
+  {
+    std::vector< InputPixelType >().swap( this->m_BrickedBuffer );
+    for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+    {
+      std::vector< OffsetValueType >().swap( this->m_BrickedOffsetTables[ dim ] );
+    }
+    return;
+  }
+
+  /** The offset of index i in dimension dim is the offset of its brick plus
+   * the offset within the brick, so that the offset of a pixel is the sum of
+   * the offsets of its index over the dimensions.
+   */
+  const typename InputImageType::RegionType & region = inputImage->GetBufferedRegion();
+  OffsetValueType brickStride = 1;
+  for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+  {
+    brickStride *= BrickSize;
+  }
+  OffsetValueType pixelStride = 1;
+  for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+  {
+    const OffsetValueType size           = region.GetSize()[ dim ];
+    const OffsetValueType numberOfBricks = ( size + BrickSize - 1 ) / BrickSize;
+    this->m_BrickedOffsetTables[ dim ].resize( size );
+    for( OffsetValueType i = 0; i < size; ++i )
+    {
+      this->m_BrickedOffsetTables[ dim ][ i ]
+        = ( i / BrickSize ) * brickStride + ( i % BrickSize ) * pixelStride;
+    }
+    brickStride *= numberOfBricks;
+    pixelStride *= BrickSize;
+  }
+
+  /** Copy the image. The bricks on the border are padded with zeros. */
+  this->m_BrickedBuffer.assign( brickStride, NumericTraits< InputPixelType >::ZeroValue() );
+  ImageRegionConstIteratorWithIndex< InputImageType > it( inputImage, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const IndexType & index  = it.GetIndex();
+    OffsetValueType   offset = 0;
+    for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+    {
+      offset += this->m_BrickedOffsetTables[ dim ][ index[ dim ] - region.GetIndex()[ dim ] ];
+    }
+    this->m_BrickedBuffer[ offset ] = it.Get();
+  }
+
+} // end UpdateBrickedLayout()
+
+
+/**
+ * ***************** PrintSelf ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "UseBrickedLayout: "
+     << ( this->m_UseBrickedLayout ? "true" : "false" ) << std::endl;
+
+} // end PrintSelf()
+
 
 /**
  * ***************** EvaluateDerivativeAtContinuousIndex ***********************
@@ -269,6 +390,260 @@ AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
 } // end EvaluateValueAndDerivativeOptimized()
 
 
+/**
+ * ***************** ComputeBatchCornerOffsets ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::ComputeBatchCornerOffsets(
+  const ContinuousIndexType * x,
+  const unsigned int blockSize,
+  OffsetValueType lowerOffsets[][ BatchBlockSize ],
+  OffsetValueType upperOffsets[][ BatchBlockSize ],
+  double dist[][ BatchBlockSize ],
+  double derivSign[][ BatchBlockSize ] ) const
+{
+  // Get some handles
+  const InputImageType *        inputImage  = this->GetInputImage();
+  const InputImageSpacingType & spacing     = inputImage->GetSpacing();
+  const OffsetValueType *       offsetTable = inputImage->GetOffsetTable();
+  const IndexType &             bufferStart = inputImage->GetBufferedRegion().GetIndex();
+
+  for( unsigned int dim = 0; dim < ImageDimension; dim++ )
+  {
+    const double startIndex = this->m_StartIndex[ dim ];
+    const double endIndex   = this->m_EndIndex[ dim ];
+    const double invSpacing = 1.0 / spacing[ dim ];
+    for( unsigned int i = 0; i < blockSize; ++i )
+    {
+      /** Create a possibly mirrored version of x, as in the single index methods. */
+      ContinuousIndexValueType xm   = x[ i ][ dim ];
+      double                   sign = invSpacing;
+      if( x[ i ][ dim ] < startIndex )
+      {
+        xm    = 2.0 * startIndex - x[ i ][ dim ];
+        sign *= -1.0;
+      }
+      if( x[ i ][ dim ] > endIndex )
+      {
+        xm    = 2.0 * endIndex - x[ i ][ dim ];
+        sign *= -1.0;
+      }
+      if( Math::FloatAlmostEqual( xm, static_cast< ContinuousIndexValueType >( this->m_EndIndex[ dim ] ) ) )
+      {
+        xm -= 0.000001;
+      }
+
+      /** Compute the base index and the distance from the point to it. */
+      const IndexValueType baseIndex = Math::Floor< IndexValueType >( xm );
+      dist[ dim ][ i ]         = xm - static_cast< double >( baseIndex );
+      derivSign[ dim ][ i ]    = sign;
+      lowerOffsets[ dim ][ i ] = baseIndex - bufferStart[ dim ];
+    }
+
+    /** Convert the indices to offsets in the buffer that is read. */
+    if( this->m_UseBrickedLayout )
+    {
+      const OffsetValueType * table = this->m_BrickedOffsetTables[ dim ].data();
+      for( unsigned int i = 0; i < blockSize; ++i )
+      {
+        upperOffsets[ dim ][ i ] = table[ lowerOffsets[ dim ][ i ] + 1 ];
+        lowerOffsets[ dim ][ i ] = table[ lowerOffsets[ dim ][ i ] ];
+      }
+    }
+    else
+    {
+      /** As in Image::ComputeOffset(). */
+      const OffsetValueType stride = offsetTable[ dim ];
+      for( unsigned int i = 0; i < blockSize; ++i )
+      {
+        lowerOffsets[ dim ][ i ] *= stride;
+        upperOffsets[ dim ][ i ]  = lowerOffsets[ dim ][ i ] + stride;
+      }
+    }
+  }
+
+} // end ComputeBatchCornerOffsets()
+
+
+/**
+ * ***************** EvaluateValueAndDerivativeBatchOptimized ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::EvaluateValueAndDerivativeBatchOptimized(
+  const Dispatch< 2 > &,
+  const ContinuousIndexType * x,
+  OutputType * values,
+  CovariantVectorType * derivs,
+  const SizeValueType numberOfIndices ) const
+{
+  // Get some handles
+  const InputImageType * inputImage = this->GetInputImage();
+  const InputPixelType * buffer     = this->GetBatchBuffer();
+
+  OffsetValueType lo[ ImageDimension ][ BatchBlockSize ];
+  OffsetValueType hi[ ImageDimension ][ BatchBlockSize ];
+  double          dist[ ImageDimension ][ BatchBlockSize ];
+  double          derivSign[ ImageDimension ][ BatchBlockSize ];
+  RealType        val00[ BatchBlockSize ], val10[ BatchBlockSize ];
+  RealType        val01[ BatchBlockSize ], val11[ BatchBlockSize ];
+
+  for( SizeValueType blockStart = 0; blockStart < numberOfIndices; blockStart += BatchBlockSize )
+  {
+    const unsigned int blockSize = static_cast< unsigned int >(
+      std::min( static_cast< SizeValueType >( BatchBlockSize ), numberOfIndices - blockStart ) );
+    this->ComputeBatchCornerOffsets( x + blockStart, blockSize, lo, hi, dist, derivSign );
+
+    /** Gather the 4 corner values. */
+    for( unsigned int i = 0; i < blockSize; ++i )
+    {
+      val00[ i ] = buffer[ lo[ 0 ][ i ] + lo[ 1 ][ i ] ];
+      val10[ i ] = buffer[ hi[ 0 ][ i ] + lo[ 1 ][ i ] ];
+      val01[ i ] = buffer[ lo[ 0 ][ i ] + hi[ 1 ][ i ] ];
+      val11[ i ] = buffer[ hi[ 0 ][ i ] + hi[ 1 ][ i ] ];
+    }
+
+    /** Interpolate to get the values and derivatives. */
+    for( unsigned int i = 0; i < blockSize; ++i )
+    {
+      const double dist0 = dist[ 0 ][ i ];
+      const double dist1 = dist[ 1 ][ i ];
+      const double dinv0 = 1.0 - dist0;
+      const double dinv1 = 1.0 - dist1;
+
+      values[ blockStart + i ] = static_cast< OutputType >(
+        val00[ i ] * dinv0 * dinv1
+        + val10[ i ] * dist0 * dinv1
+        + val01[ i ] * dinv0 * dist1
+        + val11[ i ] * dist0 * dist1 );
+
+      CovariantVectorType & deriv = derivs[ blockStart + i ];
+      deriv[ 0 ] = derivSign[ 0 ][ i ] * ( dinv1 * ( val10[ i ] - val00[ i ] ) + dist1 * ( val11[ i ] - val01[ i ] ) );
+      deriv[ 1 ] = derivSign[ 1 ][ i ] * ( dinv0 * ( val01[ i ] - val00[ i ] ) + dist0 * ( val11[ i ] - val10[ i ] ) );
+    }
+  }
+
+  /** Take direction cosines into account. */
+  CovariantVectorType orientedDerivative;
+  for( SizeValueType i = 0; i < numberOfIndices; ++i )
+  {
+    inputImage->TransformLocalVectorToPhysicalVector( derivs[ i ], orientedDerivative );
+    derivs[ i ] = orientedDerivative;
+  }
+
+} // end EvaluateValueAndDerivativeBatchOptimized()
+
+
+/**
+ * ***************** EvaluateValueAndDerivativeBatchOptimized ***********************
+ */
+
+template< class TInputImage, class TCoordRep >
+void
+AdvancedLinearInterpolateImageFunction< TInputImage, TCoordRep >
+::EvaluateValueAndDerivativeBatchOptimized(
+  const Dispatch< 3 > &,
+  const ContinuousIndexType * x,
+  OutputType * values,
+  CovariantVectorType * derivs,
+  const SizeValueType numberOfIndices ) const
+{
+  // Get some handles
+  const InputImageType * inputImage = this->GetInputImage();
+  const InputPixelType * buffer     = this->GetBatchBuffer();
+
+  OffsetValueType lo[ ImageDimension ][ BatchBlockSize ];
+  OffsetValueType hi[ ImageDimension ][ BatchBlockSize ];
+  double          dist[ ImageDimension ][ BatchBlockSize ];
+  double          derivSign[ ImageDimension ][ BatchBlockSize ];
+  RealType        val000[ BatchBlockSize ], val100[ BatchBlockSize ];
+  RealType        val010[ BatchBlockSize ], val110[ BatchBlockSize ];
+  RealType        val001[ BatchBlockSize ], val101[ BatchBlockSize ];
+  RealType        val011[ BatchBlockSize ], val111[ BatchBlockSize ];
+
+  for( SizeValueType blockStart = 0; blockStart < numberOfIndices; blockStart += BatchBlockSize )
+  {
+    const unsigned int blockSize = static_cast< unsigned int >(
+      std::min( static_cast< SizeValueType >( BatchBlockSize ), numberOfIndices - blockStart ) );
+    this->ComputeBatchCornerOffsets( x + blockStart, blockSize, lo, hi, dist, derivSign );
+
+    /** Gather the 8 corner values. This does not use the run-time dispatched
+     * kernels of RecursiveBSplineTransformSIMD: those are compiled for double
+     * coefficients only, while this gather is templated over the pixel type and
+     * also reads the bricked layout. The offsets differ per sample, so a vector
+     * gather would do the same scattered loads as this loop; the interpolation
+     * loop below is the part that vectorises.
+     */
+    for( unsigned int i = 0; i < blockSize; ++i )
+    {
+      val000[ i ] = buffer[ lo[ 0 ][ i ] + lo[ 1 ][ i ] + lo[ 2 ][ i ] ];
+      val100[ i ] = buffer[ hi[ 0 ][ i ] + lo[ 1 ][ i ] + lo[ 2 ][ i ] ];
+      val010[ i ] = buffer[ lo[ 0 ][ i ] + hi[ 1 ][ i ] + lo[ 2 ][ i ] ];
+      val110[ i ] = buffer[ hi[ 0 ][ i ] + hi[ 1 ][ i ] + lo[ 2 ][ i ] ];
+      val001[ i ] = buffer[ lo[ 0 ][ i ] + lo[ 1 ][ i ] + hi[ 2 ][ i ] ];
+      val101[ i ] = buffer[ hi[ 0 ][ i ] + lo[ 1 ][ i ] + hi[ 2 ][ i ] ];
+      val011[ i ] = buffer[ lo[ 0 ][ i ] + hi[ 1 ][ i ] + hi[ 2 ][ i ] ];
+      val111[ i ] = buffer[ hi[ 0 ][ i ] + hi[ 1 ][ i ] + hi[ 2 ][ i ] ];
+    }
+
+    /** Interpolate to get the values and derivatives. */
+    for( unsigned int i = 0; i < blockSize; ++i )
+    {
+      const double dist0 = dist[ 0 ][ i ];
+      const double dist1 = dist[ 1 ][ i ];
+      const double dist2 = dist[ 2 ][ i ];
+      const double dinv0 = 1.0 - dist0;
+      const double dinv1 = 1.0 - dist1;
+      const double dinv2 = 1.0 - dist2;
+
+      values[ blockStart + i ] = static_cast< OutputType >(
+        val000[ i ] * dinv0 * dinv1 * dinv2
+        + val100[ i ] * dist0 * dinv1 * dinv2
+        + val010[ i ] * dinv0 * dist1 * dinv2
+        + val001[ i ] * dinv0 * dinv1 * dist2
+        + val110[ i ] * dist0 * dist1 * dinv2
+        + val011[ i ] * dinv0 * dist1 * dist2
+        + val101[ i ] * dist0 * dinv1 * dist2
+        + val111[ i ] * dist0 * dist1 * dist2 );
+
+      CovariantVectorType & deriv = derivs[ blockStart + i ];
+      deriv[ 0 ] = derivSign[ 0 ][ i ]
+        * ( dinv1 * dinv2 * ( val100[ i ] - val000[ i ] )
+        + dist1 * dinv2 * ( val110[ i ] - val010[ i ] )
+        + dinv1 * dist2 * ( val101[ i ] - val001[ i ] )
+        + dist1 * dist2 * ( val111[ i ] - val011[ i ] )
+        );
+      deriv[ 1 ] = derivSign[ 1 ][ i ]
+        * ( dinv0 * dinv2 * ( val010[ i ] - val000[ i ] )
+        + dist0 * dinv2 * ( val110[ i ] - val100[ i ] )
+        + dinv0 * dist2 * ( val011[ i ] - val001[ i ] )
+        + dist0 * dist2 * ( val111[ i ] - val101[ i ] )
+        );
+      deriv[ 2 ] = derivSign[ 2 ][ i ]
+        * ( dinv0 * dinv1 * ( val001[ i ] - val000[ i ] )
+        + dist0 * dinv1 * ( val101[ i ] - val100[ i ] )
+        + dinv0 * dist1 * ( val011[ i ] - val010[ i ] )
+        + dist0 * dist1 * ( val111[ i ] - val110[ i ] )
+        );
+    }
+  }
+
+  /** Take direction cosines into account. */
+  CovariantVectorType orientedDerivative;
+  for( SizeValueType i = 0; i < numberOfIndices; ++i )
+  {
+    inputImage->TransformLocalVectorToPhysicalVector( derivs[ i ], orientedDerivative );
+    derivs[ i ] = orientedDerivative;
+  }
+
+} // end EvaluateValueAndDerivativeBatchOptimized()
+
+
 } // end namespace itk
 
 #endif
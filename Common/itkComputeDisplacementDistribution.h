@@ -24,7 +24,7 @@
 #include "itkImageRandomSamplerBase.h"
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkImageFullSampler.h"
-#include "itkPlatformMultiThreader.h"
+#include "itkSharedPoolMultiThreader.h"
 
 namespace itk
 {
@@ -136,7 +136,7 @@ protected:
   ~ComputeDisplacementDistribution() override;
 
   /** Typedefs for multi-threading. */
-  typedef itk::PlatformMultiThreader             ThreaderType;
+  typedef itk::SharedPoolMultiThreader           ThreaderType;
   typedef ThreaderType::WorkUnitInfo ThreadInfoType;
 
   typename FixedImageType::ConstPointer   m_FixedImage;
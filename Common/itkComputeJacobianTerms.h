@@ -22,6 +22,10 @@
 #include "itkImageRandomSamplerBase.h"
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkSharedPoolMultiThreader.h"
+
+#include "vnl/vnl_diag_matrix.h"
+#include "vnl/vnl_sparse_matrix.h"
 
 namespace itk
 {
@@ -31,6 +35,13 @@ namespace itk
  * More specifically this class computes the Jacobian terms related to the automatic
  * parameter estimation for the adaptive stochastic gradient descent optimizer.
  * Details can be found in the paper.
+ *
+ * The computation is multi-threaded. Each work unit accumulates the J_j^T J_j of
+ * a contiguous range of samples in its own partial covariance matrix. The partial
+ * matrices are then added to the covariance matrix in the order of the work
+ * units, with each work unit reducing a range of rows, so the result does not
+ * depend on the timing of the threads. The maximum terms are computed on ranges
+ * of samples.
  */
 
 template< class TFixedImage, class TTransform >
@@ -90,6 +101,18 @@ public:
   itkSetMacro( NumberOfBandStructureSamples, unsigned int );
   itkSetMacro( NumberOfJacobianMeasurements, SizeValueType );
 
+  /** Set/Get whether the computation is multi-threaded. Default: true. */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
+  itkBooleanMacro( UseMultiThread );
+
+  /** Set the number of threads. */
+  void SetNumberOfWorkUnits( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfWorkUnits( numberOfThreads );
+  }
+
+
   /** Set the region over which the metric will be computed. */
   void SetFixedImageRegion( const FixedImageRegionType & region )
   {
@@ -110,7 +133,12 @@ public:
 protected:
 
   ComputeJacobianTerms();
-  ~ComputeJacobianTerms() override {}
+  ~ComputeJacobianTerms() override;
+
+  /** Typedefs for multi-threading. */
+  typedef itk::SharedPoolMultiThreader       ThreaderType;
+  typedef ThreaderType::WorkUnitInfo         ThreadInfoType;
+  typedef ThreaderType::ThreadFunctionType   ThreadFunctionType;
 
   typename FixedImageType::ConstPointer m_FixedImage;
   FixedImageRegionType       m_FixedImageRegion;
@@ -122,6 +150,9 @@ protected:
   unsigned int  m_MaxBandCovSize;
   unsigned int  m_NumberOfBandStructureSamples;
   SizeValueType m_NumberOfJacobianMeasurements;
+  bool          m_UseMultiThread;
+
+  ThreaderType::Pointer m_Threader;
 
   typedef typename  FixedImageType::IndexType   FixedImageIndexType;
   typedef typename  FixedImageType::PointType   FixedImagePointType;
@@ -145,12 +176,104 @@ protected:
   typedef typename TransformType::ScalarType             CoordinateRepresentationType;
   typedef typename TransformType::NumberOfParametersType NumberOfParametersType;
 
+  /** Typedefs for the covariance matrix. */
+  typedef double                                   CovarianceValueType;
+  typedef Array2D< CovarianceValueType >           CovarianceMatrixType;
+  typedef vnl_sparse_matrix< CovarianceValueType > SparseCovarianceMatrixType;
+  typedef SparseCovarianceMatrixType::row          SparseRowType;
+  typedef Array< SizeValueType >                   NonZeroJacobianIndicesExpandedType;
+  typedef vnl_diag_matrix< CovarianceValueType >   DiagCovarianceMatrixType;
+
   /** Sample the fixed image to compute the Jacobian terms. */
   // \todo: note that this is an exact copy of itk::ComputeDisplacementDistribution
   // in the future it would be better to refactoring this part of the code.
   virtual void SampleFixedImageForJacobianTerms(
     ImageSampleContainerPointer & sampleContainer );
 
+  /** The upper triangular part of the sum of J_j^T J_j / n over a range of
+   * samples. Entries in the dominant bands are stored in band rows, which are
+   * only allocated for the rows that the samples touch; the other entries are
+   * stored in the sparse matrix.
+   */
+  struct PartialCovarianceType
+  {
+    std::vector< unsigned int >        m_BandRowMap;
+    std::vector< CovarianceValueType > m_BandRows;
+    SparseCovarianceMatrixType         m_Sparse;
+  };
+
+  /** Accumulate the samples sampleBegin, ..., sampleEnd - 1 in partial. */
+  virtual void ComputePartialCovariance(
+    const SizeValueType sampleBegin, const SizeValueType sampleEnd,
+    PartialCovarianceType & partial ) const;
+
+  /** Add the upper triangular part of a sum of J_j^T J_j to a partial covariance. */
+  void AddJacobianProductToCovariance(
+    const NonZeroJacobianIndicesType & jacind,
+    const CovarianceMatrixType & jactjac, const double n,
+    PartialCovarianceType & partial ) const;
+
+  /** Add the rows rowBegin, ..., rowEnd - 1 of all partial covariances to the
+   * covariance matrix C, in the order of the partial covariances. Then apply the
+   * scales, and add the contributions of these rows to TrC, to the sum of squares
+   * of the (upper triangular) elements, and to the sum of squares of the diagonal.
+   */
+  virtual void ReduceCovarianceRows(
+    const unsigned int rowBegin, const unsigned int rowEnd,
+    double & TrC, double & sumSquaredElements, double & sumSquaredDiagonal );
+
+  /** Compute maxJJ and maxJCJ over the samples sampleBegin, ..., sampleEnd - 1. */
+  virtual void ComputeMaximumJacobianTerms(
+    const SizeValueType sampleBegin, const SizeValueType sampleEnd,
+    double & maxJJ, double & maxJCJ );
+
+  /** Launch a threader callback. */
+  void LaunchThreaderCallback( ThreadFunctionType callback ) const;
+
+  /** Threader callbacks that compute the covariance matrix and the maximum terms. */
+  static ITK_THREAD_RETURN_TYPE ComputePartialCovarianceThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE ReduceCovarianceThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE ComputeMaximumJacobianTermsThreaderCallback( void * arg );
+
+  /** Initialize some multi-threading related parameters. */
+  virtual void InitializeThreadingParameters( void );
+
+  /** To give the threads access to all member variables and functions. */
+  struct MultiThreaderParameterType
+  {
+    Self * st_Self;
+  };
+  mutable MultiThreaderParameterType m_ThreaderParameters;
+
+  struct ComputePerThreadStruct
+  {
+    /**  Used for accumulating variables. */
+    double st_TrC;
+    double st_SumSquaredElements;
+    double st_SumSquaredDiagonal;
+    double st_MaxJJ;
+    double st_MaxJCJ;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, ComputePerThreadStruct,
+    PaddedComputePerThreadStruct );
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT, PaddedComputePerThreadStruct,
+    AlignedComputePerThreadStruct );
+  mutable AlignedComputePerThreadStruct * m_ComputePerThreadVariables;
+  mutable ThreadIdType                    m_ComputePerThreadVariablesSize;
+
+  /** Variables that are shared by the work units during Compute(). The band
+   * maps translate between a parameter number difference q - p and a column
+   * of the band rows. There is one partial covariance per work unit.
+   */
+  ImageSampleContainerPointer          m_SampleContainer;
+  SparseCovarianceMatrixType           m_Covariance;
+  DiagCovarianceMatrixType             m_DiagonalCovariance;
+  std::vector< unsigned int >          m_BandCovarianceMap;
+  std::vector< unsigned int >          m_BandCovarianceMap2;
+  std::vector< PartialCovarianceType > m_PartialCovariances;
+
 private:
 
   ComputeJacobianTerms( const Self & ); // purposely not implemented
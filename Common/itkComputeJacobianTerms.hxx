@@ -45,9 +45,64 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   this->m_NumberOfBandStructureSamples = 0;
   this->m_NumberOfJacobianMeasurements = 0;
 
+  /** Threading related variables. */
+  this->m_UseMultiThread = true;
+  this->m_Threader       = ThreaderType::New();
+
+  /** Initialize the m_ThreaderParameters. */
+  this->m_ThreaderParameters.st_Self = this;
+
+  // Multi-threading structs
+  this->m_ComputePerThreadVariables     = nullptr;
+  this->m_ComputePerThreadVariablesSize = 0;
+
 } // end Constructor
 
 
+/**
+ * ************************* Destructor ************************
+ */
+
+template< class TFixedImage, class TTransform >
+ComputeJacobianTerms< TFixedImage, TTransform >
+::~ComputeJacobianTerms()
+{
+  delete[] this->m_ComputePerThreadVariables;
+} // end Destructor
+
+
+/**
+ * ************************* InitializeThreadingParameters ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::InitializeThreadingParameters( void )
+{
+  const ThreadIdType numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
+
+  /** Only resize the array of structs when needed. */
+  if( this->m_ComputePerThreadVariablesSize != numberOfThreads )
+  {
+    delete[] this->m_ComputePerThreadVariables;
+    this->m_ComputePerThreadVariables     = new AlignedComputePerThreadStruct[ numberOfThreads ];
+    this->m_ComputePerThreadVariablesSize = numberOfThreads;
+  }
+
+  /** Some initialization. */
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_ComputePerThreadVariables[ i ].st_TrC                = NumericTraits< double >::Zero;
+    this->m_ComputePerThreadVariables[ i ].st_SumSquaredElements = NumericTraits< double >::Zero;
+    this->m_ComputePerThreadVariables[ i ].st_SumSquaredDiagonal = NumericTraits< double >::Zero;
+    this->m_ComputePerThreadVariables[ i ].st_MaxJJ              = NumericTraits< double >::Zero;
+    this->m_ComputePerThreadVariables[ i ].st_MaxJCJ             = NumericTraits< double >::Zero;
+  }
+
+} // end InitializeThreadingParameters()
+
+
 /**
  * ************************* Compute ************************
  */
@@ -73,40 +128,21 @@ ComputeJacobianTerms< TFixedImage, TTransform >
    * Term 4: maxJCJ, see (54)
    */
 
-  typedef double                                   CovarianceValueType;
-  typedef itk::Array2D< CovarianceValueType >      CovarianceMatrixType;
-  typedef vnl_sparse_matrix< CovarianceValueType > SparseCovarianceMatrixType;
-  typedef SparseCovarianceMatrixType::row          SparseRowType;
-  typedef itk::Array< SizeValueType >              NonZeroJacobianIndicesExpandedType;
-  typedef vnl_diag_matrix< CovarianceValueType >   DiagCovarianceMatrixType;
-
   /** Initialize. */
   TrC = TrCC = maxJJ = maxJCJ = 0.0;
 
   /** Get samples. */
-  ImageSampleContainerPointer sampleContainer; // default-constructed (null)
-  SampleFixedImageForJacobianTerms( sampleContainer );
-  const SizeValueType nrofsamples = sampleContainer->Size();
-  const double        n           = static_cast< double >( nrofsamples );
+  this->m_SampleContainer = nullptr;
+  SampleFixedImageForJacobianTerms( this->m_SampleContainer );
+  const SizeValueType nrofsamples = this->m_SampleContainer->Size();
 
   /** Get the number of parameters. */
   const unsigned int P = static_cast< unsigned int >(
     this->m_Transform->GetNumberOfParameters() );
 
-  /** Get transform and set current position. */
-  typename TransformType::Pointer transform
-    = this->m_Transform;
+  /** Get the output space dimension. */
   const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
 
-  /** Get scales vector */
-  const ScalesType & scales = this->m_Scales;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
-  unsigned int samplenr = 0;
-
   /** Variables for nonzerojacobian indices and the Jacobian. */
   NumberOfParametersType sizejacind
     = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
@@ -115,16 +151,6 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   NonZeroJacobianIndicesType jacind( sizejacind );
   jacind[ 0 ] = 0;
   if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
-  NonZeroJacobianIndicesType prevjacind = jacind;
-
-  /** Initialize covariance matrix. Sparse, diagonal, and band form. */
-  SparseCovarianceMatrixType cov( P, P );
-  DiagCovarianceMatrixType   diagcov( P, 0.0 );
-  CovarianceMatrixType       bandcov;
-
-  /** For temporary storage of J'J. */
-  CovarianceMatrixType jactjac( sizejacind, sizejacind );
-  jactjac.Fill( 0.0 );
 
   typedef std::vector< unsigned int >             DifHistType;
   typedef std::pair< unsigned int, unsigned int > FreqPairType;
@@ -163,7 +189,7 @@ ComputeJacobianTerms< TFixedImage, TTransform >
 
     /** Read fixed coordinates and get Jacobian J_j. */
     const FixedImagePointType & point
-      = sampleContainer->GetElement( samplenr ).m_ImageCoordinates;
+      = this->m_SampleContainer->GetElement( samplenr ).m_ImageCoordinates;
     this->m_Transform->GetJacobian( point, jacj, jacind );
 
     /** Skip invalid Jacobians in the beginning, if any. */
@@ -200,9 +226,9 @@ ComputeJacobianTerms< TFixedImage, TTransform >
     static_cast< unsigned int >( difHist2.size() ) );
 
   /** Maps parameterNrDifference (q-p) to colnr in bandcov. */
-  std::vector< unsigned int > bandcovMap( P, bandcovsize );
+  this->m_BandCovarianceMap.assign( P, bandcovsize );
   /** Maps colnr in bandcov to parameterNrDifference (q-p). */
-  std::vector< unsigned int > bandcovMap2( bandcovsize, P );
+  this->m_BandCovarianceMap2.assign( bandcovsize, P );
 
   /** Sort the difHist2 based on the frequencies. */
   std::sort( difHist2.begin(), difHist2.end() );
@@ -212,32 +238,251 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   for( unsigned int b = 0; b < bandcovsize; ++b )
   {
     --difHist2It;
-    bandcovMap[ difHist2It->second ] = b;
-    bandcovMap2[ b ]                 = difHist2It->second;
+    this->m_BandCovarianceMap[ difHist2It->second ] = b;
+    this->m_BandCovarianceMap2[ b ]                 = difHist2It->second;
   }
 
-  /** Initialize band matrix. */
-  bandcov = CovarianceMatrixType( P, bandcovsize );
-  bandcov.Fill( 0.0 );
+  /** Initialize covariance matrix. Sparse and diagonal form. */
+  this->m_Covariance         = SparseCovarianceMatrixType( P, P );
+  this->m_DiagonalCovariance = DiagCovarianceMatrixType( P, 0.0 );
 
   /**
-   *    TERM 1
+   *    TERM 1 and 2
    *
    * Loop over image and compute Jacobian.
    * Compute C = 1/n \sum_i J_i^T J_i
    * Possibly apply scaling afterwards.
+   * Compute TrC = trace(C) and TrCC = ||C||_F^2.
+   */
+  this->InitializeThreadingParameters();
+  double sumSquaredElements = 0.0;
+  double sumSquaredDiagonal = 0.0;
+  if( !this->m_UseMultiThread )
+  {
+    this->m_PartialCovariances.resize( 1 );
+    this->ComputePartialCovariance( 0, nrofsamples, this->m_PartialCovariances[ 0 ] );
+    this->ReduceCovarianceRows( 0, P, TrC, sumSquaredElements, sumSquaredDiagonal );
+  }
+  else
+  {
+    /** Each work unit accumulates its own samples, and then adds a range of
+     * rows of all partial covariances to C.
+     */
+    this->m_PartialCovariances.resize( this->m_ComputePerThreadVariablesSize );
+    this->LaunchThreaderCallback( this->ComputePartialCovarianceThreaderCallback );
+    this->LaunchThreaderCallback( this->ReduceCovarianceThreaderCallback );
+    for( ThreadIdType i = 0; i < this->m_ComputePerThreadVariablesSize; ++i )
+    {
+      TrC                += this->m_ComputePerThreadVariables[ i ].st_TrC;
+      sumSquaredElements += this->m_ComputePerThreadVariables[ i ].st_SumSquaredElements;
+      sumSquaredDiagonal += this->m_ComputePerThreadVariables[ i ].st_SumSquaredDiagonal;
+    }
+  }
+  std::vector< PartialCovarianceType >().swap( this->m_PartialCovariances );
+
+  /** Symmetry: multiply by 2 and subtract sumsqr(diagcov). */
+  TrCC = 2.0 * sumSquaredElements - sumSquaredDiagonal;
+
+  /**
+   *    TERM 3 and 4
+   *
+   * Compute maxJJ and maxJCJ
+   * \li maxJJ = max_j [ ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F ]
+   * \li maxJCJ = max_j [ Tr( J_j C J_j^T ) + 2\sqrt{2} || J_j C J_j^T ||_F ]
    */
+  if( !this->m_UseMultiThread )
+  {
+    this->ComputeMaximumJacobianTerms( 0, nrofsamples, maxJJ, maxJCJ );
+  }
+  else
+  {
+    this->LaunchThreaderCallback( this->ComputeMaximumJacobianTermsThreaderCallback );
+    for( ThreadIdType i = 0; i < this->m_ComputePerThreadVariablesSize; ++i )
+    {
+      maxJJ  = std::max( maxJJ, this->m_ComputePerThreadVariables[ i ].st_MaxJJ );
+      maxJCJ = std::max( maxJCJ, this->m_ComputePerThreadVariables[ i ].st_MaxJCJ );
+    }
+  }
+
+  /** Release the memory. */
+  this->m_Covariance         = SparseCovarianceMatrixType();
+  this->m_DiagonalCovariance = DiagCovarianceMatrixType();
+  this->m_SampleContainer    = nullptr;
+
+} // end Compute()
+
+
+/**
+ * *********************** LaunchThreaderCallback ***************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::LaunchThreaderCallback( ThreadFunctionType callback ) const
+{
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( callback,
+    const_cast< void * >( static_cast< const void * >( &this->m_ThreaderParameters ) ) );
+
+  /** Launch. */
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchThreaderCallback()
+
+
+/**
+ * ************ ComputePartialCovarianceThreaderCallback ****************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_TYPE
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ComputePartialCovarianceThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                 threadID    = infoStruct->WorkUnitID;
+  ThreadIdType                 nrOfThreads = infoStruct->NumberOfWorkUnits;
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+  Self * self = temp->st_Self;
+
+  /** Get the samples for this thread. */
+  const SizeValueType sampleContainerSize  = self->m_SampleContainer->Size();
+  const SizeValueType nrOfSamplesPerThread = static_cast< SizeValueType >( std::ceil(
+    static_cast< double >( sampleContainerSize ) / static_cast< double >( nrOfThreads ) ) );
+  const SizeValueType pos_begin = std::min( nrOfSamplesPerThread * threadID, sampleContainerSize );
+  const SizeValueType pos_end   = std::min( nrOfSamplesPerThread * ( threadID + 1 ), sampleContainerSize );
+
+  /** Call the real implementation. */
+  self->ComputePartialCovariance( pos_begin, pos_end, self->m_PartialCovariances[ threadID ] );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputePartialCovarianceThreaderCallback()
+
+
+/**
+ * ************ ReduceCovarianceThreaderCallback ****************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_TYPE
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ReduceCovarianceThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                 threadID    = infoStruct->WorkUnitID;
+  ThreadIdType                 nrOfThreads = infoStruct->NumberOfWorkUnits;
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+  Self * self = temp->st_Self;
+
+  /** Get the rows for this thread. */
+  const unsigned int P = static_cast< unsigned int >(
+    self->m_Transform->GetNumberOfParameters() );
+  const unsigned int nrOfRowsPerThread = static_cast< unsigned int >( std::ceil(
+    static_cast< double >( P ) / static_cast< double >( nrOfThreads ) ) );
+  const unsigned int rowBegin = std::min( nrOfRowsPerThread * threadID, P );
+  const unsigned int rowEnd   = std::min( nrOfRowsPerThread * ( threadID + 1 ), P );
+
+  /** Call the real implementation. */
+  AlignedComputePerThreadStruct & perThread = self->m_ComputePerThreadVariables[ threadID ];
+  self->ReduceCovarianceRows( rowBegin, rowEnd, perThread.st_TrC,
+    perThread.st_SumSquaredElements, perThread.st_SumSquaredDiagonal );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ReduceCovarianceThreaderCallback()
+
+
+/**
+ * ************ ComputeMaximumJacobianTermsThreaderCallback ****************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_TYPE
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ComputeMaximumJacobianTermsThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                 threadID   = infoStruct->WorkUnitID;
+  ThreadIdType                 nrOfThreads = infoStruct->NumberOfWorkUnits;
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+  Self * self = temp->st_Self;
+
+  /** Get the samples for this thread. */
+  const SizeValueType sampleContainerSize = self->m_SampleContainer->Size();
+  const SizeValueType nrOfSamplesPerThread = static_cast< SizeValueType >( std::ceil(
+    static_cast< double >( sampleContainerSize ) / static_cast< double >( nrOfThreads ) ) );
+  const SizeValueType pos_begin = std::min( nrOfSamplesPerThread * threadID, sampleContainerSize );
+  const SizeValueType pos_end   = std::min( nrOfSamplesPerThread * ( threadID + 1 ), sampleContainerSize );
+
+  /** Call the real implementation. */
+  AlignedComputePerThreadStruct & perThread = self->m_ComputePerThreadVariables[ threadID ];
+  self->ComputeMaximumJacobianTerms( pos_begin, pos_end,
+    perThread.st_MaxJJ, perThread.st_MaxJCJ );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeMaximumJacobianTermsThreaderCallback()
+
+
+/**
+ * ************************* ComputePartialCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ComputePartialCovariance(
+  const SizeValueType sampleBegin, const SizeValueType sampleEnd,
+  PartialCovarianceType & partial ) const
+{
+  /** Get the number of parameters, the number of samples and the output space dimension. */
+  const unsigned int P = static_cast< unsigned int >(
+    this->m_Transform->GetNumberOfParameters() );
+  const double       n      = static_cast< double >( this->m_SampleContainer->Size() );
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
+
+  /** Initialize the partial covariance. No band rows are allocated yet. */
+  partial.m_BandRowMap.assign( P, P );
+  partial.m_BandRows.clear();
+  partial.m_Sparse = SparseCovarianceMatrixType( P, P );
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  NumberOfParametersType sizejacind
+    = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
   jacind[ 0 ] = 0;
   if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
-  for( iter = begin; iter != end; ++iter )
-  {
-    /** Print progress 0-50%.
-     *progressObserver->UpdateAndPrintProgress( samplenr );*/
-    ++samplenr;
+  NonZeroJacobianIndicesType prevjacind = jacind;
+
+  /** For temporary storage of J'J. Samples with the same nonzero Jacobian
+   * indices are summed before they are added to the partial covariance.
+   */
+  CovarianceMatrixType jactjac( sizejacind, sizejacind );
+  jactjac.Fill( 0.0 );
 
+  /**
+   *    TERM 1
+   *
+   * Loop over the samples and compute Jacobian.
+   * Compute the part of C = 1/n \sum_i J_i^T J_i of these samples.
+   */
+  bool first = true;
+  for( SizeValueType samplenr = sampleBegin; samplenr < sampleEnd; ++samplenr )
+  {
     /** Read fixed coordinates and get Jacobian J_j. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind  );
+    const FixedImagePointType & point
+      = this->m_SampleContainer->ElementAt( samplenr ).m_ImageCoordinates;
+    this->m_Transform->GetJacobian( point, jacj, jacind );
 
     /** Skip invalid Jacobians in the beginning, if any. */
     if( sizejacind > 1 )
@@ -252,146 +497,211 @@ ComputeJacobianTerms< TFixedImage, TTransform >
     }
     else
     {
-      /** The following should only be done after the first sample. */
-      if( iter != begin )
+      /** Update the partial covariance with the previous sum. */
+      if( !first )
       {
-        /** Update covariance matrix. */
-        for( unsigned int pi = 0; pi < sizejacind; ++pi )
-        {
-          const unsigned int p = prevjacind[ pi ];
-          for( unsigned int qi = 0; qi < sizejacind; ++qi )
-          {
-            const unsigned int q = prevjacind[ qi ];
-            if( q >= p )
-            {
-              const double tempval = jactjac( pi, qi ) / n;
-              if( std::abs( tempval ) > 1e-14 )
-              {
-                const unsigned int bandindex = bandcovMap[ q - p ];
-                if( bandindex < bandcovsize )
-                {
-                  bandcov( p, bandindex ) += tempval;
-                }
-                else
-                {
-                  cov( p, q ) += tempval;
-                }
-              }
-            }
-          } // qi
-        }   // pi
-      }     // end if
+        this->AddJacobianProductToCovariance( prevjacind, jactjac, n, partial );
+      }
 
       /** Initialize jactjac by J_j^T J_j. */
       vnl_fastops::AtA( jactjac, jacj );
 
       /** Remember nonzerojacobian indices. */
       prevjacind = jacind;
-    } // end else
+    }
+    first = false;
 
-  } // end iter loop: end computation of covariance matrix
+  } // end loop over samples: end computation of covariance matrix
 
-  /** Update covariance matrix once again to include last jactjac updates
-   * \todo: a bit ugly that this loop is copied from above.
-   */
-  for( unsigned int pi = 0; pi < sizejacind; ++pi )
+  /** Update the partial covariance once again to include last jactjac updates. */
+  if( !first )
   {
-    const unsigned int p = prevjacind[ pi ];
-    for( unsigned int qi = 0; qi < sizejacind; ++qi )
+    this->AddJacobianProductToCovariance( prevjacind, jactjac, n, partial );
+  }
+
+} // end ComputePartialCovariance()
+
+
+/**
+ * ************************* AddJacobianProductToCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::AddJacobianProductToCovariance(
+  const NonZeroJacobianIndicesType & jacind,
+  const CovarianceMatrixType & jactjac, const double n,
+  PartialCovarianceType & partial ) const
+{
+  const unsigned int P           = static_cast< unsigned int >( partial.m_BandRowMap.size() );
+  const unsigned int bandcovsize = static_cast< unsigned int >(
+    this->m_BandCovarianceMap2.size() );
+
+  for( unsigned int pi = 0; pi < jacind.size(); ++pi )
+  {
+    const unsigned int p = jacind[ pi ];
+    for( unsigned int qi = 0; qi < jacind.size(); ++qi )
     {
-      const unsigned int q = prevjacind[ qi ];
+      const unsigned int q = jacind[ qi ];
       if( q >= p )
       {
         const double tempval = jactjac( pi, qi ) / n;
         if( std::abs( tempval ) > 1e-14 )
         {
-          const unsigned int bandindex = bandcovMap[ q - p ];
+          const unsigned int bandindex = this->m_BandCovarianceMap[ q - p ];
           if( bandindex < bandcovsize )
           {
-            bandcov( p, bandindex ) += tempval;
+            /** Allocate the band row when row p is first touched. */
+            unsigned int & bandrow = partial.m_BandRowMap[ p ];
+            if( bandrow == P )
+            {
+              bandrow = static_cast< unsigned int >( partial.m_BandRows.size() / bandcovsize );
+              partial.m_BandRows.resize( partial.m_BandRows.size() + bandcovsize, 0.0 );
+            }
+            partial.m_BandRows[ static_cast< std::size_t >( bandrow ) * bandcovsize + bandindex ] += tempval;
           }
           else
           {
-            cov( p, q ) += tempval;
+            partial.m_Sparse( p, q ) += tempval;
           }
         }
       }
     } // qi
   }   // pi
 
-  /** Copy the bandmatrix into the sparse matrix and empty the bandcov matrix.
-   * \todo: perhaps work further with this bandmatrix instead.
-   */
-  for( unsigned int p = 0; p < P; ++p )
+} // end AddJacobianProductToCovariance()
+
+
+/**
+ * ************************* ReduceCovarianceRows ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ReduceCovarianceRows( const unsigned int rowBegin, const unsigned int rowEnd,
+  double & TrC, double & sumSquaredElements, double & sumSquaredDiagonal )
+{
+  /** Get scales vector */
+  const ScalesType & scales = this->m_Scales;
+
+  /** Get the shared covariance matrix. Only the rows of this call are modified. */
+  SparseCovarianceMatrixType & cov = this->m_Covariance;
+  const unsigned int           P   = static_cast< unsigned int >(
+    this->m_BandCovarianceMap.size() );
+  const unsigned int bandcovsize = static_cast< unsigned int >(
+    this->m_BandCovarianceMap2.size() );
+
+  /** For the sum of the band rows of the partial covariances. */
+  std::vector< CovarianceValueType > bandrow( bandcovsize );
+
+  for( unsigned int p = rowBegin; p < rowEnd; ++p )
   {
+    /** Add row p of the partial covariances, in a fixed order. */
+    std::fill( bandrow.begin(), bandrow.end(), 0.0 );
+    for( std::size_t t = 0; t < this->m_PartialCovariances.size(); ++t )
+    {
+      const PartialCovarianceType & partial = this->m_PartialCovariances[ t ];
+      const unsigned int            localrow = partial.m_BandRowMap[ p ];
+      if( localrow != P )
+      {
+        const CovarianceValueType * partialrow
+          = &partial.m_BandRows[ static_cast< std::size_t >( localrow ) * bandcovsize ];
+        for( unsigned int b = 0; b < bandcovsize; ++b )
+        {
+          bandrow[ b ] += partialrow[ b ];
+        }
+      }
+
+      if( !partial.m_Sparse.empty_row( p ) )
+      {
+        const SparseRowType & partialrowp = partial.m_Sparse.get_row( p );
+        for( typename SparseRowType::const_iterator it = partialrowp.begin(); it != partialrowp.end(); ++it )
+        {
+          cov( p, ( *it ).first ) += ( *it ).second;
+        }
+      }
+    }
+
+    /** Copy the band row into the sparse matrix.
+     * \todo: perhaps work further with this bandmatrix instead.
+     */
     for( unsigned int b = 0; b < bandcovsize; ++b )
     {
-      const double tempval = bandcov( p, b );
+      const double tempval = bandrow[ b ];
       if( std::abs( tempval ) > 1e-14 )
       {
-        const unsigned int q = p + bandcovMap2[ b ];
+        const unsigned int q = p + this->m_BandCovarianceMap2[ b ];
         cov( p, q ) = tempval;
       }
     }
-  }
-  bandcov.set_size( 0, 0 );
 
-  /** Apply scales. the use of m_Scales maybe something wrong. */
-  if( this->m_UseScales )
-  {
-    for( unsigned int p = 0; p < P; ++p )
+    /** Apply scales, and compute the contributions to TrC = trace(C),
+     * diagcov, and TrCC = ||C||_F^2.
+     */
+
+    //avoid creation of element if the row is empty
+    if( cov.empty_row( p ) )
     {
-      cov.scale_row( p, 1.0 / this->m_Scales[ p ] );
+      continue;
     }
-    /**  \todo: this might be faster with get_row instead of the iterator */
-    cov.reset();
-    bool notfinished = cov.next();
-    while( notfinished )
+
+    if( this->m_UseScales )
     {
-      const int col = cov.getcolumn();
-      cov( cov.getrow(), col ) /= scales[ col ];
-      notfinished               = cov.next();
+      cov.scale_row( p, 1.0 / scales[ p ] );
+      SparseRowType & covrowp = cov.get_row( p );
+      for( typename SparseRowType::iterator it = covrowp.begin(); it != covrowp.end(); ++it )
+      {
+        ( *it ).second /= scales[ ( *it ).first ];
+      }
     }
-  }
 
-  /** Compute TrC = trace(C), and diagcov. */
-  for( unsigned int p = 0; p < P; ++p )
-  {
-    if( !cov.empty_row( p ) )
+    CovarianceValueType & covpp = cov( p, p );
+    TrC                                 += covpp;
+    this->m_DiagonalCovariance[ p ]      = covpp;
+    sumSquaredDiagonal                  += vnl_math::sqr( covpp );
+
+    const SparseRowType & covrowp = cov.get_row( p );
+    for( typename SparseRowType::const_iterator it = covrowp.begin(); it != covrowp.end(); ++it )
     {
-      //avoid creation of element if the row is empty
-      CovarianceValueType & covpp = cov( p, p );
-      TrC         += covpp;
-      diagcov[ p ] = covpp;
+      sumSquaredElements += vnl_math::sqr( ( *it ).second );
     }
   }
 
-  /**
-   *    TERM 2
-   *
-   * Compute TrCC = ||C||_F^2.
-   */
-  cov.reset();
-  bool notfinished2 = cov.next();
-  while( notfinished2 )
-  {
-    TrCC        += vnl_math::sqr( cov.value() );
-    notfinished2 = cov.next();
-  }
+} // end ReduceCovarianceRows()
 
-  /** Symmetry: multiply by 2 and subtract sumsqr(diagcov). */
-  TrCC *= 2.0;
-  TrCC -= diagcov.diagonal().squared_magnitude();
 
-  /**
-   *    TERM 3 and 4
-   *
-   * Compute maxJJ and maxJCJ
-   * \li maxJJ = max_j [ ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F ]
-   * \li maxJCJ = max_j [ Tr( J_j C J_j^T ) + 2\sqrt{2} || J_j C J_j^T ||_F ]
-   */
-  maxJJ  = 0.0;
-  maxJCJ = 0.0;
+/**
+ * ************************* ComputeMaximumJacobianTerms ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ComputeMaximumJacobianTerms(
+  const SizeValueType sampleBegin, const SizeValueType sampleEnd,
+  double & maxJJ, double & maxJCJ )
+{
+  /** Get the number of parameters and the output space dimension. */
+  const unsigned int P = static_cast< unsigned int >(
+    this->m_Transform->GetNumberOfParameters() );
+  const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
+
+  /** Get scales vector */
+  const ScalesType & scales = this->m_Scales;
+
+  /** Get the shared covariance matrices, which are only read. */
+  SparseCovarianceMatrixType &     cov     = this->m_Covariance;
+  const DiagCovarianceMatrixType & diagcov = this->m_DiagonalCovariance;
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  NumberOfParametersType sizejacind
+    = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+
   const double sqrt2 = std::sqrt( static_cast< double >( 2.0 ) );
 
   JacobianType                       jacjjacj( outdim, outdim );
@@ -402,11 +712,16 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   JacobianType                       jacjcovjacj( outdim, outdim );
   NonZeroJacobianIndicesExpandedType jacindExpanded( P );
 
-  samplenr = 0;
-  for( iter = begin; iter != end; ++iter )
+  /** The entries of jacindExpanded are reset after each sample, which is
+   * much cheaper than filling the whole vector for each sample.
+   */
+  jacindExpanded.Fill( sizejacind );
+
+  for( SizeValueType samplenr = sampleBegin; samplenr < sampleEnd; ++samplenr )
   {
     /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
+    const FixedImagePointType & point
+      = this->m_SampleContainer->ElementAt( samplenr ).m_ImageCoordinates;
     this->m_Transform->GetJacobian( point, jacj, jacind  );
 
     /** Apply scales, if necessary. */
@@ -438,7 +753,6 @@ ComputeJacobianTerms< TFixedImage, TTransform >
     /** Store the nonzero Jacobian indices in a different format
      * and create the sparse diagcov.
      */
-    jacindExpanded.Fill( sizejacind );
     for( unsigned int pi = 0; pi < sizejacind; ++pi )
     {
       const unsigned int p = jacind[ pi ];
@@ -456,8 +770,8 @@ ComputeJacobianTerms< TFixedImage, TTransform >
       const unsigned int p = jacind[ pi ];
       if( !cov.empty_row( p ) )
       {
-        SparseRowType & covrowp = cov.get_row( p );
-        typename SparseRowType::iterator covrowpit;
+        const SparseRowType & covrowp = cov.get_row( p );
+        typename SparseRowType::const_iterator covrowpit;
 
         /** Loop over row p of the sparse cov matrix. */
         for( covrowpit = covrowp.begin(); covrowpit != covrowp.end(); ++covrowpit )
@@ -479,6 +793,12 @@ ComputeJacobianTerms< TFixedImage, TTransform >
       } // if not empty row
     }   // pi
 
+    /** Reset the entries of jacindExpanded. */
+    for( unsigned int pi = 0; pi < sizejacind; ++pi )
+    {
+      jacindExpanded[ jacind[ pi ] ] = sizejacind;
+    }
+
     /** J_j C J_j^T  = jacjCjacj.
      * But note that we actually compute J_j cov' J_j^T
      */
@@ -502,16 +822,9 @@ ComputeJacobianTerms< TFixedImage, TTransform >
     /** Max_j [JCJ_j]. */
     maxJCJ = std::max( maxJCJ, JCJ_j );
 
-    /** Show progress 50-100%. */
-    //progressObserver->UpdateAndPrintProgress( samplenr + nrofsamples );
-    ++samplenr;
-
   } // end loop over sample container
 
-  /** Finalize progress information. */
-  //progressObserver->PrintProgress( 1.0 );
-
-} // end Compute()
+} // end ComputeMaximumJacobianTerms()
 
 
 /**
@@ -0,0 +1,132 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkPhiloxRandomVariateGenerator_h
+#define __itkPhiloxRandomVariateGenerator_h
+
+#include "itkIntTypes.h"
+
+namespace itk
+{
+
+/** \class PhiloxRandomVariateGenerator
+ *
+ * \brief A counter-based random number generator: Philox4x32-10.
+ *
+ * A counter-based generator has no state. It maps a key and a counter to a
+ * random number, by a fixed number of rounds of a bijective mixing function.
+ * Different counters give statistically independent numbers, so any thread
+ * can generate the i-th number of a stream directly, and the result does
+ * not depend on which thread does that, or in which order.
+ *
+ * This is the Philox4x32 generator with 10 rounds of:
+ *   J.K. Salmon, M.A. Moraes, R.O. Dror, D.E. Shaw,
+ *   "Parallel random numbers: as easy as 1, 2, 3",
+ *   Proceedings of SC'11, 2011.
+ * It passes the BigCrush test suite, and the output equals that of the
+ * reference implementation (Random123).
+ *
+ * \ingroup Common
+ */
+
+class PhiloxRandomVariateGenerator
+{
+public:
+
+  /** Compute the 4 random words for a counter of 4 words and a key of 2 words. */
+  static void Generate( const uint32_t counter[ 4 ], const uint32_t key[ 2 ], uint32_t output[ 4 ] )
+  {
+    uint32_t c0 = counter[ 0 ];
+    uint32_t c1 = counter[ 1 ];
+    uint32_t c2 = counter[ 2 ];
+    uint32_t c3 = counter[ 3 ];
+    uint32_t k0 = key[ 0 ];
+    uint32_t k1 = key[ 1 ];
+
+    for( unsigned int round = 0; round < 10; ++round )
+    {
+      const uint64_t product0 = static_cast< uint64_t >( 0xD2511F53u ) * c0;
+      const uint64_t product1 = static_cast< uint64_t >( 0xCD9E8D57u ) * c2;
+      const uint32_t hi0      = static_cast< uint32_t >( product0 >> 32 );
+      const uint32_t lo0      = static_cast< uint32_t >( product0 );
+      const uint32_t hi1      = static_cast< uint32_t >( product1 >> 32 );
+      const uint32_t lo1      = static_cast< uint32_t >( product1 );
+
+      c0 = hi1 ^ c1 ^ k0;
+      c1 = lo1;
+      c2 = hi0 ^ c3 ^ k1;
+      c3 = lo0;
+
+      /** Bump the key with the Weyl sequence constants. */
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+
+    output[ 0 ] = c0;
+    output[ 1 ] = c1;
+    output[ 2 ] = c2;
+    output[ 3 ] = c3;
+  }
+
+
+  /** Two uniform random numbers in [0,1), for a 64 bit key and the counter
+   * ( counter0, counter1, counter2 ). Each number has 53 random bits.
+   */
+  static void GetUniformVariates( const uint64_t key,
+    const uint64_t counter0, const uint32_t counter1, const uint32_t counter2,
+    double & variate0, double & variate1 )
+  {
+    const uint32_t k[ 2 ] = {
+      static_cast< uint32_t >( key ), static_cast< uint32_t >( key >> 32 )
+    };
+    const uint32_t c[ 4 ] = {
+      static_cast< uint32_t >( counter0 ), static_cast< uint32_t >( counter0 >> 32 ),
+      counter1, counter2
+    };
+    uint32_t r[ 4 ];
+    Generate( c, k, r );
+
+    variate0 = ToUniform( r[ 0 ], r[ 1 ] );
+    variate1 = ToUniform( r[ 2 ], r[ 3 ] );
+  }
+
+
+  /** One uniform random number in [0,1), see GetUniformVariates(). */
+  static double GetUniformVariate( const uint64_t key,
+    const uint64_t counter0, const uint32_t counter1, const uint32_t counter2 )
+  {
+    double variate0, variate1;
+    GetUniformVariates( key, counter0, counter1, counter2, variate0, variate1 );
+    return variate0;
+  }
+
+
+private:
+
+  /** Use the upper 53 bits of two words for a double in [0,1). */
+  static double ToUniform( const uint32_t low, const uint32_t high )
+  {
+    const uint64_t bits = ( static_cast< uint64_t >( high ) << 32 ) | low;
+    return static_cast< double >( bits >> 11 ) * ( 1.0 / 9007199254740992.0 );
+  }
+
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkPhiloxRandomVariateGenerator_h
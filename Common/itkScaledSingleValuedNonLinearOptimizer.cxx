@@ -139,6 +139,24 @@ ScaledSingleValuedNonLinearOptimizer
 } // end GetScaledValueAndDerivative()
 
 
+/**
+ * ********************* CreateScaledCostFunction ***********************
+ */
+
+ScaledSingleValuedNonLinearOptimizer::ScaledCostFunctionPointer
+ScaledSingleValuedNonLinearOptimizer
+::CreateScaledCostFunction( CostFunctionType * costFunction ) const
+{
+  ScaledCostFunctionPointer scaledCostFunction = ScaledCostFunctionType::New();
+  scaledCostFunction->SetUnscaledCostFunction( costFunction );
+  scaledCostFunction->SetSquaredScales( this->m_ScaledCostFunction->GetSquaredScales() );
+  scaledCostFunction->SetUseScales( this->m_ScaledCostFunction->GetUseScales() );
+  scaledCostFunction->SetNegateCostFunction( this->m_ScaledCostFunction->GetNegateCostFunction() );
+  return scaledCostFunction;
+
+} // end CreateScaledCostFunction()
+
+
 /**
  * ********************* GetCurrentPosition ***********************
  */
@@ -176,6 +176,13 @@ protected:
     MeasureType & value,
     DerivativeType & derivative ) const;
 
+  /** Create a scaled cost function with the scales and the sign of
+   * m_ScaledCostFunction around another cost function, for example
+   * a clone of the cost function that is evaluated concurrently.
+   */
+  ScaledCostFunctionPointer CreateScaledCostFunction(
+    CostFunctionType * costFunction ) const;
+
 private:
 
   /** The private constructor. */
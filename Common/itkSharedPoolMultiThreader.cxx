@@ -0,0 +1,70 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkSharedPoolMultiThreader.h"
+
+namespace itk
+{
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+SharedPoolMultiThreader
+::SharedPoolMultiThreader()
+{
+  this->m_ThreadFunction = nullptr;
+  this->m_ThreadUserData = nullptr;
+  this->SetNumberOfWorkUnits( MultiThreaderBase::GetGlobalDefaultNumberOfThreads() );
+
+} // end Constructor
+
+
+/**
+ * ****************** SetSingleMethod *********************************
+ */
+
+void
+SharedPoolMultiThreader
+::SetSingleMethod( ThreadFunctionType f, void * data )
+{
+  this->m_ThreadFunction = f;
+  this->m_ThreadUserData = data;
+
+} // end SetSingleMethod()
+
+
+/**
+ * ****************** SingleMethodExecute *********************************
+ */
+
+void
+SharedPoolMultiThreader
+::SingleMethodExecute( void )
+{
+  if( this->m_ThreadFunction == nullptr )
+  {
+    itkExceptionMacro( << "No single method set!" );
+  }
+
+  SharedThreadPool::GetInstance().Execute(
+    this->m_ThreadFunction, this->m_ThreadUserData, this->GetNumberOfWorkUnits() );
+
+} // end SingleMethodExecute()
+
+
+} // end namespace itk
@@ -0,0 +1,82 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkSharedPoolMultiThreader_h
+#define __itkSharedPoolMultiThreader_h
+
+#include "itkMultiThreaderBase.h"
+#include "itkSharedThreadPool.h"
+
+namespace itk
+{
+
+/** \class SharedPoolMultiThreader
+ *
+ * \brief A multi-threader that executes its work units on the SharedThreadPool.
+ *
+ * This is a replacement of the PlatformMultiThreader, with the same
+ * SetSingleMethod() / SingleMethodExecute() interface, that does not create
+ * and join threads on every call. All metrics, optimizers and samplers of
+ * elastix use it, so they all share the persistent threads of one pool.
+ *
+ * \sa SharedThreadPool
+ * \ingroup Common
+ */
+
+class SharedPoolMultiThreader : public MultiThreaderBase
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef SharedPoolMultiThreader    Self;
+  typedef MultiThreaderBase          Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( SharedPoolMultiThreader, MultiThreaderBase );
+
+  /** Set the method and the user data that SingleMethodExecute() executes. */
+  void SetSingleMethod( ThreadFunctionType f, void * data ) override;
+
+  /** Execute the single method on NumberOfWorkUnits work units, on the threads
+   * of the SharedThreadPool and the calling thread. An exception of a work unit
+   * is rethrown here.
+   */
+  void SingleMethodExecute( void ) override;
+
+protected:
+
+  SharedPoolMultiThreader();
+  ~SharedPoolMultiThreader() override {}
+
+private:
+
+  SharedPoolMultiThreader( const Self & ); // purposely not implemented
+  void operator=( const Self & );          // purposely not implemented
+
+  ThreadFunctionType m_ThreadFunction;
+  void *             m_ThreadUserData;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkSharedPoolMultiThreader_h
@@ -0,0 +1,546 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkSharedThreadPool.h"
+
+#include <algorithm>
+
+#if defined( _WIN32 )
+#include <windows.h>
+#elif defined( __linux__ )
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace itk
+{
+
+thread_local ThreadIdType               SharedThreadPool::s_ThreadBudget  = 0;
+thread_local SharedThreadPool::Budget * SharedThreadPool::s_CurrentBudget = nullptr;
+
+namespace
+{
+
+/** Get the CPUs that this process may use, in increasing order. Returns an
+ * empty list if that is not supported.
+ */
+std::vector< unsigned int >
+GetAllowedCPUs( void )
+{
+  std::vector< unsigned int > cpus;
+#if defined( _WIN32 )
+  DWORD_PTR processMask = 0;
+  DWORD_PTR systemMask  = 0;
+  if( GetProcessAffinityMask( GetCurrentProcess(), &processMask, &systemMask ) )
+  {
+    for( unsigned int cpu = 0; cpu < 8 * sizeof( DWORD_PTR ); ++cpu )
+    {
+      if( processMask & ( static_cast< DWORD_PTR >( 1 ) << cpu ) )
+      {
+        cpus.push_back( cpu );
+      }
+    }
+  }
+#elif defined( __linux__ )
+  cpu_set_t cpuSet;
+  CPU_ZERO( &cpuSet );
+  if( sched_getaffinity( 0, sizeof( cpu_set_t ), &cpuSet ) == 0 )
+  {
+    for( unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+    {
+      if( CPU_ISSET( cpu, &cpuSet ) )
+      {
+        cpus.push_back( cpu );
+      }
+    }
+  }
+#endif
+  return cpus;
+
+} // end GetAllowedCPUs()
+
+} // end namespace
+
+
+/**
+ * ****************** GetInstance *********************************
+ */
+
+SharedThreadPool &
+SharedThreadPool
+::GetInstance( void )
+{
+  static SharedThreadPool instance;
+  return instance;
+
+} // end GetInstance()
+
+
+/**
+ * ****************** Constructor *********************************
+ */
+
+SharedThreadPool
+::SharedThreadPool()
+{
+  const ThreadIdType numberOfThreads = MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  this->m_NumberOfThreads = numberOfThreads > 1 ? numberOfThreads - 1 : 0;
+  this->m_UseCPUAffinity  = false;
+  this->m_Generation      = 0;
+
+  this->m_NumberOfRunningCalls = 0;
+  this->m_RestartPending       = false;
+
+} // end Constructor
+
+
+/**
+ * ****************** Destructor *********************************
+ */
+
+SharedThreadPool
+::~SharedThreadPool()
+{
+  std::vector< std::thread > threads;
+  {
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+    threads = this->ReleaseThreads();
+  }
+  JoinThreads( threads );
+
+} // end Destructor
+
+
+/**
+ * ****************** SetNumberOfThreads *********************************
+ */
+
+void
+SharedThreadPool
+::SetNumberOfThreads( const ThreadIdType numberOfThreads )
+{
+  /** Additional threads are started at the next call. Fewer threads
+   * require a restart.
+   */
+  std::vector< std::thread > threads;
+  {
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+    this->m_NumberOfThreads = numberOfThreads;
+    if( numberOfThreads < this->m_Threads.size() )
+    {
+      threads = this->RequestRestart();
+    }
+  }
+  JoinThreads( threads );
+
+} // end SetNumberOfThreads()
+
+
+/**
+ * ****************** GetNumberOfThreads *********************************
+ */
+
+ThreadIdType
+SharedThreadPool
+::GetNumberOfThreads( void ) const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  return this->m_NumberOfThreads;
+
+} // end GetNumberOfThreads()
+
+
+/**
+ * ****************** SetUseCPUAffinity *********************************
+ */
+
+void
+SharedThreadPool
+::SetUseCPUAffinity( const bool useCPUAffinity )
+{
+  /** The threads are bound when they are started again at the next call. */
+  std::vector< std::thread > threads;
+  {
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+    if( useCPUAffinity == this->m_UseCPUAffinity )
+    {
+      return;
+    }
+    this->m_UseCPUAffinity = useCPUAffinity;
+    if( !this->m_Threads.empty() )
+    {
+      threads = this->RequestRestart();
+    }
+  }
+  JoinThreads( threads );
+
+} // end SetUseCPUAffinity()
+
+
+/**
+ * ****************** GetUseCPUAffinity *********************************
+ */
+
+bool
+SharedThreadPool
+::GetUseCPUAffinity( void ) const
+{
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  return this->m_UseCPUAffinity;
+
+} // end GetUseCPUAffinity()
+
+
+/**
+ * ****************** SetThreadBudget *********************************
+ */
+
+void
+SharedThreadPool
+::SetThreadBudget( const ThreadIdType threadBudget )
+{
+  s_ThreadBudget = threadBudget;
+
+} // end SetThreadBudget()
+
+
+/**
+ * ****************** GetThreadBudget *********************************
+ */
+
+ThreadIdType
+SharedThreadPool
+::GetThreadBudget( void )
+{
+  return s_ThreadBudget;
+
+} // end GetThreadBudget()
+
+
+/**
+ * ****************** Execute *********************************
+ */
+
+void
+SharedThreadPool
+::Execute( ThreadFunctionType function, void * data, const ThreadIdType numberOfWorkUnits )
+{
+  Job job;
+  job.m_Function                  = function;
+  job.m_Data                      = data;
+  job.m_NumberOfWorkUnits         = numberOfWorkUnits;
+  job.m_NextWorkUnit              = 0;
+  job.m_NumberOfFinishedWorkUnits = 0;
+  job.m_Xout                      = xl::get_local_xout();
+
+  /** A nested call shares the budget of the work unit that makes it. Otherwise
+   * the budget of this thread applies, of which this thread takes one place.
+   */
+  Budget budget;
+  budget.m_MaximumNumberOfThreads = s_ThreadBudget;
+  budget.m_NumberOfActiveThreads  = 1;
+  job.m_Budget = s_CurrentBudget != nullptr ? s_CurrentBudget : &budget;
+
+  /** Hand out the work units to the threads of the pool. */
+  std::unique_lock< std::mutex > lock( this->m_Mutex );
+  ++this->m_NumberOfRunningCalls;
+  if( numberOfWorkUnits > 1 && this->m_NumberOfThreads > 0
+    && job.m_Budget->m_MaximumNumberOfThreads != 1 )
+  {
+    this->StartThreads();
+    this->m_Jobs.push_back( &job );
+    this->m_WorkAvailable.notify_all();
+  }
+
+  /** Execute work units in this thread as well, until all are handed out. */
+  ThreadIdType workUnit = 0;
+  while( this->TakeWorkUnit( &job, workUnit ) )
+  {
+    lock.unlock();
+    this->RunWorkUnit( &job, workUnit, false );
+    lock.lock();
+  }
+
+  /** Wait for the work units that are executed by the threads of the pool. */
+  this->m_WorkFinished.wait( lock, [ &job ]{
+    return job.m_NumberOfFinishedWorkUnits == job.m_NumberOfWorkUnits;
+  } );
+
+  /** The last running call performs a postponed restart. */
+  --this->m_NumberOfRunningCalls;
+  std::vector< std::thread > threads;
+  if( this->m_NumberOfRunningCalls == 0 && this->m_RestartPending )
+  {
+    threads = this->ReleaseThreads();
+  }
+  lock.unlock();
+  JoinThreads( threads );
+
+  if( job.m_Exception )
+  {
+    std::rethrow_exception( job.m_Exception );
+  }
+
+} // end Execute()
+
+
+/**
+ * ****************** FindAvailableJob *********************************
+ */
+
+SharedThreadPool::Job *
+SharedThreadPool
+::FindAvailableJob( void ) const
+{
+  for( std::size_t i = 0; i < this->m_Jobs.size(); ++i )
+  {
+    const Budget * budget = this->m_Jobs[ i ]->m_Budget;
+    if( budget->m_MaximumNumberOfThreads == 0
+      || budget->m_NumberOfActiveThreads < budget->m_MaximumNumberOfThreads )
+    {
+      return this->m_Jobs[ i ];
+    }
+  }
+  return nullptr;
+
+} // end FindAvailableJob()
+
+
+/**
+ * ****************** TakeWorkUnit *********************************
+ */
+
+bool
+SharedThreadPool
+::TakeWorkUnit( Job * job, ThreadIdType & workUnit )
+{
+  if( job->m_NextWorkUnit == job->m_NumberOfWorkUnits )
+  {
+    return false;
+  }
+
+  workUnit = job->m_NextWorkUnit++;
+  if( job->m_NextWorkUnit == job->m_NumberOfWorkUnits )
+  {
+    const std::deque< Job * >::iterator it
+      = std::find( this->m_Jobs.begin(), this->m_Jobs.end(), job );
+    if( it != this->m_Jobs.end() )
+    {
+      this->m_Jobs.erase( it );
+    }
+  }
+  return true;
+
+} // end TakeWorkUnit()
+
+
+/**
+ * ****************** RunWorkUnit *********************************
+ */
+
+void
+SharedThreadPool
+::RunWorkUnit( Job * job, const ThreadIdType workUnit, const bool isPoolThread )
+{
+  WorkUnitInfo info      = {};
+  info.WorkUnitID        = workUnit;
+  info.NumberOfWorkUnits = job->m_NumberOfWorkUnits;
+  info.UserData          = job->m_Data;
+  info.ThreadFunction    = job->m_Function;
+
+  /** Calls of Execute() by the work unit share the budget of the job, and
+   * the work unit writes to the xout object of the caller.
+   */
+  Budget * const            previousBudget = s_CurrentBudget;
+  xl::xoutbase_type * const previousXout   = xl::get_local_xout();
+  s_CurrentBudget = job->m_Budget;
+  xl::set_xout( job->m_Xout );
+
+  std::exception_ptr exception;
+  try
+  {
+    job->m_Function( &info );
+  }
+  catch( ... )
+  {
+    exception = std::current_exception();
+  }
+  s_CurrentBudget = previousBudget;
+  xl::set_xout( previousXout );
+
+  /** Register that the work unit is finished, and keep the first exception.
+   * The budget may only be accessed before that, since the job and its budget
+   * are destroyed when Execute() returns.
+   */
+  std::lock_guard< std::mutex > lock( this->m_Mutex );
+  if( isPoolThread )
+  {
+    Budget * budget = job->m_Budget;
+    --budget->m_NumberOfActiveThreads;
+    if( budget->m_MaximumNumberOfThreads != 0 )
+    {
+      this->m_WorkAvailable.notify_all();
+    }
+  }
+  if( exception && !job->m_Exception )
+  {
+    job->m_Exception = exception;
+  }
+  ++job->m_NumberOfFinishedWorkUnits;
+  if( job->m_NumberOfFinishedWorkUnits == job->m_NumberOfWorkUnits )
+  {
+    this->m_WorkFinished.notify_all();
+  }
+
+} // end RunWorkUnit()
+
+
+/**
+ * ****************** ThreadLoop *********************************
+ */
+
+void
+SharedThreadPool
+::ThreadLoop( const unsigned long generation )
+{
+  std::unique_lock< std::mutex > lock( this->m_Mutex );
+  while( true )
+  {
+    this->m_WorkAvailable.wait( lock, [ this, generation ]{
+      return this->m_Generation != generation || this->FindAvailableJob() != nullptr;
+    } );
+
+    /** Stop when ReleaseThreads() was called. Work units that are not handed
+     * out yet are executed by the threads that called Execute().
+     */
+    if( this->m_Generation != generation )
+    {
+      return;
+    }
+
+    Job *        job      = this->FindAvailableJob();
+    ThreadIdType workUnit = 0;
+    this->TakeWorkUnit( job, workUnit );
+    ++job->m_Budget->m_NumberOfActiveThreads;
+    lock.unlock();
+    this->RunWorkUnit( job, workUnit, true );
+    lock.lock();
+  }
+
+} // end ThreadLoop()
+
+
+/**
+ * ****************** StartThreads *********************************
+ */
+
+void
+SharedThreadPool
+::StartThreads( void )
+{
+  if( this->m_Threads.size() >= this->m_NumberOfThreads )
+  {
+    return;
+  }
+
+  /** Bind thread i to allowed CPU i + 1; the first one is left to the calling thread. */
+  std::vector< unsigned int > cpus;
+  if( this->m_UseCPUAffinity )
+  {
+    cpus = GetAllowedCPUs();
+  }
+
+  for( ThreadIdType i = static_cast< ThreadIdType >( this->m_Threads.size() );
+    i < this->m_NumberOfThreads; ++i )
+  {
+    this->m_Threads.push_back( std::thread( &SharedThreadPool::ThreadLoop, this, this->m_Generation ) );
+
+    if( !cpus.empty() )
+    {
+      const unsigned int cpu = cpus[ ( i + 1 ) % cpus.size() ];
+#if defined( _WIN32 )
+      SetThreadAffinityMask( this->m_Threads.back().native_handle(),
+        static_cast< DWORD_PTR >( 1 ) << cpu );
+#elif defined( __linux__ )
+      cpu_set_t cpuSet;
+      CPU_ZERO( &cpuSet );
+      CPU_SET( cpu, &cpuSet );
+      pthread_setaffinity_np( this->m_Threads.back().native_handle(), sizeof( cpu_set_t ), &cpuSet );
+#endif
+    }
+  }
+
+} // end StartThreads()
+
+
+/**
+ * ****************** RequestRestart *********************************
+ */
+
+std::vector< std::thread >
+SharedThreadPool
+::RequestRestart( void )
+{
+  /** Threads may only be stopped while they execute no work units. */
+  if( this->m_NumberOfRunningCalls > 0 )
+  {
+    this->m_RestartPending = true;
+    return std::vector< std::thread >();
+  }
+  return this->ReleaseThreads();
+
+} // end RequestRestart()
+
+
+/**
+ * ****************** ReleaseThreads *********************************
+ */
+
+std::vector< std::thread >
+SharedThreadPool
+::ReleaseThreads( void )
+{
+  /** The threads stop when they see the new generation. The next call of
+   * Execute() starts new threads.
+   */
+  std::vector< std::thread > threads;
+  threads.swap( this->m_Threads );
+  ++this->m_Generation;
+  this->m_RestartPending = false;
+  this->m_WorkAvailable.notify_all();
+  return threads;
+
+} // end ReleaseThreads()
+
+
+/**
+ * ****************** JoinThreads *********************************
+ */
+
+void
+SharedThreadPool
+::JoinThreads( std::vector< std::thread > & threads )
+{
+  for( std::size_t i = 0; i < threads.size(); ++i )
+  {
+    threads[ i ].join();
+  }
+
+} // end JoinThreads()
+
+
+} // end namespace itk
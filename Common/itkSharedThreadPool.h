@@ -0,0 +1,196 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkSharedThreadPool_h
+#define __itkSharedThreadPool_h
+
+#include "itkMultiThreaderBase.h"
+#include "xoutmain.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace itk
+{
+
+/** \class SharedThreadPool
+ *
+ * \brief A process-wide pool of persistent threads that executes the work
+ * units of the multi-threaded code of elastix.
+ *
+ * The PlatformMultiThreader creates and joins its threads on every call of
+ * SingleMethodExecute(). For the short iterations of a stochastic optimization
+ * that costs a noticeable part of each iteration. The threads of this pool are
+ * created once, and wait for work between the calls.
+ *
+ * Execute() hands out the work units of a call to the threads of the pool, and
+ * the calling thread executes work units of the call as well, until all are
+ * handed out. Therefore, a work unit may call Execute() itself, as the combination
+ * metric does when it evaluates its sub-metrics concurrently: the calling thread
+ * can always finish its own call, so such nested calls do not deadlock. Since
+ * one thread may execute several work units of a call after each other, the work
+ * units may not wait for each other.
+ *
+ * The number of threads of the pool and whether the threads are bound to a CPU
+ * can be set with SetNumberOfThreads() and SetUseCPUAffinity(). The pool grows
+ * without stopping its threads. Shrinking it, or changing the affinity of the
+ * running threads, stops and restarts the threads, which is postponed until no
+ * call of Execute() is running.
+ *
+ * Several threads may call Execute() concurrently, for example when several
+ * registrations run in one process. SetThreadBudget() limits the number of
+ * threads that work on the calls of one such thread, including the nested calls
+ * of its work units, so that the registrations share the pool. The work units
+ * write to the xout object of the thread that called Execute().
+ *
+ * \sa SharedPoolMultiThreader
+ * \ingroup Common
+ */
+
+class SharedThreadPool
+{
+public:
+
+  typedef MultiThreaderBase::ThreadFunctionType ThreadFunctionType;
+  typedef MultiThreaderBase::WorkUnitInfo       WorkUnitInfo;
+
+  /** Get the pool of this process. */
+  static SharedThreadPool & GetInstance( void );
+
+  /** Set and Get the number of threads of the pool. The calling thread
+   * executes work units as well, so for N concurrent work units N - 1 threads
+   * are needed. Default: the global default number of threads minus one.
+   */
+  void SetNumberOfThreads( const ThreadIdType numberOfThreads );
+  ThreadIdType GetNumberOfThreads( void ) const;
+
+  /** Set and Get whether each thread of the pool is bound to one of the CPUs
+   * that the process may use, so that the operating system does not move the
+   * threads between the CPUs. Thread i gets the allowed CPU i + 1, cyclically;
+   * the first allowed CPU is left to the calling thread, which is not bound.
+   * Only supported on Linux and Windows. Default: false.
+   */
+  void SetUseCPUAffinity( const bool useCPUAffinity );
+  bool GetUseCPUAffinity( void ) const;
+
+  /** Execute the work units 0, ..., numberOfWorkUnits - 1 of function, and return
+   * when all are finished. An exception of a work unit is rethrown here, after the
+   * other work units are finished. Thread-safe.
+   */
+  void Execute( ThreadFunctionType function, void * data, const ThreadIdType numberOfWorkUnits );
+
+  /** Set and Get the maximum number of threads that execute the calls of Execute()
+   * by the current thread, including the current thread itself. The work units of
+   * these calls, and the calls that they make, share this budget. Applies to the
+   * current thread only. Default: 0, which means no limit other than the pool size.
+   */
+  static void SetThreadBudget( const ThreadIdType threadBudget );
+  static ThreadIdType GetThreadBudget( void );
+
+private:
+
+  SharedThreadPool();
+  ~SharedThreadPool();
+
+  SharedThreadPool( const SharedThreadPool & ); // purposely not implemented
+  void operator=( const SharedThreadPool & );   // purposely not implemented
+
+  /** The threads that work on the calls of one external thread. */
+  struct Budget
+  {
+    ThreadIdType m_MaximumNumberOfThreads;
+    ThreadIdType m_NumberOfActiveThreads;
+  };
+
+  /** The work units of one call of Execute(). */
+  struct Job
+  {
+    ThreadFunctionType  m_Function;
+    void *              m_Data;
+    ThreadIdType        m_NumberOfWorkUnits;
+    ThreadIdType        m_NextWorkUnit;
+    ThreadIdType        m_NumberOfFinishedWorkUnits;
+    std::exception_ptr  m_Exception;
+    Budget *            m_Budget;
+    xl::xoutbase_type * m_Xout;
+  };
+
+  /** Find the first job of the queue whose budget allows another thread.
+   * Returns nullptr if there is none. Must be called with m_Mutex locked.
+   */
+  Job * FindAvailableJob( void ) const;
+
+  /** Take the next work unit of a job, and remove the job from the queue when
+   * this was the last one. Returns false when all work units were handed out.
+   * Must be called with m_Mutex locked.
+   */
+  bool TakeWorkUnit( Job * job, ThreadIdType & workUnit );
+
+  /** Execute one work unit, with the budget and the xout object of the job,
+   * and register that it is finished. A thread of the pool also releases its
+   * place in the budget of the job.
+   */
+  void RunWorkUnit( Job * job, const ThreadIdType workUnit, const bool isPoolThread );
+
+  /** The loop of the threads of the pool, which runs until ReleaseThreads()
+   * changes the generation.
+   */
+  void ThreadLoop( const unsigned long generation );
+
+  /** Start the threads that are not running yet. Must be called with m_Mutex locked. */
+  void StartThreads( void );
+
+  /** Restart the threads, now if no call of Execute() is running, and otherwise
+   * when the last running call finishes. Returns the threads to join, if any.
+   * Must be called with m_Mutex locked.
+   */
+  std::vector< std::thread > RequestRestart( void );
+
+  /** Take the threads out of the pool and make them stop. Returns the threads,
+   * which must be joined after m_Mutex is unlocked. Must be called with m_Mutex locked.
+   */
+  std::vector< std::thread > ReleaseThreads( void );
+
+  /** Join the threads that were released by ReleaseThreads(). */
+  static void JoinThreads( std::vector< std::thread > & threads );
+
+  mutable std::mutex         m_Mutex;
+  std::condition_variable    m_WorkAvailable;
+  std::condition_variable    m_WorkFinished;
+  std::deque< Job * >        m_Jobs;
+  std::vector< std::thread > m_Threads;
+  ThreadIdType               m_NumberOfThreads;
+  bool                       m_UseCPUAffinity;
+  unsigned long              m_Generation;
+  ThreadIdType               m_NumberOfRunningCalls;
+  bool                       m_RestartPending;
+
+  /** The budget set by SetThreadBudget(), and the budget of the work unit
+   * that the current thread executes, if any.
+   */
+  static thread_local ThreadIdType s_ThreadBudget;
+  static thread_local Budget *     s_CurrentBudget;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkSharedThreadPool_h
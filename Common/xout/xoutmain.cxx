@@ -22,11 +22,17 @@
 
 namespace xoutlibrary
 {
-static xoutbase_type * local_xout = 0;
+static thread_local xoutbase_type * local_xout = 0;
 
 xoutbase_type &
 get_xout( void )
 {
+  if( local_xout == 0 )
+  {
+    /** A sink without outputs, which discards everything. */
+    static thread_local xoutsimple_type null_xout;
+    return null_xout;
+  }
   return *local_xout;
 }
 
@@ -37,6 +43,24 @@ set_xout( xoutbase_type * arg )
   local_xout = arg;
 }
 
+
+xoutbase_type *
+get_local_xout( void )
+{
+  return local_xout;
+}
+
+
+void
+release_xout( xoutbase_type * arg )
+{
+  if( local_xout == arg )
+  {
+    local_xout = 0;
+  }
+}
+
+
 bool xout_valid() {
   return local_xout != 0;
 }
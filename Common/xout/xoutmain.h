@@ -37,10 +37,23 @@ typedef xoutsimple< char > xoutsimple_type;
 typedef xoutrow< char >    xoutrow_type;
 typedef xoutcell< char >   xoutcell_type;
 
+/** The xout object is set per thread, so that registrations that run
+ * concurrently in one process each write to their own outputs. The shared
+ * thread pool installs the xout object of the calling thread in the thread
+ * that executes a work unit. A thread without an xout object gets a sink
+ * that discards all output.
+ */
 xoutbase_type & get_xout( void );
 
 void set_xout( xoutbase_type * arg );
 
+/** Get the xout object of the current thread, or 0 if it has none. */
+xoutbase_type * get_local_xout( void );
+
+/** Stop using arg in the current thread. Call this before arg is destroyed. */
+void release_xout( xoutbase_type * arg );
+
+/** Returns whether the current thread has an xout object. */
 bool xout_valid();
 
 } // end namespace xoutlibrary
@@ -32,10 +32,18 @@ namespace elastix
  * In principle, this is the same as using the BSplineInterpolator with
  * the setting (BSplineInterpolationOrder 1). However, the LinearInterpolator
  * is significantly faster.
+ * The metrics interpolate the value and gradient of a batch of samples at once
+ * with this interpolator, see
+ * AdvancedLinearInterpolateImageFunction::EvaluateValueAndDerivativeAtContinuousIndices().
  *
  * The parameters used in this class are:
  * \parameter Interpolator: Select this interpolator as follows:\n
  *    <tt>(Interpolator "LinearInterpolator")</tt>
+ * \parameter UseBrickedLayout: Whether the interpolator reads the moving image from
+ *    a copy in which the pixels are stored in bricks of 8x8x8 pixels. This reduces
+ *    the cache misses for large images, at the cost of a copy of the image. \n
+ *    example: <tt>(UseBrickedLayout "true")</tt> \n
+ *    The default is "false". The parameter can be specified for each resolution.
  *
  * \ingroup Interpolators
  */
@@ -90,6 +98,11 @@ public:
   typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
   typedef typename Superclass2::ITKBaseType          ITKBaseType;
 
+  /** Execute stuff before each resolution:
+   * \li Set whether the bricked layout is used.
+   */
+  void BeforeEachResolution( void ) override;
+
 protected:
 
   /** The constructor. */
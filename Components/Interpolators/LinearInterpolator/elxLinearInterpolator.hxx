@@ -24,7 +24,29 @@
 namespace elastix
 {
 
-/** Nothing */
+/**
+ * ***************** BeforeEachResolution ***********************
+ */
+
+template< class TElastix >
+void
+LinearInterpolator< TElastix >
+::BeforeEachResolution( void )
+{
+  /** Get the current resolution level. */
+  unsigned int level
+    = ( this->m_Registration->GetAsITKBaseType() )->GetCurrentLevel();
+
+  /** Read whether the bricked layout should be used. The copy is made
+   * when the metric sets the moving image of this resolution.
+   */
+  bool useBrickedLayout = false;
+  this->GetConfiguration()->ReadParameter( useBrickedLayout,
+    "UseBrickedLayout", this->GetComponentLabel(), level, 0 );
+  this->SetUseBrickedLayout( useBrickedLayout );
+
+} // end BeforeEachResolution()
+
 
 } // end namespace elastix
 
@@ -60,6 +60,21 @@ namespace elastix
  *    resolution, or for all resolutions at once. \n
  *    example: <tt>(MovingKernelBSplineOrder 3 3 3)</tt> \n
  *    The default value is 3.
+ * \parameter UseTabulatedKernels: Whether to evaluate the cubic B-spline
+ *    Parzen windows with a lookup table with linear interpolation, instead
+ *    of evaluating the B-spline polynomials for every sample. The error in
+ *    the Parzen window weights is below 2.4e-7. Can be given for each
+ *    resolution, or for all resolutions at once. \n
+ *    example: <tt>(UseTabulatedKernels "true")</tt> \n
+ *    The default is "false".
+ * \parameter UseSharedJointPDFs: Whether the threads may share a few joint
+ *    histograms, updated with atomic additions, instead of each filling its
+ *    own one. Only done when there are fewer samples per thread than
+ *    histogram bins, where zeroing and merging the histograms of all threads
+ *    dominates. The results are then not bitwise reproducible. Can be given
+ *    for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(UseSharedJointPDFs "true")</tt> \n
+ *    The default is "false".
  * \parameter FixedLimitRangeRatio: The relative extension of the intensity
  *    range of the fixed image.\n
  *    If your fixed image has grey values from a to b and the
@@ -91,6 +106,14 @@ namespace elastix
  *    B-spline grids.
  *    example: <tt>(UseFastAndLowMemoryVersion "false")</tt> \n
  *    The default is "true".
+ * \parameter UseMovingImageSampleCache: Whether the fast and low memory version
+ *    keeps the moving image values and gradients of its first loop over the
+ *    samples, for the second loop. The samples are then transformed and
+ *    interpolated once per iteration instead of twice, at the cost of one
+ *    small record per sample. Only used when multi-threading is on.
+ *    Can be given for each resolution, or for all resolutions at once. \n
+ *    example: <tt>(UseMovingImageSampleCache "true")</tt> \n
+ *    The default is "false".
  *
  * \sa ParzenWindowMutualInformationImageToImageMetric
  * \ingroup Metrics
@@ -119,12 +119,30 @@ AdvancedMattesMutualInformationMetric< TElastix >
   this->SetFixedKernelBSplineOrder( fixedKernelBSplineOrder );
   this->SetMovingKernelBSplineOrder( movingKernelBSplineOrder );
 
+  /** Set whether the Parzen kernels should be evaluated by a lookup table. */
+  bool useTabulatedKernels = false;
+  this->GetConfiguration()->ReadParameter( useTabulatedKernels,
+    "UseTabulatedKernels", this->GetComponentLabel(), level, 0 );
+  this->SetUseTabulatedKernels( useTabulatedKernels );
+
+  /** Set whether the threads may share their joint histograms. */
+  bool useSharedJointPDFs = false;
+  this->GetConfiguration()->ReadParameter( useSharedJointPDFs,
+    "UseSharedJointPDFs", this->GetComponentLabel(), level, 0 );
+  this->SetUseSharedJointPDFs( useSharedJointPDFs );
+
   /** Set whether a low memory consumption should be used. */
   bool useFastAndLowMemoryVersion = true;
   this->GetConfiguration()->ReadParameter( useFastAndLowMemoryVersion,
     "UseFastAndLowMemoryVersion", this->GetComponentLabel(), level, 0 );
   this->SetUseExplicitPDFDerivatives( !useFastAndLowMemoryVersion );
 
+  /** Set whether the low memory version keeps the moving image data of the samples. */
+  bool useMovingImageSampleCache = false;
+  this->GetConfiguration()->ReadParameter( useMovingImageSampleCache,
+    "UseMovingImageSampleCache", this->GetComponentLabel(), level, 0 );
+  this->SetUseMovingImageSampleCache( useMovingImageSampleCache );
+
   /** Set whether to use Nick Tustison's preconditioning technique. */
   bool useJacobianPreconditioning = false;
   this->GetConfiguration()->ReadParameter( useJacobianPreconditioning,
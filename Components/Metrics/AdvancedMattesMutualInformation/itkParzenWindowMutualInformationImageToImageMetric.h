@@ -22,6 +22,8 @@
 
 #include "itkArray2D.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -157,6 +159,14 @@ public:
   itkGetConstMacro( UseJacobianPreconditioning, bool );
   itkSetMacro( UseJacobianPreconditioning, bool );
 
+  /** Set/get whether the multi-threaded low memory version keeps the moving
+   * image values and gradients of its first pass over the samples, so that the
+   * second pass does not need to transform and interpolate the samples again.
+   * This costs one small record per sample; default: false.
+   */
+  itkGetConstMacro( UseMovingImageSampleCache, bool );
+  itkSetMacro( UseMovingImageSampleCache, bool );
+
 protected:
 
   /** The constructor. */
@@ -165,6 +175,9 @@ protected:
   /** The destructor. */
   ~ParzenWindowMutualInformationImageToImageMetric() override {}
 
+  /** Clone this metric, see AdvancedImageToImageMetric::Clone(). */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** Protected Typedefs ******************/
 
   /** Typedefs inherited from superclass */
@@ -192,6 +205,8 @@ protected:
   typedef typename Superclass::ParzenValueContainerType            ParzenValueContainerType;
   typedef typename Superclass::KernelFunctionType                  KernelFunctionType;
   typedef typename Superclass::NonZeroJacobianIndicesType          NonZeroJacobianIndicesType;
+  typedef typename Superclass::ImageSampleArrayContainerType       ImageSampleArrayContainerType;
+  typedef typename Superclass::SharedJointPDFValueType             SharedJointPDFValueType;
 
   /**  Get the value and analytic derivative.
    * Called by GetValueAndDerivative if UseFiniteDifferenceDerivative == false.
@@ -256,6 +271,28 @@ protected:
   /** Helper function to launch the threads. */
   void LaunchComputeDerivativeLowMemoryThreaderCallback( void ) const;
 
+  /** The moving image data of a sample, as computed by the first pass of the
+   * low memory version, see UseMovingImageSampleCache. The values are limited
+   * to the histogram range, and the derivative is that of the limited value.
+   */
+  struct CachedSampleType
+  {
+    RealType                  m_FixedImageValue;
+    RealType                  m_MovingImageValue;
+    MovingImageDerivativeType m_MovingImageDerivative;
+    bool                      m_IsValid;
+  };
+  mutable std::vector< CachedSampleType > m_SampleCache;
+
+  /** Compute the PDFs like ComputePDFs(), and fill m_SampleCache on the way. */
+  void ComputePDFsAndSampleCache( const ParametersType & parameters ) const;
+
+  /** Multi-threaded version of ComputePDFsAndSampleCache(). */
+  inline void ThreadedComputePDFsAndSampleCache( ThreadIdType threadId );
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_TYPE ComputePDFsAndSampleCacheThreaderCallback( void * arg );
+
 private:
 
   /** The private constructor. */
@@ -268,8 +305,15 @@ private:
   typedef Array2D< PRatioType > PRatioArrayType;
   mutable PRatioArrayType m_PRatioArray;
 
-  /** Setting */
+  /** Settings */
   bool m_UseJacobianPreconditioning;
+  bool m_UseMovingImageSampleCache;
+
+  /** True if the PDFs were computed by the last call to GetValue(), and may be
+   * reused by GetValueAndDerivative() at the same parameters. Only set when
+   * the evaluation cache is used, see SetUseEvaluationCache().
+   */
+  mutable bool m_PDFsAreFromGetValue;
 
   /** Helper function to compute the derivative for the low memory variant. */
   void ComputeDerivativeLowMemorySingleThreaded( DerivativeType & derivative ) const;
@@ -284,6 +328,21 @@ private:
     const NonZeroJacobianIndicesType & nzji,
     DerivativeType & derivative ) const;
 
+  /** Helper function for ThreadedComputeDerivativeLowMemory: the contribution
+   * of one valid sample to the derivative of this thread.
+   */
+  inline void ThreadedUpdateDerivativeLowMemory(
+    ThreadIdType threadId,
+    const FixedImagePointType & fixedPoint,
+    const RealType & fixedImageValue,
+    const RealType & movingImageValue,
+    const MovingImageDerivativeType & movingImageDerivative,
+    DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nzji,
+    DerivativeType & jacobianPreconditioner,
+    DerivativeType & preconditioningDivisor,
+    DerivativeType & derivative );
+
   /** Helper function to compute m_PRatioArray in case of low memory consumption. */
   void ComputeValueAndPRatioArray( double & MI ) const;
 
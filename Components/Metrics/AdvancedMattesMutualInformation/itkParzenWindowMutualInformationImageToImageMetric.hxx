@@ -42,6 +42,9 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::ParzenWindowMutualInformationImageToImageMetric()
 {
   this->m_UseJacobianPreconditioning = false;
+  this->m_UseMovingImageSampleCache  = false;
+  this->m_PDFsAreFromGetValue        = false;
+  this->SetSupportsSparseDerivativeAccumulation( true );
 
   /** Initialize the m_ParzenWindowHistogramThreaderParameters. */
   this->m_ParzenWindowMutualInformationThreaderParameters.m_Metric = this;
@@ -49,6 +52,28 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 } // end constructor
 
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+LightObject::Pointer
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  if( !this->CopySettingsToClone( clone ) )
+  {
+    return LightObject::Pointer();
+  }
+  clone->m_UseJacobianPreconditioning = this->m_UseJacobianPreconditioning;
+  clone->m_UseMovingImageSampleCache  = this->m_UseMovingImageSampleCache;
+
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
 /**
  * ********************* InitializeHistograms ******************************
  */
@@ -82,6 +107,13 @@ typename ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingIm
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValue( const ParametersType & parameters ) const
 {
+  /** Reuse the result of a previous evaluation at the same parameters. */
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  if( this->GetCachedValue( parameters, value ) )
+  {
+    return value;
+  }
+
   /** Construct the JointPDF and Alpha. */
   this->ComputePDFs( parameters );
 
@@ -133,7 +165,13 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 
   } // end while-loop over fixed index
 
-  return static_cast< MeasureType >( -1.0 * MI );
+  value = static_cast< MeasureType >( -1.0 * MI );
+  this->SetCachedValue( parameters, value );
+
+  /** The PDFs can be reused by a subsequent GetValueAndDerivative(). */
+  this->m_PDFsAreFromGetValue = this->GetUseEvaluationCache();
+
+  return value;
 
 } // end GetValue()
 
@@ -158,6 +196,9 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     return;
   }
 
+  /** The PDFs are overwritten below. */
+  this->m_PDFsAreFromGetValue = false;
+
   /** Initialize some variables. */
   value      = NumericTraits< MeasureType >::Zero;
   derivative = DerivativeType( this->GetNumberOfParameters() );
@@ -253,18 +294,40 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   MeasureType & value,
   DerivativeType & derivative ) const
 {
-  /** Construct the JointPDF and Alpha.
-   * This function contains a loop over the samples.
-   * It executes multi-threadedly when m_UseMultiThread == true.
+  /** If GetValue() was the last evaluation, at these same parameters, the
+   * normalized joint PDF, alpha and the marginal PDFs it computed are still
+   * valid, and the first loop over the samples can be skipped. GetCachedValue()
+   * then also sets the transform parameters. This is not possible when the
+   * moving image sample cache is used, since GetValue() does not fill it.
    */
-  this->ComputePDFs( parameters );
+  const bool reusePDFs = this->m_PDFsAreFromGetValue
+    && !( this->m_UseMultiThread && this->m_UseMovingImageSampleCache )
+    && this->GetCachedValue( parameters, value );
+  this->m_PDFsAreFromGetValue = false;
 
-  /** Normalize the joint histogram by alpha. */
-  this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha );
+  if( !reusePDFs )
+  {
+    /** Construct the JointPDF and Alpha.
+     * This function contains a loop over the samples.
+     * It executes multi-threadedly when m_UseMultiThread == true.
+     * Optionally, the moving image data of the samples is kept for the second loop.
+     */
+    if( this->m_UseMultiThread && this->m_UseMovingImageSampleCache )
+    {
+      this->ComputePDFsAndSampleCache( parameters );
+    }
+    else
+    {
+      this->ComputePDFs( parameters );
+    }
 
-  /** Compute the fixed and moving marginal pdf by summing over the histogram. */
-  this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
-  this->ComputeMarginalPDF( this->m_JointPDF, this->m_MovingImageMarginalPDF, 1 );
+    /** Normalize the joint histogram by alpha. */
+    this->NormalizeJointPDF( this->m_JointPDF, this->m_Alpha );
+
+    /** Compute the fixed and moving marginal pdf by summing over the histogram. */
+    this->ComputeMarginalPDF( this->m_JointPDF, this->m_FixedImageMarginalPDF, 0 );
+    this->ComputeMarginalPDF( this->m_JointPDF, this->m_MovingImageMarginalPDF, 1 );
+  }
 
   // \todo: the last three loops over the joint histogram can be done in
   // one loop, maybe also include the next loop to generate m_PRatioArray.
@@ -286,6 +349,129 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetValueAndAnalyticDerivativeLowMemory()
 
 
+/**
+ * ******************** ComputePDFsAndSampleCache *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePDFsAndSampleCache( const ParametersType & parameters ) const
+{
+  /** Call non-thread-safe stuff, see ComputePDFs(). */
+  this->BeforeThreadedGetValueAndDerivative( parameters );
+
+  /** One record per sample. The memory is only reallocated when the number
+   * of samples grows.
+   */
+  const SizeValueType numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+  this->m_SampleCache.resize( numberOfSamples );
+
+  /** Distribute the samples over the threads. */
+  this->InitializeSharedJointPDFs( numberOfSamples );
+  this->InitializeSampleChunkScheduler( numberOfSamples );
+
+  /** Launch multi-threading JointPDF computation. */
+  this->m_Threader->SetSingleMethod( this->ComputePDFsAndSampleCacheThreaderCallback,
+    const_cast< void * >( static_cast< const void * >(
+      &this->m_ParzenWindowMutualInformationThreaderParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Gather the results from all threads. */
+  this->AfterThreadedComputePDFs();
+
+} // end ComputePDFsAndSampleCache()
+
+
+/**
+ * ******************* ThreadedComputePDFsAndSampleCache *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputePDFsAndSampleCache( ThreadIdType threadId )
+{
+  /** Get a handle to the joint PDF that this thread adds to. */
+  SharedJointPDFValueType * sharedJointPDF = nullptr;
+  JointPDFType *            jointPDF       = this->GetThreaderJointPDF( threadId, sharedJointPDF );
+
+  /** Get a handle to the samples in the structure-of-arrays layout. */
+  typedef typename ImageSampleArrayContainerType::ImageValueType FixedImageValueType;
+  const FixedImageValueType * fixedImageValues = this->m_ImageSampleArrays->GetImageValues();
+
+  unsigned long numberOfPixelsCounted = 0;
+
+  /** Buffers for one batch of samples. */
+  RealType                  movingImageValues[ Superclass::SampleBatchSize ];
+  MovingImageDerivativeType movingImageDerivatives[ Superclass::SampleBatchSize ];
+  unsigned char             sampleOk[ Superclass::SampleBatchSize ];
+
+  /** Loop over the chunks of samples handed out by the scheduler. */
+  unsigned long pos_begin, pos_end;
+  while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
+  {
+    for( unsigned long batch_begin = pos_begin; batch_begin < pos_end; batch_begin += Superclass::SampleBatchSize )
+    {
+      const unsigned long batch_end = std::min( batch_begin + Superclass::SampleBatchSize, pos_end );
+      const unsigned long batchSize = batch_end - batch_begin;
+
+      /** Compute the moving image values M(T(x)) and gradients of the batch. */
+      numberOfPixelsCounted += this->EvaluateMovingImageValuesBatch(
+        batch_begin, batch_end, movingImageValues, sampleOk, movingImageDerivatives );
+
+      /** Store the valid samples, and add them to the joint pdf. */
+      for( unsigned long i = 0; i < batchSize; ++i )
+      {
+        CachedSampleType & sample = this->m_SampleCache[ batch_begin + i ];
+        sample.m_IsValid = sampleOk[ i ] != 0;
+        if( !sample.m_IsValid )
+        {
+          continue;
+        }
+
+        /** Make sure the values fall within the histogram range. */
+        sample.m_FixedImageValue = this->GetFixedImageLimiter()->Evaluate(
+          static_cast< RealType >( fixedImageValues[ batch_begin + i ] ) );
+        sample.m_MovingImageDerivative = movingImageDerivatives[ i ];
+        sample.m_MovingImageValue      = this->GetMovingImageLimiter()->Evaluate(
+          movingImageValues[ i ], sample.m_MovingImageDerivative );
+
+        /** Compute this sample's contribution to the joint distributions. */
+        this->UpdateThreaderJointPDF( sample.m_FixedImageValue, sample.m_MovingImageValue,
+          jointPDF, sharedJointPDF );
+      }
+    } // end for loop over the batches
+  } // end while over the sample chunks
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+
+} // end ThreadedComputePDFsAndSampleCache()
+
+
+/**
+ * **************** ComputePDFsAndSampleCacheThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePDFsAndSampleCacheThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  ParzenWindowMutualInformationMultiThreaderParameterType * temp
+    = static_cast< ParzenWindowMutualInformationMultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedComputePDFsAndSampleCache( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputePDFsAndSampleCacheThreaderCallback()
+
+
 /**
  * ******************** ComputeDerivativeLowMemorySingleThreaded *******************
  */
@@ -464,105 +650,93 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     preconditioningDivisor.Fill( 0.0 );
   }
 
-  /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->Begin();
-  fbegin                                                 += (int)pos_begin;
-  fend                                                   += (int)pos_end;
-
-  /** Loop over sample container and compute contribution of each sample to pdfs. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  /** With the sample cache, the moving image data was computed by the first pass. */
+  if( this->m_UseMovingImageSampleCache )
   {
-    /** Read fixed coordinates and create some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImageDerivativeType   movingImageDerivative;
-    MovingImagePointType        mappedPoint;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    const ImageSampleArrayContainerType * sampleArrays = this->m_ImageSampleArrays.GetPointer();
 
-    /** Check if the point is inside the moving mask. */
-    if( sampleOk )
+    /** Loop over the chunks of samples handed out by the scheduler. */
+    unsigned long pos_begin, pos_end;
+    while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
+      for( unsigned long pos = pos_begin; pos < pos_end; ++pos )
+      {
+        const CachedSampleType & sample = this->m_SampleCache[ pos ];
+        if( !sample.m_IsValid )
+        {
+          continue;
+        }
 
-    /** Compute the moving image value, its derivative, and check
-     * if the point is inside the moving image buffer.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative );
+        FixedImagePointType fixedPoint;
+        sampleArrays->GetPoint( pos, fixedPoint );
+
+        this->ThreadedUpdateDerivativeLowMemory( threadId, fixedPoint,
+          sample.m_FixedImageValue, sample.m_MovingImageValue, sample.m_MovingImageDerivative,
+          imageJacobian, nzji, jacobianPreconditioner, preconditioningDivisor, derivative );
+      }
     }
+  }
+  else
+  {
+    /** Get a handle to the sample container. */
+    ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
-    if( sampleOk )
+    /** Loop over the chunks of samples handed out by the scheduler. */
+    unsigned long pos_begin, pos_end;
+    while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
     {
-      /** Get the fixed image value. */
-      RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
-
-      /** Make sure the values fall within the histogram range. */
-      fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
-      movingImageValue = this->GetMovingImageLimiter()
-        ->Evaluate( movingImageValue, movingImageDerivative );
-
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+      /** Create iterator over the sample container. */
+      typename ImageSampleContainerType::ConstIterator fiter;
+      typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+      typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->Begin();
+      fbegin += (int)pos_begin;
+      fend += (int)pos_end;
+
+      /** Loop over sample container and compute contribution of each sample to pdfs. */
+      for( fiter = fbegin; fiter != fend; ++fiter )
+      {
+        /** Read fixed coordinates and create some variables. */
+        const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+        RealType                    movingImageValue;
+        MovingImageDerivativeType   movingImageDerivative;
+        MovingImagePointType        mappedPoint;
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji );
-#endif
+        /** Transform point and check if it is inside the B-spline support region. */
+        bool sampleOk = this->TransformPoint( fiter.Index(), fixedPoint, mappedPoint );
 
-      /** If desired, apply the technique introduced by Tustison. */
-      TransformJacobianType jacobian;
-      if( this->GetUseJacobianPreconditioning() )
-      {
-        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        /** Check if the point is inside the moving mask. */
+        if( sampleOk )
+        {
+          sampleOk = this->IsInsideMovingMask( mappedPoint );
+        }
 
-        this->ComputeJacobianPreconditioner( jacobian, nzji,
-          jacobianPreconditioner, preconditioningDivisor );
-        DerivativeValueType * imjacit   = imageJacobian.begin();
-        DerivativeValueType * jacprecit = jacobianPreconditioner.begin();
-        for( unsigned int i = 0; i < nzji.size(); ++i )
+        /** Compute the moving image value, its derivative, and check
+         * if the point is inside the moving image buffer.
+         */
+        if( sampleOk )
         {
-          while( imjacit != imageJacobian.end() )
-          {
-            ( *imjacit ) *= ( *jacprecit );
-            ++imjacit;
-            ++jacprecit;
-          }
+          sampleOk = this->EvaluateMovingImageValueAndDerivative(
+            mappedPoint, movingImageValue, &movingImageDerivative );
         }
-      }
 
-      /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateDerivativeLowMemory(
-        fixedImageValue, movingImageValue, imageJacobian, nzji,
-        derivative );
+        if( sampleOk )
+        {
+          /** Get the fixed image value. */
+          RealType fixedImageValue = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
 
-    } // end sampleOk
-  } // end loop over sample container
+          /** Make sure the values fall within the histogram range. */
+          fixedImageValue  = this->GetFixedImageLimiter()->Evaluate( fixedImageValue );
+          movingImageValue = this->GetMovingImageLimiter()
+            ->Evaluate( movingImageValue, movingImageDerivative );
+
+          this->ThreadedUpdateDerivativeLowMemory( threadId, fixedPoint,
+            fixedImageValue, movingImageValue, movingImageDerivative,
+            imageJacobian, nzji, jacobianPreconditioner, preconditioningDivisor, derivative );
+
+        } // end sampleOk
+      } // end loop over sample container
+    } // end while over the sample chunks
+  }
 
   /** If desired, apply the technique introduced by Tustison. */
   if( this->GetUseJacobianPreconditioning() )
@@ -585,6 +759,70 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 } // end ThreadedComputeDerivativeLowMemory()
 
 
+/**
+ * ******************* ThreadedUpdateDerivativeLowMemory *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedUpdateDerivativeLowMemory(
+  ThreadIdType threadId,
+  const FixedImagePointType & fixedPoint,
+  const RealType & fixedImageValue,
+  const RealType & movingImageValue,
+  const MovingImageDerivativeType & movingImageDerivative,
+  DerivativeType & imageJacobian,
+  NonZeroJacobianIndicesType & nzji,
+  DerivativeType & jacobianPreconditioner,
+  DerivativeType & preconditioningDivisor,
+  DerivativeType & derivative )
+{
+#if 0
+  /** Get the TransformJacobian dT/dmu. */
+  this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+
+  /** Compute the inner products (dM/dx)^T (dT/dmu). */
+  this->EvaluateTransformJacobianInnerProduct(
+    jacobian, movingImageDerivative, imageJacobian );
+#else
+  /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+  this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+    fixedPoint, movingImageDerivative, imageJacobian, nzji );
+#endif
+
+  /** If desired, apply the technique introduced by Tustison. */
+  TransformJacobianType jacobian;
+  if( this->GetUseJacobianPreconditioning() )
+  {
+    this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+
+    this->ComputeJacobianPreconditioner( jacobian, nzji,
+      jacobianPreconditioner, preconditioningDivisor );
+    DerivativeValueType * imjacit   = imageJacobian.begin();
+    DerivativeValueType * jacprecit = jacobianPreconditioner.begin();
+    for( unsigned int i = 0; i < nzji.size(); ++i )
+    {
+      while( imjacit != imageJacobian.end() )
+      {
+        ( *imjacit ) *= ( *jacprecit );
+        ++imjacit;
+        ++jacprecit;
+      }
+    }
+  }
+
+  /** Compute this sample's contribution to the joint distributions. */
+  this->UpdateDerivativeLowMemory(
+    fixedImageValue, movingImageValue, imageJacobian, nzji,
+    derivative );
+
+  /** Register the derivative entries updated by this sample. */
+  this->RegisterDerivativeIndices( threadId, nzji );
+
+} // end ThreadedUpdateDerivativeLowMemory()
+
+
 /**
  * ******************* AfterThreadedComputeDerivativeLowMemory *******************
  */
@@ -669,6 +907,13 @@ void
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::LaunchComputeDerivativeLowMemoryThreaderCallback( void ) const
 {
+  /** Distribute the samples over the threads, and select the way
+   * the per-thread derivatives are accumulated.
+   */
+  const SizeValueType numberOfSamples = this->GetImageSampler()->GetOutput()->Size();
+  this->InitializeSampleChunkScheduler( numberOfSamples );
+  this->InitializeDerivativeAccumulation( numberOfSamples );
+
   /** Setup threader. */
   this->m_Threader->SetSingleMethod( this->ComputeDerivativeLowMemoryThreaderCallback,
     const_cast< void * >( static_cast< const void * >(
@@ -867,6 +1112,9 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   derivative = DerivativeType( this->GetNumberOfParameters() );
   derivative.Fill( NumericTraits< double >::ZeroValue() );
 
+  /** The PDFs are overwritten below. */
+  this->m_PDFsAreFromGetValue = false;
+
   /** Construct the JointPDF, JointPDFDerivatives, Alpha and its derivatives. */
   this->ComputePDFsAndIncrementalPDFs( parameters );
 
@@ -110,6 +110,8 @@ public:
   typedef typename Superclass::ImageSampleContainerType   ImageSampleContainerType;
   typedef typename
     Superclass::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename
+    Superclass::ImageSampleArrayContainerType ImageSampleArrayContainerType;
   typedef typename Superclass::FixedImageLimiterType  FixedImageLimiterType;
   typedef typename Superclass::MovingImageLimiterType MovingImageLimiterType;
   typedef typename
@@ -195,6 +197,9 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Clone this metric, see AdvancedImageToImageMetric::Clone(). */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** Protected Typedefs ******************/
 
   /** Typedefs inherited from superclass */
@@ -22,6 +22,7 @@
 #include "vnl/algo/vnl_matrix_update.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkComputeImageExtremaFilter.h"
+#include <algorithm>
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -39,6 +40,8 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::AdvancedMeanSquaresImageToImageMetric()
 {
   this->SetUseImageSampler( true );
+  this->SetSupportsSparseDerivativeAccumulation( true );
+  this->SetUseImageSampleArrays( true );
   this->SetUseFixedImageLimiter( false );
   this->SetUseMovingImageLimiter( false );
 
@@ -173,6 +176,30 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 } // end PrintSelf()
 
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+LightObject::Pointer
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  if( !this->CopySettingsToClone( clone ) )
+  {
+    return LightObject::Pointer();
+  }
+  clone->m_UseNormalization              = this->m_UseNormalization;
+  clone->m_SelfHessianSmoothingSigma     = this->m_SelfHessianSmoothingSigma;
+  clone->m_SelfHessianNoiseRange         = this->m_SelfHessianNoiseRange;
+  clone->m_NumberOfSamplesForSelfHessian = this->m_NumberOfSamplesForSelfHessian;
+
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
 /**
  * ******************* GetValueSingleThreaded *******************
  */
@@ -278,10 +305,19 @@ typename AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >::Mea
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValue( const TransformParametersType & parameters ) const
 {
+  /** Reuse the result of a previous evaluation at the same parameters. */
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  if( this->GetCachedValue( parameters, value ) )
+  {
+    return value;
+  }
+
   /** Option for now to still use the single threaded code. */
   if( !this->m_UseMultiThread )
   {
-    return this->GetValueSingleThreaded( parameters );
+    value = this->GetValueSingleThreaded( parameters );
+    this->SetCachedValue( parameters, value );
+    return value;
   }
 
   /** Call non-thread-safe stuff, such as:
@@ -302,8 +338,8 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   this->LaunchGetValueThreaderCallback();
 
   /** Gather the metric values from all threads. */
-  MeasureType value = NumericTraits< MeasureType >::Zero;
   this->AfterThreadedGetValue( value );
+  this->SetCachedValue( parameters, value );
 
   return value;
 
@@ -319,73 +355,46 @@ void
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedGetValue( ThreadIdType threadId )
 {
-  /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend   += (int)pos_end;
+  /** Get a handle to the samples in the structure-of-arrays layout. */
+  typedef typename ImageSampleArrayContainerType::ImageValueType FixedImageValueType;
+  const ImageSampleArrayContainerType * sampleArrays     = this->m_ImageSampleArrays.GetPointer();
+  const FixedImageValueType *           fixedImageValues = sampleArrays->GetImageValues();
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
   MeasureType   measure               = NumericTraits< MeasureType >::Zero;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint ); // thread-safe?
-    }
+  /** Buffers for one batch of samples. */
+  RealType      movingImageValues[ Superclass::SampleBatchSize ];
+  unsigned char sampleOk[ Superclass::SampleBatchSize ];
 
-    /** Compute the moving image value M(T(x)) and check if
-     * the point is inside the moving image buffer.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, 0 );
-    }
-
-    if( sampleOk )
+  /** Loop over the chunks of samples handed out by the scheduler. */
+  unsigned long pos_begin, pos_end;
+  while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
+  {
+    /** Loop over the chunk in batches to calculate the mean squares. */
+    for( unsigned long batch_begin = pos_begin; batch_begin < pos_end; batch_begin += Superclass::SampleBatchSize )
     {
-      numberOfPixelsCounted++;
+      const unsigned long batch_end = std::min( batch_begin + Superclass::SampleBatchSize, pos_end );
+      const unsigned long batchSize = batch_end - batch_begin;
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
+      /** Compute the moving image values M(T(x)) of the batch. */
+      numberOfPixelsCounted += this->EvaluateMovingImageValuesBatch(
+        batch_begin, batch_end, movingImageValues, sampleOk );
 
-      /** The difference squared. */
-      const RealType diff = movingImageValue - fixedImageValue;
-      measure += diff * diff;
-
-    } // end if sampleOk
+      /** The difference squared; invalid samples contribute zero.
+       * This loop has no branches, so that the compiler can vectorise it.
+       */
+      const FixedImageValueType * fixedBatch = fixedImageValues + batch_begin;
+      for( unsigned long i = 0; i < batchSize; ++i )
+      {
+        const RealType diff = sampleOk[ i ]
+          ? movingImageValues[ i ] - static_cast< RealType >( fixedBatch[ i ] ) : 0.0;
+        measure += diff * diff;
+      }
 
-  } // end for loop over the image sample container
+    } // end for loop over the batches
+  } // end while over the sample chunks
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -598,11 +607,18 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
+  /** Reuse the result of a previous evaluation at the same parameters. */
+  if( this->GetCachedValueAndDerivative( parameters, value, derivative ) )
+  {
+    return;
+  }
+
   /** Option for now to still use the single threaded code. */
   if( !this->m_UseMultiThread )
   {
-    return this->GetValueAndDerivativeSingleThreaded(
-      parameters, value, derivative );
+    this->GetValueAndDerivativeSingleThreaded( parameters, value, derivative );
+    this->SetCachedValueAndDerivative( parameters, value, derivative );
+    return;
   }
 
   /** Call non-thread-safe stuff, such as:
@@ -625,6 +641,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 
   /** Gather the metric values and derivatives from all threads. */
   this->AfterThreadedGetValueAndDerivative( value, derivative );
+  this->SetCachedValueAndDerivative( parameters, value, derivative );
 
 } // end GetValueAndDerivative()
 
@@ -650,89 +667,63 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
    */
   DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
 
-  /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend   += (int)pos_end;
+  /** Get a handle to the samples in the structure-of-arrays layout. */
+  typedef typename ImageSampleArrayContainerType::ImageValueType FixedImageValueType;
+  const ImageSampleArrayContainerType * sampleArrays     = this->m_ImageSampleArrays.GetPointer();
+  const FixedImageValueType *           fixedImageValues = sampleArrays->GetImageValues();
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
   MeasureType   measure               = NumericTraits< MeasureType >::Zero;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-    MovingImageDerivativeType   movingImageDerivative;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+  /** Buffers for one batch of samples. */
+  RealType                  movingImageValues[ Superclass::SampleBatchSize ];
+  MovingImageDerivativeType movingImageDerivatives[ Superclass::SampleBatchSize ];
+  unsigned char             sampleOk[ Superclass::SampleBatchSize ];
 
-    /** Check if point is inside mask. */
-    if( sampleOk )
+  /** Loop over the chunks of samples handed out by the scheduler. */
+  unsigned long pos_begin, pos_end;
+  while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
+  {
+    /** Loop over the chunk in batches to calculate the mean squares. */
+    for( unsigned long batch_begin = pos_begin; batch_begin < pos_end; batch_begin += Superclass::SampleBatchSize )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint ); // thread-safe?
-    }
+      const unsigned long batch_end = std::min( batch_begin + Superclass::SampleBatchSize, pos_end );
+      const unsigned long batchSize = batch_end - batch_begin;
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative );
-    }
+      /** Compute the moving image values M(T(x)) and derivatives dM/dx of the batch. */
+      numberOfPixelsCounted += this->EvaluateMovingImageValuesBatch(
+        batch_begin, batch_end, movingImageValues, sampleOk, movingImageDerivatives );
 
-    if( sampleOk )
-    {
-      numberOfPixelsCounted++;
+      /** The Jacobian products are computed per sample, in sample order. */
+      for( unsigned long i = 0; i < batchSize; ++i )
+      {
+        if( !sampleOk[ i ] )
+        {
+          continue;
+        }
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
+        FixedImagePointType fixedPoint;
+        sampleArrays->GetPoint( batch_begin + i, fixedPoint );
+        const RealType fixedImageValue = static_cast< RealType >( fixedImageValues[ batch_begin + i ] );
 
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+        this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, movingImageDerivatives[ i ], imageJacobian, nzji );
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji );
-#endif
+        /** Compute this pixel's contribution to the measure and derivatives. */
+        this->UpdateValueAndDerivativeTerms(
+          fixedImageValue, movingImageValues[ i ],
+          imageJacobian, nzji,
+          measure, derivative );
 
-      /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(
-        fixedImageValue, movingImageValue,
-        imageJacobian, nzji,
-        measure, derivative );
+        /** Register the derivative entries updated by this sample. */
+        this->RegisterDerivativeIndices( threadId, nzji );
 
-    } // end if sampleOk
+      } // end for loop over the batch
 
-  } // end for loop over the image sample container
+    } // end for loop over the batches
+  } // end while over the sample chunks
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -144,6 +144,8 @@ public:
   typedef typename Superclass::ImageSampleContainerType   ImageSampleContainerType;
   typedef typename
     Superclass::ImageSampleContainerPointer ImageSampleContainerPointer;
+  typedef typename
+    Superclass::ImageSampleArrayContainerType ImageSampleArrayContainerType;
   typedef typename Superclass::FixedImageLimiterType  FixedImageLimiterType;
   typedef typename Superclass::MovingImageLimiterType MovingImageLimiterType;
   typedef typename
@@ -196,6 +198,9 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Clone this metric, see AdvancedImageToImageMetric::Clone(). */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** Protected Typedefs ******************/
 
   /** Typedefs inherited from superclass */
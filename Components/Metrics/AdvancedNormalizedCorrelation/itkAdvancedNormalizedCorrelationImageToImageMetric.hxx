@@ -19,6 +19,7 @@
 #define _itkAdvancedNormalizedCorrelationImageToImageMetric_hxx
 
 #include "itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+#include <algorithm>
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -38,6 +39,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_SubtractMean = false;
 
   this->SetUseImageSampler( true );
+  this->SetUseImageSampleArrays( true );
   this->SetUseFixedImageLimiter( false );
   this->SetUseMovingImageLimiter( false );
 
@@ -124,6 +126,27 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 } // end PrintSelf()
 
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+LightObject::Pointer
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  if( !this->CopySettingsToClone( clone ) )
+  {
+    return LightObject::Pointer();
+  }
+  clone->m_SubtractMean = this->m_SubtractMean;
+
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
 /**
  * *************** UpdateDerivativeTerms ***************************
  */
@@ -187,9 +210,15 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 {
   itkDebugMacro( "GetValue( " << parameters << " ) " );
 
+  /** Reuse the result of a previous evaluation at the same parameters. */
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  if( this->GetCachedValue( parameters, measure ) )
+  {
+    return measure;
+  }
+
   /** Initialize some variables */
   this->m_NumberOfPixelsCounted = 0;
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
 
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
@@ -206,13 +235,11 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
-  /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
+  /** Get a handle to the samples in the structure-of-arrays layout. */
+  typedef typename ImageSampleArrayContainerType::ImageValueType FixedImageValueType;
+  const ImageSampleArrayContainerType * sampleArrays     = this->m_ImageSampleArrays.GetPointer();
+  const FixedImageValueType *           fixedImageValues = sampleArrays->GetImageValues();
+  const SizeValueType                   numberOfSamples  = sampleArrays->Size();
 
   /** Create variables to store intermediate results. */
   AccumulateType sff = NumericTraits< AccumulateType >::Zero;
@@ -221,55 +248,41 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   AccumulateType sf  = NumericTraits< AccumulateType >::Zero;
   AccumulateType sm  = NumericTraits< AccumulateType >::Zero;
 
-  /** Loop over the fixed image samples to calculate the mean squares. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
+  /** Buffers for one batch of samples. */
+  RealType      movingImageValues[ Superclass::SampleBatchSize ];
+  unsigned char sampleOk[ Superclass::SampleBatchSize ];
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
+  /** Loop over the fixed image samples in batches to calculate the NC. */
+  for( SizeValueType batch_begin = 0; batch_begin < numberOfSamples; batch_begin += Superclass::SampleBatchSize )
+  {
+    const SizeValueType batch_end = std::min(
+      batch_begin + static_cast< SizeValueType >( Superclass::SampleBatchSize ), numberOfSamples );
+    const SizeValueType batchSize = batch_end - batch_begin;
 
-    /** Compute the moving image value and check if the point is
-    * inside the moving image buffer. */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, 0 );
-    }
+    /** Compute the moving image values M(T(x)) of the batch. */
+    this->m_NumberOfPixelsCounted += this->EvaluateMovingImageValuesBatch(
+      batch_begin, batch_end, movingImageValues, sampleOk );
 
-    if( sampleOk )
+    /** Update some sums needed to calculate NC. Invalid samples have
+     * their fixed and moving value set to zero, so they do not contribute.
+     * This loop has no branches, so that the compiler can vectorise it.
+     */
+    const FixedImageValueType * fixedBatch = fixedImageValues + batch_begin;
+    for( SizeValueType i = 0; i < batchSize; ++i )
     {
-      this->m_NumberOfPixelsCounted++;
-
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast< double >( ( *fiter ).Value().m_ImageValue );
-
-      /** Update some sums needed to calculate NC. */
+      const RealType fixedImageValue  = sampleOk[ i ] ? static_cast< RealType >( fixedBatch[ i ] ) : 0.0;
+      const RealType movingImageValue = movingImageValues[ i ];
       sff += fixedImageValue  * fixedImageValue;
       smm += movingImageValue * movingImageValue;
       sfm += fixedImageValue  * movingImageValue;
-      if( this->m_SubtractMean )
-      {
-        sf += fixedImageValue;
-        sm += movingImageValue;
-      }
-
-    } // end if sampleOk
+      sf  += fixedImageValue;
+      sm  += movingImageValue;
+    }
 
-  } // end for loop over the image sample container
+  } // end for loop over the batches
 
   /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+  this->CheckNumberOfSamples( numberOfSamples, this->m_NumberOfPixelsCounted );
 
   /** If SubtractMean, then subtract things from sff, smm and sfm. */
   const RealType N = static_cast< RealType >( this->m_NumberOfPixelsCounted );
@@ -292,6 +305,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   {
     measure = NumericTraits< MeasureType >::Zero;
   }
+  this->SetCachedValue( parameters, measure );
 
   /** Return the NC measure value. */
   return measure;
@@ -491,11 +505,18 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   const TransformParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
+  /** Reuse the result of a previous evaluation at the same parameters. */
+  if( this->GetCachedValueAndDerivative( parameters, value, derivative ) )
+  {
+    return;
+  }
+
   /** Option for now to still use the single threaded code. */
   if( !this->m_UseMultiThread )
   {
-    return this->GetValueAndDerivativeSingleThreaded(
-      parameters, value, derivative );
+    this->GetValueAndDerivativeSingleThreaded( parameters, value, derivative );
+    this->SetCachedValueAndDerivative( parameters, value, derivative );
+    return;
   }
 
   /** Call non-thread-safe stuff, such as:
@@ -518,6 +539,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 
   /** Gather the metric values and derivatives from all threads. */
   this->AfterThreadedGetValueAndDerivative( value, derivative );
+  this->SetCachedValueAndDerivative( parameters, value, derivative );
 
 } // end GetValueAndDerivative()
 
@@ -545,27 +567,10 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   DerivativeType & derivativeM  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_DerivativeM;
   DerivativeType & differential = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Differential;
 
-  /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend   += (int)pos_end;
+  /** Get a handle to the samples in the structure-of-arrays layout. */
+  typedef typename ImageSampleArrayContainerType::ImageValueType FixedImageValueType;
+  const ImageSampleArrayContainerType * sampleArrays     = this->m_ImageSampleArrays.GetPointer();
+  const FixedImageValueType *           fixedImageValues = sampleArrays->GetImageValues();
 
   /** Create variables to store intermediate results. */
   AccumulateType sff                   = NumericTraits< AccumulateType >::Zero;
@@ -575,69 +580,58 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   AccumulateType sm                    = NumericTraits< AccumulateType >::Zero;
   unsigned long  numberOfPixelsCounted = 0;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-    MovingImageDerivativeType   movingImageDerivative;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
-
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative );
-    }
+  /** Buffers for one batch of samples. */
+  RealType                  movingImageValues[ Superclass::SampleBatchSize ];
+  MovingImageDerivativeType movingImageDerivatives[ Superclass::SampleBatchSize ];
+  unsigned char             sampleOk[ Superclass::SampleBatchSize ];
 
-    if( sampleOk )
+  /** Loop over the chunks of samples handed out by the scheduler. */
+  unsigned long pos_begin, pos_end;
+  while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
+  {
+    /** Loop over the chunk in batches to calculate the NC. */
+    for( unsigned long batch_begin = pos_begin; batch_begin < pos_end; batch_begin += Superclass::SampleBatchSize )
     {
-      numberOfPixelsCounted++;
+      const unsigned long batch_end = std::min( batch_begin + Superclass::SampleBatchSize, pos_end );
+      const unsigned long batchSize = batch_end - batch_begin;
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
+      /** Compute the moving image values M(T(x)) and derivatives dM/dx of the batch. */
+      numberOfPixelsCounted += this->EvaluateMovingImageValuesBatch(
+        batch_begin, batch_end, movingImageValues, sampleOk, movingImageDerivatives );
 
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji );
-#endif
-
-      /** Update some sums needed to calculate the value of NC. */
-      sff += fixedImageValue  * fixedImageValue;
-      smm += movingImageValue * movingImageValue;
-      sfm += fixedImageValue  * movingImageValue;
-      sf  += fixedImageValue;  // Only needed when m_SubtractMean == true
-      sm  += movingImageValue; // Only needed when m_SubtractMean == true
-
-      /** Compute this voxel's contribution to the derivative terms. */
-      this->UpdateDerivativeTerms(
-        fixedImageValue, movingImageValue, imageJacobian, nzji,
-        derivativeF, derivativeM, differential );
-
-    } // end if sampleOk
-
-  } // end for loop over the image sample container
+      /** The Jacobian products are computed per sample, in sample order. */
+      for( unsigned long i = 0; i < batchSize; ++i )
+      {
+        if( !sampleOk[ i ] )
+        {
+          continue;
+        }
+
+        FixedImagePointType fixedPoint;
+        sampleArrays->GetPoint( batch_begin + i, fixedPoint );
+        const RealType fixedImageValue  = static_cast< RealType >( fixedImageValues[ batch_begin + i ] );
+        const RealType movingImageValue = movingImageValues[ i ];
+
+        /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+        this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, movingImageDerivatives[ i ], imageJacobian, nzji );
+
+        /** Update some sums needed to calculate the value of NC. */
+        sff += fixedImageValue  * fixedImageValue;
+        smm += movingImageValue * movingImageValue;
+        sfm += fixedImageValue  * movingImageValue;
+        sf  += fixedImageValue;  // Only needed when m_SubtractMean == true
+        sm  += movingImageValue; // Only needed when m_SubtractMean == true
+
+        /** Compute this voxel's contribution to the derivative terms. */
+        this->UpdateDerivativeTerms(
+          fixedImageValue, movingImageValue, imageJacobian, nzji,
+          derivativeF, derivativeM, differential );
+
+      } // end for loop over the batch
+
+    } // end for loop over the batches
+  } // end while over the sample chunks
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -39,6 +39,12 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Metric: Select this metric as follows:\n
  *    <tt>(Metric "TransformBendingEnergyPenalty")</tt>
+ * \parameter UseAnalyticBendingEnergy: Whether to compute the bending energy of a
+ *    B-spline transform exactly over the fixed image domain, instead of estimating
+ *    it from samples. Masks are not taken into account in this case.
+ *    Can be given for each resolution.\n
+ *    example: <tt>(UseAnalyticBendingEnergy "true")</tt> \n
+ *    The default is "false".
  *
  * \ingroup Metrics
  *
@@ -144,6 +150,7 @@ public:
   /**
    * Do some things before each resolution:
    * \li Set options for SelfHessian
+   * \li Set the option to use the analytic bending energy
    */
   void BeforeEachResolution( void ) override;
 
@@ -62,6 +62,12 @@ TransformBendingEnergyPenalty< TElastix >
     "NumberOfSamplesForSelfHessian", this->GetComponentLabel(), level, 0 );
   this->SetNumberOfSamplesForSelfHessian( numberOfSamplesForSelfHessian );
 
+  /** Check if the bending energy should be computed analytically. */
+  bool useAnalyticBendingEnergy = false;
+  this->GetConfiguration()->ReadParameter( useAnalyticBendingEnergy,
+    "UseAnalyticBendingEnergy", this->GetComponentLabel(), level, 0 );
+  this->SetUseAnalyticBendingEnergy( useAnalyticBendingEnergy );
+
 } // end BeforeEachResolution()
 
 
@@ -20,6 +20,8 @@
 
 #include "itkTransformPenaltyTerm.h"
 #include "itkImageGridSampler.h"
+#include "itkAdvancedBSplineDeformableTransformBase.h"
+#include "itkKernelFunctionBase.h"
 
 namespace itk
 {
@@ -43,6 +45,17 @@ namespace itk
  *      "Itk::Transforms supporting spatial derivatives"",
  *      Insight Journal, http://hdl.handle.net/10380/3215.
  *
+ * For a B-spline transform the bending energy is a quadratic form in the
+ * B-spline coefficients. With UseAnalyticBendingEnergy the penalty is not
+ * estimated from samples, but integrated exactly over the fixed image
+ * domain. The operator of the quadratic form is a sum of Kronecker products
+ * of banded 1D Gram matrices of the B-spline kernel and its derivatives.
+ * These are computed once in Initialize(), after which the value and
+ * derivative only require a separable product of this operator with the
+ * coefficients. The analytic mode ignores the masks and the image sampler.
+ * GetSelfHessian() is not affected by it: it still samples the fixed image
+ * domain on a grid of NumberOfSamplesForSelfHessian points, using the masks.
+ *
  * \ingroup Metrics
  */
 
@@ -153,13 +166,30 @@ public:
   inline void AfterThreadedGetValueAndDerivative(
     MeasureType & value, DerivativeType & derivative ) const override;
 
-  /** Experimental feature: compute SelfHessian */
+  /** Experimental feature: compute SelfHessian.
+   * This is always estimated from samples on a regular grid, also when
+   * UseAnalyticBendingEnergy is on.
+   */
   void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const override;
 
   /** Default: 100000 */
   itkSetMacro( NumberOfSamplesForSelfHessian, unsigned int );
   itkGetConstMacro( NumberOfSamplesForSelfHessian, unsigned int );
 
+  /** Compute the bending energy analytically instead of from samples.
+   * Only supported for a B-spline transform, possibly combined with an
+   * initial transform by addition that has a zero spatial Hessian.
+   * Make sure to set it before calling Initialize; default: false.
+   */
+  itkSetMacro( UseAnalyticBendingEnergy, bool );
+  itkGetConstReferenceMacro( UseAnalyticBendingEnergy, bool );
+  itkBooleanMacro( UseAnalyticBendingEnergy );
+
+  /** Initialize the penalty term. In the analytic mode this builds
+   * the operator of the bending energy for the current B-spline grid.
+   */
+  void Initialize( void ) override;
+
 protected:
 
   /** Typedefs for indices and points. */
@@ -174,12 +204,22 @@ protected:
   /** Typedefs for SelfHessian */
   typedef ImageGridSampler< FixedImageType > SelfHessianSamplerType;
 
+  /** Typedefs for the analytic bending energy. */
+  typedef AdvancedBSplineDeformableTransformBase<
+    ScalarType, FixedImageDimension >                 BSplineTransformBaseType;
+  typedef KernelFunctionBase< double >                KernelFunctionType;
+  typedef vnl_matrix< double >                        GramMatrixType;
+  typedef FixedArray< unsigned int, FixedImageDimension > DerivativeOrdersType;
+
   /** The constructor. */
   TransformBendingEnergyPenaltyTerm();
 
   /** The destructor. */
   ~TransformBendingEnergyPenaltyTerm() override {}
 
+  /** Clone this metric, see AdvancedImageToImageMetric::Clone(). */
+  LightObject::Pointer InternalClone( void ) const override;
+
 private:
 
   /** The private constructor. */
@@ -187,8 +227,46 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );                    // purposely not implemented
 
+  /** Get the B-spline transform of which the bending energy can be
+   * computed analytically, or a null pointer if there is none.
+   */
+  const BSplineTransformBaseType * GetBSplineTransformForAnalyticBendingEnergy( void ) const;
+
+  /** Build the operator of the analytic bending energy. */
+  void InitializeAnalyticBendingEnergy( void );
+
+  /** Compute the Gram matrix of a derivative of the 1D B-spline kernel:
+   *   G_ij = \int_lower^upper k( u - c_i ) k( u - c_j ) du,
+   * with c_i = gridStart + i the grid positions.
+   */
+  static void ComputeGramMatrix(
+    const KernelFunctionType * kernel,
+    const unsigned int splineOrder,
+    const double gridStart,
+    const double lower,
+    const double upper,
+    GramMatrixType & gram );
+
+  /** Multiply the coefficients of one dimension by the bending energy operator. */
+  void ApplyAnalyticBendingEnergyOperator(
+    const double * coefficients, double * result ) const;
+
+  /** Compute the value and derivative analytically. */
+  void GetValueAndDerivativeAnalytic(
+    const ParametersType & parameters,
+    MeasureType & value,
+    DerivativeType & derivative ) const;
+
   unsigned int m_NumberOfSamplesForSelfHessian;
 
+  /** Variables for the analytic bending energy. */
+  bool                                m_UseAnalyticBendingEnergy;
+  unsigned int                        m_AnalyticSplineOrder;
+  FixedArray< SizeValueType, FixedImageDimension > m_AnalyticGridSize;
+  std::vector< GramMatrixType >       m_AnalyticGramMatrices;
+  std::vector< DerivativeOrdersType > m_AnalyticTermDerivativeOrders;
+  std::vector< double >               m_AnalyticTermWeights;
+
 };
 
 } // end namespace itk
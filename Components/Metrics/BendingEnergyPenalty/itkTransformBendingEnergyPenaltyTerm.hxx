@@ -19,6 +19,11 @@
 #define __itkTransformBendingEnergyPenaltyTerm_hxx
 
 #include "itkTransformBendingEnergyPenaltyTerm.h"
+#include "itkBSplineKernelFunction2.h"
+#include "itkBSplineDerivativeKernelFunction2.h"
+#include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+#include <algorithm>
+#include <cmath>
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -39,12 +44,65 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 
   /** Turn on the sampler functionality. */
   this->SetUseImageSampler( true );
+  this->SetSupportsSparseDerivativeAccumulation( true );
 
   this->m_NumberOfSamplesForSelfHessian = 100000;
 
+  this->m_UseAnalyticBendingEnergy = false;
+  this->m_AnalyticSplineOrder      = 0;
+  this->m_AnalyticGridSize.Fill( 0 );
+
 } // end Constructor
 
 
+/**
+ * ******************* InternalClone *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+LightObject::Pointer
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::InternalClone( void ) const
+{
+  Pointer clone = Self::New();
+  if( !this->CopySettingsToClone( clone ) )
+  {
+    return LightObject::Pointer();
+  }
+  clone->m_NumberOfSamplesForSelfHessian = this->m_NumberOfSamplesForSelfHessian;
+  clone->m_UseAnalyticBendingEnergy      = this->m_UseAnalyticBendingEnergy;
+
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
+/**
+ * ****************** Initialize *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::Initialize( void )
+{
+  /** Call the superclass' implementation. */
+  this->Superclass::Initialize();
+
+  /** Build the operator of the analytic bending energy. The B-spline grid
+   * may change every resolution, so this is redone every time.
+   */
+  this->m_AnalyticGramMatrices.clear();
+  this->m_AnalyticTermDerivativeOrders.clear();
+  this->m_AnalyticTermWeights.clear();
+  if( this->m_UseAnalyticBendingEnergy )
+  {
+    this->InitializeAnalyticBendingEnergy();
+  }
+
+} // end Initialize()
+
+
 /**
  * ****************** GetValue *******************************
  */
@@ -54,6 +112,17 @@ typename TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >::MeasureT
 TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 ::GetValue( const ParametersType & parameters ) const
 {
+  /** The analytic bending energy is computed together with its derivative,
+   * which only costs a few extra additions.
+   */
+  if( this->m_UseAnalyticBendingEnergy )
+  {
+    MeasureType    value = NumericTraits< MeasureType >::Zero;
+    DerivativeType dummyDerivative;
+    this->GetValueAndDerivativeAnalytic( parameters, value, dummyDerivative );
+    return value;
+  }
+
   /** Initialize some variables. */
   this->m_NumberOfPixelsCounted = 0;
   RealType           measure = NumericTraits< RealType >::Zero;
@@ -368,6 +437,13 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   const ParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
+  /** Compute the bending energy analytically if requested. */
+  if( this->m_UseAnalyticBendingEnergy )
+  {
+    return this->GetValueAndDerivativeAnalytic(
+      parameters, value, derivative );
+  }
+
   /** Option for now to still use the single threaded code. */
   if( !this->m_UseMultiThread )
   {
@@ -437,143 +513,140 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
 
   /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->Begin();
-  fbegin                                                 += (int)pos_begin;
-  fend                                                   += (int)pos_end;
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Create variables to store intermediate results. circumvent false sharing */
   unsigned long numberOfPixelsCounted = 0;
   MeasureType   measure               = NumericTraits< MeasureType >::Zero;
 
-  /** Loop over the fixed image to calculate the penalty term and its derivative. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  /** Loop over the chunks of samples handed out by the scheduler. */
+  unsigned long pos_begin, pos_end;
+  while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-    MovingImagePointType        mappedPoint;
-
-    /** Although the mapped point is not needed to compute the penalty term,
-     * we compute in order to check if it maps inside the support region of
-     * the B-spline and if it maps inside the moving image mask.
-     */
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside mask. */
-    if( sampleOk )
+    /** Create iterator over the sample container. */
+    typename ImageSampleContainerType::ConstIterator fiter;
+    typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+    typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->Begin();
+    fbegin += (int)pos_begin;
+    fend += (int)pos_end;
+
+    /** Loop over the fixed image to calculate the penalty term and its derivative. */
+    for( fiter = fbegin; fiter != fend; ++fiter )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
-
-    if( sampleOk )
-    {
-      numberOfPixelsCounted++;
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+      MovingImagePointType        mappedPoint;
 
-      /** Get the spatial Hessian of the transformation at the current point.
-       * This is needed to compute the bending energy.
+      /** Although the mapped point is not needed to compute the penalty term,
+       * we compute in order to check if it maps inside the support region of
+       * the B-spline and if it maps inside the moving image mask.
        */
-      this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
-        spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices );
 
-      /** Prepare some stuff for the computation of the metric (derivative). */
-      FixedArray< InternalMatrixType, FixedImageDimension > A;
-      for( unsigned int k = 0; k < FixedImageDimension; ++k )
-      {
-        A[ k ] = spatialHessian[ k ].GetVnlMatrix();
-      }
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
 
-      /** Compute the contribution to the metric value of this point. */
-      for( unsigned int k = 0; k < FixedImageDimension; ++k )
+      /** Check if point is inside mask. */
+      if( sampleOk )
       {
-        measure += vnl_math::sqr( A[ k ].frobenius_norm() );
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
       }
 
-      /** Make a distinction between a B-spline transform and other transforms. */
-      if( !transformIsBSpline )
+      if( sampleOk )
       {
-        /** Compute the contribution to the metric derivative of this point. */
-        for( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
-        {
-          for( unsigned int k = 0; k < FixedImageDimension; ++k )
-          {
-            /** This computes:
-             * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
-             */
-            const InternalMatrixType & B
-              = jacobianOfSpatialHessian[ mu ][ k ].GetVnlMatrix();
+        numberOfPixelsCounted++;
 
-            RealType matrixElementProduct = 0.0;
-            typename InternalMatrixType::const_iterator itA    = A[ k ].begin();
-            typename InternalMatrixType::const_iterator itB    = B.begin();
-            typename InternalMatrixType::const_iterator itAend = A[ k ].end();
-            while( itA != itAend )
-            {
-              matrixElementProduct += ( *itA ) * ( *itB );
-              ++itA;
-              ++itB;
-            }
+        /** Get the spatial Hessian of the transformation at the current point.
+         * This is needed to compute the bending energy.
+         */
+        this->m_AdvancedTransform->GetJacobianOfSpatialHessian( fixedPoint,
+          spatialHessian, jacobianOfSpatialHessian, nonZeroJacobianIndices );
 
-            derivative[ nonZeroJacobianIndices[ mu ] ]
-              += 2.0 * matrixElementProduct;
-          }
+        /** Prepare some stuff for the computation of the metric (derivative). */
+        FixedArray< InternalMatrixType, FixedImageDimension > A;
+        for( unsigned int k = 0; k < FixedImageDimension; ++k )
+        {
+          A[ k ] = spatialHessian[ k ].GetVnlMatrix();
         }
-      }
-      else
-      {
-        /** For the B-spline transform we know that only 1/FixedImageDimension
-         * part of the JacobianOfSpatialHessian is non-zero.
-         *
-         * In addition we know that jsh[ mu + numParPerDim * k ][ k ] is the same for all k.
-         */
 
-        /** Compute the contribution to the metric derivative of this point. */
-        const unsigned int numParPerDim
-          = nonZeroJacobianIndices.size() / FixedImageDimension;
-        for( unsigned int mu = 0; mu < numParPerDim; ++mu )
+        /** Compute the contribution to the metric value of this point. */
+        for( unsigned int k = 0; k < FixedImageDimension; ++k )
         {
-          const InternalMatrixType & B
-            = jacobianOfSpatialHessian[ mu + numParPerDim * 0 ][ 0 ].GetVnlMatrix();
+          measure += vnl_math::sqr( A[ k ].frobenius_norm() );
+        }
 
-          for( unsigned int k = 0; k < FixedImageDimension; ++k )
+        /** Make a distinction between a B-spline transform and other transforms. */
+        if( !transformIsBSpline )
+        {
+          /** Compute the contribution to the metric derivative of this point. */
+          for( unsigned int mu = 0; mu < nonZeroJacobianIndices.size(); ++mu )
           {
-            /** This computes:
-             * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
-             */
-            RealType matrixElementProduct = 0.0;
-            typename InternalMatrixType::const_iterator itA    = A[ k ].begin();
-            typename InternalMatrixType::const_iterator itB    = B.begin();
-            typename InternalMatrixType::const_iterator itAend = A[ k ].end();
-            while( itA != itAend )
+            for( unsigned int k = 0; k < FixedImageDimension; ++k )
             {
-              matrixElementProduct += ( *itA ) * ( *itB );
-              ++itA;
-              ++itB;
+              /** This computes:
+               * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
+               */
+              const InternalMatrixType & B
+                = jacobianOfSpatialHessian[ mu ][ k ].GetVnlMatrix();
+
+              RealType matrixElementProduct = 0.0;
+              typename InternalMatrixType::const_iterator itA    = A[ k ].begin();
+              typename InternalMatrixType::const_iterator itB    = B.begin();
+              typename InternalMatrixType::const_iterator itAend = A[ k ].end();
+              while( itA != itAend )
+              {
+                matrixElementProduct += ( *itA ) * ( *itB );
+                ++itA;
+                ++itB;
+              }
+
+              derivative[ nonZeroJacobianIndices[ mu ] ]
+                += 2.0 * matrixElementProduct;
             }
-
-            derivative[ nonZeroJacobianIndices[ mu + numParPerDim * k ] ]
-              += 2.0 * matrixElementProduct;
           }
         }
-      } // end if B-spline
-    } // end if sampleOk
-  }     // end for loop over the image sample container
+        else
+        {
+          /** For the B-spline transform we know that only 1/FixedImageDimension
+           * part of the JacobianOfSpatialHessian is non-zero.
+           *
+           * In addition we know that jsh[ mu + numParPerDim * k ][ k ] is the same for all k.
+           */
+
+          /** Compute the contribution to the metric derivative of this point. */
+          const unsigned int numParPerDim
+            = nonZeroJacobianIndices.size() / FixedImageDimension;
+          for( unsigned int mu = 0; mu < numParPerDim; ++mu )
+          {
+            const InternalMatrixType & B
+              = jacobianOfSpatialHessian[ mu + numParPerDim * 0 ][ 0 ].GetVnlMatrix();
+
+            for( unsigned int k = 0; k < FixedImageDimension; ++k )
+            {
+              /** This computes:
+               * \sum_i \sum_j A_ij B_ij = element_product(A,B).mean()*B.size()
+               */
+              RealType matrixElementProduct = 0.0;
+              typename InternalMatrixType::const_iterator itA    = A[ k ].begin();
+              typename InternalMatrixType::const_iterator itB    = B.begin();
+              typename InternalMatrixType::const_iterator itAend = A[ k ].end();
+              while( itA != itAend )
+              {
+                matrixElementProduct += ( *itA ) * ( *itB );
+                ++itA;
+                ++itB;
+              }
+
+              derivative[ nonZeroJacobianIndices[ mu + numParPerDim * k ] ]
+                += 2.0 * matrixElementProduct;
+            }
+          }
+        } // end if B-spline
+
+        /** Register the derivative entries updated by this sample. */
+        this->RegisterDerivativeIndices( threadId, nonZeroJacobianIndices );
+      } // end if sampleOk
+    } // end for loop over the image sample container
+  } // end while over the sample chunks
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -708,7 +781,9 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
     return;
   }
 
-  /** Set up grid sampler */
+  /** Set up grid sampler. The self Hessian is sampled in the analytic
+   * mode too, and respects the masks in both modes.
+   */
   typename SelfHessianSamplerType::Pointer sampler = SelfHessianSamplerType::New();
   sampler->SetInputImageRegion( this->GetImageSampler()->GetInputImageRegion() );
   sampler->SetMask( this->GetImageSampler()->GetMask() );
@@ -843,6 +918,382 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 } // end GetSelfHessian()
 
 
+/**
+ * ******************* GetBSplineTransformForAnalyticBendingEnergy *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+const typename TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >::BSplineTransformBaseType *
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::GetBSplineTransformForAnalyticBendingEnergy( void ) const
+{
+  const CombinationTransformType * combination
+    = dynamic_cast< const CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  if( combination == nullptr )
+  {
+    return dynamic_cast< const BSplineTransformBaseType * >( this->m_AdvancedTransform.GetPointer() );
+  }
+
+  /** An initial transform changes the bending energy if it is composed
+   * with the B-spline, or if it has a spatial Hessian itself.
+   */
+  const typename CombinationTransformType::InitialTransformType * initialTransform
+    = combination->GetInitialTransform();
+  if( initialTransform != nullptr
+    && ( !combination->GetUseAddition() || initialTransform->GetHasNonZeroSpatialHessian() ) )
+  {
+    return nullptr;
+  }
+
+  return dynamic_cast< const BSplineTransformBaseType * >( combination->GetCurrentTransform() );
+
+} // end GetBSplineTransformForAnalyticBendingEnergy()
+
+
+/**
+ * ******************* InitializeAnalyticBendingEnergy *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::InitializeAnalyticBendingEnergy( void )
+{
+  /** Check if the transform is supported. */
+  const BSplineTransformBaseType * bspline = this->GetBSplineTransformForAnalyticBendingEnergy();
+  if( bspline == nullptr )
+  {
+    itkExceptionMacro( << "The analytic bending energy is only supported for a B-spline "
+                       << "transform, optionally added to an initial transform with a zero spatial Hessian." );
+  }
+
+  /** The number of weights affecting a point is ( splineOrder + 1 )^dimension. */
+  const unsigned int splineOrder = static_cast< unsigned int >( std::floor( std::pow(
+    static_cast< double >( bspline->GetNumberOfAffectedWeights() ),
+    1.0 / static_cast< double >( FixedImageDimension ) ) + 0.5 ) ) - 1;
+
+  /** Create the B-spline kernel and its first and second order derivative.
+   * The second order derivative of a first order B-spline is zero.
+   */
+  std::vector< typename KernelFunctionType::Pointer > kernels( 3 );
+  if( splineOrder == 1 )
+  {
+    kernels[ 0 ] = BSplineKernelFunction2< 1 >::New().GetPointer();
+    kernels[ 1 ] = BSplineDerivativeKernelFunction2< 1 >::New().GetPointer();
+  }
+  else if( splineOrder == 2 )
+  {
+    kernels[ 0 ] = BSplineKernelFunction2< 2 >::New().GetPointer();
+    kernels[ 1 ] = BSplineDerivativeKernelFunction2< 2 >::New().GetPointer();
+    kernels[ 2 ] = BSplineSecondOrderDerivativeKernelFunction2< 2 >::New().GetPointer();
+  }
+  else if( splineOrder == 3 )
+  {
+    kernels[ 0 ] = BSplineKernelFunction2< 3 >::New().GetPointer();
+    kernels[ 1 ] = BSplineDerivativeKernelFunction2< 3 >::New().GetPointer();
+    kernels[ 2 ] = BSplineSecondOrderDerivativeKernelFunction2< 3 >::New().GetPointer();
+  }
+  else
+  {
+    itkExceptionMacro( << "The analytic bending energy is not implemented for spline order "
+                       << splineOrder << "." );
+  }
+
+  /** Compute the matrix that maps physical points to continuous grid indices. */
+  Matrix< double, FixedImageDimension, FixedImageDimension > indexToPoint;
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
+  {
+    for( unsigned int j = 0; j < FixedImageDimension; ++j )
+    {
+      indexToPoint[ i ][ j ] = bspline->GetGridDirection()[ i ][ j ] * bspline->GetGridSpacing()[ j ];
+    }
+  }
+  const Matrix< double, FixedImageDimension, FixedImageDimension > pointToIndex( indexToPoint.GetInverse() );
+
+  /** Map the corners of the fixed image region to the grid, and take the
+   * bounding box as the integration domain. This is exact when the grid
+   * has the same direction as the fixed image, which is the default.
+   */
+  const FixedImageRegionType & region = this->GetFixedImageRegion();
+  FixedArray< double, FixedImageDimension > lower;
+  FixedArray< double, FixedImageDimension > upper;
+  lower.Fill( NumericTraits< double >::max() );
+  upper.Fill( NumericTraits< double >::NonpositiveMin() );
+  for( unsigned int corner = 0; corner < ( 1u << FixedImageDimension ); ++corner )
+  {
+    ContinuousIndex< double, FixedImageDimension > cornerIndex;
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      cornerIndex[ d ] = static_cast< double >( region.GetIndex()[ d ] ) - 0.5;
+      if( ( corner >> d ) & 1 )
+      {
+        cornerIndex[ d ] += static_cast< double >( region.GetSize()[ d ] );
+      }
+    }
+    FixedImagePointType cornerPoint;
+    this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( cornerIndex, cornerPoint );
+
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      double gridIndex = 0.0;
+      for( unsigned int j = 0; j < FixedImageDimension; ++j )
+      {
+        gridIndex += pointToIndex[ i ][ j ] * ( cornerPoint[ j ] - bspline->GetGridOrigin()[ j ] );
+      }
+      lower[ i ] = std::min( lower[ i ], gridIndex );
+      upper[ i ] = std::max( upper[ i ], gridIndex );
+    }
+  }
+
+  /** Restrict the domain to the region where the B-spline is valid,
+   * and compute the Gram matrices of each dimension.
+   */
+  const typename BSplineTransformBaseType::RegionType gridRegion = bspline->GetGridRegion();
+  const double halfOrder = ( static_cast< double >( splineOrder ) - 1.0 ) / 2.0;
+  double       volume    = 1.0;
+  this->m_AnalyticGramMatrices.resize( 3 * FixedImageDimension );
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    const double gridStart = static_cast< double >( gridRegion.GetIndex()[ d ] );
+    const double gridEnd   = gridStart + static_cast< double >( gridRegion.GetSize()[ d ] ) - 1.0;
+    lower[ d ] = std::max( lower[ d ], gridStart + halfOrder );
+    upper[ d ] = std::min( upper[ d ], gridEnd - halfOrder );
+    if( upper[ d ] <= lower[ d ] )
+    {
+      itkExceptionMacro( << "The fixed image domain does not overlap with the valid region of the B-spline grid." );
+    }
+    volume *= upper[ d ] - lower[ d ];
+
+    this->m_AnalyticGridSize[ d ] = gridRegion.GetSize()[ d ];
+    for( unsigned int order = 0; order < 3; ++order )
+    {
+      GramMatrixType & gram = this->m_AnalyticGramMatrices[ 3 * d + order ];
+      gram.set_size( gridRegion.GetSize()[ d ], gridRegion.GetSize()[ d ] );
+      Self::ComputeGramMatrix( kernels[ order ].GetPointer(), splineOrder,
+        gridStart, lower[ d ], upper[ d ], gram );
+    }
+  }
+  this->m_AnalyticSplineOrder = splineOrder;
+
+  /** The bending energy is the sum over i and j of the squared derivatives
+   * d^2 T_k / dx_i dx_j. A derivative to x_i in grid coordinates is scaled
+   * by 1 / s_i, and the orthonormal grid direction does not change the sum
+   * of squares. The mixed derivatives occur twice. Dividing by the volume
+   * of the domain gives the mean over the domain, like the sampled version.
+   */
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
+  {
+    for( unsigned int j = i; j < FixedImageDimension; ++j )
+    {
+      if( i == j && kernels[ 2 ].IsNull() )
+      {
+        continue;
+      }
+
+      DerivativeOrdersType orders;
+      orders.Fill( 0 );
+      ++orders[ i ];
+      ++orders[ j ];
+      const double multiplicity = ( i == j ) ? 1.0 : 2.0;
+      const double scale        = bspline->GetGridSpacing()[ i ] * bspline->GetGridSpacing()[ j ];
+      this->m_AnalyticTermDerivativeOrders.push_back( orders );
+      this->m_AnalyticTermWeights.push_back( multiplicity / ( scale * scale * volume ) );
+    }
+  }
+
+} // end InitializeAnalyticBendingEnergy()
+
+
+/**
+ * ******************* ComputeGramMatrix *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ComputeGramMatrix(
+  const KernelFunctionType * kernel,
+  const unsigned int splineOrder,
+  const double gridStart,
+  const double lower,
+  const double upper,
+  GramMatrixType & gram )
+{
+  gram.fill( 0.0 );
+  if( kernel == nullptr )
+  {
+    return;
+  }
+
+  /** Between the knots the products of the kernels are polynomials of
+   * degree 2 * splineOrder <= 6, which 4-point Gauss-Legendre quadrature
+   * integrates exactly.
+   */
+  const double nodes[ 4 ]   = { -0.861136311594053, -0.339981043584856, 0.339981043584856, 0.861136311594053 };
+  const double weights[ 4 ] = { 0.347854845137454, 0.652145154862546, 0.652145154862546, 0.347854845137454 };
+
+  /** The kernel is supported on [ -halfSupport, halfSupport ]. The knots are
+   * at the integers for odd spline orders, and halfway for even ones.
+   */
+  const double halfSupport = ( static_cast< double >( splineOrder ) + 1.0 ) / 2.0;
+  const double knotOffset  = ( splineOrder % 2 == 0 ) ? 0.5 : 0.0;
+
+  const unsigned int size = gram.rows();
+  for( unsigned int i = 0; i < size; ++i )
+  {
+    const double ci = gridStart + static_cast< double >( i );
+    for( unsigned int j = i; j < std::min( size, i + splineOrder + 1 ); ++j )
+    {
+      /** Integrate over the overlap of both supports within the domain. */
+      const double cj    = gridStart + static_cast< double >( j );
+      const double begin = std::max( lower, cj - halfSupport );
+      const double end   = std::min( upper, ci + halfSupport );
+
+      double sum = 0.0;
+      for( double a = begin; a < end; )
+      {
+        const double b         = std::min( end, std::floor( a - knotOffset + 1.0 ) + knotOffset );
+        const double halfWidth = 0.5 * ( b - a );
+        const double center    = 0.5 * ( b + a );
+        for( unsigned int q = 0; q < 4; ++q )
+        {
+          const double u = center + halfWidth * nodes[ q ];
+          sum += halfWidth * weights[ q ] * kernel->Evaluate( u - ci ) * kernel->Evaluate( u - cj );
+        }
+        a = b;
+      }
+
+      gram( i, j ) = sum;
+      gram( j, i ) = sum;
+    }
+  }
+
+} // end ComputeGramMatrix()
+
+
+/**
+ * ******************* ApplyAnalyticBendingEnergyOperator *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ApplyAnalyticBendingEnergyOperator(
+  const double * coefficients, double * result ) const
+{
+  SizeValueType numberOfCoefficients = 1;
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    numberOfCoefficients *= this->m_AnalyticGridSize[ d ];
+  }
+  std::fill( result, result + numberOfCoefficients, 0.0 );
+
+  /** Each term is a Kronecker product of banded Gram matrices, which is
+   * applied by multiplying with the Gram matrix of each dimension in turn.
+   */
+  const SizeValueType   bandwidth = this->m_AnalyticSplineOrder;
+  std::vector< double > input( numberOfCoefficients );
+  std::vector< double > output( numberOfCoefficients );
+  for( std::size_t t = 0; t < this->m_AnalyticTermWeights.size(); ++t )
+  {
+    std::copy( coefficients, coefficients + numberOfCoefficients, input.begin() );
+
+    SizeValueType stride = 1;
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      const GramMatrixType & gram
+        = this->m_AnalyticGramMatrices[ 3 * d + this->m_AnalyticTermDerivativeOrders[ t ][ d ] ];
+      const SizeValueType size        = this->m_AnalyticGridSize[ d ];
+      const SizeValueType outerStride = stride * size;
+
+      for( SizeValueType outer = 0; outer < numberOfCoefficients; outer += outerStride )
+      {
+        for( SizeValueType inner = 0; inner < stride; ++inner )
+        {
+          const double * in  = &input[ outer + inner ];
+          double *       out = &output[ outer + inner ];
+          for( SizeValueType i = 0; i < size; ++i )
+          {
+            const SizeValueType jbegin = ( i > bandwidth ) ? i - bandwidth : 0;
+            const SizeValueType jend   = std::min( size, i + bandwidth + 1 );
+            double              sum    = 0.0;
+            for( SizeValueType j = jbegin; j < jend; ++j )
+            {
+              sum += gram( i, j ) * in[ j * stride ];
+            }
+            out[ i * stride ] = sum;
+          }
+        }
+      }
+
+      input.swap( output );
+      stride = outerStride;
+    }
+
+    const double weight = this->m_AnalyticTermWeights[ t ];
+    for( SizeValueType i = 0; i < numberOfCoefficients; ++i )
+    {
+      result[ i ] += weight * input[ i ];
+    }
+  }
+
+} // end ApplyAnalyticBendingEnergyOperator()
+
+
+/**
+ * ******************* GetValueAndDerivativeAnalytic *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::GetValueAndDerivativeAnalytic(
+  const ParametersType & parameters,
+  MeasureType & value,
+  DerivativeType & derivative ) const
+{
+  /** Check that the operator was built for the current B-spline grid. */
+  SizeValueType numberOfCoefficients = 1;
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    numberOfCoefficients *= this->m_AnalyticGridSize[ d ];
+  }
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+  if( this->m_AnalyticGramMatrices.empty()
+    || numberOfCoefficients * FixedImageDimension != numberOfParameters
+    || parameters.GetSize() != numberOfParameters )
+  {
+    itkExceptionMacro( << "The analytic bending energy does not match the B-spline grid. "
+                       << "Call Initialize() after changing the transform." );
+  }
+
+  /** Keep the transform up to date, as in the sampled version. */
+  if( this->m_UseMetricSingleThreaded )
+  {
+    this->SetTransformParameters( parameters );
+  }
+
+  /** The bending energy of each dimension is c^T Q c, with derivative 2 Q c. */
+  derivative = DerivativeType( numberOfParameters );
+  RealType measure = NumericTraits< RealType >::Zero;
+  for( unsigned int k = 0; k < FixedImageDimension; ++k )
+  {
+    const double * coefficients = parameters.data_block() + k * numberOfCoefficients;
+    double *       gradient     = derivative.data_block() + k * numberOfCoefficients;
+    this->ApplyAnalyticBendingEnergyOperator( coefficients, gradient );
+
+    for( SizeValueType i = 0; i < numberOfCoefficients; ++i )
+    {
+      measure     += coefficients[ i ] * gradient[ i ];
+      gradient[ i ] *= 2.0;
+    }
+  }
+
+  value = static_cast< MeasureType >( measure );
+
+} // end GetValueAndDerivativeAnalytic()
+
+
 } // end namespace itk
 
 #endif // #ifndef __itkTransformBendingEnergyPenaltyTerm_hxx
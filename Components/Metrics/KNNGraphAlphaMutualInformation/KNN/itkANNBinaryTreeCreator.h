@@ -23,6 +23,8 @@
 #include "itkObjectFactory.h"
 #include "ANN/ANN.h"
 
+#include <mutex>
+
 namespace itk
 {
 
@@ -84,7 +86,10 @@ public:
   /** Static function to delete an ANN BruteForceTree. */
   static void DeleteANNBruteForceTree( ANNBruteForceTreeType * & tree );
 
-  /** Static function to increase the reference count to ANN trees. */
+  /** Static function to increase the reference count to ANN trees.
+   * The reference count is guarded by a mutex, so that trees can be created
+   * and deleted by several threads simultaneously.
+   */
   static void IncreaseReferenceCount( void );
 
   /** Static function to decrease the reference count to ANN trees. */
@@ -102,6 +107,7 @@ private:
 
   /** Member variables. */
   static unsigned int m_NumberOfANNBinaryTrees;
+  static std::mutex   m_NumberOfANNBinaryTreesMutex;
 
 };
 
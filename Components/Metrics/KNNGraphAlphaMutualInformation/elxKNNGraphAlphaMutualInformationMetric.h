@@ -70,6 +70,14 @@ namespace elastix
  * \parameter AvoidDivisionBy: a small number to avoid division by zero in the implentation. \n
  *    <tt>(AvoidDivisionBy 0.000000001)</tt> \n
  *    The default is 1e-5.
+ * \parameter ReuseFixedFeatureTree: whether to keep the tree of the fixed features when the
+ *    fixed samples are the same as in the previous iteration, e.g. with the "Full" or "Grid"
+ *    ImageSampler. Only the moving and joint trees are then regenerated. \n
+ *    <tt>(ReuseFixedFeatureTree "true")</tt> \n
+ *    The default is "false" for all resolutions.
+ *
+ * The kNN trees are generated simultaneously, and the neighbour searches are
+ * distributed over the threads, if UseMultiThreadingForMetrics is true.
  *
  * \warning Note that we assume the FixedFeatureImageType to have the same
  * pixeltype as the FixedImageType
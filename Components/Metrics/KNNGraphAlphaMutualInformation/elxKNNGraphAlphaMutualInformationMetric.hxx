@@ -237,6 +237,12 @@ KNNGraphAlphaMutualInformationMetric< TElastix >
                        << treeSearchType << "\" implemented." );
   }
 
+  /** Should the fixed tree be kept when the fixed samples do not change? */
+  bool reuseFixedFeatureTree = false;
+  this->m_Configuration->ReadParameter( reuseFixedFeatureTree,
+    "ReuseFixedFeatureTree", this->GetComponentLabel(), level, 0 );
+  this->SetReuseFixedFeatureTree( reuseFixedFeatureTree );
+
 } // end BeforeEachResolution()
 
 
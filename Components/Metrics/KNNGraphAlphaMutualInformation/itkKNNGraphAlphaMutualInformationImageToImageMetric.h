@@ -134,6 +134,8 @@ public:
   typedef typename
     Superclass::MovingImageLimiterOutputType MovingImageLimiterOutputType;
   typedef typename Superclass::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+  typedef typename Superclass::ThreaderType               ThreaderType;
+  typedef typename Superclass::ThreadInfoType             ThreadInfoType;
 
   /** Typedef's for storing multiple inputs. */
   typedef typename Superclass::FixedImageVectorType             FixedImageVectorType;
@@ -247,13 +249,23 @@ public:
   /** Avoid division by a small number. */
   itkGetConstReferenceMacro( AvoidDivisionBy, double );
 
+  /** Keep the kNN tree of the fixed features when the fixed feature samples
+   * are exactly the same as in the previous evaluation, which is the case when
+   * the sampler does not select new samples and the set of valid samples does
+   * not change. Only the moving and joint trees are then regenerated.
+   * Default: false.
+   */
+  itkSetMacro( ReuseFixedFeatureTree, bool );
+  itkGetConstReferenceMacro( ReuseFixedFeatureTree, bool );
+  itkBooleanMacro( ReuseFixedFeatureTree );
+
 protected:
 
   /** Constructor. */
   KNNGraphAlphaMutualInformationImageToImageMetric();
 
   /** Destructor. */
-  ~KNNGraphAlphaMutualInformationImageToImageMetric() override {}
+  ~KNNGraphAlphaMutualInformationImageToImageMetric() override;
 
   /** PrintSelf. */
   void PrintSelf( std::ostream & os, Indent indent ) const override;
@@ -269,6 +281,21 @@ protected:
 
   double m_Alpha;
   double m_AvoidDivisionBy;
+  bool   m_ReuseFixedFeatureTree;
+
+  /** Initialize some multi-threading related parameters, such as the
+   * tree searchers and the derivative buffers of each thread.
+   */
+  void InitializeThreadingParameters( void ) const override;
+
+  /** Multi-threaded versions of the kNN searches of GetValue() and
+   * GetValueAndDerivative(). Each thread handles a contiguous range of the
+   * query points with its own tree searchers, and stores its part of the sum
+   * over the query points in the per-thread variables of the superclass.
+   */
+  void ThreadedGetValue( ThreadIdType threadId ) override;
+
+  void ThreadedGetValueAndDerivative( ThreadIdType threadId ) override;
 
 private:
 
@@ -285,6 +312,101 @@ private:
   typedef std::vector< NonZeroJacobianIndicesType > TransformJacobianIndicesContainerType;
   typedef Array2D< double >                         SpatialDerivativeType;
   typedef std::vector< SpatialDerivativeType >      SpatialDerivativeContainerType;
+  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
+
+  /** The list samples and derivative information of the current evaluation,
+   * which the threads search through. */
+  mutable ListSamplePointer                     m_ListSampleFixed;
+  mutable ListSamplePointer                     m_ListSampleMoving;
+  mutable ListSamplePointer                     m_ListSampleJoint;
+  mutable TransformJacobianContainerType        m_JacobianContainer;
+  mutable TransformJacobianIndicesContainerType m_JacobianIndicesContainer;
+  mutable SpatialDerivativeContainerType        m_SpatialDerivativesContainer;
+
+  /** Helper struct that multi-threads the generation of the trees. */
+  struct KNNGraphAlphaMutualInformationMultiThreaderParameterType
+  {
+    Self * m_Metric;
+  };
+  KNNGraphAlphaMutualInformationMultiThreaderParameterType m_KNNGraphAlphaMutualInformationThreaderParameters;
+
+  /** The type and settings of the tree searchers, as set by one of the
+   * SetANN*TreeSearch() functions. They are used to create the searchers
+   * of each thread.
+   */
+  enum TreeSearchType { StandardTreeSearch, FixedRadiusTreeSearch, PriorityTreeSearch };
+  TreeSearchType m_TreeSearchType;
+  unsigned int   m_KNearestNeighbors;
+  double         m_ErrorBound;
+  double         m_SquaredRadius;
+
+  /** Create a new tree searcher with the current type and settings. */
+  BinaryKNNTreeSearchPointer CreateTreeSearcher( void ) const;
+
+  /** The tree searchers are not shared between threads, since they store
+   * the tree they search through. The dGamma vectors are needed for every
+   * query point, so they are allocated once per thread.
+   */
+  struct KNNGraphAlphaMutualInformationPerThreadStruct
+  {
+    BinaryKNNTreeSearchPointer st_BinaryKNNTreeSearcherFixed;
+    BinaryKNNTreeSearchPointer st_BinaryKNNTreeSearcherMoving;
+    BinaryKNNTreeSearchPointer st_BinaryKNNTreeSearcherJoint;
+    DerivativeType             st_DGammaM;
+    DerivativeType             st_DGammaJ;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, KNNGraphAlphaMutualInformationPerThreadStruct,
+    PaddedKNNGraphAlphaMutualInformationPerThreadStruct );
+  itkAlignedTypedef( ITK_CACHE_LINE_ALIGNMENT, PaddedKNNGraphAlphaMutualInformationPerThreadStruct,
+    AlignedKNNGraphAlphaMutualInformationPerThreadStruct );
+  mutable AlignedKNNGraphAlphaMutualInformationPerThreadStruct * m_KNNGraphAlphaMutualInformationPerThreadVariables;
+  mutable ThreadIdType                                           m_KNNGraphAlphaMutualInformationPerThreadVariablesSize;
+
+  /** The trees that GenerateTrees() (re)generates. */
+  mutable std::vector< BinaryKNNTreeType * > m_TreesToGenerate;
+
+  /** Store the list samples, generate the fixed, moving and joint trees and
+   * connect them to the searchers, including those of the threads. The trees
+   * are generated simultaneously if multi-threading is used. The fixed tree
+   * is kept if ReuseFixedFeatureTree is true and the fixed samples did not
+   * change.
+   */
+  void GenerateTrees(
+    const ListSamplePointer & listSampleFixed,
+    const ListSamplePointer & listSampleMoving,
+    const ListSamplePointer & listSampleJoint ) const;
+
+  /** Generate the trees in m_TreesToGenerate assigned to this thread. */
+  void ThreadedGenerateTrees( ThreadIdType threadId, ThreadIdType numberOfThreads );
+
+  /** GenerateTrees threader callback function. */
+  static ITK_THREAD_RETURN_TYPE GenerateTreesThreaderCallback( void * arg );
+
+  /** Check if two list samples contain exactly the same points. */
+  bool ListSamplesAreEqual(
+    const ListSamplePointer & listSample1,
+    const ListSamplePointer & listSample2 ) const;
+
+  /** Add the contributions of the query points [ begin, end [ to the sum of
+   * the graph length ratios sumG, and, for the derivative version, to the
+   * unnormalized derivative contribution. The neighbours are searched with
+   * the given searchers, and dGamma_M and dGamma_J are used as work space.
+   * Thread-safe, as long as each thread passes its own searchers and buffers.
+   */
+  void ComputeValueContributions(
+    const SizeValueType begin, const SizeValueType end,
+    BinaryKNNTreeSearchType * searcherFixed,
+    BinaryKNNTreeSearchType * searcherMoving,
+    BinaryKNNTreeSearchType * searcherJoint,
+    AccumulateType & sumG ) const;
+
+  void ComputeValueAndDerivativeContributions(
+    const SizeValueType begin, const SizeValueType end,
+    BinaryKNNTreeSearchType * searcherFixed,
+    BinaryKNNTreeSearchType * searcherMoving,
+    BinaryKNNTreeSearchType * searcherJoint,
+    DerivativeType & dGamma_M, DerivativeType & dGamma_J,
+    AccumulateType & sumG, DerivativeType & contribution ) const;
 
   /** This function takes the fixed image samples from the ImageSampler
    * and puts them in the listSampleFixed, together with the fixed feature
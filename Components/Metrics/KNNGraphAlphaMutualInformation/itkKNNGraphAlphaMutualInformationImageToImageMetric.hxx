@@ -20,6 +20,8 @@
 
 #include "itkKNNGraphAlphaMutualInformationImageToImageMetric.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -44,9 +46,37 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_BinaryKNNTreeSearcherMoving = 0;
   this->m_BinaryKNNTreeSearcherJoint  = 0;
 
+  this->m_ReuseFixedFeatureTree = false;
+  this->m_ListSampleFixed       = 0;
+  this->m_ListSampleMoving      = 0;
+  this->m_ListSampleJoint       = 0;
+
+  this->m_TreeSearchType    = StandardTreeSearch;
+  this->m_KNearestNeighbors = 0;
+  this->m_ErrorBound        = 0.0;
+  this->m_SquaredRadius     = 0.0;
+
+  this->m_KNNGraphAlphaMutualInformationThreaderParameters.m_Metric = this;
+
+  // Multi-threading structs
+  this->m_KNNGraphAlphaMutualInformationPerThreadVariables     = nullptr;
+  this->m_KNNGraphAlphaMutualInformationPerThreadVariablesSize = 0;
+
 } // end Constructor()
 
 
+/**
+ * ************************ Destructor *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::~KNNGraphAlphaMutualInformationImageToImageMetric()
+{
+  delete[] this->m_KNNGraphAlphaMutualInformationPerThreadVariables;
+} // end Destructor
+
+
 /**
  * ************************ SetANNkDTree *************************
  */
@@ -172,24 +202,13 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   unsigned int kNearestNeighbors,
   double errorBound )
 {
-  typename ANNStandardTreeSearchType::Pointer tmpPtrF
-    = ANNStandardTreeSearchType::New();
-  typename ANNStandardTreeSearchType::Pointer tmpPtrM
-    = ANNStandardTreeSearchType::New();
-  typename ANNStandardTreeSearchType::Pointer tmpPtrJ
-    = ANNStandardTreeSearchType::New();
-
-  tmpPtrF->SetKNearestNeighbors( kNearestNeighbors );
-  tmpPtrM->SetKNearestNeighbors( kNearestNeighbors );
-  tmpPtrJ->SetKNearestNeighbors( kNearestNeighbors );
-
-  tmpPtrF->SetErrorBound( errorBound );
-  tmpPtrM->SetErrorBound( errorBound );
-  tmpPtrJ->SetErrorBound( errorBound );
+  this->m_TreeSearchType    = StandardTreeSearch;
+  this->m_KNearestNeighbors = kNearestNeighbors;
+  this->m_ErrorBound        = errorBound;
 
-  this->m_BinaryKNNTreeSearcherFixed  = tmpPtrF;
-  this->m_BinaryKNNTreeSearcherMoving = tmpPtrM;
-  this->m_BinaryKNNTreeSearcherJoint  = tmpPtrJ;
+  this->m_BinaryKNNTreeSearcherFixed  = this->CreateTreeSearcher();
+  this->m_BinaryKNNTreeSearcherMoving = this->CreateTreeSearcher();
+  this->m_BinaryKNNTreeSearcherJoint  = this->CreateTreeSearcher();
 
 } // end SetANNStandardTreeSearch()
 
@@ -206,28 +225,14 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   double errorBound,
   double squaredRadius )
 {
-  typename ANNFixedRadiusTreeSearchType::Pointer tmpPtrF
-    = ANNFixedRadiusTreeSearchType::New();
-  typename ANNFixedRadiusTreeSearchType::Pointer tmpPtrM
-    = ANNFixedRadiusTreeSearchType::New();
-  typename ANNFixedRadiusTreeSearchType::Pointer tmpPtrJ
-    = ANNFixedRadiusTreeSearchType::New();
+  this->m_TreeSearchType    = FixedRadiusTreeSearch;
+  this->m_KNearestNeighbors = kNearestNeighbors;
+  this->m_ErrorBound        = errorBound;
+  this->m_SquaredRadius     = squaredRadius;
 
-  tmpPtrF->SetKNearestNeighbors( kNearestNeighbors );
-  tmpPtrM->SetKNearestNeighbors( kNearestNeighbors );
-  tmpPtrJ->SetKNearestNeighbors( kNearestNeighbors );
-
-  tmpPtrF->SetErrorBound( errorBound );
-  tmpPtrM->SetErrorBound( errorBound );
-  tmpPtrJ->SetErrorBound( errorBound );
-
-  tmpPtrF->SetSquaredRadius( squaredRadius );
-  tmpPtrM->SetSquaredRadius( squaredRadius );
-  tmpPtrJ->SetSquaredRadius( squaredRadius );
-
-  this->m_BinaryKNNTreeSearcherFixed  = tmpPtrF;
-  this->m_BinaryKNNTreeSearcherMoving = tmpPtrM;
-  this->m_BinaryKNNTreeSearcherJoint  = tmpPtrJ;
+  this->m_BinaryKNNTreeSearcherFixed  = this->CreateTreeSearcher();
+  this->m_BinaryKNNTreeSearcherMoving = this->CreateTreeSearcher();
+  this->m_BinaryKNNTreeSearcherJoint  = this->CreateTreeSearcher();
 
 } // end SetANNFixedRadiusTreeSearch()
 
@@ -243,26 +248,51 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   unsigned int kNearestNeighbors,
   double errorBound )
 {
-  typename ANNPriorityTreeSearchType::Pointer tmpPtrF
-    = ANNPriorityTreeSearchType::New();
-  typename ANNPriorityTreeSearchType::Pointer tmpPtrM
-    = ANNPriorityTreeSearchType::New();
-  typename ANNPriorityTreeSearchType::Pointer tmpPtrJ
-    = ANNPriorityTreeSearchType::New();
+  this->m_TreeSearchType    = PriorityTreeSearch;
+  this->m_KNearestNeighbors = kNearestNeighbors;
+  this->m_ErrorBound        = errorBound;
 
-  tmpPtrF->SetKNearestNeighbors( kNearestNeighbors );
-  tmpPtrM->SetKNearestNeighbors( kNearestNeighbors );
-  tmpPtrJ->SetKNearestNeighbors( kNearestNeighbors );
+  this->m_BinaryKNNTreeSearcherFixed  = this->CreateTreeSearcher();
+  this->m_BinaryKNNTreeSearcherMoving = this->CreateTreeSearcher();
+  this->m_BinaryKNNTreeSearcherJoint  = this->CreateTreeSearcher();
 
-  tmpPtrF->SetErrorBound( errorBound );
-  tmpPtrM->SetErrorBound( errorBound );
-  tmpPtrJ->SetErrorBound( errorBound );
+} // end SetANNPriorityTreeSearch()
 
-  this->m_BinaryKNNTreeSearcherFixed  = tmpPtrF;
-  this->m_BinaryKNNTreeSearcherMoving = tmpPtrM;
-  this->m_BinaryKNNTreeSearcherJoint  = tmpPtrJ;
 
-} // end SetANNPriorityTreeSearch()
+/**
+ * ************************ CreateTreeSearcher *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >::BinaryKNNTreeSearchPointer
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::CreateTreeSearcher( void ) const
+{
+  if( this->m_TreeSearchType == FixedRadiusTreeSearch )
+  {
+    typename ANNFixedRadiusTreeSearchType::Pointer tmpPtr
+      = ANNFixedRadiusTreeSearchType::New();
+    tmpPtr->SetKNearestNeighbors( this->m_KNearestNeighbors );
+    tmpPtr->SetErrorBound( this->m_ErrorBound );
+    tmpPtr->SetSquaredRadius( this->m_SquaredRadius );
+    return tmpPtr.GetPointer();
+  }
+  else if( this->m_TreeSearchType == PriorityTreeSearch )
+  {
+    typename ANNPriorityTreeSearchType::Pointer tmpPtr
+      = ANNPriorityTreeSearchType::New();
+    tmpPtr->SetKNearestNeighbors( this->m_KNearestNeighbors );
+    tmpPtr->SetErrorBound( this->m_ErrorBound );
+    return tmpPtr.GetPointer();
+  }
+
+  typename ANNStandardTreeSearchType::Pointer tmpPtr
+    = ANNStandardTreeSearchType::New();
+  tmpPtr->SetKNearestNeighbors( this->m_KNearestNeighbors );
+  tmpPtr->SetErrorBound( this->m_ErrorBound );
+  return tmpPtr.GetPointer();
+
+} // end CreateTreeSearcher()
 
 
 /**
@@ -292,6 +322,46 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 } // end Initialize()
 
 
+/**
+ * ******************* InitializeThreadingParameters *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeThreadingParameters( void ) const
+{
+  /** Call the superclass. */
+  this->Superclass::InitializeThreadingParameters();
+
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+
+  /** Only resize the array of structs when needed. */
+  if( this->m_KNNGraphAlphaMutualInformationPerThreadVariablesSize != numberOfThreads )
+  {
+    delete[] this->m_KNNGraphAlphaMutualInformationPerThreadVariables;
+    this->m_KNNGraphAlphaMutualInformationPerThreadVariables
+      = new AlignedKNNGraphAlphaMutualInformationPerThreadStruct[ numberOfThreads ];
+    this->m_KNNGraphAlphaMutualInformationPerThreadVariablesSize = numberOfThreads;
+  }
+
+  /** Create the tree searchers of each thread, since the searcher settings
+   * may have changed since the previous resolution. The trees are connected
+   * to them in GenerateTrees(). The SetSize() functions do not resize the
+   * dGamma vectors when this is not needed.
+   */
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    this->m_KNNGraphAlphaMutualInformationPerThreadVariables[ i ].st_BinaryKNNTreeSearcherFixed  = this->CreateTreeSearcher();
+    this->m_KNNGraphAlphaMutualInformationPerThreadVariables[ i ].st_BinaryKNNTreeSearcherMoving = this->CreateTreeSearcher();
+    this->m_KNNGraphAlphaMutualInformationPerThreadVariables[ i ].st_BinaryKNNTreeSearcherJoint  = this->CreateTreeSearcher();
+    this->m_KNNGraphAlphaMutualInformationPerThreadVariables[ i ].st_DGammaM.SetSize( this->GetNumberOfParameters() );
+    this->m_KNNGraphAlphaMutualInformationPerThreadVariables[ i ].st_DGammaJ.SetSize( this->GetNumberOfParameters() );
+  }
+
+} // end InitializeThreadingParameters()
+
+
 /**
  * ************************ GetValue *************************
  */
@@ -336,25 +406,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
-  this->m_BinaryKNNTreeFixed->GenerateTree();
-
-  /** Generate the tree for the moving image samples. */
-  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
-  this->m_BinaryKNNTreeMoving->GenerateTree();
-
-  /** Generate the tree for the joint image samples. */
-  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
-  this->m_BinaryKNNTreeJoint->GenerateTree();
-
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed
-  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
-  this->m_BinaryKNNTreeSearcherMoving
-  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
-  this->m_BinaryKNNTreeSearcherJoint
-  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+  this->GenerateTrees( listSampleFixed, listSampleMoving, listSampleJoint );
 
   /**
    * *************** Estimate the \alpha MI ******************
@@ -389,77 +441,29 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
-  /** Temporary variables. */
-  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
-  MeasurementVectorType z_F, z_M, z_J;
-  IndexArrayType        indices_F, indices_M, indices_J;
-  DistanceArrayType     distances_F, distances_M, distances_J;
-
-  MeasureType    H, G;
+  /** Search the neighbours of all query points, i.e. all samples. */
   AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
-
-  /** Get the size of the feature vectors. */
-  unsigned int fixedSize  = this->GetNumberOfFixedImages();
-  unsigned int movingSize = this->GetNumberOfMovingImages();
-  unsigned int jointSize  = fixedSize + movingSize;
-
-  /** Get the number of neighbours and \gamma. */
-  unsigned int k        = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
-  double       twoGamma = jointSize * ( 1.0 - this->m_Alpha );
-
-  /** Loop over all query points, i.e. all samples. */
-  for( unsigned long i = 0; i < this->m_NumberOfPixelsCounted; i++ )
+  if( !this->m_UseMultiThread )
   {
-    /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(  i, z_F );
-    listSampleMoving->GetMeasurementVector( i, z_M );
-    listSampleJoint->GetMeasurementVector(  i, z_J );
-
-    /** Search for the K nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
-    this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
-    this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
-
-    /** Add the distances between the points to get the total graph length.
-     * The outcommented implementation calculates: sum J/sqrt(F*M)
-     *
-    for ( unsigned int j = 0; j < K; j++ )
-    {
-    enumerator = std::sqrt( distsJ[ j ] );
-    denominator = std::sqrt( std::sqrt( distsF[ j ] ) * std::sqrt( distsM[ j ] ) );
-    if ( denominator > 1e-14 )
-    {
-    contribution += std::pow( enumerator / denominator, twoGamma );
-    }
-    }*/
-
-    /** Add the distances of all neighbours of the query point,
-    * for the three graphs:
-    * sum M / sqrt( sum F * sum M)
-    */
-
-    /** Variables to compute the measure. */
-    AccumulateType Gamma_F = NumericTraits< AccumulateType >::Zero;
-    AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
-    AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
+    this->ComputeValueContributions( 0, this->m_NumberOfPixelsCounted,
+      this->m_BinaryKNNTreeSearcherFixed, this->m_BinaryKNNTreeSearcherMoving,
+      this->m_BinaryKNNTreeSearcherJoint, sumG );
+  }
+  else
+  {
+    this->LaunchGetValueThreaderCallback();
 
-    /** Loop over the neighbours. */
-    for( unsigned int p = 0; p < k; p++ )
+    /** Gather the contributions of the threads. */
+    const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
     {
-      Gamma_F += std::sqrt( distances_F[ p ] );
-      Gamma_M += std::sqrt( distances_M[ p ] );
-      Gamma_J += std::sqrt( distances_J[ p ] );
-    } // end loop over the k neighbours
+      sumG += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
 
-    /** Calculate the contribution of this query point. */
-    H = std::sqrt( Gamma_F * Gamma_M );
-    if( H > this->m_AvoidDivisionBy )
-    {
-      /** Compute some sums. */
-      G     = Gamma_J / H;
-      sumG += std::pow( G, twoGamma );
+      /** Reset this variable for the next iteration. */
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value = NumericTraits< MeasureType >::Zero;
     }
-  } // end looping over all query points
+  }
+
 
   /**
    * *************** Finally, calculate the metric value \alpha MI ******************
@@ -544,12 +548,10 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   ListSamplePointer listSampleJoint  = ListSampleType::New();
 
   /** Compute the three list samples and the derivatives. */
-  TransformJacobianContainerType        jacobianContainer;
-  TransformJacobianIndicesContainerType jacobianIndicesContainer;
-  SpatialDerivativeContainerType        spatialDerivativesContainer;
   this->ComputeListSampleValuesAndDerivativePlusJacobian(
     listSampleFixed, listSampleMoving, listSampleJoint,
-    true, jacobianContainer, jacobianIndicesContainer, spatialDerivativesContainer );
+    true, this->m_JacobianContainer, this->m_JacobianIndicesContainer,
+    this->m_SpatialDerivativesContainer );
 
   /** Check if enough samples were valid. */
   unsigned long size = this->GetImageSampler()->GetOutput()->Size();
@@ -561,25 +563,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
-  this->m_BinaryKNNTreeFixed->GenerateTree();
-
-  /** Generate the tree for the moving image samples. */
-  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
-  this->m_BinaryKNNTreeMoving->GenerateTree();
-
-  /** Generate the tree for the joint image samples. */
-  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
-  this->m_BinaryKNNTreeJoint->GenerateTree();
-
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed
-  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
-  this->m_BinaryKNNTreeSearcherMoving
-  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
-  this->m_BinaryKNNTreeSearcherJoint
-  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+  this->GenerateTrees( listSampleFixed, listSampleMoving, listSampleJoint );
 
   /**
    * *************** Estimate the \alpha MI and its derivatives ******************
@@ -614,20 +598,392 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
+  /** Search the neighbours of all query points, i.e. all samples. */
+  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
+  DerivativeType contribution( this->GetNumberOfParameters() );
+  contribution.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  if( !this->m_UseMultiThread )
+  {
+    DerivativeType dGamma_M( this->GetNumberOfParameters() );
+    DerivativeType dGamma_J( this->GetNumberOfParameters() );
+    this->ComputeValueAndDerivativeContributions(
+      0, this->m_NumberOfPixelsCounted,
+      this->m_BinaryKNNTreeSearcherFixed, this->m_BinaryKNNTreeSearcherMoving,
+      this->m_BinaryKNNTreeSearcherJoint, dGamma_M, dGamma_J, sumG, contribution );
+  }
+  else
+  {
+    this->LaunchGetValueAndDerivativeThreaderCallback();
+
+    /** Gather the contributions of the threads. */
+    const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+    {
+      sumG += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
+
+      /** Reset this variable for the next iteration. */
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value = NumericTraits< MeasureType >::Zero;
+    }
+
+    /** Sum the derivative contributions of the threads, which also resets them. */
+    this->m_ThreaderMetricParameters.st_DerivativePointer   = contribution.begin();
+    this->m_ThreaderMetricParameters.st_NormalizationFactor = 1.0;
+    this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+
+
+  /**
+   * *************** Finally, calculate the metric value and derivative ******************
+   */
+
+  /** Compute the value. */
+  const unsigned int jointSize = this->GetNumberOfFixedImages() + this->GetNumberOfMovingImages();
+  double             n, number;
+  if( sumG > this->m_AvoidDivisionBy )
+  {
+    /** Compute the measure. */
+    n       = static_cast< double >( this->m_NumberOfPixelsCounted );
+    number  = std::pow( n, this->m_Alpha );
+    measure = std::log( sumG / number ) / ( this->m_Alpha - 1.0 );
+
+    /** Compute the derivative (-2.0 * d = -jointSize). */
+    derivative = ( static_cast< AccumulateType >( jointSize ) / sumG ) * contribution;
+  }
+  value = -measure;
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ************************ GenerateTrees *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GenerateTrees(
+  const ListSamplePointer & listSampleFixed,
+  const ListSamplePointer & listSampleMoving,
+  const ListSamplePointer & listSampleJoint ) const
+{
+  this->m_TreesToGenerate.clear();
+
+  /** The fixed tree only needs to be regenerated when the fixed samples changed.
+   * Check that the fixed tree was generated from the previous fixed samples:
+   * this is not the case when a new tree was set in the meantime.
+   */
+  const bool reuseFixedTree = this->m_ReuseFixedFeatureTree
+    && this->m_ListSampleFixed.IsNotNull()
+    && this->m_BinaryKNNTreeFixed->GetSample() == this->m_ListSampleFixed.GetPointer()
+    && this->ListSamplesAreEqual( listSampleFixed, this->m_ListSampleFixed );
+  if( !reuseFixedTree )
+  {
+    this->m_ListSampleFixed = listSampleFixed;
+    this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
+    this->m_TreesToGenerate.push_back( this->m_BinaryKNNTreeFixed.GetPointer() );
+  }
+
+  /** The moving and joint trees always need to be regenerated. */
+  this->m_ListSampleMoving = listSampleMoving;
+  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
+  this->m_TreesToGenerate.push_back( this->m_BinaryKNNTreeMoving.GetPointer() );
+
+  this->m_ListSampleJoint = listSampleJoint;
+  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
+  this->m_TreesToGenerate.push_back( this->m_BinaryKNNTreeJoint.GetPointer() );
+
+  /** Generate the trees. The trees are independent, so with multi-threading
+   * each tree is generated by a different thread.
+   */
+  if( !this->m_UseMultiThread )
+  {
+    for( std::size_t i = 0; i < this->m_TreesToGenerate.size(); ++i )
+    {
+      this->m_TreesToGenerate[ i ]->GenerateTree();
+    }
+  }
+  else
+  {
+    this->m_Threader->SetSingleMethod( this->GenerateTreesThreaderCallback,
+      const_cast< void * >( static_cast< const void * >(
+        &this->m_KNNGraphAlphaMutualInformationThreaderParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+
+  /** Initialize tree searchers. */
+  this->m_BinaryKNNTreeSearcherFixed
+  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
+  this->m_BinaryKNNTreeSearcherMoving
+  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
+  this->m_BinaryKNNTreeSearcherJoint
+  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+
+  if( this->m_UseMultiThread )
+  {
+    const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+    {
+      this->m_KNNGraphAlphaMutualInformationPerThreadVariables[ i ].st_BinaryKNNTreeSearcherFixed
+      ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
+      this->m_KNNGraphAlphaMutualInformationPerThreadVariables[ i ].st_BinaryKNNTreeSearcherMoving
+      ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
+      this->m_KNNGraphAlphaMutualInformationPerThreadVariables[ i ].st_BinaryKNNTreeSearcherJoint
+      ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+    }
+  }
+
+} // end GenerateTrees()
+
+
+/**
+ * ************************ ThreadedGenerateTrees *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGenerateTrees( ThreadIdType threadId, ThreadIdType numberOfThreads )
+{
+  for( std::size_t i = threadId; i < this->m_TreesToGenerate.size(); i += numberOfThreads )
+  {
+    this->m_TreesToGenerate[ i ]->GenerateTree();
+  }
+
+} // end ThreadedGenerateTrees()
+
+
+/**
+ * **************** GenerateTreesThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GenerateTreesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct      = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId        = infoStruct->WorkUnitID;
+  ThreadIdType     numberOfThreads = infoStruct->NumberOfWorkUnits;
+
+  KNNGraphAlphaMutualInformationMultiThreaderParameterType * temp
+    = static_cast< KNNGraphAlphaMutualInformationMultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedGenerateTrees( threadId, numberOfThreads );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GenerateTreesThreaderCallback()
+
+
+/**
+ * ************************ ListSamplesAreEqual *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ListSamplesAreEqual(
+  const ListSamplePointer & listSample1,
+  const ListSamplePointer & listSample2 ) const
+{
+  const unsigned long numberOfPoints = listSample1->GetActualSize();
+  const unsigned int  dimension      = listSample1->GetMeasurementVectorSize();
+  if( listSample2->GetActualSize() != numberOfPoints
+    || listSample2->GetMeasurementVectorSize() != dimension )
+  {
+    return false;
+  }
+
+  /** Compare the points exactly, since the tree is reused as is. */
+  typedef typename ListSampleType::InternalDataContainerType InternalDataContainerType;
+  const InternalDataContainerType points1 = listSample1->GetInternalContainer();
+  const InternalDataContainerType points2 = listSample2->GetInternalContainer();
+  for( unsigned long i = 0; i < numberOfPoints; ++i )
+  {
+    if( !std::equal( points1[ i ], points1[ i ] + dimension, points2[ i ] ) )
+    {
+      return false;
+    }
+  }
+  return true;
+
+} // end ListSamplesAreEqual()
+
+
+/**
+ * ************************ ThreadedGetValue *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValue( ThreadIdType threadId )
+{
+  /** Get the range of query points of this thread. The query points are
+   * distributed statically, so that the result does not depend on timing.
+   */
+  const ThreadIdType  numberOfThreads = Self::GetNumberOfWorkUnits();
+  const SizeValueType numberOfQueries = this->m_NumberOfPixelsCounted;
+  const SizeValueType pos_begin       = ( numberOfQueries * threadId ) / numberOfThreads;
+  const SizeValueType pos_end         = ( numberOfQueries * ( threadId + 1 ) ) / numberOfThreads;
+
+  /** Search the neighbours of the query points with the searchers of this thread. */
+  const AlignedKNNGraphAlphaMutualInformationPerThreadStruct & threadVariables
+    = this->m_KNNGraphAlphaMutualInformationPerThreadVariables[ threadId ];
+  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
+  this->ComputeValueContributions( pos_begin, pos_end,
+    threadVariables.st_BinaryKNNTreeSearcherFixed,
+    threadVariables.st_BinaryKNNTreeSearcherMoving,
+    threadVariables.st_BinaryKNNTreeSearcherJoint, sumG );
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value = sumG;
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ************************ ThreadedGetValueAndDerivative *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivative( ThreadIdType threadId )
+{
+  /** Get the range of query points of this thread. */
+  const ThreadIdType  numberOfThreads = Self::GetNumberOfWorkUnits();
+  const SizeValueType numberOfQueries = this->m_NumberOfPixelsCounted;
+  const SizeValueType pos_begin       = ( numberOfQueries * threadId ) / numberOfThreads;
+  const SizeValueType pos_end         = ( numberOfQueries * ( threadId + 1 ) ) / numberOfThreads;
+
+  /** Search the neighbours of the query points with the searchers of this
+   * thread. The derivative contributions are added to the pre-allocated
+   * derivative of the thread, which is reset when the contributions are summed.
+   */
+  AlignedKNNGraphAlphaMutualInformationPerThreadStruct & threadVariables
+    = this->m_KNNGraphAlphaMutualInformationPerThreadVariables[ threadId ];
+  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
+  this->ComputeValueAndDerivativeContributions( pos_begin, pos_end,
+    threadVariables.st_BinaryKNNTreeSearcherFixed,
+    threadVariables.st_BinaryKNNTreeSearcherMoving,
+    threadVariables.st_BinaryKNNTreeSearcherJoint,
+    threadVariables.st_DGammaM, threadVariables.st_DGammaJ, sumG,
+    this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative );
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value = sumG;
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ************************ ComputeValueContributions *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValueContributions(
+  const SizeValueType begin, const SizeValueType end,
+  BinaryKNNTreeSearchType * searcherFixed,
+  BinaryKNNTreeSearchType * searcherMoving,
+  BinaryKNNTreeSearchType * searcherJoint,
+  AccumulateType & sumG ) const
+{
+  /** Temporary variables. */
+  MeasurementVectorType z_F, z_M, z_J;
+  IndexArrayType        indices_F, indices_M, indices_J;
+  DistanceArrayType     distances_F, distances_M, distances_J;
+
+  MeasureType H, G;
+
+  /** Get the size of the feature vectors. */
+  unsigned int fixedSize  = this->GetNumberOfFixedImages();
+  unsigned int movingSize = this->GetNumberOfMovingImages();
+  unsigned int jointSize  = fixedSize + movingSize;
+
+  /** Get the number of neighbours and \gamma. */
+  unsigned int k        = searcherFixed->GetKNearestNeighbors();
+  double       twoGamma = jointSize * ( 1.0 - this->m_Alpha );
+
+  /** Loop over the query points [ begin, end [. */
+  for( SizeValueType i = begin; i < end; ++i )
+  {
+    /** Get the i-th query point. */
+    this->m_ListSampleFixed->GetMeasurementVector(  i, z_F );
+    this->m_ListSampleMoving->GetMeasurementVector( i, z_M );
+    this->m_ListSampleJoint->GetMeasurementVector(  i, z_J );
+
+    /** Search for the K nearest neighbours of the current query point. */
+    searcherFixed->Search(  z_F, indices_F, distances_F );
+    searcherMoving->Search( z_M, indices_M, distances_M );
+    searcherJoint->Search(  z_J, indices_J, distances_J );
+
+    /** Add the distances between the points to get the total graph length.
+     * The outcommented implementation calculates: sum J/sqrt(F*M)
+     *
+    for ( unsigned int j = 0; j < K; j++ )
+    {
+    enumerator = std::sqrt( distsJ[ j ] );
+    denominator = std::sqrt( std::sqrt( distsF[ j ] ) * std::sqrt( distsM[ j ] ) );
+    if ( denominator > 1e-14 )
+    {
+    contribution += std::pow( enumerator / denominator, twoGamma );
+    }
+    }*/
+
+    /** Add the distances of all neighbours of the query point,
+    * for the three graphs:
+    * sum M / sqrt( sum F * sum M)
+    */
+
+    /** Variables to compute the measure. */
+    AccumulateType Gamma_F = NumericTraits< AccumulateType >::Zero;
+    AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
+    AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
+
+    /** Loop over the neighbours. */
+    for( unsigned int p = 0; p < k; p++ )
+    {
+      Gamma_F += std::sqrt( distances_F[ p ] );
+      Gamma_M += std::sqrt( distances_M[ p ] );
+      Gamma_J += std::sqrt( distances_J[ p ] );
+    } // end loop over the k neighbours
+
+    /** Calculate the contribution of this query point. */
+    H = std::sqrt( Gamma_F * Gamma_M );
+    if( H > this->m_AvoidDivisionBy )
+    {
+      /** Compute some sums. */
+      G     = Gamma_J / H;
+      sumG += std::pow( G, twoGamma );
+    }
+  } // end looping over the query points
+
+} // end ComputeValueContributions()
+
+
+/**
+ * ************************ ComputeValueAndDerivativeContributions *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValueAndDerivativeContributions(
+  const SizeValueType begin, const SizeValueType end,
+  BinaryKNNTreeSearchType * searcherFixed,
+  BinaryKNNTreeSearchType * searcherMoving,
+  BinaryKNNTreeSearchType * searcherJoint,
+  DerivativeType & dGamma_M, DerivativeType & dGamma_J,
+  AccumulateType & sumG, DerivativeType & contribution ) const
+{
   /** Temporary variables. */
-  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
   MeasurementVectorType z_F, z_M, z_J, z_M_ip, z_J_ip, diff_M, diff_J;
   IndexArrayType        indices_F,   indices_M,   indices_J;
   DistanceArrayType     distances_F, distances_M, distances_J;
   MeasureType           distance_F,  distance_M,  distance_J;
 
-  MeasureType    H, G, Gpow;
-  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
-
-  DerivativeType contribution( this->GetNumberOfParameters() );
-  contribution.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
-  DerivativeType dGamma_M( this->GetNumberOfParameters() );
-  DerivativeType dGamma_J( this->GetNumberOfParameters() );
+  MeasureType H, G, Gpow;
 
   /** Get the size of the feature vectors. */
   unsigned int fixedSize  = this->GetNumberOfFixedImages();
@@ -635,21 +991,21 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   unsigned int jointSize  = fixedSize + movingSize;
 
   /** Get the number of neighbours and \gamma. */
-  unsigned int k        = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
+  unsigned int k        = searcherFixed->GetKNearestNeighbors();
   double       twoGamma = jointSize * ( 1.0 - this->m_Alpha );
 
-  /** Loop over all query points, i.e. all samples. */
-  for( unsigned long i = 0; i < this->m_NumberOfPixelsCounted; i++ )
+  /** Loop over the query points [ begin, end [. */
+  for( SizeValueType i = begin; i < end; ++i )
   {
     /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(  i, z_F );
-    listSampleMoving->GetMeasurementVector( i, z_M );
-    listSampleJoint->GetMeasurementVector(  i, z_J );
+    this->m_ListSampleFixed->GetMeasurementVector(  i, z_F );
+    this->m_ListSampleMoving->GetMeasurementVector( i, z_M );
+    this->m_ListSampleJoint->GetMeasurementVector(  i, z_J );
 
     /** Search for the k nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
-    this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
-    this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
+    searcherFixed->Search(  z_F, indices_F, distances_F );
+    searcherMoving->Search( z_M, indices_M, distances_M );
+    searcherJoint->Search(  z_J, indices_J, distances_J );
 
     /** Variables to compute the measure and its derivative. */
     AccumulateType Gamma_F = NumericTraits< AccumulateType >::Zero;
@@ -657,7 +1013,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
 
     SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
-    D1sparse = spatialDerivativesContainer[ i ] * jacobianContainer[ i ];
+    D1sparse = this->m_SpatialDerivativesContainer[ i ] * this->m_JacobianContainer[ i ];
 
     dGamma_M.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
     dGamma_J.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
@@ -666,8 +1022,8 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     for( unsigned int p = 0; p < k; p++ )
     {
       /** Get the neighbour point z_ip^M. */
-      listSampleMoving->GetMeasurementVector( indices_M[ p ], z_M_ip );
-      listSampleMoving->GetMeasurementVector( indices_J[ p ], z_J_ip );
+      this->m_ListSampleMoving->GetMeasurementVector( indices_M[ p ], z_M_ip );
+      this->m_ListSampleMoving->GetMeasurementVector( indices_J[ p ], z_J_ip );
 
       /** Get the distances. */
       distance_F = std::sqrt( distances_F[ p ] );
@@ -684,17 +1040,17 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       diff_J = z_M - z_J_ip;
 
       /** Compute derivatives. */
-      D2sparse_M = spatialDerivativesContainer[ indices_M[ p ] ]
-        * jacobianContainer[ indices_M[ p ] ];
-      D2sparse_J = spatialDerivativesContainer[ indices_J[ p ] ]
-        * jacobianContainer[ indices_J[ p ] ];
+      D2sparse_M = this->m_SpatialDerivativesContainer[ indices_M[ p ] ]
+        * this->m_JacobianContainer[ indices_M[ p ] ];
+      D2sparse_J = this->m_SpatialDerivativesContainer[ indices_J[ p ] ]
+        * this->m_JacobianContainer[ indices_J[ p ] ];
 
       /** Update the dGamma's. */
       this->UpdateDerivativeOfGammas(
         D1sparse, D2sparse_M, D2sparse_J,
-        jacobianIndicesContainer[ i ],
-        jacobianIndicesContainer[ indices_M[ p ] ],
-        jacobianIndicesContainer[ indices_J[ p ] ],
+        this->m_JacobianIndicesContainer[ i ],
+        this->m_JacobianIndicesContainer[ indices_M[ p ] ],
+        this->m_JacobianIndicesContainer[ indices_J[ p ] ],
         diff_M, diff_J,
         distance_M, distance_J,
         dGamma_M, dGamma_J );
@@ -714,27 +1070,9 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       contribution += ( Gpow / H ) * ( dGamma_J - ( 0.5 * Gamma_J / Gamma_M ) * dGamma_M );
     }
 
-  } // end looping over all query points
-
-  /**
-   * *************** Finally, calculate the metric value and derivative ******************
-   */
+  } // end looping over the query points
 
-  /** Compute the value. */
-  double n, number;
-  if( sumG > this->m_AvoidDivisionBy )
-  {
-    /** Compute the measure. */
-    n       = static_cast< double >( this->m_NumberOfPixelsCounted );
-    number  = std::pow( n, this->m_Alpha );
-    measure = std::log( sumG / number ) / ( this->m_Alpha - 1.0 );
-
-    /** Compute the derivative (-2.0 * d = -jointSize). */
-    derivative = ( static_cast< AccumulateType >( jointSize ) / sumG ) * contribution;
-  }
-  value = -measure;
-
-} // end GetValueAndDerivative()
+} // end ComputeValueAndDerivativeContributions()
 
 
 /**
@@ -1089,6 +1427,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 
   os << indent << "Alpha: " << this->m_Alpha << std::endl;
   os << indent << "AvoidDivisionBy: " << this->m_AvoidDivisionBy << std::endl;
+  os << indent << "ReuseFixedFeatureTree: " << this->m_ReuseFixedFeatureTree << std::endl;
 
   os << indent << "BinaryKNNTreeFixed: "
      << this->m_BinaryKNNTreeFixed.GetPointer() << std::endl;
@@ -145,6 +145,13 @@ typename ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage,
 ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::GetValue( const ParametersType & parameters ) const
 {
+  /** Reuse the result of a previous evaluation at the same parameters. */
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  if( this->GetCachedValue( parameters, value ) )
+  {
+    return value;
+  }
+
   /** Construct the JointPDF and Alpha */
   this->ComputePDFs( parameters );
 
@@ -162,8 +169,10 @@ ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingI
   /** Compute the measure */
   MeasureType       jointEntropy = 0.0;
   const MeasureType nMI          = this->ComputeNormalizedMutualInformation( jointEntropy );
+  value = static_cast< MeasureType >( -1.0 * nMI );
+  this->SetCachedValue( parameters, value );
 
-  return static_cast< MeasureType >( -1.0 * nMI );
+  return value;
 
 } // end GetValue
 
@@ -181,6 +190,12 @@ ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingI
   MeasureType & value,
   DerivativeType & derivative ) const
 {
+  /** Reuse the result of a previous evaluation at the same parameters. */
+  if( this->GetCachedValueAndDerivative( parameters, value, derivative ) )
+  {
+    return;
+  }
+
   /** Initialize some variables */
   value      = NumericTraits< MeasureType >::Zero;
   derivative = DerivativeType( this->GetNumberOfParameters() );
@@ -277,6 +292,8 @@ ParzenWindowNormalizedMutualInformationImageToImageMetric< TFixedImage, TMovingI
     jointPDFconstit.NextLine();
   }    // end while-loop over fixed index
 
+  this->SetCachedValueAndDerivative( parameters, value, derivative );
+
 } // end GetValueAndDerivative
 
 
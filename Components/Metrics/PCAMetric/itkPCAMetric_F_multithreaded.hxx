@@ -741,86 +741,90 @@ PCAMetric< TFixedImage, TMovingImage >
 ::ThreadedGetSamples( ThreadIdType threadId )
 {
   /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
-  threader_fbegin                                                 += (int)pos_begin;
-  threader_fend                                                   += (int)pos_end;
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
+  /** The moving image values of the accepted samples, row by row. */
   std::vector< FixedImagePointType > SamplesOK;
-  MatrixType                         datablock( nrOfSamplesPerThreads, this->m_G );
+  std::vector< RealType >            dataRows;
+  vnl_vector< RealType >             dataRow( this->m_G );
 
-  unsigned int pixelIndex = 0;
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
+  unsigned int  pixelIndex = 0;
+  unsigned long pos_begin, pos_end;
+  while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
   {
-    /** Read fixed coordinates. */
-    FixedImagePointType fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
+    /** Create iterator over the sample container. */
+    typename ImageSampleContainerType::ConstIterator threader_fiter;
+    typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+    typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
+    threader_fbegin                                                 += (int)pos_begin;
+    threader_fend                                                   += (int)pos_end;
+
+    for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
+    {
+      /** Read fixed coordinates. */
+      FixedImagePointType fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
 
-    /** Transform sampled point to voxel coordinates. */
-    FixedImageContinuousIndexType voxelCoord;
-    this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
+      /** Transform sampled point to voxel coordinates. */
+      FixedImageContinuousIndexType voxelCoord;
+      this->GetFixedImage()->TransformPhysicalPointToContinuousIndex( fixedPoint, voxelCoord );
 
-    unsigned int numSamplesOk = 0;
+      unsigned int numSamplesOk = 0;
 
-    /** Loop over t */
-    for( unsigned int d = 0; d < this->m_G; ++d )
-    {
-      /** Initialize some variables. */
-      RealType             movingImageValue;
-      MovingImagePointType mappedPoint;
+      /** Loop over t */
+      for( unsigned int d = 0; d < this->m_G; ++d )
+      {
+        /** Initialize some variables. */
+        RealType             movingImageValue;
+        MovingImagePointType mappedPoint;
 
-      /** Set fixed point's last dimension to lastDimPosition. */
-      voxelCoord[ this->m_LastDimIndex ] = d;
+        /** Set fixed point's last dimension to lastDimPosition. */
+        voxelCoord[ this->m_LastDimIndex ] = d;
 
-      /** Transform sampled point back to world coordinates. */
-      this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
+        /** Transform sampled point back to world coordinates. */
+        this->GetFixedImage()->TransformContinuousIndexToPhysicalPoint( voxelCoord, fixedPoint );
 
-      /** Transform point and check if it is inside the B-spline support region. */
-      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-      /** Check if point is inside mask. */
-      if( sampleOk )
-      {
-        sampleOk = this->IsInsideMovingMask( mappedPoint );
-      }
+        /** Transform point and check if it is inside the B-spline support region. */
+        bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+        /** Check if point is inside mask. */
+        if( sampleOk )
+        {
+          sampleOk = this->IsInsideMovingMask( mappedPoint );
+        }
 
-      if( sampleOk )
+        if( sampleOk )
 
+        {
+          sampleOk = this->EvaluateMovingImageValueAndDerivative(
+            mappedPoint, movingImageValue, 0 );
+        }
+
+        if( sampleOk )
+        {
+          numSamplesOk++;
+          dataRow[ d ] = movingImageValue;
+        } // end if sampleOk
+
+      } // end loop over t
+      if( numSamplesOk == m_G )
       {
-        sampleOk = this->EvaluateMovingImageValueAndDerivative(
-          mappedPoint, movingImageValue, 0 );
+        SamplesOK.push_back( fixedPoint );
+        dataRows.insert( dataRows.end(), dataRow.begin(), dataRow.end() );
+        pixelIndex++;
       }
 
-      if( sampleOk )
-      {
-        numSamplesOk++;
-        datablock( pixelIndex, d ) = movingImageValue;
-      } // end if sampleOk
+    } /** end first loop over image sample container */
 
-    } // end loop over t
-    if( numSamplesOk == m_G )
-    {
-      SamplesOK.push_back( fixedPoint );
-      pixelIndex++;
-    }
+  } // end loop over sample chunks
 
-  } /** end first loop over image sample container */
+  MatrixType datablock( pixelIndex, this->m_G );
+  if( pixelIndex > 0 )
+  {
+    datablock.copy_in( &dataRows[ 0 ] );
+  }
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_NumberOfPixelsCounted = pixelIndex;
-  this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_DataBlock             = datablock.extract( pixelIndex, this->m_G );
+  this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_DataBlock             = datablock;
   this->m_PCAMetricGetSamplesPerThreadVariables[ threadId ].st_ApprovedSamples       = SamplesOK;
 
 } // end ThreadedGetSamples()
@@ -959,16 +963,16 @@ void
 PCAMetric< TFixedImage, TMovingImage >
 ::LaunchGetSamplesThreaderCallback( void ) const
 {
-  /** Setup local threader. */
-  // \todo: is a global threader better performance-wise? check
-  typename ThreaderType::Pointer local_threader = ThreaderType::New();
-  local_threader->SetNumberOfWorkUnits( Self::GetNumberOfWorkUnits() );
-  local_threader->SetSingleMethod( this->GetSamplesThreaderCallback,
+  /** Distribute the samples over the threads. */
+  this->InitializeSampleChunkScheduler( this->GetImageSampler()->GetOutput()->Size() );
+
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( this->GetSamplesThreaderCallback,
     const_cast< void * >( static_cast< const void * >(
       &this->m_PCAMetricThreaderParameters ) ) );
 
   /** Launch. */
-  local_threader->SingleMethodExecute();
+  this->m_Threader->SingleMethodExecute();
 
 } // end LaunchGetSamplesThreaderCallback()
 
@@ -1169,16 +1173,13 @@ void
 PCAMetric< TFixedImage, TMovingImage >
 ::LaunchComputeDerivativeThreaderCallback( void ) const
 {
-  /** Setup local threader. */
-  // \todo: is a global threader better performance-wise? check
-  typename ThreaderType::Pointer local_threader = ThreaderType::New();
-  local_threader->SetNumberOfWorkUnits( Self::GetNumberOfWorkUnits() );
-  local_threader->SetSingleMethod( this->ComputeDerivativeThreaderCallback,
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( this->ComputeDerivativeThreaderCallback,
     const_cast< void * >( static_cast< const void * >(
       &this->m_PCAMetricThreaderParameters ) ) );
 
   /** Launch. */
-  local_threader->SingleMethodExecute();
+  this->m_Threader->SingleMethodExecute();
 
 } // end LaunchComputeDerivativeThreaderCallback()
 
@@ -52,6 +52,14 @@ namespace itk
  * The RigidityPenaltyTermValueImageFilter at each pixel location is computed by
  * convolution with some separable 1D kernels.
  *
+ * In GetValueAndDerivative() the filters are not applied as a chain of
+ * image filters. Instead, every filter is evaluated as a 3^D stencil on the
+ * neighbourhood of a grid point, so that no filtered images are stored.
+ * This is done in two multi-threaded passes over the grid: the first
+ * computes the condition values and the parts of the derivative, the second
+ * filters these parts with the adjoint operators. The number of threads is
+ * set with SetNumberOfWorkUnits().
+ *
  * The rigid penalty term penalizes deviations from a rigid
  * transformation at regions specified by the so-called rigidity images.
  *
@@ -138,6 +146,8 @@ public:
   typedef typename Superclass::SpatialHessianType             SpatialHessianType;
   typedef typename Superclass::JacobianOfSpatialHessianType   JacobianOfSpatialHessianType;
   typedef typename Superclass::InternalMatrixType             InternalMatrixType;
+  typedef typename Superclass::ThreaderType                   ThreaderType;
+  typedef typename Superclass::ThreadInfoType                 ThreadInfoType;
 
   /** Define the dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int, FixedImageType::ImageDimension );
@@ -154,6 +164,7 @@ public:
   typedef typename BSplineTransformType::ImageType   CoefficientImageType;
   typedef typename CoefficientImageType::Pointer     CoefficientImagePointer;
   typedef typename CoefficientImageType::SpacingType CoefficientImageSpacingType;
+  typedef typename CoefficientImageType::PixelType   CoefficientPixelType;
 
   /** Typedef support for neighborhoods, filters, etc. */
   typedef Neighborhood< ScalarType,
@@ -326,6 +337,37 @@ private:
   CoefficientImagePointer FilterSeparable( const CoefficientImageType *,
     const std::vector< NeighborhoodType > & Operators ) const;
 
+  /** Typedef for an operator as a list of its non-zero elements. */
+  typedef std::vector< std::pair< unsigned int, ScalarType > > StencilType;
+
+  /** Create the stencils of the separable operators and of their adjoints. */
+  void CreateStencils( const CoefficientImageSpacingType & spacing ) const;
+
+  /** Get the indices of the neighbourhood of a grid point. The boundary
+   * is replicated, as by the boundary condition of the filters.
+   */
+  void GetNeighbourhoodIndices( const SizeValueType index,
+    OffsetValueType * neighbours ) const;
+
+  /** Compute the values of the conditions and the value of the penalty term,
+   * with the stencils on the current coefficients, and if computeDerivativeParts
+   * also the derivative parts for ThreadedComputeDerivative(). Used by both
+   * GetValue() and GetValueAndDerivative(). Returns false, with a zero value,
+   * if all rigidity coefficients are zero.
+   */
+  bool ComputeConditionValues( const bool computeDerivativeParts ) const;
+
+  /** Compute the condition values and the derivative parts of a part of the grid. */
+  void ThreadedComputeConditionParts( ThreadIdType threadId ) const;
+
+  /** Filter the derivative parts and compute the derivative of a part of the grid. */
+  void ThreadedComputeDerivative( ThreadIdType threadId ) const;
+
+  /** The threader callbacks of the two passes. */
+  static ITK_THREAD_RETURN_TYPE ComputeConditionPartsThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE ComputeDerivativeThreaderCallback( void * arg );
+
   /** Member variables. */
   BSplineTransformPointer m_BSplineTransform;
   ScalarType              m_LinearityConditionWeight;
@@ -361,6 +403,40 @@ private:
   bool                               m_UseFixedRigidityImage;
   bool                               m_UseMovingRigidityImage;
 
+  /** Variables for the multi-threaded evaluation. */
+  struct RigidityPenaltyTermMultiThreaderParameterType
+  {
+    Self * m_Metric;
+  };
+  RigidityPenaltyTermMultiThreaderParameterType m_RigidityPenaltyTermThreaderParameters;
+
+  struct RigidityPenaltyTermPerThreadStruct
+  {
+    MeasureType st_LinearityConditionValue;
+    MeasureType st_OrthonormalityConditionValue;
+    MeasureType st_PropernessConditionValue;
+    MeasureType st_LinearityConditionGradientMagnitude;
+    MeasureType st_OrthonormalityConditionGradientMagnitude;
+    MeasureType st_PropernessConditionGradientMagnitude;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, RigidityPenaltyTermPerThreadStruct,
+    PaddedRigidityPenaltyTermPerThreadStruct );
+  mutable std::vector< PaddedRigidityPenaltyTermPerThreadStruct > m_RigidityPenaltyTermPerThreadVariables;
+
+  mutable std::vector< StencilType >                  m_Stencils;
+  mutable std::vector< StencilType >                  m_AdjointStencils;
+  mutable std::vector< std::vector< OffsetValueType > > m_NeighbourhoodOffsets;
+  mutable FixedArray< SizeValueType,
+    itkGetStaticConstMacro( ImageDimension ) >        m_GridSize;
+  mutable SizeValueType                               m_NumberOfGridPoints;
+  mutable ThreadIdType                                m_NumberOfRigidityWorkUnits;
+  mutable std::vector< const CoefficientPixelType * > m_CoefficientBuffers;
+  mutable const RigidityPixelType *                   m_RigidityCoefficientBuffer;
+  mutable std::vector< ScalarType >                   m_ConditionParts;
+  mutable DerivativeValueType *                       m_DerivativeBuffer;
+  mutable ScalarType                                  m_RigidityCoefficientSum;
+  mutable bool                                        m_ComputeConditionDerivativeParts;
+
 };
 
 } // end namespace itk
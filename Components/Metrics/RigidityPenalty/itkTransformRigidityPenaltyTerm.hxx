@@ -21,6 +21,7 @@
 #include "itkTransformRigidityPenaltyTerm.h"
 
 #include "itkZeroFluxNeumannBoundaryCondition.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -87,6 +88,15 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
 
   this->m_BSplineTransform = nullptr;
 
+  /** Initialize the variables for the multi-threaded evaluation. */
+  this->m_RigidityPenaltyTermThreaderParameters.m_Metric = this;
+  this->m_NumberOfGridPoints        = 0;
+  this->m_NumberOfRigidityWorkUnits = 1;
+  this->m_RigidityCoefficientBuffer = nullptr;
+  this->m_DerivativeBuffer          = nullptr;
+  this->m_RigidityCoefficientSum    = NumericTraits< ScalarType >::Zero;
+  this->m_ComputeConditionDerivativeParts = false;
+
 } // end Constructor
 
 
@@ -489,403 +499,10 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
    */
   this->m_BSplineTransform->SetParameters( parameters );
 
-  /** Sanity check. */
-  if( ImageDimension != 2 && ImageDimension != 3 )
-  {
-    itkExceptionMacro( << "ERROR: This filter is only implemented for dimension 2 and 3." );
-  }
-
-  /** Get a handle to the B-spline coefficient images. */
-  std::vector< CoefficientImagePointer > inputImages( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    inputImages[ i ] = this->m_BSplineTransform->GetCoefficientImages()[ i ];
-  }
-
-  /** Get the B-spline coefficient image spacing. */
-  CoefficientImageSpacingType spacing = inputImages[ 0 ]->GetSpacing();
-
-  /** TASK 0:
-   * Compute the rigidityCoefficientSum and check on it.
-   *
-   ************************************************************************* */
-
-  /** Create iterator over the rigidity coeficient image. */
-  CoefficientImageIteratorType it_RCI( this->m_RigidityCoefficientImage,
-  this->m_RigidityCoefficientImage->GetLargestPossibleRegion() );
-  it_RCI.GoToBegin();
-  ScalarType rigidityCoefficientSum = NumericTraits< ScalarType >::Zero;
-
-  /** Add the rigidity coefficients together. */
-  while( !it_RCI.IsAtEnd() )
-  {
-    rigidityCoefficientSum += it_RCI.Get();
-    ++it_RCI;
-  }
-
-  /** Check for early termination. */
-  if( rigidityCoefficientSum < 1e-14 )
-  {
-    this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
-    return this->m_RigidityPenaltyTermValue;
-  }
-
-  /** TASK 1:
-   * Prepare for the calculation of the rigidity penalty term.
-   *
-   ************************************************************************* */
-
-  /** Create 1D neighbourhood operators. */
-  std::vector< NeighborhoodType > Operators_A( ImageDimension ),
-  Operators_B( ImageDimension ), Operators_C( ImageDimension ),
-  Operators_D( ImageDimension ), Operators_E( ImageDimension ),
-  Operators_F( ImageDimension ), Operators_G( ImageDimension ),
-  Operators_H( ImageDimension ), Operators_I( ImageDimension );
-
-  /** Create B-spline coefficient images that are filtered once. */
-  std::vector< CoefficientImagePointer > ui_FA( ImageDimension ),
-  ui_FB( ImageDimension ), ui_FC( ImageDimension ),
-  ui_FD( ImageDimension ), ui_FE( ImageDimension ),
-  ui_FF( ImageDimension ), ui_FG( ImageDimension ),
-  ui_FH( ImageDimension ), ui_FI( ImageDimension );
-
-  /** For all dimensions ... */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    /** ... create the filtered images ... */
-    ui_FA[ i ] = CoefficientImageType::New();
-    ui_FB[ i ] = CoefficientImageType::New();
-    ui_FD[ i ] = CoefficientImageType::New();
-    ui_FE[ i ] = CoefficientImageType::New();
-    ui_FG[ i ] = CoefficientImageType::New();
-    if( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = CoefficientImageType::New();
-      ui_FF[ i ] = CoefficientImageType::New();
-      ui_FH[ i ] = CoefficientImageType::New();
-      ui_FI[ i ] = CoefficientImageType::New();
-    }
-    /** ... and the apropiate operators.
-     * The operators C, D and E from the paper are here created
-     * by Create1DOperator D, E and G, because of the 3D case and history.
-     */
-    this->Create1DOperator( Operators_A[ i ], "FA_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_B[ i ], "FB_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_D[ i ], "FD_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_E[ i ], "FE_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_G[ i ], "FG_xi", i + 1, spacing );
-    if( ImageDimension == 3 )
-    {
-      this->Create1DOperator( Operators_C[ i ], "FC_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_F[ i ], "FF_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_H[ i ], "FH_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_I[ i ], "FI_xi", i + 1, spacing );
-    }
-  } // end for loop
-
-  /** TASK 2:
-   * Filter the B-spline coefficient images.
-   *
-   ************************************************************************* */
-
-  /** Filter the inputImages. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    ui_FA[ i ] = this->FilterSeparable( inputImages[ i ], Operators_A );
-    ui_FB[ i ] = this->FilterSeparable( inputImages[ i ], Operators_B );
-    ui_FD[ i ] = this->FilterSeparable( inputImages[ i ], Operators_D );
-    ui_FE[ i ] = this->FilterSeparable( inputImages[ i ], Operators_E );
-    ui_FG[ i ] = this->FilterSeparable( inputImages[ i ], Operators_G );
-    if( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = this->FilterSeparable( inputImages[ i ], Operators_C );
-      ui_FF[ i ] = this->FilterSeparable( inputImages[ i ], Operators_F );
-      ui_FH[ i ] = this->FilterSeparable( inputImages[ i ], Operators_H );
-      ui_FI[ i ] = this->FilterSeparable( inputImages[ i ], Operators_I );
-    }
-  }
-
-  /** TASK 3:
-   * Create iterators.
-   *
-   ************************************************************************* */
-
-  /** Create iterators over ui_F?. */
-  std::vector< CoefficientImageIteratorType > itA( ImageDimension ),
-  itB( ImageDimension ), itC( ImageDimension ),
-  itD( ImageDimension ), itE( ImageDimension ),
-  itF( ImageDimension ), itG( ImageDimension ),
-  itH( ImageDimension ), itI( ImageDimension );
-
-  /** Create iterators. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    /** Create iterators. */
-    itA[ i ] = CoefficientImageIteratorType( ui_FA[ i ], ui_FA[ i ]->GetLargestPossibleRegion() );
-    itB[ i ] = CoefficientImageIteratorType( ui_FB[ i ], ui_FB[ i ]->GetLargestPossibleRegion() );
-    itD[ i ] = CoefficientImageIteratorType( ui_FD[ i ], ui_FD[ i ]->GetLargestPossibleRegion() );
-    itE[ i ] = CoefficientImageIteratorType( ui_FE[ i ], ui_FE[ i ]->GetLargestPossibleRegion() );
-    itG[ i ] = CoefficientImageIteratorType( ui_FG[ i ], ui_FG[ i ]->GetLargestPossibleRegion() );
-    if( ImageDimension == 3 )
-    {
-      itC[ i ] = CoefficientImageIteratorType( ui_FC[ i ], ui_FC[ i ]->GetLargestPossibleRegion() );
-      itF[ i ] = CoefficientImageIteratorType( ui_FF[ i ], ui_FF[ i ]->GetLargestPossibleRegion() );
-      itH[ i ] = CoefficientImageIteratorType( ui_FH[ i ], ui_FH[ i ]->GetLargestPossibleRegion() );
-      itI[ i ] = CoefficientImageIteratorType( ui_FI[ i ], ui_FI[ i ]->GetLargestPossibleRegion() );
-    }
-    /** Reset iterators. */
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    itD[ i ].GoToBegin(); itE[ i ].GoToBegin(); itG[ i ].GoToBegin();
-    if( ImageDimension == 3 )
-    {
-      itC[ i ].GoToBegin(); itF[ i ].GoToBegin();
-      itH[ i ].GoToBegin(); itI[ i ].GoToBegin();
-    }
-  }
-
-  /** TASK 4A:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the orthonormality term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculateOrthonormalityCondition )
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    while( !itA[ 0 ].IsAtEnd() )
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if( ImageDimension == 3 )
-      {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
-      }
-
-      if( ImageDimension == 2 )
-      {
-        this->m_OrthonormalityConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          +( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * mu2_A
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +mu1_B * mu1_B
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +( 1.0 + mu1_A ) * mu1_B
-          + mu2_A * ( 1.0 + mu2_B ),
-          2.0 )
-          );
-      }
-      else if( ImageDimension == 3 )
-      {
-        this->m_OrthonormalityConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          +( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * mu2_A
-          + mu3_A * mu3_A
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +( 1.0 + mu1_A ) * mu1_B
-          + mu2_A * ( 1.0 + mu2_B )
-          + mu3_A * mu3_B,
-          2.0 )
-          + std::pow(
-          +( 1.0 + mu1_A ) * mu1_C
-          + mu2_A * mu2_C
-          + mu3_A * ( 1.0 + mu3_C ),
-          2.0 )
-          + std::pow(
-          +mu1_B * mu1_B
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu3_B * mu3_B
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +mu1_B * mu1_C
-          + ( 1.0 + mu2_B ) * mu2_C
-          + mu3_B * ( 1.0 + mu3_C ),
-          2.0 )
-          + std::pow(
-          +mu1_C * mu1_C
-          + mu2_C * mu2_C
-          + ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - 1.0,
-          2.0 ) );
-      }
-
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ]; ++itB[ i ];
-        if( ImageDimension == 3 ) { ++itC[ i ]; }
-      }
-      ++it_RCI;
-    } // end while
-  } // end if do orthonormality
-
-  /** TASK 4B:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the properness term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    if( ImageDimension == 3 ) { itC[ i ].GoToBegin(); }
-  }
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculatePropernessCondition )
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    while( !itA[ 0 ].IsAtEnd() )
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if( ImageDimension == 3 )
-      {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
-      }
-
-      if( ImageDimension == 2 )
-      {
-        this->m_PropernessConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          +( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          - mu2_A * mu1_B
-          - 1.0,
-          2.0 )
-          );
-      }
-      else if( ImageDimension == 3 )
-      {
-        this->m_PropernessConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          -mu1_C * ( 1.0 + mu2_B ) * mu3_A
-          + mu1_B * mu2_C * mu3_A
-          + mu1_C * mu2_A * mu3_B
-          - ( 1.0 + mu1_A ) * mu2_C * mu3_B
-          - mu1_B * mu2_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          - 1.0,
-          2.0 )
-          );
-      }
-
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ]; ++itB[ i ];
-        if( ImageDimension == 3 ) { ++itC[ i ]; }
-      }
-      ++it_RCI;
-
-    } // end while
-  } // end if do properness
-
-  /** TASK 4C:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the linearity term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculateLinearityCondition )
-  {
-    while( !itD[ 0 ].IsAtEnd() )
-    {
-      /** Linearity condition part. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        this->m_LinearityConditionValue
-          += it_RCI.Get() * (
-          +itD[ i ].Get() * itD[ i ].Get()
-          + itE[ i ].Get() * itE[ i ].Get()
-          + itG[ i ].Get() * itG[ i ].Get()
-          );
-        if( ImageDimension == 3 )
-        {
-          this->m_LinearityConditionValue
-            += it_RCI.Get() * (
-            +itF[ i ].Get() * itF[ i ].Get()
-            + itH[ i ].Get() * itH[ i ].Get()
-            + itI[ i ].Get() * itI[ i ].Get()
-            );
-        }
-      } // end loop over i
-
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itD[ i ]; ++itE[ i ]; ++itG[ i ];
-        if( ImageDimension == 3 )
-        {
-          ++itF[ i ]; ++itH[ i ]; ++itI[ i ];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
-  } // end if do properness
-
-  /** TASK 5:
-   * Do the actual calculation of the rigidity penalty term value.
-   *
-   ************************************************************************* */
-
-  /** Calculate the rigidity penalty term value. */
-  if( this->m_CalculateLinearityCondition )
-  {
-    this->m_LinearityConditionValue /= rigidityCoefficientSum;
-  }
-  if( this->m_CalculateOrthonormalityCondition )
-  {
-    this->m_OrthonormalityConditionValue /= rigidityCoefficientSum;
-  }
-  if( this->m_CalculatePropernessCondition )
-  {
-    this->m_PropernessConditionValue /= rigidityCoefficientSum;
-  }
-
-  if( this->m_UseLinearityCondition )
-  {
-    this->m_RigidityPenaltyTermValue
-      += this->m_LinearityConditionWeight * this->m_LinearityConditionValue;
-  }
-  if( this->m_UseOrthonormalityCondition )
-  {
-    this->m_RigidityPenaltyTermValue
-      += this->m_OrthonormalityConditionWeight * this->m_OrthonormalityConditionValue;
-  }
-  if( this->m_UsePropernessCondition )
-  {
-    this->m_RigidityPenaltyTermValue
-      += this->m_PropernessConditionWeight * this->m_PropernessConditionValue;
-  }
+  /** Compute the value with the same stencils as GetValueAndDerivative(),
+   * so that both give the same value. The derivative parts are not needed.
+   */
+  this->ComputeConditionValues( false );
 
   /** Return the rigidity penalty term value. */
   return this->m_RigidityPenaltyTermValue;
@@ -973,21 +590,76 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
-  /** Sanity check. */
-  if( ImageDimension != 2 && ImageDimension != 3 )
+  /** Compute the value and the derivative parts of the conditions. */
+  this->m_DerivativeBuffer = derivative.data_block();
+  if( !this->ComputeConditionValues( true ) )
   {
-    itkExceptionMacro( << "ERROR: This filter is only implemented for dimension 2 and 3." );
+    return;
   }
+  value = this->m_RigidityPenaltyTermValue;
 
-  /** Get a handle to the B-spline coefficient images. */
-  std::vector< CoefficientImagePointer > inputImages( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
+  /** TASK 4:
+   * Filter the derivative parts with the adjoint operators, and
+   * add it all to create the final derivative.
+   *
+   ************************************************************************* */
+
+  if( this->m_UseMultiThread )
   {
-    inputImages[ i ] = this->m_BSplineTransform->GetCoefficientImages()[ i ];
+    this->m_Threader->SetSingleMethod( this->ComputeDerivativeThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_RigidityPenaltyTermThreaderParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+  else
+  {
+    this->ThreadedComputeDerivative( 0 );
+  }
+
+  /** Accumulate the gradient magnitudes of the threads. */
+  MeasureType gradMagLC = NumericTraits< MeasureType >::Zero;
+  MeasureType gradMagOC = NumericTraits< MeasureType >::Zero;
+  MeasureType gradMagPC = NumericTraits< MeasureType >::Zero;
+  for( ThreadIdType t = 0; t < this->m_NumberOfRigidityWorkUnits; ++t )
+  {
+    gradMagLC += this->m_RigidityPenaltyTermPerThreadVariables[ t ].st_LinearityConditionGradientMagnitude;
+    gradMagOC += this->m_RigidityPenaltyTermPerThreadVariables[ t ].st_OrthonormalityConditionGradientMagnitude;
+    gradMagPC += this->m_RigidityPenaltyTermPerThreadVariables[ t ].st_PropernessConditionGradientMagnitude;
+  }
+
+  /** Set the gradient magnitudes of the several terms. */
+  this->m_LinearityConditionGradientMagnitude      = std::sqrt( gradMagLC );
+  this->m_OrthonormalityConditionGradientMagnitude = std::sqrt( gradMagOC );
+  this->m_PropernessConditionGradientMagnitude     = std::sqrt( gradMagPC );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * *********************** ComputeConditionValues ****************
+ */
+
+template< class TFixedImage, class TScalarType >
+bool
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeConditionValues( const bool computeDerivativeParts ) const
+{
+  /** Sanity check. */
+  if( ImageDimension != 2 && ImageDimension != 3 )
+  {
+    itkExceptionMacro( << "ERROR: This filter is only implemented for dimension 2 and 3." );
+  }
+
+  /** Get a handle to the B-spline coefficient images. */
+  const CoefficientImageType * inputImage = this->m_BSplineTransform->GetCoefficientImages()[ 0 ];
+  const typename CoefficientImageType::SizeType gridSize
+    = inputImage->GetLargestPossibleRegion().GetSize();
+  if( this->m_RigidityCoefficientImage->GetLargestPossibleRegion().GetSize() != gridSize )
+  {
+    itkExceptionMacro( << "ERROR: The rigidity coefficient image does not match the B-spline grid." );
   }
 
   /** Get the B-spline coefficient image spacing. */
-  CoefficientImageSpacingType spacing = inputImages[ 0 ]->GetSpacing();
+  CoefficientImageSpacingType spacing = inputImage->GetSpacing();
 
   /** TASK 0:
    * Compute the rigidityCoefficientSum and check on it.
@@ -1011,209 +683,353 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   if( rigidityCoefficientSum < 1e-14 )
   {
     this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
-    return;
+    return false;
   }
 
   /** TASK 1:
    * Prepare for the calculation of the rigidity penalty term.
+   * The filters are applied as 3^D stencils on the grid, so that the
+   * filtered coefficient images are never stored. The boundary is
+   * replicated, as by the ZeroFluxNeumann boundary condition of the
+   * neighborhood filters in FilterSeparable().
    *
    ************************************************************************* */
 
-  /** Create 1D neighbourhood operators. */
-  std::vector< NeighborhoodType > Operators_A( ImageDimension ),
-  Operators_B( ImageDimension ), Operators_C( ImageDimension ),
-  Operators_D( ImageDimension ), Operators_E( ImageDimension ),
-  Operators_F( ImageDimension ), Operators_G( ImageDimension ),
-  Operators_H( ImageDimension ), Operators_I( ImageDimension );
-
-  /** Create B-spline coefficient images that are filtered once. */
-  std::vector< CoefficientImagePointer > ui_FA( ImageDimension ),
-  ui_FB( ImageDimension ), ui_FC( ImageDimension ),
-  ui_FD( ImageDimension ), ui_FE( ImageDimension ),
-  ui_FF( ImageDimension ), ui_FG( ImageDimension ),
-  ui_FH( ImageDimension ), ui_FI( ImageDimension );
-
-  /** For all dimensions ... */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
+  /** Create the operators. */
+  this->CreateStencils( spacing );
+
+  /** Store the relative offsets of the neighbours along each dimension. */
+  this->m_NumberOfGridPoints = 1;
+  this->m_NeighbourhoodOffsets.resize( ImageDimension );
+  for( unsigned int d = 0; d < ImageDimension; d++ )
   {
-    /** ... create the filtered images ... */
-    ui_FA[ i ] = CoefficientImageType::New();
-    ui_FB[ i ] = CoefficientImageType::New();
-    ui_FD[ i ] = CoefficientImageType::New();
-    ui_FE[ i ] = CoefficientImageType::New();
-    ui_FG[ i ] = CoefficientImageType::New();
-    if( ImageDimension == 3 )
+    const OffsetValueType size   = static_cast< OffsetValueType >( gridSize[ d ] );
+    const OffsetValueType stride = static_cast< OffsetValueType >( this->m_NumberOfGridPoints );
+    this->m_GridSize[ d ] = gridSize[ d ];
+    this->m_NeighbourhoodOffsets[ d ].resize( 3 * size );
+    for( OffsetValueType p = 0; p < size; ++p )
     {
-      ui_FC[ i ] = CoefficientImageType::New();
-      ui_FF[ i ] = CoefficientImageType::New();
-      ui_FH[ i ] = CoefficientImageType::New();
-      ui_FI[ i ] = CoefficientImageType::New();
-    }
-    /** ... and the apropiate operators.
-     * The operators C, D and E from the paper are here created
-     * by Create1DOperator D, E and G, because of the 3D case and history.
-     */
-    this->Create1DOperator( Operators_A[ i ], "FA_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_B[ i ], "FB_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_D[ i ], "FD_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_E[ i ], "FE_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_G[ i ], "FG_xi", i + 1, spacing );
-    if( ImageDimension == 3 )
-    {
-      this->Create1DOperator( Operators_C[ i ], "FC_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_F[ i ], "FF_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_H[ i ], "FH_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_I[ i ], "FI_xi", i + 1, spacing );
+      for( OffsetValueType k = 0; k < 3; ++k )
+      {
+        const OffsetValueType q = std::min( std::max( p + k - 1, OffsetValueType( 0 ) ), size - 1 );
+        this->m_NeighbourhoodOffsets[ d ][ 3 * p + k ] = ( q - p ) * stride;
+      }
     }
-  } // end for loop
+    this->m_NumberOfGridPoints *= gridSize[ d ];
+  }
+
+  /** Get handles to the raw buffers. */
+  this->m_CoefficientBuffers.resize( ImageDimension );
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+  {
+    this->m_CoefficientBuffers[ i ]
+      = this->m_BSplineTransform->GetCoefficientImages()[ i ]->GetBufferPointer();
+  }
+  this->m_RigidityCoefficientBuffer = this->m_RigidityCoefficientImage->GetBufferPointer();
+  this->m_RigidityCoefficientSum    = rigidityCoefficientSum;
+
+  /** Allocate the derivative parts of all conditions, for all grid points. */
+  this->m_ComputeConditionDerivativeParts = computeDerivativeParts;
+  if( computeDerivativeParts )
+  {
+    const unsigned int NofLParts = 3 * ImageDimension - 3;
+    const unsigned int numberOfParts
+      = 2 * ImageDimension * ImageDimension + ImageDimension * NofLParts;
+    this->m_ConditionParts.resize( this->m_NumberOfGridPoints * numberOfParts );
+  }
+
+  /** Set up the per-thread variables. */
+  this->m_NumberOfRigidityWorkUnits = 1;
+  if( this->m_UseMultiThread )
+  {
+    this->m_NumberOfRigidityWorkUnits = this->m_Threader->GetNumberOfWorkUnits();
+  }
+  this->m_RigidityPenaltyTermPerThreadVariables.resize( this->m_NumberOfRigidityWorkUnits );
 
   /** TASK 2:
-   * Filter the B-spline coefficient images.
+   * Compute the values of the conditions and, if requested, the derivative
+   * parts, already multiplied by the rigidity coefficients.
    *
    ************************************************************************* */
 
-  /** Filter the inputImages. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
+  if( this->m_UseMultiThread )
   {
-    ui_FA[ i ] = this->FilterSeparable( inputImages[ i ], Operators_A );
-    ui_FB[ i ] = this->FilterSeparable( inputImages[ i ], Operators_B );
-    ui_FD[ i ] = this->FilterSeparable( inputImages[ i ], Operators_D );
-    ui_FE[ i ] = this->FilterSeparable( inputImages[ i ], Operators_E );
-    ui_FG[ i ] = this->FilterSeparable( inputImages[ i ], Operators_G );
-    if( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = this->FilterSeparable( inputImages[ i ], Operators_C );
-      ui_FF[ i ] = this->FilterSeparable( inputImages[ i ], Operators_F );
-      ui_FH[ i ] = this->FilterSeparable( inputImages[ i ], Operators_H );
-      ui_FI[ i ] = this->FilterSeparable( inputImages[ i ], Operators_I );
-    }
+    this->m_Threader->SetSingleMethod( this->ComputeConditionPartsThreaderCallback,
+      const_cast< void * >( static_cast< const void * >( &this->m_RigidityPenaltyTermThreaderParameters ) ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+  else
+  {
+    this->ThreadedComputeConditionParts( 0 );
+  }
+
+  /** Accumulate the values of the threads. */
+  for( ThreadIdType t = 0; t < this->m_NumberOfRigidityWorkUnits; ++t )
+  {
+    this->m_LinearityConditionValue
+      += this->m_RigidityPenaltyTermPerThreadVariables[ t ].st_LinearityConditionValue;
+    this->m_OrthonormalityConditionValue
+      += this->m_RigidityPenaltyTermPerThreadVariables[ t ].st_OrthonormalityConditionValue;
+    this->m_PropernessConditionValue
+      += this->m_RigidityPenaltyTermPerThreadVariables[ t ].st_PropernessConditionValue;
   }
 
   /** TASK 3:
-   * Create subparts and iterators.
+   * Do the actual calculation of the rigidity penalty term value.
    *
    ************************************************************************* */
 
-  /** Create iterators over ui_F?. */
-  std::vector< CoefficientImageIteratorType > itA( ImageDimension ),
-  itB( ImageDimension ), itC( ImageDimension ),
-  itD( ImageDimension ), itE( ImageDimension ),
-  itF( ImageDimension ), itG( ImageDimension ),
-  itH( ImageDimension ), itI( ImageDimension );
+  /** Calculate the rigidity penalty term value. */
+  if( this->m_CalculateLinearityCondition )
+  {
+    this->m_LinearityConditionValue /= rigidityCoefficientSum;
+  }
+  if( this->m_CalculateOrthonormalityCondition )
+  {
+    this->m_OrthonormalityConditionValue /= rigidityCoefficientSum;
+  }
+  if( this->m_CalculatePropernessCondition )
+  {
+    this->m_PropernessConditionValue /= rigidityCoefficientSum;
+  }
+
+  if( this->m_UseLinearityCondition )
+  {
+    this->m_RigidityPenaltyTermValue
+      += this->m_LinearityConditionWeight * this->m_LinearityConditionValue;
+  }
+  if( this->m_UseOrthonormalityCondition )
+  {
+    this->m_RigidityPenaltyTermValue
+      += this->m_OrthonormalityConditionWeight * this->m_OrthonormalityConditionValue;
+  }
+  if( this->m_UsePropernessCondition )
+  {
+    this->m_RigidityPenaltyTermValue
+      += this->m_PropernessConditionWeight * this->m_PropernessConditionValue;
+  }
 
-  /** Create iterators. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
+  return true;
+
+} // end ComputeConditionValues()
+
+
+/**
+ * ************************ CreateStencils *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::CreateStencils( const CoefficientImageSpacingType & spacing ) const
+{
+  /** The operators A to I are stored in this order. The separable
+   * operators are the products of the 1D operators, so that a single
+   * stencil gives the result of FilterSeparable(). The adjoint operators
+   * are the ND operators that are used to filter the derivative parts.
+   */
+  const std::string names = "ABCDEFGHI";
+  this->m_Stencils.assign( names.size(), StencilType() );
+  this->m_AdjointStencils.assign( names.size(), StencilType() );
+
+  for( unsigned int op = 0; op < names.size(); ++op )
   {
-    /** Create iterators. */
-    itA[ i ] = CoefficientImageIteratorType( ui_FA[ i ], ui_FA[ i ]->GetLargestPossibleRegion() );
-    itB[ i ] = CoefficientImageIteratorType( ui_FB[ i ], ui_FB[ i ]->GetLargestPossibleRegion() );
-    itD[ i ] = CoefficientImageIteratorType( ui_FD[ i ], ui_FD[ i ]->GetLargestPossibleRegion() );
-    itE[ i ] = CoefficientImageIteratorType( ui_FE[ i ], ui_FE[ i ]->GetLargestPossibleRegion() );
-    itG[ i ] = CoefficientImageIteratorType( ui_FG[ i ], ui_FG[ i ]->GetLargestPossibleRegion() );
-    if( ImageDimension == 3 )
+    /** The operators C, F, H and I only exist in 3D, and the operators
+     * D to I are only needed for the linearity condition.
+     */
+    const std::string whichF = std::string( "F" ) + names[ op ];
+    if( ImageDimension == 2
+      && ( names[ op ] == 'C' || names[ op ] == 'F' || names[ op ] == 'H' || names[ op ] == 'I' ) )
     {
-      itC[ i ] = CoefficientImageIteratorType( ui_FC[ i ], ui_FC[ i ]->GetLargestPossibleRegion() );
-      itF[ i ] = CoefficientImageIteratorType( ui_FF[ i ], ui_FF[ i ]->GetLargestPossibleRegion() );
-      itH[ i ] = CoefficientImageIteratorType( ui_FH[ i ], ui_FH[ i ]->GetLargestPossibleRegion() );
-      itI[ i ] = CoefficientImageIteratorType( ui_FI[ i ], ui_FI[ i ]->GetLargestPossibleRegion() );
+      continue;
     }
-    /** Reset iterators. */
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    itD[ i ].GoToBegin(); itE[ i ].GoToBegin(); itG[ i ].GoToBegin();
-    if( ImageDimension == 3 )
+    if( op > 2 && !this->m_CalculateLinearityCondition )
     {
-      itC[ i ].GoToBegin(); itF[ i ].GoToBegin();
-      itH[ i ].GoToBegin(); itI[ i ].GoToBegin();
+      continue;
     }
-  }
 
-  /** Create orthonormality and properness parts. */
-  std::vector< std::vector< CoefficientImagePointer > > OCparts( ImageDimension );
-  std::vector< std::vector< CoefficientImagePointer > > PCparts( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    OCparts[ i ].resize( ImageDimension );
-    PCparts[ i ].resize( ImageDimension );
-    for( unsigned int j = 0; j < ImageDimension; j++ )
+    /** Create the 1D and ND operators. */
+    std::vector< NeighborhoodType > operators1D( ImageDimension );
+    for( unsigned int i = 0; i < ImageDimension; i++ )
     {
-      OCparts[ i ][ j ] = CoefficientImageType::New();
-      OCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      OCparts[ i ][ j ]->Allocate();
-      PCparts[ i ][ j ] = CoefficientImageType::New();
-      PCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      PCparts[ i ][ j ]->Allocate();
+      this->Create1DOperator( operators1D[ i ], whichF + "_xi", i + 1, spacing );
     }
-  }
+    NeighborhoodType operatorND;
+    this->CreateNDOperator( operatorND, whichF, spacing );
 
-  /** Create linearity parts. */
-  unsigned int                                          NofLParts = 3 * ImageDimension - 3;
-  std::vector< std::vector< CoefficientImagePointer > > LCparts( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    LCparts[ i ].resize( NofLParts );
-    for( unsigned int j = 0; j < NofLParts; j++ )
+    /** Store the non-zero elements. */
+    for( unsigned int k = 0; k < operatorND.Size(); ++k )
     {
-      LCparts[ i ][ j ] = CoefficientImageType::New();
-      LCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      LCparts[ i ][ j ]->Allocate();
+      ScalarType   weight = NumericTraits< ScalarType >::One;
+      unsigned int kk     = k;
+      for( unsigned int d = 0; d < ImageDimension; d++ )
+      {
+        weight *= operators1D[ d ][ kk % 3 ];
+        kk     /= 3;
+      }
+      if( weight != 0.0 )
+      {
+        this->m_Stencils[ op ].push_back( std::make_pair( k, weight ) );
+      }
+      if( operatorND[ k ] != 0.0 )
+      {
+        this->m_AdjointStencils[ op ].push_back( std::make_pair( k, operatorND[ k ] ) );
+      }
     }
   }
 
-  /** Create iterators over all parts. */
-  std::vector< std::vector< CoefficientImageIteratorType > > itOCp( ImageDimension );
-  std::vector< std::vector< CoefficientImageIteratorType > > itPCp( ImageDimension );
-  std::vector< std::vector< CoefficientImageIteratorType > > itLCp( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
+} // end CreateStencils()
+
+
+/**
+ * ************************ GetNeighbourhoodIndices *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::GetNeighbourhoodIndices( const SizeValueType index,
+  OffsetValueType * neighbours ) const
+{
+  /** The neighbourhood is built one dimension at a time, in the order of
+   * the elements of a Neighborhood, i.e. with the first dimension fastest.
+   */
+  SizeValueType remainder = index;
+  unsigned int  size      = 1;
+  neighbours[ 0 ] = static_cast< OffsetValueType >( index );
+  for( unsigned int d = 0; d < ImageDimension; d++ )
   {
-    itOCp[ i ].resize( ImageDimension );
-    itPCp[ i ].resize( ImageDimension );
-    itLCp[ i ].resize( NofLParts );
-    for( unsigned int j = 0; j < ImageDimension; j++ )
-    {
-      itOCp[ i ][ j ] = CoefficientImageIteratorType( OCparts[ i ][ j ],
-        OCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      itOCp[ i ][ j ].GoToBegin();
-      itPCp[ i ][ j ] = CoefficientImageIteratorType( PCparts[ i ][ j ],
-        PCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      itPCp[ i ][ j ].GoToBegin();
-    }
-    for( unsigned int j = 0; j < NofLParts; j++ )
+    const SizeValueType     position = remainder % this->m_GridSize[ d ];
+    const OffsetValueType * offsets  = &this->m_NeighbourhoodOffsets[ d ][ 3 * position ];
+    remainder /= this->m_GridSize[ d ];
+
+    /** Go backwards, to not overwrite the first block before it is used. */
+    for( int k = 2; k >= 0; --k )
     {
-      itLCp[ i ][ j ] = CoefficientImageIteratorType( LCparts[ i ][ j ],
-        LCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      itLCp[ i ][ j ].GoToBegin();
+      for( unsigned int j = 0; j < size; ++j )
+      {
+        neighbours[ k * size + j ] = neighbours[ j ] + offsets[ k ];
+      }
     }
+    size *= 3;
   }
 
-  /** TASK 4A:
-   * Do the calculation of the orthonormality subparts.
-   *
-   ************************************************************************* */
+} // end GetNeighbourhoodIndices()
 
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
 
-  if( this->m_CalculateOrthonormalityCondition )
+/**
+ * ******************* ComputeConditionPartsThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_TYPE
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeConditionPartsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+
+  RigidityPenaltyTermMultiThreaderParameterType * temp
+    = static_cast< RigidityPenaltyTermMultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedComputeConditionParts( threadID );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeConditionPartsThreaderCallback()
+
+
+/**
+ * ******************* ThreadedComputeConditionParts *******************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedComputeConditionParts( ThreadIdType threadId ) const
+{
+  /** Get the range of grid points of this thread. */
+  const SizeValueType numberOfGridPoints = this->m_NumberOfGridPoints;
+  const SizeValueType numberOfThreads    = this->m_NumberOfRigidityWorkUnits;
+  const SizeValueType begin              = numberOfGridPoints * threadId / numberOfThreads;
+  const SizeValueType end                = numberOfGridPoints * ( threadId + 1 ) / numberOfThreads;
+
+  const unsigned int NofLParts = 3 * ImageDimension - 3;
+  const unsigned int numberOfParts
+    = 2 * ImageDimension * ImageDimension + ImageDimension * NofLParts;
+
+  /** The linearity parts are filtered by the operators D, E, G, F, H, I. */
+  const unsigned int linearityOperators[ 6 ] = { 3, 4, 6, 5, 7, 8 };
+  const bool         computeFirstOrder
+    = this->m_CalculateOrthonormalityCondition || this->m_CalculatePropernessCondition;
+
+  std::vector< OffsetValueType > neighbours( 27 );
+  MeasureType                    linearityConditionValue      = NumericTraits< MeasureType >::Zero;
+  MeasureType                    orthonormalityConditionValue = NumericTraits< MeasureType >::Zero;
+  MeasureType                    propernessConditionValue     = NumericTraits< MeasureType >::Zero;
+
+  /** The filtered coefficients, with room for the 3D case. */
+  ScalarType mu[ 9 ][ 3 ];
+  for( unsigned int op = 0; op < 9; ++op )
+  {
+    mu[ op ][ 0 ] = mu[ op ][ 1 ] = mu[ op ][ 2 ] = NumericTraits< ScalarType >::Zero;
+  }
+
+  /** When only the values are needed, the derivative parts are written to
+   * a scratch buffer that is never read.
+   */
+  ScalarType scratchParts[ 2 * 3 * 3 + 3 * 6 ];
+
+  for( SizeValueType v = begin; v < end; ++v )
   {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    ScalarType valueOC;
-    while( !itOCp[ 0 ][ 0 ].IsAtEnd() )
+    ScalarType * partsOC = this->m_ComputeConditionDerivativeParts
+      ? &this->m_ConditionParts[ v * numberOfParts ] : scratchParts;
+    ScalarType * partsPC = partsOC + ImageDimension * ImageDimension;
+    ScalarType * partsLC = partsPC + ImageDimension * ImageDimension;
+
+    /** Grid points that are not rigid do not contribute. */
+    const ScalarType c = this->m_RigidityCoefficientBuffer[ v ];
+    if( c == 0.0 )
     {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if( ImageDimension == 3 )
+      std::fill( partsOC, partsOC + numberOfParts, NumericTraits< ScalarType >::Zero );
+      continue;
+    }
+
+    /** Filter the B-spline coefficients at this grid point. */
+    this->GetNeighbourhoodIndices( v, &neighbours[ 0 ] );
+    for( unsigned int op = 0; op < 9; ++op )
+    {
+      const StencilType & stencil = this->m_Stencils[ op ];
+      if( stencil.empty() || ( op < 3 && !computeFirstOrder ) )
+      {
+        continue;
+      }
+      for( unsigned int i = 0; i < ImageDimension; i++ )
       {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
+        const CoefficientPixelType * coefficients = this->m_CoefficientBuffers[ i ];
+        ScalarType                   tmp          = NumericTraits< ScalarType >::Zero;
+        for( unsigned int k = 0; k < stencil.size(); ++k )
+        {
+          tmp += stencil[ k ].second * coefficients[ neighbours[ stencil[ k ].first ] ];
+        }
+        mu[ op ][ i ] = tmp;
       }
+    }
+
+    /** Copy values: this improves code readability. */
+    const ScalarType mu1_A = mu[ 0 ][ 0 ]; const ScalarType mu2_A = mu[ 0 ][ 1 ]; const ScalarType mu3_A = mu[ 0 ][ 2 ];
+    const ScalarType mu1_B = mu[ 1 ][ 0 ]; const ScalarType mu2_B = mu[ 1 ][ 1 ]; const ScalarType mu3_B = mu[ 1 ][ 2 ];
+    const ScalarType mu1_C = mu[ 2 ][ 0 ]; const ScalarType mu2_C = mu[ 2 ][ 1 ]; const ScalarType mu3_C = mu[ 2 ][ 2 ];
+
+    /** Do the calculation of the orthonormality subparts. */
+    if( this->m_CalculateOrthonormalityCondition )
+    {
+      ScalarType valueOC;
       if( ImageDimension == 2 )
       {
         /** Calculate the value of the orthonormality condition. */
-        this->m_OrthonormalityConditionValue
-          += it_RCI.Get() * (
+        orthonormalityConditionValue
+          += c * (
           std::pow(
           +( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
           + mu2_A * mu2_A
@@ -1237,7 +1053,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           - 2.0 * ( 1.0 + mu1_A )
           + mu1_B * mu1_B * ( 1.0 + mu1_A )
           + mu2_A * ( 1.0 + mu2_B ) * mu1_B;
-        itOCp[ 0 ][ 0 ].Set( 2.0 * valueOC );
+        partsOC[ 0 * ImageDimension + 0 ] = 2.0 * c * valueOC;
         /** mu1, part2*/
         valueOC
           = +mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
@@ -1245,7 +1061,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + 2.0 * mu1_B * mu1_B * mu1_B
           + 2.0 * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
           - 2.0 * mu1_B;
-        itOCp[ 0 ][ 1 ].Set( 2.0 * valueOC );
+        partsOC[ 0 * ImageDimension + 1 ] = 2.0 * c * valueOC;
         /** mu2, part 1 */
         valueOC
           = +2.0 * mu2_A * mu2_A * mu2_A
@@ -1253,7 +1069,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           - 2.0 * mu2_A
           + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
           + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B );
-        itOCp[ 1 ][ 0 ].Set( 2.0 * valueOC );
+        partsOC[ 1 * ImageDimension + 0 ] = 2.0 * c * valueOC;
         /** mu2, part2*/
         valueOC
           = +mu2_A * mu2_A * ( 1.0 + mu2_B )
@@ -1261,13 +1077,13 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
           + 2.0 * mu1_B * mu1_B * ( 1.0 + mu2_B )
           - 2.0 * ( 1.0 + mu2_B );
-        itOCp[ 1 ][ 1 ].Set( 2.0 * valueOC );
+        partsOC[ 1 * ImageDimension + 1 ] = 2.0 * c * valueOC;
       } // end if dim == 2
       else if( ImageDimension == 3 )
       {
         /** Calculate the value of the orthonormality condition. */
-        this->m_OrthonormalityConditionValue
-          += it_RCI.Get() * (
+        orthonormalityConditionValue
+          += c * (
           std::pow(
           +( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
           + mu2_A * mu2_A
@@ -1314,7 +1130,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + ( 1.0 + mu1_A ) * mu1_C * mu1_C
           + mu1_C * mu2_A * mu2_C
           + mu1_C * mu3_A * ( 1.0 + mu3_C );
-        itOCp[ 0 ][ 0 ].Set( 2.0 * valueOC );
+        partsOC[ 0 * ImageDimension + 0 ] = 2.0 * c * valueOC;
         /** mu1, part2 */
         valueOC
           = +( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu1_B
@@ -1327,7 +1143,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + mu1_B * mu1_C * mu1_C
           + mu1_C * ( 1.0 + mu2_B ) * mu2_C
           + mu1_C * mu3_B * ( 1.0 + mu3_C );
-        itOCp[ 0 ][ 1 ].Set( 2.0 * valueOC );
+        partsOC[ 0 * ImageDimension + 1 ] = 2.0 * c * valueOC;
         /** mu1, part3 */
         valueOC
           = +( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu1_C
@@ -1340,7 +1156,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + 2.0 * mu1_C * mu2_C * mu2_C
           + 2.0 * mu1_C * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
           - 2.0 * mu1_C;
-        itOCp[ 0 ][ 2 ].Set( 2.0 * valueOC );
+        partsOC[ 0 * ImageDimension + 2 ] = 2.0 * c * valueOC;
         /** mu2, part 1 */
         valueOC
           = +2.0 * mu2_A * mu2_A * mu2_A
@@ -1353,7 +1169,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + mu2_A * mu2_C * mu2_C
           + ( 1.0 + mu1_A ) * mu1_C * mu2_C
           + mu2_C * mu3_A * ( 1.0 + mu3_C );
-        itOCp[ 1 ][ 0 ].Set( 2.0 * valueOC );
+        partsOC[ 1 * ImageDimension + 0 ] = 2.0 * c * valueOC;
         /** mu2, part2 */
         valueOC
           = +mu2_A * mu2_A * ( 1.0 + mu2_B )
@@ -1366,7 +1182,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + ( 1.0 + mu2_B ) * mu2_C * mu2_C
           + mu1_B * mu1_C * mu2_C
           + mu2_C * mu3_B * ( 1.0 + mu3_C );
-        itOCp[ 1 ][ 1 ].Set( 2.0 * valueOC );
+        partsOC[ 1 * ImageDimension + 1 ] = 2.0 * c * valueOC;
         /** mu2, part 3 */
         valueOC
           = +mu2_A * mu2_A * mu2_C
@@ -1379,7 +1195,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + 2.0 * mu1_C * mu1_C * mu2_C
           + 2.0 * mu2_C * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
           - 2.0 * mu2_C;
-        itOCp[ 1 ][ 2 ].Set( 2.0 * valueOC );
+        partsOC[ 1 * ImageDimension + 2 ] = 2.0 * c * valueOC;
         /** mu3, part 1 */
         valueOC
           = +2.0 * mu3_A * mu3_A * mu3_A
@@ -1392,7 +1208,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + mu3_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
           + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu3_C )
           + mu2_C * mu2_A * ( 1.0 + mu3_C );
-        itOCp[ 2 ][ 0 ].Set( 2.0 * valueOC );
+        partsOC[ 2 * ImageDimension + 0 ] = 2.0 * c * valueOC;
         /** mu3, part2 */
         valueOC
           = +mu3_A * mu3_A * mu3_B
@@ -1405,7 +1221,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + mu3_B * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
           + mu1_B * mu1_C * ( 1.0 + mu3_C )
           + mu2_C * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C );
-        itOCp[ 2 ][ 1 ].Set( 2.0 * valueOC );
+        partsOC[ 2 * ImageDimension + 1 ] = 2.0 * c * valueOC;
         /** mu3, part 3 */
         valueOC
           = +mu3_A * mu3_A * ( 1.0 + mu3_C )
@@ -1418,58 +1234,23 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + 2.0 * mu1_C * mu1_C * ( 1.0 + mu3_C )
           + 2.0 * mu2_C * mu2_C * ( 1.0 + mu3_C )
           - 2.0 * ( 1.0 + mu3_C );
-        itOCp[ 2 ][ 2 ].Set( 2.0 * valueOC );
+        partsOC[ 2 * ImageDimension + 2 ] = 2.0 * c * valueOC;
       } // end if dim == 3
+    }
+    else
+    {
+      std::fill( partsOC, partsOC + ImageDimension * ImageDimension, NumericTraits< ScalarType >::Zero );
+    }
 
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ]; ++itB[ i ];
-        if( ImageDimension == 3 ) { ++itC[ i ]; }
-        for( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++itOCp[ i ][ j ];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
-  } // end if do orthonormality
-
-  /** TASK 4B:
-   * Do the calculation of the properness parts.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    if( ImageDimension == 3 ) { itC[ i ].GoToBegin(); }
-  }
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculatePropernessCondition )
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    ScalarType valuePC;
-    while( !itPCp[ 0 ][ 0 ].IsAtEnd() )
+    /** Do the calculation of the properness subparts. */
+    if( this->m_CalculatePropernessCondition )
     {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if( ImageDimension == 3 )
-      {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
-      }
+      ScalarType valuePC;
       if( ImageDimension == 2 )
       {
         /** Calculate the value of the properness condition. */
-        this->m_PropernessConditionValue
-          += it_RCI.Get() * (
+        propernessConditionValue
+          += c * (
           std::pow(
           +( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
           - mu2_A * mu1_B
@@ -1482,31 +1263,31 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           = +( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A )
           - mu2_A * ( 1.0 + mu2_B ) * mu1_B
           - ( 1.0 + mu2_B );
-        itPCp[ 0 ][ 0 ].Set( 2.0 * valuePC );
+        partsPC[ 0 * ImageDimension + 0 ] = 2.0 * c * valuePC;
         /** mu1, part 2 */
         valuePC
           = +mu2_A
           + mu2_A * mu2_A * mu1_B
           - mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A );
-        itPCp[ 0 ][ 1 ].Set( 2.0 * valuePC );
+        partsPC[ 0 * ImageDimension + 1 ] = 2.0 * c * valuePC;
         /** mu2, part 1 */
         valuePC
           = +mu1_B * mu1_B * mu2_A
           - mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
           + mu1_B;
-        itPCp[ 1 ][ 0 ].Set( 2.0 * valuePC );
+        partsPC[ 1 * ImageDimension + 0 ] = 2.0 * c * valuePC;
         /** mu2, part 2 */
         valuePC
           = -( 1.0 + mu1_A )
           + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
           - mu1_B * ( 1.0 + mu1_A ) * mu2_A;
-        itPCp[ 1 ][ 1 ].Set( 2.0 * valuePC );
+        partsPC[ 1 * ImageDimension + 1 ] = 2.0 * c * valuePC;
       } // end if dim == 2
       else if( ImageDimension == 3 )
       {
         /** Calculate the value of the properness condition. */
-        this->m_PropernessConditionValue
-          += it_RCI.Get() * (
+        propernessConditionValue
+          += c * (
           std::pow(
           -mu1_C * ( 1.0 + mu2_B ) * mu3_A
           + mu1_B * mu2_C * mu3_A
@@ -1533,7 +1314,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + mu2_C * mu3_B
           - mu1_B * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
           - ( 1.0 + mu2_B ) * ( 1.0 + mu3_C );
-        itPCp[ 0 ][ 0 ].Set( 2.0 * valuePC );
+        partsPC[ 0 * ImageDimension + 0 ] = 2.0 * c * valuePC;
         /** mu1, part 2 */
         valuePC
           = +mu1_B * mu2_C * mu2_C * mu3_A * mu3_A
@@ -1549,7 +1330,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + ( 1.0 + mu1_A ) * mu2_A * mu2_C * mu3_B * ( 1.0 + mu3_C )
           - ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
           + mu2_A * ( 1.0 + mu3_C );
-        itPCp[ 0 ][ 1 ].Set( 2.0 * valuePC );
+        partsPC[ 0 * ImageDimension + 1 ] = 2.0 * c * valuePC;
         /** mu1, part 3 */
         valuePC
           = +mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * mu3_A
@@ -1565,7 +1346,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           - mu1_B * mu2_A * mu2_A * mu3_B * ( 1.0 + mu3_C )
           + ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
           - mu2_A * mu3_B;
-        itPCp[ 0 ][ 2 ].Set( 2.0 * valuePC );
+        partsPC[ 0 * ImageDimension + 2 ] = 2.0 * c * valuePC;
         /** mu2, part 1 */
         valuePC
           = +mu1_C * mu1_C * mu2_A * mu3_B * mu3_B
@@ -1581,7 +1362,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_B * ( 1.0 + mu3_C )
           - ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
           + mu1_B * ( 1.0 + mu3_C );
-        itPCp[ 1 ][ 0 ].Set( 2.0 * valuePC );
+        partsPC[ 1 * ImageDimension + 0 ] = 2.0 * c * valuePC;
         /** mu2, part 2 */
         valuePC
           = +mu1_C * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_A
@@ -1597,7 +1378,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu3_B * ( 1.0 + mu3_C )
           - ( 1.0 + mu1_A ) * mu1_B * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
           - ( 1.0 + mu1_A ) * ( 1.0 + mu3_C );
-        itPCp[ 1 ][ 1 ].Set( 2.0 * valuePC );
+        partsPC[ 1 * ImageDimension + 1 ] = 2.0 * c * valuePC;
         /** mu2, part 3 */
         valuePC
           = +mu1_B * mu1_B * mu2_C * mu3_A * mu3_A
@@ -1613,7 +1394,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu3_B * ( 1.0 + mu3_C )
           - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
           + ( 1.0 + mu1_A ) * mu3_B;
-        itPCp[ 1 ][ 2 ].Set( 2.0 * valuePC );
+        partsPC[ 1 * ImageDimension + 2 ] = 2.0 * c * valuePC;
         /** mu3, part 1 */
         valuePC
           = +mu1_C * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A
@@ -1629,7 +1410,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           - mu1_B * mu1_B * mu2_A * mu2_C * ( 1.0 + mu3_C )
           + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu2_C * ( 1.0 + mu3_C )
           + mu1_B * mu2_C;
-        itPCp[ 2 ][ 0 ].Set( 2.0 * valuePC );
+        partsPC[ 2 * ImageDimension + 0 ] = 2.0 * c * valuePC;
         /** mu3, part 2 */
         valuePC
           = +mu1_C * mu1_C * mu2_A * mu2_A * mu3_B
@@ -1645,7 +1426,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu2_C * ( 1.0 + mu3_C )
           - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * ( 1.0 + mu3_C )
           + ( 1.0 + mu1_A ) * mu2_C;
-        itPCp[ 2 ][ 1 ].Set( 2.0 * valuePC );
+        partsPC[ 2 * ImageDimension + 1 ] = 2.0 * c * valuePC;
         /** mu3, part 3 */
         valuePC
           = +mu1_B * mu1_B * mu2_A * mu2_A * ( 1.0 + mu3_C )
@@ -1661,453 +1442,150 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
           - 2.0 * ( 1.0 + mu1_A ) * mu1_B * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
           + mu1_B * mu2_A
           - ( 1.0 + mu1_A ) * ( 1.0 + mu2_B );
-        itPCp[ 2 ][ 2 ].Set( 2.0 * valuePC );
+        partsPC[ 2 * ImageDimension + 2 ] = 2.0 * c * valuePC;
       } // end if dim == 3
-
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ]; ++itB[ i ];
-        if( ImageDimension == 3 ) { ++itC[ i ]; }
-        for( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++itPCp[ i ][ j ];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
-  } // end if do properness
-
-  /** TASK 4C:
-   * Do the calculation of the linearity parts.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculateLinearityCondition )
-  {
-    while( !itLCp[ 0 ][ 0 ].IsAtEnd() )
+    }
+    else
     {
-      /** Linearity condition part. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        /** Calculate the value of the linearity condition. */
-        this->m_LinearityConditionValue
-          += it_RCI.Get() * (
-          +itD[ i ].Get() * itD[ i ].Get()
-          + itE[ i ].Get() * itE[ i ].Get()
-          + itG[ i ].Get() * itG[ i ].Get()
-          );
-        if( ImageDimension == 3 )
-        {
-          this->m_LinearityConditionValue
-            += it_RCI.Get() * (
-            +itF[ i ].Get() * itF[ i ].Get()
-            + itH[ i ].Get() * itH[ i ].Get()
-            + itI[ i ].Get() * itI[ i ].Get()
-            );
-        }
-      } // end loop over i
-
-      /** Calculate the derivative of the linearity condition. */
-      if( ImageDimension == 2 )
-      {
-        itLCp[ 0 ][ 0 ].Set( 2.0 * itD[ 0 ].Get() );
-        itLCp[ 0 ][ 1 ].Set( 2.0 * itE[ 0 ].Get() );
-        itLCp[ 0 ][ 2 ].Set( 2.0 * itG[ 0 ].Get() );
-        itLCp[ 1 ][ 0 ].Set( 2.0 * itD[ 1 ].Get() );
-        itLCp[ 1 ][ 1 ].Set( 2.0 * itE[ 1 ].Get() );
-        itLCp[ 1 ][ 2 ].Set( 2.0 * itG[ 1 ].Get() );
-      } // end if dim == 2
-      else if( ImageDimension == 3 )
-      {
-        itLCp[ 0 ][ 0 ].Set( 2.0 * itD[ 0 ].Get() );
-        itLCp[ 0 ][ 1 ].Set( 2.0 * itE[ 0 ].Get() );
-        itLCp[ 0 ][ 2 ].Set( 2.0 * itG[ 0 ].Get() );
-        itLCp[ 0 ][ 3 ].Set( 2.0 * itF[ 0 ].Get() );
-        itLCp[ 0 ][ 4 ].Set( 2.0 * itH[ 0 ].Get() );
-        itLCp[ 0 ][ 5 ].Set( 2.0 * itI[ 0 ].Get() );
-        itLCp[ 1 ][ 0 ].Set( 2.0 * itD[ 1 ].Get() );
-        itLCp[ 1 ][ 1 ].Set( 2.0 * itE[ 1 ].Get() );
-        itLCp[ 1 ][ 2 ].Set( 2.0 * itG[ 1 ].Get() );
-        itLCp[ 1 ][ 3 ].Set( 2.0 * itF[ 1 ].Get() );
-        itLCp[ 1 ][ 4 ].Set( 2.0 * itH[ 1 ].Get() );
-        itLCp[ 1 ][ 5 ].Set( 2.0 * itI[ 1 ].Get() );
-        itLCp[ 2 ][ 0 ].Set( 2.0 * itD[ 2 ].Get() );
-        itLCp[ 2 ][ 1 ].Set( 2.0 * itE[ 2 ].Get() );
-        itLCp[ 2 ][ 2 ].Set( 2.0 * itG[ 2 ].Get() );
-        itLCp[ 2 ][ 3 ].Set( 2.0 * itF[ 2 ].Get() );
-        itLCp[ 2 ][ 4 ].Set( 2.0 * itH[ 2 ].Get() );
-        itLCp[ 2 ][ 5 ].Set( 2.0 * itI[ 2 ].Get() );
-      } // end if dim == 3
+      std::fill( partsPC, partsPC + ImageDimension * ImageDimension, NumericTraits< ScalarType >::Zero );
+    }
 
-      /** Increase all iterators. */
+    /** Do the calculation of the linearity parts. */
+    if( this->m_CalculateLinearityCondition )
+    {
       for( unsigned int i = 0; i < ImageDimension; i++ )
       {
-        ++itD[ i ]; ++itE[ i ]; ++itG[ i ];
-        if( ImageDimension == 3 )
-        {
-          ++itF[ i ]; ++itH[ i ]; ++itI[ i ];
-        }
+        /** Calculate the value and the derivative of the linearity condition. */
         for( unsigned int j = 0; j < NofLParts; j++ )
         {
-          ++itLCp[ i ][ j ];
+          const ScalarType muL = mu[ linearityOperators[ j ] ][ i ];
+          linearityConditionValue     += c * muL * muL;
+          partsLC[ i * NofLParts + j ] = 2.0 * c * muL;
         }
       }
-      ++it_RCI;
-
-    } // end while
-  } // end if do linearity
-
-  /** TASK 5:
-   * Do the actual calculation of the rigidity penalty term value.
-   *
-   ************************************************************************* */
-
-  /** Calculate the rigidity penalty term value. */
-  if( this->m_CalculateLinearityCondition )
-  {
-    this->m_LinearityConditionValue /= rigidityCoefficientSum;
-  }
-  if( this->m_CalculateOrthonormalityCondition )
-  {
-    this->m_OrthonormalityConditionValue /= rigidityCoefficientSum;
-  }
-  if( this->m_CalculatePropernessCondition )
-  {
-    this->m_PropernessConditionValue /= rigidityCoefficientSum;
-  }
-
-  if( this->m_UseLinearityCondition )
-  {
-    this->m_RigidityPenaltyTermValue
-      += this->m_LinearityConditionWeight * this->m_LinearityConditionValue;
-  }
-  if( this->m_UseOrthonormalityCondition )
-  {
-    this->m_RigidityPenaltyTermValue
-      += this->m_OrthonormalityConditionWeight * this->m_OrthonormalityConditionValue;
-  }
-  if( this->m_UsePropernessCondition )
-  {
-    this->m_RigidityPenaltyTermValue
-      += this->m_PropernessConditionWeight * this->m_PropernessConditionValue;
-  }
-  value = this->m_RigidityPenaltyTermValue;
-
-  /** TASK 6:
-   * Create filtered versions of the subparts.
-   * Create all necessary iterators and operators.
-   ************************************************************************* */
-
-  /** Create filtered orthonormality, properness and linearity parts. */
-  std::vector< CoefficientImagePointer > OCpartsF( ImageDimension );
-  std::vector< CoefficientImagePointer > PCpartsF( ImageDimension );
-  std::vector< CoefficientImagePointer > LCpartsF( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    OCpartsF[ i ] = CoefficientImageType::New();
-    OCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    OCpartsF[ i ]->Allocate();
-    PCpartsF[ i ] = CoefficientImageType::New();
-    PCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    PCpartsF[ i ]->Allocate();
-    LCpartsF[ i ] = CoefficientImageType::New();
-    LCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    LCpartsF[ i ]->Allocate();
-  }
-
-  /** Create neighborhood iterators over the subparts. */
-  std::vector< std::vector< NeighborhoodIteratorType > > nitOCp( ImageDimension );
-  std::vector< std::vector< NeighborhoodIteratorType > > nitPCp( ImageDimension );
-  std::vector< std::vector< NeighborhoodIteratorType > > nitLCp( ImageDimension );
-  RadiusType                                             radius;
-  radius.Fill( 1 );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    nitOCp[ i ].resize( ImageDimension );
-    nitPCp[ i ].resize( ImageDimension );
-    nitLCp[ i ].resize( NofLParts );
-    for( unsigned int j = 0; j < ImageDimension; j++ )
-    {
-      nitOCp[ i ][ j ] = NeighborhoodIteratorType( radius,
-        OCparts[ i ][ j ], OCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      nitOCp[ i ][ j ].GoToBegin();
-      nitPCp[ i ][ j ] = NeighborhoodIteratorType( radius,
-        PCparts[ i ][ j ], PCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      nitPCp[ i ][ j ].GoToBegin();
     }
-    for( unsigned int j = 0; j < NofLParts; j++ )
+    else
     {
-      nitLCp[ i ][ j ] = NeighborhoodIteratorType( radius,
-        LCparts[ i ][ j ], LCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      nitLCp[ i ][ j ].GoToBegin();
+      std::fill( partsLC, partsLC + ImageDimension * NofLParts, NumericTraits< ScalarType >::Zero );
     }
-  }
 
-  /** Create iterators over the filtered parts. */
-  std::vector< CoefficientImageIteratorType > itOCpf( ImageDimension );
-  std::vector< CoefficientImageIteratorType > itPCpf( ImageDimension );
-  std::vector< CoefficientImageIteratorType > itLCpf( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itOCpf[ i ] = CoefficientImageIteratorType( OCpartsF[ i ],
-      OCpartsF[ i ]->GetLargestPossibleRegion() );
-    itOCpf[ i ].GoToBegin();
-    itPCpf[ i ] = CoefficientImageIteratorType( PCpartsF[ i ],
-      PCpartsF[ i ]->GetLargestPossibleRegion() );
-    itPCpf[ i ].GoToBegin();
-    itLCpf[ i ] = CoefficientImageIteratorType( LCpartsF[ i ],
-      LCpartsF[ i ]->GetLargestPossibleRegion() );
-    itLCpf[ i ].GoToBegin();
-  }
+  } // end for loop over the grid points
 
-  /** Create a neigborhood iterator over the rigidity image. */
-  NeighborhoodIteratorType nit_RCI( radius, this->m_RigidityCoefficientImage,
-  this->m_RigidityCoefficientImage->GetLargestPossibleRegion() );
-  nit_RCI.GoToBegin();
-  unsigned int neighborhoodSize = nit_RCI.Size();
+  /** Store the values of this thread. */
+  this->m_RigidityPenaltyTermPerThreadVariables[ threadId ].st_LinearityConditionValue      = linearityConditionValue;
+  this->m_RigidityPenaltyTermPerThreadVariables[ threadId ].st_OrthonormalityConditionValue = orthonormalityConditionValue;
+  this->m_RigidityPenaltyTermPerThreadVariables[ threadId ].st_PropernessConditionValue     = propernessConditionValue;
 
-  /** Create ND operators. */
-  NeighborhoodType Operator_A, Operator_B, Operator_C,
-    Operator_D, Operator_E, Operator_F,
-    Operator_G, Operator_H, Operator_I;
-  this->CreateNDOperator( Operator_A, "FA", spacing );
-  this->CreateNDOperator( Operator_B, "FB", spacing );
-  if( ImageDimension == 3 )
-  {
-    this->CreateNDOperator( Operator_C, "FC", spacing );
-  }
+} // end ThreadedComputeConditionParts()
 
-  if( this->m_CalculateLinearityCondition )
-  {
-    this->CreateNDOperator( Operator_D, "FD", spacing );
-    this->CreateNDOperator( Operator_E, "FE", spacing );
-    this->CreateNDOperator( Operator_G, "FG", spacing );
-    if( ImageDimension == 3 )
-    {
-      this->CreateNDOperator( Operator_F, "FF", spacing );
-      this->CreateNDOperator( Operator_H, "FH", spacing );
-      this->CreateNDOperator( Operator_I, "FI", spacing );
-    }
-  }
 
-  /** TASK 7A:
-   * Calculate the filtered versions of the orthonormality subparts.
-   * These are F_A * {subpart_0} + F_B * {subpart_1},
-   * and (for 3D) + F_C * {subpart_2}, for all dimensions.
-   ************************************************************************* */
-
-  if( this->m_CalculateOrthonormalityCondition )
-  {
-    while( !itOCpf[ 0 ].IsAtEnd() )
-    {
-      /** Create and reset tmp with zeros. */
-      std::vector< double > tmp( ImageDimension, 0.0 );
+/**
+ * ******************* ComputeDerivativeThreaderCallback *******************
+ */
 
-      /** Loop over all dimensions. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        /** Loop over the neighborhood. */
-        for( unsigned int k = 0; k < neighborhoodSize; ++k )
-        {
-          /** Calculation of the inner product. */
-          tmp[ i ] += Operator_A.GetElement( k )      // FA *
-            * nitOCp[ i ][ 0 ].GetPixel( k )          // subpart[ i ][ 0 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          tmp[ i ] += Operator_B.GetElement( k )      // FB *
-            * nitOCp[ i ][ 1 ].GetPixel( k )          // subpart[ i ][ 1 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          if( ImageDimension == 3 )
-          {
-            tmp[ i ] += Operator_C.GetElement( k )    // FC *
-              * nitOCp[ i ][ 2 ].GetPixel( k )        // subpart[ i ][ 2 ]
-              * nit_RCI.GetPixel( k );                // c(k)
-          }
-        } // end loop over neighborhood
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_TYPE
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeDerivativeThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
 
-        /** Set the result in the filtered part. */
-        itOCpf[ i ].Set( tmp[ i ] );
+  RigidityPenaltyTermMultiThreaderParameterType * temp
+    = static_cast< RigidityPenaltyTermMultiThreaderParameterType * >( infoStruct->UserData );
 
-      } // end loop over dimension i
+  temp->m_Metric->ThreadedComputeDerivative( threadID );
 
-      /** Increase all iterators. */
-      ++nit_RCI;
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itOCpf[ i ];
-        for( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++nitOCp[ i ][ j ];
-        }
-      }
-    } // end while
-  } // end if do orthonormality
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
 
-  /** TASK 7B:
-   * Calculate the filtered versions of the properness subparts.
-   * These are F_A * {subpart_0} + F_B * {subpart_1},
-   * and (for 3D) + F_C * {subpart_2}, for all dimensions.
-   ************************************************************************* */
+} // end ComputeDerivativeThreaderCallback()
 
-  nit_RCI.GoToBegin();
-  if( this->m_CalculatePropernessCondition )
-  {
-    while( !itPCpf[ 0 ].IsAtEnd() )
-    {
-      /** Create and reset tmp with zeros. */
-      std::vector< double > tmp( ImageDimension, 0.0 );
 
-      /** Loop over all dimensions. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        /** Loop over the neighborhood. */
-        for( unsigned int k = 0; k < neighborhoodSize; ++k )
-        {
-          /** Calculation of the inner product. */
-          tmp[ i ] += Operator_A.GetElement( k )      // FA *
-            * nitPCp[ i ][ 0 ].GetPixel( k )          // subpart[ i ][ 0 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          tmp[ i ] += Operator_B.GetElement( k )      // FB *
-            * nitPCp[ i ][ 1 ].GetPixel( k )          // subpart[ i ][ 1 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          if( ImageDimension == 3 )
-          {
-            tmp[ i ] += Operator_C.GetElement( k )    // FC *
-              * nitPCp[ i ][ 2 ].GetPixel( k )        // subpart[ i ][ 2 ]
-              * nit_RCI.GetPixel( k );                // c(k)
-          }
-        } // end loop over neighborhood
+/**
+ * ******************* ThreadedComputeDerivative *******************
+ */
 
-        /** Set the result in the filtered part. */
-        itPCpf[ i ].Set( tmp[ i ] );
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedComputeDerivative( ThreadIdType threadId ) const
+{
+  /** Get the range of grid points of this thread. */
+  const SizeValueType numberOfGridPoints = this->m_NumberOfGridPoints;
+  const SizeValueType numberOfThreads    = this->m_NumberOfRigidityWorkUnits;
+  const SizeValueType begin              = numberOfGridPoints * threadId / numberOfThreads;
+  const SizeValueType end                = numberOfGridPoints * ( threadId + 1 ) / numberOfThreads;
 
-      } // end loop over dimension i
+  const unsigned int NofLParts = 3 * ImageDimension - 3;
+  const unsigned int numberOfParts
+    = 2 * ImageDimension * ImageDimension + ImageDimension * NofLParts;
+  const unsigned int linearityOperators[ 6 ] = { 3, 4, 6, 5, 7, 8 };
 
-      /** Increase all iterators. */
-      ++nit_RCI;
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itPCpf[ i ];
-        for( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++nitPCp[ i ][ j ];
-        }
-      }
-    } // end while
-  } // end if do properness
+  const ScalarType * parts                     = &this->m_ConditionParts[ 0 ];
+  const ScalarType   rigidityCoefficientSum    = this->m_RigidityCoefficientSum;
+  const double       rigidityCoefficientSumSqr = rigidityCoefficientSum * rigidityCoefficientSum;
 
-  /** TASK 7C:
-   * Calculate the filtered versions of the linearity subparts.
-   * These are sum_{i=1}^{NofLParts} F_{D,E,G,F,H,I} * {subpart_i}.
-   ************************************************************************* */
+  std::vector< OffsetValueType > neighbours( 27 );
+  MeasureType                    gradMagLC = NumericTraits< MeasureType >::Zero;
+  MeasureType                    gradMagOC = NumericTraits< MeasureType >::Zero;
+  MeasureType                    gradMagPC = NumericTraits< MeasureType >::Zero;
 
-  nit_RCI.GoToBegin();
-  if( this->m_CalculateLinearityCondition )
+  for( SizeValueType v = begin; v < end; ++v )
   {
-    while( !itLCpf[ 0 ].IsAtEnd() )
-    {
-      /** Create and reset tmp with zeros. */
-      std::vector< double > tmp( ImageDimension, 0.0 );
+    this->GetNeighbourhoodIndices( v, &neighbours[ 0 ] );
 
-      /** Loop over all dimensions. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+      /** Calculate the filtered versions of the orthonormality and properness
+       * subparts. These are F_A * {subpart_0} + F_B * {subpart_1},
+       * and (for 3D) + F_C * {subpart_2}. The subparts already include c(k).
+       */
+      ScalarType filteredOC = NumericTraits< ScalarType >::Zero;
+      ScalarType filteredPC = NumericTraits< ScalarType >::Zero;
+      for( unsigned int j = 0; j < ImageDimension; j++ )
       {
-        /** Loop over the neighborhood. */
-        for( unsigned int k = 0; k < neighborhoodSize; ++k )
+        const StencilType & stencil = this->m_AdjointStencils[ j ];
+        const unsigned int  partOC  = i * ImageDimension + j;
+        const unsigned int  partPC  = partOC + ImageDimension * ImageDimension;
+        for( unsigned int k = 0; k < stencil.size(); ++k )
         {
-          /** Calculation of the inner product. */
-          tmp[ i ] += Operator_D.GetElement( k )      // FD *
-            * nitLCp[ i ][ 0 ].GetPixel( k )          // subpart[ i ][ 0 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          tmp[ i ] += Operator_E.GetElement( k )      // FE *
-            * nitLCp[ i ][ 1 ].GetPixel( k )          // subpart[ i ][ 1 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          tmp[ i ] += Operator_G.GetElement( k )      // FG *
-            * nitLCp[ i ][ 2 ].GetPixel( k )          // subpart[ i ][ 1 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          if( ImageDimension == 3 )
-          {
-            tmp[ i ] += Operator_F.GetElement( k )    // FF *
-              * nitLCp[ i ][ 3 ].GetPixel( k )        // subpart[ i ][ 1 ]
-              * nit_RCI.GetPixel( k );                // c(k)
-            tmp[ i ] += Operator_H.GetElement( k )    // FH *
-              * nitLCp[ i ][ 4 ].GetPixel( k )        // subpart[ i ][ 1 ]
-              * nit_RCI.GetPixel( k );                // c(k)
-            tmp[ i ] += Operator_I.GetElement( k )    // FI *
-              * nitLCp[ i ][ 5 ].GetPixel( k )        // subpart[ i ][ 1 ]
-              * nit_RCI.GetPixel( k );                // c(k)
-          }
-        } // end loop over neighborhood
-
-        /** Set the result in the filtered part. */
-        itLCpf[ i ].Set( tmp[ i ] );
-
-      } // end loop over dimension i
+          const ScalarType * neighbourParts = parts + neighbours[ stencil[ k ].first ] * numberOfParts;
+          filteredOC += stencil[ k ].second * neighbourParts[ partOC ];
+          filteredPC += stencil[ k ].second * neighbourParts[ partPC ];
+        }
+      }
 
-      /** Increase all iterators. */
-      ++nit_RCI;
-      for( unsigned int i = 0; i < ImageDimension; i++ )
+      /** Calculate the filtered versions of the linearity subparts.
+       * These are sum_{i=1}^{NofLParts} F_{D,E,G,F,H,I} * {subpart_i}.
+       */
+      ScalarType filteredLC = NumericTraits< ScalarType >::Zero;
+      if( this->m_CalculateLinearityCondition )
       {
-        ++itLCpf[ i ];
         for( unsigned int j = 0; j < NofLParts; j++ )
         {
-          ++nitLCp[ i ][ j ];
+          const StencilType & stencil = this->m_AdjointStencils[ linearityOperators[ j ] ];
+          const unsigned int  partLC  = 2 * ImageDimension * ImageDimension + i * NofLParts + j;
+          for( unsigned int k = 0; k < stencil.size(); ++k )
+          {
+            filteredLC += stencil[ k ].second
+              * parts[ neighbours[ stencil[ k ].first ] * numberOfParts + partLC ];
+          }
         }
       }
-    } // end while
-  } // end if do linearity
 
-  /** TASK 8:
-   * Add it all to create the final derivative images.
-   ************************************************************************* */
-
-  /** Create derivative images, each holding a component of the vector field. */
-  std::vector< CoefficientImagePointer > derivativeImages( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    derivativeImages[ i ] = CoefficientImageType::New();
-    derivativeImages[ i ]->SetRegions( inputImages[ i ]->GetLargestPossibleRegion() );
-    derivativeImages[ i ]->Allocate();
-  }
-
-  /** Create iterators over the derivative images. */
-  std::vector< CoefficientImageIteratorType > itDIs( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itDIs[ i ] = CoefficientImageIteratorType( derivativeImages[ i ],
-      derivativeImages[ i ]->GetLargestPossibleRegion() );
-    itDIs[ i ].GoToBegin();
-    itOCpf[ i ].GoToBegin();
-    itPCpf[ i ].GoToBegin();
-    itLCpf[ i ].GoToBegin();
-  }
-
-  /** Do the addition. */
-  // NOTE: unlike the values, for the derivatives weight * derivative is returned.
-  MeasureType gradMagLC                 = NumericTraits< MeasureType >::Zero;
-  MeasureType gradMagOC                 = NumericTraits< MeasureType >::Zero;
-  MeasureType gradMagPC                 = NumericTraits< MeasureType >::Zero;
-  double      rigidityCoefficientSumSqr = rigidityCoefficientSum * rigidityCoefficientSum;
-  while( !itDIs[ 0 ].IsAtEnd() )
-  {
-    for( unsigned int i = 0; i < ImageDimension; i++ )
-    {
+      // NOTE: unlike the values, for the derivatives weight * derivative is returned.
       ScalarType tmpDIs = NumericTraits< ScalarType >::Zero;
 
       /** Compute gradient magnitude of LC. */
-      ScalarType tmpLC = this->m_LinearityConditionWeight * itLCpf[ i ].Get();
+      ScalarType tmpLC = this->m_LinearityConditionWeight * filteredLC;
       gradMagLC += tmpLC * tmpLC / rigidityCoefficientSumSqr;
 
       /** Compute gradient magnitude of OC. */
-      ScalarType tmpOC = this->m_OrthonormalityConditionWeight * itOCpf[ i ].Get();
+      ScalarType tmpOC = this->m_OrthonormalityConditionWeight * filteredOC;
       gradMagOC += tmpOC * tmpOC / rigidityCoefficientSumSqr;
 
       /** Compute gradient magnitude of PC. */
-      ScalarType tmpPC = this->m_PropernessConditionWeight * itPCpf[ i ].Get();
+      ScalarType tmpPC = this->m_PropernessConditionWeight * filteredPC;
       gradMagPC += tmpPC * tmpPC / rigidityCoefficientSumSqr;
 
       /** Compute derivative contribution. */
@@ -2123,32 +1601,17 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
       {
         tmpDIs += tmpPC;
       }
-      itDIs[ i ].Set( tmpDIs );
+      this->m_DerivativeBuffer[ i * numberOfGridPoints + v ] = tmpDIs / rigidityCoefficientSum;
 
-      /** Update iterators. */
-      ++itDIs[ i ]; ++itOCpf[ i ]; ++itPCpf[ i ]; ++itLCpf[ i ];
-    }
-  } // end while
+    } // end loop over dimension i
+  } // end for loop over the grid points
 
-  /** Set the gradient magnitudes of the several terms. */
-  this->m_LinearityConditionGradientMagnitude      = std::sqrt( gradMagLC );
-  this->m_OrthonormalityConditionGradientMagnitude = std::sqrt( gradMagOC );
-  this->m_PropernessConditionGradientMagnitude     = std::sqrt( gradMagPC );
+  /** Store the gradient magnitudes of this thread. */
+  this->m_RigidityPenaltyTermPerThreadVariables[ threadId ].st_LinearityConditionGradientMagnitude      = gradMagLC;
+  this->m_RigidityPenaltyTermPerThreadVariables[ threadId ].st_OrthonormalityConditionGradientMagnitude = gradMagOC;
+  this->m_RigidityPenaltyTermPerThreadVariables[ threadId ].st_PropernessConditionGradientMagnitude     = gradMagPC;
 
-  /** Rearrange to create a derivative. */
-  unsigned int j = 0;
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itDIs[ i ].GoToBegin();
-    while( !itDIs[ i ].IsAtEnd() )
-    {
-      derivative[ j ] = itDIs[ i ].Get() / rigidityCoefficientSum;
-      ++itDIs[ i ];
-      j++;
-    } // end while
-  } // end for
-
-} // end GetValueAndDerivative()
+} // end ThreadedComputeDerivative()
 
 
 /**
@@ -37,6 +37,7 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage,TMovingImage>
 ::SumSquaredTissueVolumeDifferenceImageToImageMetric()
 {
   this->SetUseImageSampler( true );
+  this->SetSupportsSparseDerivativeAccumulation( true );
   this->SetUseFixedImageLimiter( false );
   this->SetUseMovingImageLimiter( false );
   this->m_AirValue = -1000.0;
@@ -213,72 +214,66 @@ void SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage,TMovingImage
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  const unsigned long sampleContainerSize = sampleContainer->Size();
 
-  /** Get the samples for this thread. */
-  const unsigned long nSamplesPerThread
-    = static_cast<unsigned long>( std::ceil( static_cast<double>( sampleContainerSize )
-    / static_cast<double>( Self::GetNumberOfWorkUnits() ) ) );
-
-  unsigned long pos_begin = nSamplesPerThread * threadId;
-  unsigned long pos_end = nSamplesPerThread * (threadId + 1);
-  pos_begin = (pos_begin > sampleContainerSize) ? sampleContainerSize : pos_begin;
-  pos_end = (pos_end > sampleContainerSize) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend = sampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend += (int)pos_end;
-
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
+  /** Loop over the chunks of samples handed out by the scheduler. */
+  unsigned long pos_begin, pos_end;
+  while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = (*threader_fiter).Value().m_ImageCoordinates;
-    RealType movingImageValue;
-    MovingImagePointType mappedPoint;
+    /** Create iterator over the sample container. */
+    typename ImageSampleContainerType::ConstIterator threader_fiter;
+    typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+    typename ImageSampleContainerType::ConstIterator threader_fend = sampleContainer->Begin();
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    threader_fbegin += (int)pos_begin;
+    threader_fend += (int)pos_end;
 
-    /** Check if point is inside mask. */
-    if( sampleOk )
+    /** Loop over the fixed image to calculate the mean squares. */
+    for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
     {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = (*threader_fiter).Value().m_ImageCoordinates;
+      RealType movingImageValue;
+      MovingImagePointType mappedPoint;
 
-    /** Compute the moving image value M(T(x)) and check if
-    * the point is inside the moving image buffer.
-    */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative( mappedPoint, movingImageValue, 0 );
-    }
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
 
-    if( sampleOk )
-    {
-      numberOfPixelsCounted++;
+      /** Check if point is inside mask. */
+      if( sampleOk )
+      {
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast<RealType>( (*threader_fiter).Value().m_ImageValue );
+      /** Compute the moving image value M(T(x)) and check if
+      * the point is inside the moving image buffer.
+      */
+      if( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative( mappedPoint, movingImageValue, 0 );
+      }
 
-      /** Get the SpatialJacobian dT/dx. */
-      this->m_AdvancedTransform->GetSpatialJacobian( fixedPoint, spatialJac );
+      if( sampleOk )
+      {
+        numberOfPixelsCounted++;
 
-      /** Compute the determinant of the Transform Jacobian |dT/dx|. */
-      const RealType detjac = static_cast<RealType>( vnl_det( spatialJac.GetVnlMatrix() ) );
+        /** Get the fixed image value. */
+        const RealType & fixedImageValue = static_cast<RealType>( (*threader_fiter).Value().m_ImageValue );
 
-      /** The difference squared. */
-      const RealType diff = ( ( fixedImageValue - this->m_AirValue ) - detjac * ( movingImageValue - this->m_AirValue ) )
-        / ( this->m_TissueValue - this->m_AirValue );
-      measure += diff * diff;
+        /** Get the SpatialJacobian dT/dx. */
+        this->m_AdvancedTransform->GetSpatialJacobian( fixedPoint, spatialJac );
 
-    } // end if sampleOk
+        /** Compute the determinant of the Transform Jacobian |dT/dx|. */
+        const RealType detjac = static_cast<RealType>( vnl_det( spatialJac.GetVnlMatrix() ) );
 
-  } // end for loop over the image sample container
+        /** The difference squared. */
+        const RealType diff = ( ( fixedImageValue - this->m_AirValue ) - detjac * ( movingImageValue - this->m_AirValue ) )
+          / ( this->m_TissueValue - this->m_AirValue );
+        measure += diff * diff;
+
+      } // end if sampleOk
+
+    } // end for loop over the image sample container
+  } // end while over the sample chunks
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -542,96 +537,93 @@ SumSquaredTissueVolumeDifferenceImageToImageMetric<TFixedImage, TMovingImage>
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
-  const unsigned long sampleContainerSize = sampleContainer->Size();
-
-  /** Get the samples for this thread. */
-  const unsigned long nSamplesPerThread
-    = static_cast<unsigned long>(std::ceil(static_cast<double>( sampleContainerSize )
-      / static_cast<double>( Self::GetNumberOfWorkUnits() ) ) );
-
-  unsigned long pos_begin = nSamplesPerThread * threadId;
-  unsigned long pos_end = nSamplesPerThread * (threadId + 1);
-  pos_begin = (pos_begin > sampleContainerSize) ? sampleContainerSize : pos_begin;
-  pos_end = (pos_end > sampleContainerSize) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend = sampleContainer->Begin();
-  threader_fbegin += (int)pos_begin;
-  threader_fend += (int)pos_end;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
+  /** Loop over the chunks of samples handed out by the scheduler. */
+  unsigned long pos_begin, pos_end;
+  while( this->GetNextSampleChunk( threadId, pos_begin, pos_end ) )
   {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = (*threader_fiter).Value().m_ImageCoordinates;
-    RealType movingImageValue;
-    MovingImagePointType mappedPoint;
-    MovingImageDerivativeType movingImageDerivative;
+    /** Create iterator over the sample container. */
+    typename ImageSampleContainerType::ConstIterator threader_fiter;
+    typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
+    typename ImageSampleContainerType::ConstIterator threader_fend = sampleContainer->Begin();
+    threader_fbegin += (int)pos_begin;
+    threader_fend += (int)pos_end;
+
+    /** Loop over the fixed image to calculate the mean squares. */
+    for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
+    {
+      /** Read fixed coordinates and initialize some variables. */
+      const FixedImagePointType & fixedPoint = (*threader_fiter).Value().m_ImageCoordinates;
+      RealType movingImageValue;
+      MovingImagePointType mappedPoint;
+      MovingImageDerivativeType movingImageDerivative;
 
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+      /** Transform point and check if it is inside the B-spline support region. */
+      bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
 
-    /** Check if point is inside mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
+      /** Check if point is inside mask. */
+      if( sampleOk )
+      {
+        sampleOk = this->IsInsideMovingMask( mappedPoint );
+      }
 
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-    * the point is inside the moving image buffer.
-    */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative( mappedPoint, movingImageValue, &movingImageDerivative );
-    }
+      /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
+      * the point is inside the moving image buffer.
+      */
+      if( sampleOk )
+      {
+        sampleOk = this->EvaluateMovingImageValueAndDerivative( mappedPoint, movingImageValue, &movingImageDerivative );
+      }
 
-    if( sampleOk )
-    {
-      numberOfPixelsCounted++;
+      if( sampleOk )
+      {
+        numberOfPixelsCounted++;
 
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast<RealType>( (*threader_fiter).Value().m_ImageValue );
+        /** Get the fixed image value. */
+        const RealType & fixedImageValue = static_cast<RealType>( (*threader_fiter).Value().m_ImageValue );
 
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+        /** Get the TransformJacobian dT/dmu. */
+        this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
 
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct( jacobian, movingImageDerivative, imageJacobian );
+        /** Compute the inner products (dM/dx)^T (dT/dmu). */
+        this->EvaluateTransformJacobianInnerProduct( jacobian, movingImageDerivative, imageJacobian );
 
-      /** Get the SpatialJacobian dT/dx. */
-      this->m_AdvancedTransform->GetSpatialJacobian( fixedPoint, spatialJac );
+        /** Get the SpatialJacobian dT/dx. */
+        this->m_AdvancedTransform->GetSpatialJacobian( fixedPoint, spatialJac );
 
-      /** Compute the determinant of the Transform Jacobian |dT/dx|. */
-      const RealType detjac = static_cast<RealType>( vnl_det( spatialJac.GetVnlMatrix() ) );
+        /** Compute the determinant of the Transform Jacobian |dT/dx|. */
+        const RealType detjac = static_cast<RealType>( vnl_det( spatialJac.GetVnlMatrix() ) );
 
-      /** Compute the inverse spatialJacobian. */
-      inverseSpatialJacobian = spatialJac.GetInverse();
+        /** Compute the inverse spatialJacobian. */
+        inverseSpatialJacobian = spatialJac.GetInverse();
 
-      /** Compute the JacobianOfSpatialJacobian. */
-      this->m_AdvancedTransform->GetJacobianOfSpatialJacobian( fixedPoint, jacobianOfSpatialJacobian, nzji );
+        /** Compute the JacobianOfSpatialJacobian. */
+        this->m_AdvancedTransform->GetJacobianOfSpatialJacobian( fixedPoint, jacobianOfSpatialJacobian, nzji );
 
-      /** Compute the dot product of the inverse spatialJacobian and JacobianOfSpatialJacobian
-       * to support calculation of the JacobianOfSpatialJacobianDeterminant.
-       */
-      this->EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
-        jacobianOfSpatialJacobian, inverseSpatialJacobian, jacobianOfSpatialJacobianDeterminant );
+        /** Compute the dot product of the inverse spatialJacobian and JacobianOfSpatialJacobian
+         * to support calculation of the JacobianOfSpatialJacobianDeterminant.
+         */
+        this->EvaluateJacobianOfSpatialJacobianDeterminantInnerProduct(
+          jacobianOfSpatialJacobian, inverseSpatialJacobian, jacobianOfSpatialJacobianDeterminant );
 
-      /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(
-        fixedImageValue,
-        movingImageValue,
-        imageJacobian,
-        nzji,
-        detjac,
-        jacobianOfSpatialJacobianDeterminant,
-        measure,
-        derivative );
+        /** Compute this pixel's contribution to the measure and derivatives. */
+        this->UpdateValueAndDerivativeTerms(
+          fixedImageValue,
+          movingImageValue,
+          imageJacobian,
+          nzji,
+          detjac,
+          jacobianOfSpatialJacobianDeterminant,
+          measure,
+          derivative );
 
-    } // end if sampleOk
+        /** Register the derivative entries updated by this sample. */
+        this->RegisterDerivativeIndices( threadId, nzji );
 
-  }
+      } // end if sampleOk
+
+    }
+  } // end while over the sample chunks
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[threadId].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -26,6 +26,12 @@
 #include "elxProgressCommand.h"
 #include "itkAdvancedTransform.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkAdvancedImageToImageMetric.h"
+#include "MultiMetricMultiResolutionRegistration/itkCombinationImageToImageMetric.h"
+#include "itkSharedPoolMultiThreader.h"
+
+#include <atomic>
+#include <exception>
 
 
 namespace elastix
@@ -323,6 +329,9 @@ protected:
   /** Other protected typedefs */
   typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
   typedef typename RandomGeneratorType::Pointer                  RandomGeneratorPointer;
+  typedef typename RandomGeneratorType::IntegerType              RandomSeedType;
+  typedef itk::SharedPoolMultiThreader                           ThreaderType;
+  typedef ThreaderType::WorkUnitInfo                             ThreadInfoType;
   typedef ProgressCommand                                        ProgressCommandType;
   typedef typename ProgressCommand::Pointer                      ProgressCommandPointer;
 
@@ -339,6 +348,46 @@ protected:
   typedef typename
     AdvancedTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
 
+  /** Typedefs for the clones of the cost function used by SampleGradients. */
+  typedef itk::AdvancedImageToImageMetric<
+    FixedImageType, MovingImageType >                   AdvancedMetricType;
+  typedef typename AdvancedMetricType::Pointer          AdvancedMetricPointer;
+  typedef itk::CombinationImageToImageMetric<
+    FixedImageType, MovingImageType >                   CombinationMetricType;
+  typedef Superclass1::ScaledCostFunctionPointer        ScaledCostFunctionPointer;
+  typedef Superclass1::MeasureType                      MeasureType;
+
+  /** A clone of the cost function, with its own transform and samplers, on
+   * which one work unit of SampleGradients does its gradient measurements.
+   * The metrics, random samplers and grid samplers are indexed like the
+   * metrics of elastix.
+   */
+  struct GradientMeasurementContextType
+  {
+    AdvancedMetricPointer                        st_CostFunction;
+    ScaledCostFunctionPointer                    st_ScaledCostFunction;
+    std::vector< AdvancedMetricType * >          st_Metrics;
+    std::vector< ImageRandomSamplerBasePointer > st_RandomSamplers;
+    std::vector< ImageSamplerBasePointer >       st_GridSamplers;
+    RandomGeneratorPointer                       st_RandomGenerator;
+  };
+
+  /** The data that SampleGradients passes to its work units. */
+  struct SampleGradientsThreaderParameterType
+  {
+    const Self *                                  st_Self;
+    const ParametersType *                        st_Mu0;
+    double                                        st_PerturbationSigma;
+    bool                                          st_StochasticGradients;
+    std::vector< GradientMeasurementContextType > st_Contexts;
+    std::vector< RandomSeedType >                 st_PerturbationSeeds;
+    std::vector< uint64_t >                       st_SamplerSeeds;
+    std::atomic< SizeValueType >                  st_NextMeasurement;
+    std::vector< double >                         st_ExactGG;
+    std::vector< double >                         st_DiffGG;
+    std::vector< std::exception_ptr >             st_Exceptions;
+  };
+
   AdaptiveStochasticGradientDescent();
   ~AdaptiveStochasticGradientDescent() override {}
 
@@ -356,6 +405,9 @@ protected:
   /** RandomGenerator for AddRandomPerturbation. */
   RandomGeneratorPointer m_RandomGenerator;
 
+  /** Threader for the gradient measurements of SampleGradients. */
+  ThreaderType::Pointer m_Threader;
+
   double m_SigmoidScaleFactor;
 
   /** Check if the transform is an advanced transform. Called by Initialize. */
@@ -387,10 +439,39 @@ protected:
    * Gradients are measured at position mu_n, which are generated according to:
    * mu_n - mu_0 ~ N(0, perturbationSigma^2 I );
    * gg = g^T g, etc.
+   * The measurements are done concurrently, by SampleGradientsOnClones(). If
+   * the cost function cannot be cloned, they are done one after the other.
    */
   virtual void SampleGradients( const ParametersType & mu0,
     double perturbationSigma, double & gg, double & ee );
 
+  /** Does the gradient measurements of SampleGradients concurrently, each
+   * work unit on its own clone of the cost function. The perturbation and
+   * the random samples of a measurement come from seeds that are drawn from
+   * m_RandomGenerator in the order of the measurements, and the clones are
+   * evaluated single-threaded, so the sums exactgg and diffgg do not depend
+   * on the number of threads. Returns false, without drawing any random
+   * numbers, if the cost function or one of its samplers cannot be cloned,
+   * or if a random sampler does not select new samples every iteration.
+   */
+  virtual bool SampleGradientsOnClones( const ParametersType & mu0,
+    const double perturbationSigma, const bool stochasticGradients,
+    const std::vector< ImageRandomSamplerBasePointer > & randomSamplers,
+    const std::vector< ImageGridSamplerPointer > & gridSamplers,
+    double & exactgg, double & diffgg );
+
+  /** Sets up a clone of the cost function for SampleGradientsOnClones.
+   * Returns false if that is not possible.
+   */
+  virtual bool CreateGradientMeasurementContext(
+    const AdvancedMetricType * costFunction,
+    const std::vector< ImageRandomSamplerBasePointer > & randomSamplers,
+    const std::vector< ImageGridSamplerPointer > & gridSamplers,
+    GradientMeasurementContextType & context ) const;
+
+  /** Threader callback for SampleGradientsOnClones. */
+  static ITK_THREAD_RETURN_TYPE SampleGradientsThreaderCallback( void * arg );
+
   /** Helper function, which calls GetScaledValueAndDerivative and does
    * some exception handling. Used by SampleGradients.
    */
@@ -402,6 +483,10 @@ protected:
    */
   virtual void AddRandomPerturbation( ParametersType & parameters, double sigma );
 
+  /** Same, but draws delta from the given generator. */
+  virtual void AddRandomPerturbation( ParametersType & parameters, double sigma,
+    RandomGeneratorType * randomGenerator ) const;
+
 private:
 
   AdaptiveStochasticGradientDescent( const Self & );  // purposely not implemented
@@ -56,6 +56,7 @@ AdaptiveStochasticGradientDescent< TElastix >
 
   this->m_RandomGenerator   = RandomGeneratorType::GetInstance();
   this->m_AdvancedTransform = 0;
+  this->m_Threader          = ThreaderType::New();
 
   this->m_UseNoiseCompensation        = true;
   this->m_OriginalButSigmoidToDefault = false;
@@ -580,6 +581,9 @@ AdaptiveStochasticGradientDescent< TElastix >
   computeJacobianTerms->SetNumberOfJacobianMeasurements(
     this->m_NumberOfJacobianMeasurements );
 
+  /** Multi-thread the computation like the metric. */
+  computeJacobianTerms->SetUseMultiThread( testPtr->GetUseMultiThread() );
+
   /** Check if use scales. */
   bool useScales = this->GetUseScales();
   if( useScales )
@@ -906,13 +910,6 @@ AdaptiveStochasticGradientDescent< TElastix >
 
   } // end if NewSamplesEveryIteration.
 
-#ifndef _ELASTIX_BUILD_LIBRARY
-  /** Prepare for progress printing. */
-  ProgressCommandPointer progressObserver = ProgressCommandType::New();
-  progressObserver->SetUpdateFrequency(
-    this->m_NumberOfGradientMeasurements, this->m_NumberOfGradientMeasurements );
-  progressObserver->SetStartString( "  Progress: " );
-#endif
   elxout << "  Sampling gradients ..." << std::endl;
 
   /** Initialize some variables for storing gradients and their magnitudes. */
@@ -924,8 +921,20 @@ AdaptiveStochasticGradientDescent< TElastix >
   double         exactgg = 0.0;
   double         diffgg  = 0.0;
 
-  /** Compute gg for some random parameters. */
-  for( unsigned int i = 0; i < this->m_NumberOfGradientMeasurements; ++i )
+  /** Measure the gradients concurrently on clones of the cost function, if possible. */
+  const bool measuredOnClones = this->SampleGradientsOnClones( mu0, perturbationSigma,
+    stochasticgradients, randomSamplerVec, gridSamplerVec, exactgg, diffgg );
+
+#ifndef _ELASTIX_BUILD_LIBRARY
+  /** Prepare for progress printing. */
+  ProgressCommandPointer progressObserver = ProgressCommandType::New();
+  progressObserver->SetUpdateFrequency(
+    this->m_NumberOfGradientMeasurements, this->m_NumberOfGradientMeasurements );
+  progressObserver->SetStartString( "  Progress: " );
+#endif
+
+  /** Otherwise compute gg for some random parameters, one after the other. */
+  for( unsigned int i = 0; !measuredOnClones && i < this->m_NumberOfGradientMeasurements; ++i )
   {
 #ifndef _ELASTIX_BUILD_LIBRARY
     /** Show progress 0-100% */
@@ -1010,6 +1019,284 @@ AdaptiveStochasticGradientDescent< TElastix >
 } // end SampleGradients()
 
 
+/**
+ * ******************** SampleGradientsOnClones **********************
+ */
+
+template< class TElastix >
+bool
+AdaptiveStochasticGradientDescent< TElastix >
+::SampleGradientsOnClones( const ParametersType & mu0,
+  const double perturbationSigma, const bool stochasticGradients,
+  const std::vector< ImageRandomSamplerBasePointer > & randomSamplers,
+  const std::vector< ImageGridSamplerPointer > & gridSamplers,
+  double & exactgg, double & diffgg )
+{
+  const SizeValueType N = this->m_NumberOfGradientMeasurements;
+  const unsigned int  M = this->GetElastix()->GetNumberOfMetrics();
+
+  const AdvancedMetricType * costFunction
+    = dynamic_cast< const AdvancedMetricType * >( this->GetCostFunction() );
+  if( costFunction == nullptr || N == 0 )
+  {
+    return false;
+  }
+
+  /** Set up a clone of the cost function for each work unit. */
+  SampleGradientsThreaderParameterType parameters;
+  const itk::ThreadIdType numberOfWorkUnits = static_cast< itk::ThreadIdType >( std::min< SizeValueType >(
+    itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads(), N ) );
+  parameters.st_Contexts.resize( numberOfWorkUnits );
+  for( itk::ThreadIdType w = 0; w < numberOfWorkUnits; ++w )
+  {
+    if( !this->CreateGradientMeasurementContext( costFunction,
+      randomSamplers, gridSamplers, parameters.st_Contexts[ w ] ) )
+    {
+      return false;
+    }
+  }
+
+  /** Draw the seeds of all measurements in a fixed order: first the seed of the
+   * perturbation, then a seed for each random sampler. Metrics that share a
+   * random sampler also share its seed.
+   */
+  parameters.st_PerturbationSeeds.resize( N );
+  parameters.st_SamplerSeeds.assign( N * M, 0 );
+  for( SizeValueType i = 0; i < N; ++i )
+  {
+    parameters.st_PerturbationSeeds[ i ] = this->m_RandomGenerator->GetIntegerVariate();
+    for( unsigned int m = 0; stochasticGradients && m < M; ++m )
+    {
+      if( randomSamplers[ m ].IsNull() )
+      {
+        continue;
+      }
+      unsigned int first = 0;
+      while( randomSamplers[ first ] != randomSamplers[ m ] )
+      {
+        ++first;
+      }
+      if( first < m )
+      {
+        parameters.st_SamplerSeeds[ i * M + m ] = parameters.st_SamplerSeeds[ i * M + first ];
+        continue;
+      }
+      const uint64_t high = this->m_RandomGenerator->GetIntegerVariate();
+      const uint64_t low  = this->m_RandomGenerator->GetIntegerVariate();
+      parameters.st_SamplerSeeds[ i * M + m ] = ( high << 32 ) | low;
+    }
+  }
+
+  /** Do the measurements. */
+  parameters.st_Self                = this;
+  parameters.st_Mu0                 = &mu0;
+  parameters.st_PerturbationSigma   = perturbationSigma;
+  parameters.st_StochasticGradients = stochasticGradients;
+  parameters.st_NextMeasurement     = 0;
+  parameters.st_ExactGG.assign( N, 0.0 );
+  parameters.st_DiffGG.assign( N, 0.0 );
+  parameters.st_Exceptions.assign( N, std::exception_ptr() );
+
+  this->m_Threader->SetNumberOfWorkUnits( numberOfWorkUnits );
+  this->m_Threader->SetSingleMethod( this->SampleGradientsThreaderCallback, &parameters );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Pass on the first exception, if any, and sum in the order of the measurements. */
+  for( SizeValueType i = 0; i < N; ++i )
+  {
+    if( parameters.st_Exceptions[ i ] )
+    {
+      this->m_StopCondition = MetricError;
+      this->StopOptimization();
+      std::rethrow_exception( parameters.st_Exceptions[ i ] );
+    }
+    exactgg += parameters.st_ExactGG[ i ];
+    diffgg  += parameters.st_DiffGG[ i ];
+  }
+
+  return true;
+
+} // end SampleGradientsOnClones()
+
+
+/**
+ * ******************** CreateGradientMeasurementContext **********************
+ */
+
+template< class TElastix >
+bool
+AdaptiveStochasticGradientDescent< TElastix >
+::CreateGradientMeasurementContext(
+  const AdvancedMetricType * costFunction,
+  const std::vector< ImageRandomSamplerBasePointer > & randomSamplers,
+  const std::vector< ImageGridSamplerPointer > & gridSamplers,
+  GradientMeasurementContextType & context ) const
+{
+  const unsigned int M = this->GetElastix()->GetNumberOfMetrics();
+
+  /** The clone has its own transform and samplers. */
+  context.st_CostFunction = costFunction->Clone();
+  if( context.st_CostFunction.IsNull() )
+  {
+    return false;
+  }
+
+  /** Find the clones of the metrics of elastix, which are the sub metrics
+   * of a combination of metrics.
+   */
+  CombinationMetricType * combination
+    = dynamic_cast< CombinationMetricType * >( context.st_CostFunction.GetPointer() );
+  context.st_Metrics.assign( M, nullptr );
+  context.st_RandomSamplers.resize( M );
+  context.st_GridSamplers.resize( M );
+  for( unsigned int m = 0; m < M; ++m )
+  {
+    if( combination != nullptr )
+    {
+      context.st_Metrics[ m ] = dynamic_cast< AdvancedMetricType * >( combination->GetMetric( m ) );
+    }
+    else if( m == 0 )
+    {
+      context.st_Metrics[ m ] = context.st_CostFunction;
+    }
+    if( context.st_Metrics[ m ] == nullptr )
+    {
+      return false;
+    }
+
+    /** Evaluate single-threaded, such that the result does not depend on the
+     * number of threads. The work units evaluate concurrently instead.
+     */
+    context.st_Metrics[ m ]->SetUseMultiThread( false );
+
+    /** A random sampler that keeps its samples would select other samples in
+     * the clone, and would do so with the global random generator.
+     */
+    context.st_RandomSamplers[ m ] = dynamic_cast< ImageRandomSamplerBaseType * >(
+      context.st_Metrics[ m ]->GetImageSampler() );
+    if( context.st_RandomSamplers[ m ].IsNotNull() && randomSamplers[ m ].IsNull() )
+    {
+      return false;
+    }
+
+    if( randomSamplers[ m ].IsNotNull() )
+    {
+      context.st_GridSamplers[ m ] = gridSamplers[ m ]->Clone();
+      if( context.st_RandomSamplers[ m ].IsNull() || context.st_GridSamplers[ m ].IsNull() )
+      {
+        return false;
+      }
+
+      /** Only the multi-threaded version of the random samplers uses the seed,
+       * with samples that do not depend on the number of work units.
+       */
+      context.st_RandomSamplers[ m ]->SetUseMultiThread( true );
+      context.st_RandomSamplers[ m ]->SetNumberOfWorkUnits( 1 );
+    }
+  }
+  context.st_CostFunction->SetUseMultiThread( false );
+
+  try
+  {
+    context.st_CostFunction->Initialize();
+  }
+  catch( itk::ExceptionObject & )
+  {
+    return false;
+  }
+  context.st_ScaledCostFunction = this->CreateScaledCostFunction( context.st_CostFunction );
+  context.st_RandomGenerator     = RandomGeneratorType::New();
+  return true;
+
+} // end CreateGradientMeasurementContext()
+
+
+/**
+ * ******************** SampleGradientsThreaderCallback **********************
+ */
+
+template< class TElastix >
+ITK_THREAD_RETURN_TYPE
+AdaptiveStochasticGradientDescent< TElastix >
+::SampleGradientsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  const itk::ThreadIdType threadID = infoStruct->WorkUnitID;
+
+  SampleGradientsThreaderParameterType * temp
+    = static_cast< SampleGradientsThreaderParameterType * >( infoStruct->UserData );
+  GradientMeasurementContextType & context = temp->st_Contexts[ threadID ];
+  const unsigned int                M       = context.st_Metrics.size();
+  const SizeValueType               N       = temp->st_PerturbationSeeds.size();
+
+  MeasureType    dummyvalue = 0.0;
+  DerivativeType exactgradient;
+  DerivativeType approxgradient;
+
+  /** Every work unit takes the next measurement, until all are done. */
+  SizeValueType i = temp->st_NextMeasurement++;
+  while( i < N )
+  {
+    try
+    {
+      /** Generate a perturbation, according to:
+       *    \mu_i ~ N( \mu_0, perturbationsigma^2 I ).
+       */
+      ParametersType perturbedMu0 = *temp->st_Mu0;
+      context.st_RandomGenerator->SetSeed( temp->st_PerturbationSeeds[ i ] );
+      temp->st_Self->AddRandomPerturbation( perturbedMu0,
+        temp->st_PerturbationSigma, context.st_RandomGenerator );
+
+      if( temp->st_StochasticGradients )
+      {
+        /** Set grid sampler(s) and get exact derivative. */
+        for( unsigned int m = 0; m < M; ++m )
+        {
+          if( context.st_GridSamplers[ m ].IsNotNull() )
+          {
+            context.st_Metrics[ m ]->SetImageSampler( context.st_GridSamplers[ m ] );
+          }
+        }
+        context.st_ScaledCostFunction->GetValueAndDerivative( perturbedMu0, dummyvalue, exactgradient );
+
+        /** Set random sampler(s), select the samples of this measurement and
+         * get approximate derivative.
+         */
+        for( unsigned int m = 0; m < M; ++m )
+        {
+          if( context.st_RandomSamplers[ m ].IsNotNull() )
+          {
+            context.st_Metrics[ m ]->SetImageSampler( context.st_RandomSamplers[ m ] );
+            context.st_RandomSamplers[ m ]->SetRandomSeed( temp->st_SamplerSeeds[ i * M + m ] );
+          }
+        }
+        context.st_ScaledCostFunction->GetValueAndDerivative( perturbedMu0, dummyvalue, approxgradient );
+
+        /** Compute g^T g and e^T e */
+        temp->st_ExactGG[ i ] = exactgradient.squared_magnitude();
+        temp->st_DiffGG[ i ]  = ( exactgradient - approxgradient ).squared_magnitude();
+      }
+      else
+      {
+        /** Get exact gradient and compute g^T g. NB: diffgg=0. */
+        context.st_ScaledCostFunction->GetValueAndDerivative( perturbedMu0, dummyvalue, exactgradient );
+        temp->st_ExactGG[ i ] = exactgradient.squared_magnitude();
+      }
+    }
+    catch( ... )
+    {
+      /** Exceptions may not leave a thread; rethrow them after the join. */
+      temp->st_Exceptions[ i ] = std::current_exception();
+    }
+
+    i = temp->st_NextMeasurement++;
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end SampleGradientsThreaderCallback()
+
+
 /**
  * **************** PrintSettingsVector **********************
  */
@@ -1132,11 +1419,26 @@ template< class TElastix >
 void
 AdaptiveStochasticGradientDescent< TElastix >
 ::AddRandomPerturbation( ParametersType & parameters, double sigma )
+{
+  this->AddRandomPerturbation( parameters, sigma, this->m_RandomGenerator );
+
+} // end AddRandomPerturbation()
+
+
+/**
+ * *************** AddRandomPerturbation ***************
+ */
+
+template< class TElastix >
+void
+AdaptiveStochasticGradientDescent< TElastix >
+::AddRandomPerturbation( ParametersType & parameters, double sigma,
+  RandomGeneratorType * randomGenerator ) const
 {
   /** Add delta ~ sigma * N(0,I) to the input parameters. */
   for( unsigned int p = 0; p < parameters.GetSize(); ++p )
   {
-    parameters[ p ] += sigma * this->m_RandomGenerator->GetNormalVariate( 0.0, 1.0 );
+    parameters[ p ] += sigma * randomGenerator->GetNormalVariate( 0.0, 1.0 );
   }
 
 } // end AddRandomPerturbation()
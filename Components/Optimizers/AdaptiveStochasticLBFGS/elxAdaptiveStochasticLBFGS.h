@@ -26,7 +26,7 @@
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkComputeJacobianTerms.h"
 #include "itkComputeDisplacementDistribution.h"
-#include "itkPlatformMultiThreader.h"
+#include "itkSharedPoolMultiThreader.h"
 #include "itkImageRandomSampler.h"
 #include "itkLineSearchOptimizer.h"
 #include "itkMoreThuenteLineSearchOptimizer.h"
@@ -20,6 +20,10 @@
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
 #include "itkCMAEvolutionStrategyOptimizer.h"
+#include "itkAdvancedImageToImageMetric.h"
+#include "MultiMetricMultiResolutionRegistration/itkCombinationImageToImageMetric.h"
+#include "itkImageRandomSamplerBase.h"
+#include "itkImageRandomCoordinateSampler.h"
 
 namespace elastix
 {
@@ -35,6 +39,13 @@ namespace elastix
  * the offspring generation). The theory doesn't say anything about such a
  * situation, so, think twice before using the NewSamplesEveryIteration option.
  *
+ * The offspring of an iteration are evaluated concurrently, each thread on its
+ * own clone of the metric. A random sampler of a clone selects the same samples
+ * as the sampler of the metric itself, because both start from the same seed.
+ * If the metric or one of its samplers cannot be cloned, or a random coordinate
+ * sampler uses a random sample region, the offspring are evaluated one after
+ * the other.
+ *
  * The parameters used in this class are:
  * \parameter Optimizer: Select this optimizer as follows:\n
  *    <tt>(Optimizer "CMAEvolutionStrategy")</tt>
@@ -146,6 +157,7 @@ public:
   typedef Superclass1::ParametersType      ParametersType;
   typedef Superclass1::DerivativeType      DerivativeType;
   typedef Superclass1::ScalesType          ScalesType;
+  typedef Superclass1::CostFunctionContainerType CostFunctionContainerType;
 
   /** Typedef's inherited from Elastix.*/
   typedef typename Superclass2::ElastixType          ElastixType;
@@ -177,9 +189,40 @@ protected:
   CMAEvolutionStrategy(){}
   ~CMAEvolutionStrategy() override {}
 
+  /** Typedefs for the clones of the metric. */
+  typedef typename RegistrationType::FixedImageType     FixedImageType;
+  typedef typename RegistrationType::MovingImageType    MovingImageType;
+  typedef itk::AdvancedImageToImageMetric<
+    FixedImageType, MovingImageType >                   AdvancedMetricType;
+  typedef typename AdvancedMetricType::Pointer          AdvancedMetricPointer;
+  typedef itk::CombinationImageToImageMetric<
+    FixedImageType, MovingImageType >                   CombinationMetricType;
+  typedef itk::ImageRandomSamplerBase< FixedImageType > ImageRandomSamplerBaseType;
+  typedef typename
+    ImageRandomSamplerBaseType::Pointer ImageRandomSamplerBasePointer;
+  typedef
+    itk::ImageRandomCoordinateSampler< FixedImageType > ImageRandomCoordinateSamplerType;
+  typedef std::vector< ImageRandomSamplerBasePointer > RandomSamplerContainerType;
+
   /** Call the superclass' implementation and print the value of some variables */
   void InitializeProgressVariables( void ) override;
 
+  /** Set a clone of the metric for each thread, on which the offspring are
+   * evaluated concurrently. Sets no clones if that is not possible.
+   */
+  virtual void CreateCostFunctionClones( void );
+
+  /** Give the random sampler of each metric and the random samplers of its
+   * clones the same new seed, drawn from m_RandomGenerator, such that they
+   * all select the same samples.
+   */
+  virtual void SetRandomSamplerSeeds( void );
+
+  /** For each metric with a random sampler: that sampler, followed by the
+   * random samplers of the clones of the metric.
+   */
+  std::vector< RandomSamplerContainerType > m_SynchronizedRandomSamplers;
+
 private:
 
   CMAEvolutionStrategy( const Self & );   // purposely not implemented
@@ -49,12 +49,165 @@ CMAEvolutionStrategy< TElastix >::StartOptimization( void )
     }
   }
 
+  /** Evaluate the offspring concurrently, on clones of the metric */
+  this->CreateCostFunctionClones();
+
   /** Call the superclass */
   this->Superclass1::StartOptimization();
 
 }   //end StartOptimization
 
 
+/**
+ * ***************** CreateCostFunctionClones ************************
+ */
+
+template< class TElastix >
+void
+CMAEvolutionStrategy< TElastix >::CreateCostFunctionClones( void )
+{
+  /** Start without clones: the offspring are then evaluated one after the other. */
+  this->SetCostFunctionClones( CostFunctionContainerType() );
+  this->m_SynchronizedRandomSamplers.clear();
+
+  const unsigned int M              = this->GetElastix()->GetNumberOfMetrics();
+  const unsigned int numberOfClones = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  const AdvancedMetricType * costFunction
+    = dynamic_cast< const AdvancedMetricType * >( this->GetCostFunction() );
+  if( costFunction == nullptr || numberOfClones < 2 )
+  {
+    return;
+  }
+
+  /** The random samplers of the metrics. A random sample region is drawn from
+   * the global random generator, also by the multi-threaded sampler, so it
+   * would differ between the clones.
+   */
+  std::vector< RandomSamplerContainerType > randomSamplers( M );
+  for( unsigned int m = 0; m < M; ++m )
+  {
+    ImageRandomSamplerBaseType * sampler = dynamic_cast< ImageRandomSamplerBaseType * >(
+      this->GetElastix()->GetElxMetricBase( m )->GetAdvancedMetricImageSampler() );
+    const ImageRandomCoordinateSamplerType * coordinateSampler
+      = dynamic_cast< const ImageRandomCoordinateSamplerType * >( sampler );
+    if( coordinateSampler != nullptr && coordinateSampler->GetUseRandomSampleRegion() )
+    {
+      return;
+    }
+    if( sampler != nullptr )
+    {
+      randomSamplers[ m ].push_back( sampler );
+    }
+  }
+
+  /** Clone the metric, with its own transform and samplers. */
+  std::vector< AdvancedMetricPointer > clones( numberOfClones );
+  for( unsigned int i = 0; i < numberOfClones; ++i )
+  {
+    clones[ i ] = costFunction->Clone();
+    if( clones[ i ].IsNull() )
+    {
+      return;
+    }
+
+    /** Find the clones of the metrics of elastix, which are the sub metrics
+     * of a combination of metrics.
+     */
+    CombinationMetricType * combination
+      = dynamic_cast< CombinationMetricType * >( clones[ i ].GetPointer() );
+    for( unsigned int m = 0; m < M; ++m )
+    {
+      AdvancedMetricType * metric = nullptr;
+      if( combination != nullptr )
+      {
+        metric = dynamic_cast< AdvancedMetricType * >( combination->GetMetric( m ) );
+      }
+      else if( m == 0 )
+      {
+        metric = clones[ i ];
+      }
+      if( metric == nullptr )
+      {
+        return;
+      }
+
+      /** Evaluate single-threaded; the clones run concurrently instead. */
+      metric->SetUseMultiThread( false );
+
+      ImageRandomSamplerBaseType * sampler
+        = dynamic_cast< ImageRandomSamplerBaseType * >( metric->GetImageSampler() );
+      if( ( sampler == nullptr ) != randomSamplers[ m ].empty() )
+      {
+        return;
+      }
+      if( sampler != nullptr )
+      {
+        sampler->SetNumberOfWorkUnits( 1 );
+        randomSamplers[ m ].push_back( sampler );
+      }
+    }
+    clones[ i ]->SetUseMultiThread( false );
+  }
+
+  /** Only the multi-threaded version of the random samplers uses the seed,
+   * with samples that do not depend on the number of work units. So the
+   * sampler of the metric then selects the same samples as the clones.
+   */
+  for( unsigned int m = 0; m < M; ++m )
+  {
+    for( std::size_t j = 0; j < randomSamplers[ m ].size(); ++j )
+    {
+      randomSamplers[ m ][ j ]->SetUseMultiThread( true );
+    }
+    if( !randomSamplers[ m ].empty() )
+    {
+      this->m_SynchronizedRandomSamplers.push_back( randomSamplers[ m ] );
+    }
+  }
+  this->SetRandomSamplerSeeds();
+
+  /** Initialize the clones. */
+  CostFunctionContainerType costFunctionClones( numberOfClones );
+  for( unsigned int i = 0; i < numberOfClones; ++i )
+  {
+    try
+    {
+      clones[ i ]->Initialize();
+    }
+    catch( itk::ExceptionObject & )
+    {
+      this->m_SynchronizedRandomSamplers.clear();
+      return;
+    }
+    costFunctionClones[ i ] = clones[ i ].GetPointer();
+  }
+  this->SetCostFunctionClones( costFunctionClones );
+
+} // end CreateCostFunctionClones
+
+
+/**
+ * ***************** SetRandomSamplerSeeds ************************
+ */
+
+template< class TElastix >
+void
+CMAEvolutionStrategy< TElastix >::SetRandomSamplerSeeds( void )
+{
+  for( std::size_t m = 0; m < this->m_SynchronizedRandomSamplers.size(); ++m )
+  {
+    const uint64_t high = this->m_RandomGenerator->GetIntegerVariate();
+    const uint64_t low  = this->m_RandomGenerator->GetIntegerVariate();
+    const uint64_t seed = ( high << 32 ) | low;
+    for( std::size_t j = 0; j < this->m_SynchronizedRandomSamplers[ m ].size(); ++j )
+    {
+      this->m_SynchronizedRandomSamplers[ m ][ j ]->SetRandomSeed( seed );
+    }
+  }
+
+} // end SetRandomSamplerSeeds
+
+
 /**
  * ***************** InitializeProgressVariables ************************
  */
@@ -235,6 +388,7 @@ CMAEvolutionStrategy< TElastix >
   if( this->GetNewSamplesEveryIteration() )
   {
     this->SelectNewSamples();
+    this->SetRandomSamplerSeeds();
   }
 
 } // end AfterEachIteration
@@ -295,6 +449,10 @@ CMAEvolutionStrategy< TElastix >
   /** Print the stopping condition */
   elxout << "Stopping condition: " << stopcondition << "." << std::endl;
 
+  /** Release the clones of the metric */
+  this->SetCostFunctionClones( CostFunctionContainerType() );
+  this->m_SynchronizedRandomSamplers.clear();
+
 } // end AfterEachResolution
 
 
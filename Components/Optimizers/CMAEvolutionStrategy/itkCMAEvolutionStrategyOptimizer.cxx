@@ -40,6 +40,7 @@ CMAEvolutionStrategyOptimizer::CMAEvolutionStrategyOptimizer()
   itkDebugMacro( "Constructor" );
 
   this->m_RandomGenerator = RandomGeneratorType::GetInstance();
+  this->m_Threader        = ThreaderType::New();
 
   this->m_CurrentValue     = NumericTraits< MeasureType >::Zero;
   this->m_CurrentIteration = 0;
@@ -159,6 +160,14 @@ CMAEvolutionStrategyOptimizer::StartOptimization()
   /** Initialize the scaledCostFunction with the currently set scales */
   this->InitializeScales();
 
+  /** Wrap the clones of the cost function with the same scales */
+  this->m_ScaledCostFunctionClones.clear();
+  for( std::size_t i = 0; i < this->m_CostFunctionClones.size(); ++i )
+  {
+    this->m_ScaledCostFunctionClones.push_back(
+      this->CreateScaledCostFunction( this->m_CostFunctionClones[ i ] ) );
+  }
+
   /** Set the current position as the scaled initial position */
   this->SetCurrentPosition( this->GetInitialPosition() );
 
@@ -179,6 +188,21 @@ CMAEvolutionStrategyOptimizer::StartOptimization()
 } // end StartOptimization
 
 
+/**
+ * ******************* SetCostFunctionClones *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::SetCostFunctionClones( const CostFunctionContainerType & clones )
+{
+  itkDebugMacro( "SetCostFunctionClones" );
+
+  this->m_CostFunctionClones = clones;
+  this->Modified();
+
+} // end SetCostFunctionClones
+
+
 /**
  * ******************* ResumeOptimization *********************
  */
@@ -501,64 +525,78 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring( void )
 {
   itkDebugMacro( "GenerateOffspring" );
 
-  /** Get the number of parameters from the cost function */
-  const unsigned int numberOfParameters
-    = this->GetScaledCostFunction()->GetNumberOfParameters();
-
   /** Some casts/aliases: */
-  const unsigned int N      = numberOfParameters;
-  const unsigned int lambda = this->m_PopulationSize;
+  const unsigned int lambda     = this->m_PopulationSize;
+  const bool         concurrent = !this->m_ScaledCostFunctionClones.empty();
 
   /** Clear the old values */
   this->m_CostFunctionValues.clear();
 
-  /** Fill the m_NormalizedSearchDirs and SearchDirs */
+  /** With clones: draw all search directions first, in the order of the
+   * offspring, and evaluate them concurrently. */
+  std::vector< MeasureType >   concurrentValues;
+  std::vector< unsigned char > concurrentFailed;
+  if( concurrent )
+  {
+    for( unsigned int lam = 0; lam < lambda; ++lam )
+    {
+      this->GenerateSearchDirection( lam );
+    }
+    this->EvaluateOffspringOnClones( concurrentValues, concurrentFailed );
+  }
+
+  /** Fill the m_CostFunctionValues, in the order of the offspring. A failed
+   * evaluation is retried with a new search direction, one after the other. */
+  const ScaledCostFunctionType * costFunction = concurrent
+    ? this->m_ScaledCostFunctionClones[ 0 ].GetPointer()
+    : this->GetScaledCostFunction();
   unsigned int lam       = 0;
   unsigned int nrOfFails = 0;
   while( lam < lambda )
   {
-    /** draw from distribution N(0,I) */
-    for( unsigned int par = 0; par < N; ++par )
-    {
-      this->m_NormalizedSearchDirs[ lam ][ par ]
-        = this->m_RandomGenerator->GetNormalVariate();
-    }
-    /** Make like it was drawn from N(0,C) */
-    if( this->GetUseCovarianceMatrixAdaptation() )
+    MeasureType costFunctionValue = 0.0;
+
+    /** The first attempt may have been done concurrently */
+    const bool evaluatedConcurrently = concurrent && nrOfFails == 0;
+    if( evaluatedConcurrently && !concurrentFailed[ lam ] )
     {
-      this->m_SearchDirs[ lam ] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[ lam ] );
+      costFunctionValue = concurrentValues[ lam ];
     }
     else
     {
-      this->m_SearchDirs[ lam ] = this->m_NormalizedSearchDirs[ lam ];
-    }
-    /** Make like it was drawn from N( 0, sigma^2 C ) */
-    this->m_SearchDirs[ lam ] *= this->m_CurrentSigma;
+      if( evaluatedConcurrently )
+      {
+        ++nrOfFails;
+      }
 
-    /** Compute the cost function */
-    MeasureType costFunctionValue = 0.0;
-    /** x_lam = m + d_lam */
-    ParametersType x_lam = this->GetScaledCurrentPosition();
-    x_lam += this->m_SearchDirs[ lam ];
-    try
-    {
-      costFunctionValue = this->GetScaledValue( x_lam );
-    }
-    catch( ExceptionObject & err )
-    {
-      ++nrOfFails;
-      /** try another parameter vector if we haven't tried that for 10 times already */
-      if( nrOfFails <= 10 )
+      /** Fill the m_NormalizedSearchDirs and SearchDirs */
+      this->GenerateSearchDirection( lam );
+
+      /** Compute the cost function */
+      /** x_lam = m + d_lam */
+      ParametersType x_lam = this->GetScaledCurrentPosition();
+      x_lam += this->m_SearchDirs[ lam ];
+      try
       {
-        continue;
+        costFunctionValue = costFunction->GetValue( x_lam );
       }
-      else
+      catch( ExceptionObject & err )
       {
-        this->m_StopCondition = MetricError;
-        this->StopOptimization();
-        throw err;
+        ++nrOfFails;
+        /** try another parameter vector if we haven't tried that for 10 times already */
+        if( nrOfFails <= 10 )
+        {
+          continue;
+        }
+        else
+        {
+          this->m_StopCondition = MetricError;
+          this->StopOptimization();
+          throw err;
+        }
       }
     }
+
     /** Successfull cost function evaluation */
     this->m_CostFunctionValues.push_back(
       MeasureIndexPairType( costFunctionValue, lam ) );
@@ -573,6 +611,126 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring( void )
 } // end GenerateOffspring
 
 
+/**
+ * ****************** GenerateSearchDirection *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::GenerateSearchDirection( const unsigned int lam )
+{
+  /** Some casts/aliases: */
+  const unsigned int N = this->m_NormalizedSearchDirs[ lam ].GetSize();
+
+  /** draw from distribution N(0,I) */
+  for( unsigned int par = 0; par < N; ++par )
+  {
+    this->m_NormalizedSearchDirs[ lam ][ par ]
+      = this->m_RandomGenerator->GetNormalVariate();
+  }
+  /** Make like it was drawn from N(0,C) */
+  if( this->GetUseCovarianceMatrixAdaptation() )
+  {
+    this->m_SearchDirs[ lam ] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[ lam ] );
+  }
+  else
+  {
+    this->m_SearchDirs[ lam ] = this->m_NormalizedSearchDirs[ lam ];
+  }
+  /** Make like it was drawn from N( 0, sigma^2 C ) */
+  this->m_SearchDirs[ lam ] *= this->m_CurrentSigma;
+
+} // end GenerateSearchDirection
+
+
+/**
+ * ****************** EvaluateOffspringOnClones *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::EvaluateOffspringOnClones(
+  std::vector< MeasureType > & values, std::vector< unsigned char > & failed )
+{
+  itkDebugMacro( "EvaluateOffspringOnClones" );
+
+  /** Some casts/aliases: */
+  const unsigned int lambda = this->m_PopulationSize;
+
+  values.assign( lambda, 0.0 );
+  failed.assign( lambda, 0 );
+
+  EvaluateOffspringThreaderParameterType threaderParameters;
+  threaderParameters.st_Self          = this;
+  threaderParameters.st_NextOffspring = 0;
+  threaderParameters.st_Values        = &values;
+  threaderParameters.st_Failed        = &failed;
+  threaderParameters.st_Exceptions.assign( lambda, std::exception_ptr() );
+
+  /** One work unit per clone */
+  const ThreadIdType numberOfWorkUnits = static_cast< ThreadIdType >( std::min< std::size_t >(
+    this->m_ScaledCostFunctionClones.size(), lambda ) );
+  this->m_Threader->SetNumberOfWorkUnits( numberOfWorkUnits );
+  this->m_Threader->SetSingleMethod( EvaluateOffspringThreaderCallback, &threaderParameters );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Pass on the first exception that is no ExceptionObject, if any */
+  for( unsigned int lam = 0; lam < lambda; ++lam )
+  {
+    if( threaderParameters.st_Exceptions[ lam ] )
+    {
+      std::rethrow_exception( threaderParameters.st_Exceptions[ lam ] );
+    }
+  }
+
+} // end EvaluateOffspringOnClones
+
+
+/**
+ * ****************** EvaluateOffspringThreaderCallback *********************
+ */
+
+ITK_THREAD_RETURN_TYPE
+CMAEvolutionStrategyOptimizer::EvaluateOffspringThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *                         infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                             threadID   = infoStruct->WorkUnitID;
+  EvaluateOffspringThreaderParameterType * temp
+    = static_cast< EvaluateOffspringThreaderParameterType * >( infoStruct->UserData );
+
+  /** Each work unit evaluates on its own clone. */
+  const Self *                   self         = temp->st_Self;
+  const ScaledCostFunctionType * costFunction = self->m_ScaledCostFunctionClones[ threadID ];
+  const unsigned int             lambda       = self->m_PopulationSize;
+
+  /** Every work unit takes the next offspring, until all are done. */
+  unsigned int lam = temp->st_NextOffspring++;
+  while( lam < lambda )
+  {
+    /** x_lam = m + d_lam */
+    ParametersType x_lam = self->GetScaledCurrentPosition();
+    x_lam += self->m_SearchDirs[ lam ];
+    try
+    {
+      ( *temp->st_Values )[ lam ] = costFunction->GetValue( x_lam );
+    }
+    catch( ExceptionObject & )
+    {
+      ( *temp->st_Failed )[ lam ] = 1;
+    }
+    catch( ... )
+    {
+      /** Exceptions may not leave a thread; rethrow them after the join. */
+      temp->st_Exceptions[ lam ] = std::current_exception();
+    }
+
+    lam = temp->st_NextOffspring++;
+  }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end EvaluateOffspringThreaderCallback
+
+
 /**
  * ****************** SortCostFunctionValues *********************
  */
@@ -752,46 +910,125 @@ CMAEvolutionStrategyOptimizer::UpdateC( void )
   const double       mu_cov = this->m_CovarianceMatrixAdaptationWeight;
   const double       sigma  = this->m_CurrentSigma;
 
-  /** Multiply old m_C with some factor */
+  /** Compute the factors of the old C, the rank-one and the rank-mu update */
   double oldCfactor = 1.0 - c_cov;
   if( !this->m_Heaviside )
   {
     oldCfactor += ( c_cov * c_c * ( 2.0 - c_c ) / mu_cov );
   }
-  this->m_C *= oldCfactor;
-
-  /** Do rank-one update */
   const double rankonefactor = c_cov / mu_cov;
-  for( unsigned int i = 0; i < N; ++i )
+  const double rankmufactor  = c_cov * ( 1.0 - 1.0 / mu_cov );
+
+  /** Weight the search directions of the parents */
+  CovarianceMatrixType weightedSearchDirs( mu, N );
+  for( unsigned int m = 0; m < mu; ++m )
   {
+    const unsigned int lam        = this->m_CostFunctionValues[ m ].second;
+    const double       sqrtweight = std::sqrt( this->m_RecombinationWeights[ m ] );
+    for( unsigned int i = 0; i < N; ++i )
+    {
+      weightedSearchDirs[ m ][ i ] = this->m_SearchDirs[ lam ][ i ] * ( sqrtweight / sigma );
+    }
+  }
+
+  /** Single-threaded if the update is too small to be worth the threads */
+  if( N < 64 )
+  {
+    this->UpdateCRows( 0, N, oldCfactor, rankonefactor, rankmufactor, weightedSearchDirs );
+    return;
+  }
+
+  /** Update the rows of C in parallel */
+  UpdateCThreaderParameterType threaderParameters;
+  threaderParameters.st_Self               = this;
+  threaderParameters.st_OldCfactor         = oldCfactor;
+  threaderParameters.st_RankOneFactor      = rankonefactor;
+  threaderParameters.st_RankMuFactor       = rankmufactor;
+  threaderParameters.st_WeightedSearchDirs = &weightedSearchDirs;
+
+  this->m_Threader->SetNumberOfWorkUnits( MultiThreaderBase::GetGlobalDefaultNumberOfThreads() );
+  this->m_Threader->SetSingleMethod( UpdateCThreaderCallback, &threaderParameters );
+  this->m_Threader->SingleMethodExecute();
+
+} // end UpdateC
+
+
+/**
+ * ****************** UpdateCRows *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::UpdateCRows(
+  const unsigned int rowBegin, const unsigned int rowEnd,
+  const double oldCfactor, const double rankonefactor, const double rankmufactor,
+  const CovarianceMatrixType & weightedSearchDirs )
+{
+  /** Some casts/aliases: */
+  const unsigned int N  = this->m_C.cols();
+  const unsigned int mu = weightedSearchDirs.rows();
+
+  for( unsigned int i = rowBegin; i < rowEnd; ++i )
+  {
+    double * C_i = this->m_C[ i ];
+
+    /** Multiply old m_C with some factor */
+    for( unsigned int j = 0; j < N; ++j )
+    {
+      C_i[ j ] *= oldCfactor;
+    }
+
+    /** Do rank-one update */
     const double evolutionPath_i = this->m_EvolutionPath[ i ];
     for( unsigned int j = 0; j < N; ++j )
     {
       const double update = rankonefactor * evolutionPath_i * this->m_EvolutionPath[ j ];
-      this->m_C[ i ][ j ] += update;
+      C_i[ j ] += update;
     }
-  }
 
-  /** Do rank-mu update */
-  const double rankmufactor = c_cov * ( 1.0 - 1.0 / mu_cov );
-  for( unsigned int m = 0; m < mu; ++m )
-  {
-    const unsigned int lam               = this->m_CostFunctionValues[ m ].second;
-    const double       sqrtweight        = std::sqrt( this->m_RecombinationWeights[ m ] );
-    ParametersType     weightedSearchDir = this->m_SearchDirs[ lam ];
-    weightedSearchDir *= ( sqrtweight / sigma );
-    for( unsigned int i = 0; i < N; ++i )
+    /** Do rank-mu update */
+    for( unsigned int m = 0; m < mu; ++m )
     {
-      const double weightedSearchDir_i = weightedSearchDir[ i ];
+      const double * weightedSearchDir   = weightedSearchDirs[ m ];
+      const double   weightedSearchDir_i = weightedSearchDir[ i ];
       for( unsigned int j = 0; j < N; ++j )
       {
         const double update = rankmufactor * weightedSearchDir_i * weightedSearchDir[ j ];
-        this->m_C[ i ][ j ] += update;
+        C_i[ j ] += update;
       }
     }
-  } // end for m
+  } // end for i
 
-} // end UpdateC
+} // end UpdateCRows
+
+
+/**
+ * ****************** UpdateCThreaderCallback *********************
+ */
+
+ITK_THREAD_RETURN_TYPE
+CMAEvolutionStrategyOptimizer::UpdateCThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *               infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType                   threadID    = infoStruct->WorkUnitID;
+  ThreadIdType                   nrOfThreads = infoStruct->NumberOfWorkUnits;
+  UpdateCThreaderParameterType * temp
+    = static_cast< UpdateCThreaderParameterType * >( infoStruct->UserData );
+
+  /** Get the rows for this thread. */
+  const unsigned int N = temp->st_Self->m_C.rows();
+  const unsigned int nrOfRowsPerThread = static_cast< unsigned int >( std::ceil(
+    static_cast< double >( N ) / static_cast< double >( nrOfThreads ) ) );
+  const unsigned int rowBegin = std::min( nrOfRowsPerThread * threadID, N );
+  const unsigned int rowEnd   = std::min( nrOfRowsPerThread * ( threadID + 1 ), N );
+
+  /** Call the real implementation. */
+  temp->st_Self->UpdateCRows( rowBegin, rowEnd, temp->st_OldCfactor,
+    temp->st_RankOneFactor, temp->st_RankMuFactor, *temp->st_WeightedSearchDirs );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end UpdateCThreaderCallback
 
 
 /**
@@ -23,10 +23,13 @@
 #include <vector>
 #include <utility>
 #include <deque>
+#include <atomic>
+#include <exception>
 
 #include "itkArray.h"
 #include "itkArray2D.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkSharedPoolMultiThreader.h"
 #include "vnl/vnl_diag_matrix.h"
 
 namespace itk
@@ -43,6 +46,14 @@ namespace itk
  *   - See also the Matlab code, cmaes.m, which you can download from the
  *     website mentioned above.
  *
+ * The offspring of a generation are evaluated concurrently if clones of the
+ * cost function are set, see SetCostFunctionClones(): every work unit
+ * evaluates its offspring on its own clone. The search directions are drawn
+ * before, in the order of the offspring, and the values are stored in that
+ * order, so the result does not depend on the number of threads. Without
+ * clones the offspring are evaluated one after the other, on the cost
+ * function itself. The update of the covariance matrix is multi-threaded too.
+ *
  * \ingroup Numerics Optimizers
  */
 
@@ -66,6 +77,9 @@ public:
   typedef Superclass::ScaledCostFunctionType ScaledCostFunctionType;
   typedef Superclass::MeasureType            MeasureType;
   typedef Superclass::ScalesType             ScalesType;
+  typedef Superclass::CostFunctionPointer    CostFunctionPointer;
+
+  typedef std::vector< CostFunctionPointer > CostFunctionContainerType;
 
   typedef enum {
     MetricError,
@@ -219,6 +233,18 @@ public:
   itkSetMacro( ValueTolerance, double );
   itkGetConstMacro( ValueTolerance, double );
 
+  /** Setting: clones of the cost function, on which the offspring of a
+   * generation are evaluated concurrently, one clone per work unit. The clones
+   * should be independent of each other and of the cost function, and should
+   * give the same value for the same parameters. They are wrapped with the
+   * scales in StartOptimization().
+   * Default: none, which means that the offspring are evaluated one after the
+   * other, on the cost function itself. */
+  virtual void SetCostFunctionClones( const CostFunctionContainerType & clones );
+
+  virtual const CostFunctionContainerType & GetCostFunctionClones( void ) const
+  { return this->m_CostFunctionClones; }
+
 protected:
 
   typedef Array< double >               RecombinationWeightsType;
@@ -233,9 +259,18 @@ protected:
 
   typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
 
+  typedef SharedPoolMultiThreader ThreaderType;
+  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
+
   /** The random number generator used to generate the offspring. */
   RandomGeneratorType::Pointer m_RandomGenerator;
 
+  /** The threader used to evaluate the offspring and to update the covariance matrix. */
+  ThreaderType::Pointer m_Threader;
+
+  /** The clones of the cost function, wrapped with the scales. */
+  std::vector< ScaledCostFunctionPointer > m_ScaledCostFunctionClones;
+
   /** The value of the cost function at the current position */
   MeasureType m_CurrentValue;
 
@@ -355,9 +390,34 @@ protected:
   virtual void InitializeBCD( void );
 
   /** GenerateOffspring: Fill m_SearchDirs, m_NormalizedSearchDirs,
-   * and m_CostFunctionValues */
+   * and m_CostFunctionValues. If the cost function cannot be evaluated
+   * for an offspring, its search direction is drawn again, up to 10 times. */
   virtual void GenerateOffspring( void );
 
+  /** Draw m_NormalizedSearchDirs[ lam ] from N(0,I), and compute
+   * m_SearchDirs[ lam ] from it. */
+  virtual void GenerateSearchDirection( const unsigned int lam );
+
+  /** Evaluate the offspring concurrently on the clones of the cost function.
+   * An offspring for which the evaluation throws an ExceptionObject is marked
+   * as failed; other exceptions are passed on. */
+  virtual void EvaluateOffspringOnClones(
+    std::vector< MeasureType > & values, std::vector< unsigned char > & failed );
+
+  /** Threader callback for EvaluateOffspringOnClones. */
+  static ITK_THREAD_RETURN_TYPE EvaluateOffspringThreaderCallback( void * arg );
+
+  /** To give the threads access to the offspring and their results.
+   * st_Failed is no vector< bool >, because the threads write to it. */
+  struct EvaluateOffspringThreaderParameterType
+  {
+    Self *                            st_Self;
+    std::atomic< unsigned int >       st_NextOffspring;
+    std::vector< MeasureType > *      st_Values;
+    std::vector< unsigned char > *    st_Failed;
+    std::vector< std::exception_ptr > st_Exceptions;
+  };
+
   /** Sort the m_CostFunctionValues vector and update m_MeasureHistory */
   virtual void SortCostFunctionValues( void );
 
@@ -373,9 +433,31 @@ protected:
   /** Update m_EvolutionPath */
   virtual void UpdateEvolutionPath( void );
 
-  /** Update the covariance matrix C */
+  /** Update the covariance matrix C. For large N the rows of C are
+   * distributed over the threads; the result does not depend on the
+   * number of threads. */
   virtual void UpdateC( void );
 
+  /** Apply the rank-one and rank-mu updates to the rows [rowBegin, rowEnd)
+   * of C. The weighted search directions are stored row-wise in
+   * weightedSearchDirs, one row per parent. */
+  virtual void UpdateCRows( const unsigned int rowBegin, const unsigned int rowEnd,
+    const double oldCfactor, const double rankonefactor, const double rankmufactor,
+    const CovarianceMatrixType & weightedSearchDirs );
+
+  /** Threader callback for UpdateC. */
+  static ITK_THREAD_RETURN_TYPE UpdateCThreaderCallback( void * arg );
+
+  /** To give the threads access to the arguments of UpdateCRows. */
+  struct UpdateCThreaderParameterType
+  {
+    Self *                       st_Self;
+    double                       st_OldCfactor;
+    double                       st_RankOneFactor;
+    double                       st_RankMuFactor;
+    const CovarianceMatrixType * st_WeightedSearchDirs;
+  };
+
   /** Update the Sigma either by adaptation or using the predefined function */
   virtual void UpdateSigma( void );
 
@@ -423,6 +505,8 @@ private:
   double        m_PositionToleranceMin;
   double        m_ValueTolerance;
 
+  CostFunctionContainerType m_CostFunctionClones;
+
 };
 
 } // end namespace itk
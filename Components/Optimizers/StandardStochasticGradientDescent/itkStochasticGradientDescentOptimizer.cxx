@@ -307,17 +307,13 @@ StochasticGradientDescentOptimizer
   else
   {
     /** Fill the threader parameter struct with information. */
-    MultiThreaderParameterType * temp = new  MultiThreaderParameterType;
-    temp->t_NewPosition = &newPosition;
-    temp->t_Optimizer = this;
+    MultiThreaderParameterType temp;
+    temp.t_NewPosition = &newPosition;
+    temp.t_Optimizer = this;
 
     /** Call multi-threaded AdvanceOneStep(). */
-    ThreaderType::Pointer local_threader = ThreaderType::New();
-    local_threader->SetNumberOfWorkUnits( this->m_Threader->GetNumberOfWorkUnits() );
-    local_threader->SetSingleMethod( AdvanceOneStepThreaderCallback, (void *)( temp ) );
-    local_threader->SingleMethodExecute();
-
-    delete temp;
+    this->m_Threader->SetSingleMethod( AdvanceOneStepThreaderCallback, (void *)( &temp ) );
+    this->m_Threader->SingleMethodExecute();
   }
 
   this->InvokeEvent( IterationEvent() );
@@ -19,7 +19,7 @@
 #define __itkStochasticGradientDescentOptimizer_h
 
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
-#include "itkPlatformMultiThreader.h"
+#include "itkSharedPoolMultiThreader.h"
 
 namespace itk
 {
@@ -169,7 +169,7 @@ protected:
   void PrintSelf( std::ostream& os, Indent indent ) const override;
 
   /** Typedefs for multi-threading. */
-  typedef itk::PlatformMultiThreader               ThreaderType;
+  typedef itk::SharedPoolMultiThreader             ThreaderType;
   typedef ThreaderType::WorkUnitInfo   ThreadInfoType;
 
   // made protected so subclass can access
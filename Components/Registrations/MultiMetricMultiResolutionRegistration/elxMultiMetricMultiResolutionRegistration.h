@@ -88,6 +88,18 @@ namespace elastix
  *    example: <tt>(Metric0Use "false" "true")</tt> \n
  *    example: <tt>(Metric1Use "true" "false")</tt> \n
  *    The default is "true".
+ * \parameter UseConcurrentMetricEvaluation: Whether the metrics are computed
+ *    at the same time, each by its own thread, instead of one after the other.
+ *    This is useful when cheap metrics, such as penalty terms, are combined with
+ *    an expensive image metric. Metrics that share an interpolator or an image
+ *    sampler are never computed concurrently. \n
+ *    example: <tt>(UseConcurrentMetricEvaluation "true")</tt> \n
+ *    The default is "false".
+ * \parameter UseSharedTransformResults: Whether metrics that use the same image
+ *    sampler and transform compute the transformed samples only once, instead
+ *    of once per metric. \n
+ *    example: <tt>(UseSharedTransformResults "false")</tt> \n
+ *    The default is "true".
  *
  * \ingroup Registrations
  */
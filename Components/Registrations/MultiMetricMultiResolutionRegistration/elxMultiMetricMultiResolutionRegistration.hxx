@@ -197,6 +197,18 @@ MultiMetricMultiResolutionRegistration< TElastix >
   this->GetConfiguration()->ReadParameter( useRelativeWeights, "UseRelativeWeights", 0 );
   this->GetCombinationMetric()->SetUseRelativeWeights( useRelativeWeights );
 
+  /** Set whether the metrics are evaluated concurrently. */
+  bool useConcurrentMetricEvaluation = false;
+  this->GetConfiguration()->ReadParameter( useConcurrentMetricEvaluation,
+    "UseConcurrentMetricEvaluation", "", level, 0 );
+  this->GetCombinationMetric()->SetUseConcurrentMetricEvaluation( useConcurrentMetricEvaluation );
+
+  /** Set whether metrics with the same sampler share the transform results. */
+  bool useSharedTransformResults = true;
+  this->GetConfiguration()->ReadParameter( useSharedTransformResults,
+    "UseSharedTransformResults", "", level, 0 );
+  this->GetCombinationMetric()->SetUseSharedTransformResults( useSharedTransformResults );
+
   /** Set the metric weights. The default metric weight is 1.0 / nrOfMetrics. */
   if( !useRelativeWeights )
   {
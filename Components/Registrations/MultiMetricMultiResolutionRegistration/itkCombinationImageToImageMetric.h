@@ -21,6 +21,10 @@
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkSingleValuedPointSetToPointSetMetric.h"
 
+#include <atomic>
+#include <exception>
+#include <map>
+
 namespace itk
 {
 
@@ -133,6 +137,8 @@ public:
   /** Typedefs for the metrics. */
   typedef Superclass                                     ImageMetricType;
   typedef typename ImageMetricType::Pointer              ImageMetricPointer;
+  typedef typename ImageMetricType::SharedTransformResultsType
+    SharedTransformResultsType;
   typedef SingleValuedCostFunction                       SingleValuedCostFunctionType;
   typedef typename SingleValuedCostFunctionType::Pointer SingleValuedCostFunctionPointer;
 
@@ -200,6 +206,25 @@ public:
   itkSetMacro( UseRelativeWeights, bool );
   itkGetMacro( UseRelativeWeights, bool );
 
+  /** Set and Get whether the sub-metrics are evaluated concurrently in
+   * GetValueAndDerivative(). Each sub-metric is then a task for the threads
+   * of this metric, so that cheap metrics, such as penalty terms, are computed
+   * while an expensive image metric is still running. The sub-metrics keep
+   * using their own threads. The weighted sum of the derivatives is computed
+   * in parallel as well. Image metrics that share an interpolator or an image
+   * sampler are never evaluated concurrently. Default: false.
+   */
+  itkSetMacro( UseConcurrentMetricEvaluation, bool );
+  itkGetMacro( UseConcurrentMetricEvaluation, bool );
+
+  /** Set and Get whether image metrics that use the same image sampler and
+   * transform share the transformed sample points in GetValueAndDerivative(),
+   * instead of each computing them again.
+   * Default: true.
+   */
+  itkSetMacro( UseSharedTransformResults, bool );
+  itkGetMacro( UseSharedTransformResults, bool );
+
   /** Select which metrics are used.
    * This is useful in case you want to compute a certain measure, but not
    * actually use it during the registration.
@@ -406,6 +431,12 @@ protected:
   ~CombinationImageToImageMetric() override {}
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Clone this metric and its sub metrics, see AdvancedImageToImageMetric::Clone().
+   * Sub metrics that share a transform or an image sampler share the clone of it.
+   * Returns a null pointer if a sub metric is not an image metric, or cannot be cloned.
+   */
+  LightObject::Pointer InternalClone( void ) const override;
+
   /** Store the metrics and the corresponding weights. */
   unsigned int                                   m_NumberOfMetrics;
   std::vector< SingleValuedCostFunctionPointer > m_Metrics;
@@ -417,6 +448,8 @@ protected:
   mutable std::vector< DerivativeType >          m_MetricDerivatives;
   mutable std::vector< double >                  m_MetricDerivativesMagnitude;
   mutable std::vector< double >                  m_MetricComputationTime;
+  bool                                           m_UseConcurrentMetricEvaluation;
+  bool                                           m_UseSharedTransformResults;
 
   /** Dummy image region and derivatives. */
   FixedImageRegionType m_NullFixedImageRegion;
@@ -438,6 +471,49 @@ private:
    */
   double GetFinalMetricWeight( unsigned int pos ) const;
 
+  /** Check if the sub-metrics can be evaluated concurrently. This is not
+   * the case if image metrics share an interpolator or an image sampler.
+   */
+  bool CanEvaluateMetricsConcurrently( void ) const;
+
+  /** Compute the transform results once for each group of image metrics
+   * that use the same image sampler and transform, and hand them to the
+   * metrics of that group.
+   */
+  void ShareTransformResults( void ) const;
+
+  /** Detach the shared transform results from the image metrics. */
+  void ReleaseSharedTransformResults( void ) const;
+
+  /** Evaluate all sub-metrics concurrently, and store their values,
+   * derivatives, derivative magnitudes and computation times.
+   */
+  void LaunchComputeMetricsThreaderCallback( const ParametersType & parameters ) const;
+
+  /** Compute the weighted sum of the derivatives, multi-threaded. */
+  void LaunchCombineDerivativesThreaderCallback( DerivativeType & derivative ) const;
+
+  /** The threader callbacks. */
+  static ITK_THREAD_RETURN_TYPE ComputeMetricsThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_TYPE CombineDerivativesThreaderCallback( void * arg );
+
+  /** Variables for the concurrent evaluation. */
+  struct CombinationMetricMultiThreaderParameterType
+  {
+    const Self *           st_Metric;
+    const ParametersType * st_Parameters;
+    DerivativeValueType *  st_DerivativePointer;
+  };
+  mutable CombinationMetricMultiThreaderParameterType m_CombinationThreaderParameters;
+  mutable std::atomic< unsigned int >                 m_NextMetricTask;
+  mutable std::vector< unsigned int >                 m_MetricTaskOrder;
+  mutable std::vector< std::exception_ptr >           m_MetricExceptions;
+  mutable std::vector< double >                       m_FinalMetricWeights;
+
+  /** Transform results per metric; only filled for the first metric of a group. */
+  mutable std::vector< SharedTransformResultsType > m_SharedTransformResults;
+
 };
 
 } // end namespace itk
@@ -21,6 +21,7 @@
 #include "itkCombinationImageToImageMetric.h"
 #include "itkTimeProbe.h"
 #include "itkMath.h"
+#include <algorithm>
 
 /** Macros to reduce some copy-paste work.
  * These macros provide the implementation of
@@ -161,8 +162,14 @@ template< class TFixedImage, class TMovingImage >
 CombinationImageToImageMetric< TFixedImage, TMovingImage >
 ::CombinationImageToImageMetric()
 {
-  this->m_NumberOfMetrics    = 0;
-  this->m_UseRelativeWeights = false;
+  this->m_NumberOfMetrics               = 0;
+  this->m_UseRelativeWeights            = false;
+  this->m_UseConcurrentMetricEvaluation = false;
+  this->m_UseSharedTransformResults     = true;
+  this->m_NextMetricTask                = 0;
+  this->m_CombinationThreaderParameters.st_Metric            = this;
+  this->m_CombinationThreaderParameters.st_Parameters        = nullptr;
+  this->m_CombinationThreaderParameters.st_DerivativePointer = nullptr;
   this->ComputeGradientOff();
 
 } // end Constructor
@@ -182,6 +189,10 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
 
   /** Add debugging information. */
   os << "NumberOfMetrics: " << this->m_NumberOfMetrics << std::endl;
+  os << "UseConcurrentMetricEvaluation: "
+     << ( this->m_UseConcurrentMetricEvaluation ? "true" : "false" ) << std::endl;
+  os << "UseSharedTransformResults: "
+     << ( this->m_UseSharedTransformResults ? "true" : "false" ) << std::endl;
   for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
   {
     os << "Metric " << i << ":\n";
@@ -198,6 +209,75 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
 } // end PrintSelf()
 
 
+/**
+ * ********************* InternalClone ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+LightObject::Pointer
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::InternalClone( void ) const
+{
+  /** The components of the superclass, which are those of the first metric. */
+  Pointer clone = Self::New();
+  if( !this->Superclass::CopySettingsToClone( clone ) )
+  {
+    return LightObject::Pointer();
+  }
+
+  std::map< const TransformType *, TransformPointer >     transforms;
+  std::map< const ImageSamplerType *, ImageSamplerType * > samplers;
+  if( this->m_AdvancedTransform.IsNotNull() )
+  {
+    transforms[ this->m_AdvancedTransform.GetPointer() ] = clone->m_AdvancedTransform;
+  }
+
+  clone->SetNumberOfMetrics( this->m_NumberOfMetrics );
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; ++i )
+  {
+    const ImageMetricType * metric = dynamic_cast< const ImageMetricType * >( this->GetMetric( i ) );
+    if( metric == nullptr )
+    {
+      return LightObject::Pointer();
+    }
+    ImageMetricPointer metricClone = metric->Clone();
+    if( metricClone.IsNull() )
+    {
+      return LightObject::Pointer();
+    }
+
+    /** Replace the clones of shared components by a single clone. */
+    const TransformType * transform = metric->GetTransform();
+    if( transforms.count( transform ) == 0 )
+    {
+      transforms[ transform ] = const_cast< TransformType * >( metricClone->GetTransform() );
+    }
+    metricClone->SetTransform( transforms[ transform ] );
+
+    const ImageSamplerType * sampler = metric->GetImageSampler();
+    if( sampler != nullptr )
+    {
+      if( samplers.count( sampler ) == 0 )
+      {
+        samplers[ sampler ] = metricClone->GetImageSampler();
+      }
+      metricClone->SetImageSampler( samplers[ sampler ] );
+    }
+
+    clone->m_Metrics[ i ]               = metricClone.GetPointer();
+    clone->m_MetricWeights[ i ]         = this->m_MetricWeights[ i ];
+    clone->m_MetricRelativeWeights[ i ] = this->m_MetricRelativeWeights[ i ];
+    clone->m_UseMetric[ i ]             = this->m_UseMetric[ i ];
+  }
+
+  clone->m_UseRelativeWeights            = this->m_UseRelativeWeights;
+  clone->m_UseConcurrentMetricEvaluation = this->m_UseConcurrentMetricEvaluation;
+  clone->m_UseSharedTransformResults     = this->m_UseSharedTransformResults;
+  return clone.GetPointer();
+
+} // end InternalClone()
+
+
 /**
  * ******************** SetFixedImageRegion ************************
  */
@@ -858,25 +938,52 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
   /** Initialize some threading related parameters. */
   this->InitializeThreadingParameters();
 
+  /** Check if the metrics can be computed concurrently. */
+  const bool concurrent = this->m_UseConcurrentMetricEvaluation
+    && this->m_UseMultiThread && this->m_NumberOfMetrics > 1
+    && this->CanEvaluateMetricsConcurrently();
+
+  /** Compute the transform results that are shared by several metrics. */
+  if( this->m_UseSharedTransformResults )
+  {
+    this->ShareTransformResults();
+  }
+
   /** Compute all metric values and derivatives. */
-  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  try
   {
-    /** Compute ... */
-    timer.Reset();
-    timer.Start();
-    this->m_Metrics[ i ]->GetValueAndDerivative( parameters,
-      this->m_MetricValues[ i ], this->m_MetricDerivatives[ i ] );
-    timer.Stop();
+    if( concurrent )
+    {
+      this->LaunchComputeMetricsThreaderCallback( parameters );
+    }
+    else
+    {
+      for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+      {
+        /** Compute ... */
+        timer.Reset();
+        timer.Start();
+        this->m_Metrics[ i ]->GetValueAndDerivative( parameters,
+          this->m_MetricValues[ i ], this->m_MetricDerivatives[ i ] );
+        timer.Stop();
+
+        /** Store computation time. */
+        this->m_MetricComputationTime[ i ] = timer.GetMean() * 1000.0;
+      }
 
-    /** Store computation time. */
-    this->m_MetricComputationTime[ i ] = timer.GetMean() * 1000.0;
+      /** Compute the derivative magnitude. */
+      for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+      {
+        this->m_MetricDerivativesMagnitude[ i ] = this->m_MetricDerivatives[ i ].magnitude();
+      }
+    }
   }
-
-  /** Compute the derivative magnitude. */
-  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  catch( ... )
   {
-    this->m_MetricDerivativesMagnitude[ i ] = this->m_MetricDerivatives[ i ].magnitude();
+    this->ReleaseSharedTransformResults();
+    throw;
   }
+  this->ReleaseSharedTransformResults();
 
   /** Combine the metric values. */
   value = NumericTraits< MeasureType >::Zero;
@@ -889,6 +996,13 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
     }
   }
 
+  /** Combine the metric derivatives in parallel. */
+  if( concurrent )
+  {
+    this->LaunchCombineDerivativesThreaderCallback( derivative );
+    return;
+  }
+
   /** Combine the metric derivatives. First, the first derivative. */
   if( this->m_UseMetric[ 0 ] )
   {
@@ -913,6 +1027,286 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetValueAndDerivative()
 
 
+/**
+ * ******************* ShareTransformResults *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::ShareTransformResults( void ) const
+{
+  /** Allocate the storage before pointers to it are handed out. */
+  this->m_SharedTransformResults.resize( this->m_NumberOfMetrics );
+
+  std::vector< bool > assigned( this->m_NumberOfMetrics, false );
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    ImageMetricType * leader = dynamic_cast< ImageMetricType * >( this->GetMetric( i ) );
+    if( assigned[ i ] || !leader || !leader->GetUseImageSampler()
+      || !leader->GetUseMultiThread() )
+    {
+      continue;
+    }
+
+    /** Find the other metrics that sample and transform the same points. */
+    std::vector< ImageMetricType * > group( 1, leader );
+    for( unsigned int j = i + 1; j < this->m_NumberOfMetrics; j++ )
+    {
+      ImageMetricType * metric = dynamic_cast< ImageMetricType * >( this->GetMetric( j ) );
+      if( !assigned[ j ] && metric && metric->GetUseImageSampler()
+        && metric->GetUseMultiThread()
+        && metric->GetImageSampler() == leader->GetImageSampler()
+        && metric->GetTransform() == leader->GetTransform() )
+      {
+        group.push_back( metric );
+        assigned[ j ] = true;
+      }
+    }
+
+    /** Sharing only pays off if at least two metrics use the results. */
+    if( group.size() < 2 )
+    {
+      continue;
+    }
+
+    leader->ComputeSharedTransformResults( this->m_SharedTransformResults[ i ] );
+    for( std::size_t k = 0; k < group.size(); ++k )
+    {
+      group[ k ]->SetSharedTransformResults( &this->m_SharedTransformResults[ i ] );
+    }
+  }
+
+} // end ShareTransformResults()
+
+
+/**
+ * ******************* ReleaseSharedTransformResults *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::ReleaseSharedTransformResults( void ) const
+{
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    ImageMetricType * metric = dynamic_cast< ImageMetricType * >( this->GetMetric( i ) );
+    if( metric )
+    {
+      metric->SetSharedTransformResults( nullptr );
+    }
+  }
+
+} // end ReleaseSharedTransformResults()
+
+
+/**
+ * ******************* CanEvaluateMetricsConcurrently *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::CanEvaluateMetricsConcurrently( void ) const
+{
+  /** Interpolators and image samplers are not thread-safe, so they
+   * may not be shared by metrics that run at the same time.
+   */
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    const ImageMetricType * metric_i = dynamic_cast< const ImageMetricType * >( this->GetMetric( i ) );
+    if( !metric_i )
+    {
+      continue;
+    }
+    for( unsigned int j = i + 1; j < this->m_NumberOfMetrics; j++ )
+    {
+      const ImageMetricType * metric_j = dynamic_cast< const ImageMetricType * >( this->GetMetric( j ) );
+      if( !metric_j )
+      {
+        continue;
+      }
+      if( metric_i->GetInterpolator() == metric_j->GetInterpolator() )
+      {
+        return false;
+      }
+      if( metric_i->GetUseImageSampler() && metric_j->GetUseImageSampler()
+        && metric_i->GetImageSampler() == metric_j->GetImageSampler() )
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+
+} // end CanEvaluateMetricsConcurrently()
+
+
+/**
+ * ******************* ComputeMetricsThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMetricsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+
+  CombinationMetricMultiThreaderParameterType * temp
+    = static_cast< CombinationMetricMultiThreaderParameterType * >( infoStruct->UserData );
+  const Self * self = temp->st_Metric;
+
+  /** Every thread takes the next metric from the list, until all are done. */
+  unsigned int task = self->m_NextMetricTask++;
+  while( task < self->m_NumberOfMetrics )
+  {
+    const unsigned int i = self->m_MetricTaskOrder[ task ];
+
+    /** Compute ... */
+    itk::TimeProbe timer;
+    timer.Start();
+    try
+    {
+      self->m_Metrics[ i ]->GetValueAndDerivative( *temp->st_Parameters,
+        self->m_MetricValues[ i ], self->m_MetricDerivatives[ i ] );
+    }
+    catch( ... )
+    {
+      /** Exceptions may not leave a thread; rethrow them after the join. */
+      self->m_MetricExceptions[ i ] = std::current_exception();
+    }
+    timer.Stop();
+
+    /** Store computation time and the derivative magnitude. */
+    self->m_MetricComputationTime[ i ]      = timer.GetMean() * 1000.0;
+    self->m_MetricDerivativesMagnitude[ i ] = self->m_MetricDerivatives[ i ].magnitude();
+
+    task = self->m_NextMetricTask++;
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeMetricsThreaderCallback()
+
+
+/**
+ * *********************** LaunchComputeMetricsThreaderCallback ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::LaunchComputeMetricsThreaderCallback( const ParametersType & parameters ) const
+{
+  /** Start with the metrics that took longest in the previous iteration,
+   * so that the cheap ones fill up the remaining threads.
+   */
+  this->m_MetricTaskOrder.resize( this->m_NumberOfMetrics );
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    this->m_MetricTaskOrder[ i ] = i;
+  }
+  const std::vector< double > & times = this->m_MetricComputationTime;
+  std::stable_sort( this->m_MetricTaskOrder.begin(), this->m_MetricTaskOrder.end(),
+    [ &times ]( const unsigned int a, const unsigned int b ) { return times[ a ] > times[ b ]; } );
+
+  this->m_NextMetricTask = 0;
+  this->m_MetricExceptions.assign( this->m_NumberOfMetrics, std::exception_ptr() );
+  this->m_CombinationThreaderParameters.st_Parameters = &parameters;
+
+  /** Setup threader and launch. */
+  this->m_Threader->SetSingleMethod( this->ComputeMetricsThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_CombinationThreaderParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+  /** Pass on the first exception, if any. */
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    if( this->m_MetricExceptions[ i ] )
+    {
+      std::rethrow_exception( this->m_MetricExceptions[ i ] );
+    }
+  }
+
+} // end LaunchComputeMetricsThreaderCallback()
+
+
+/**
+ * ******************* CombineDerivativesThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_TYPE
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::CombineDerivativesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID    = infoStruct->WorkUnitID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfWorkUnits;
+
+  CombinationMetricMultiThreaderParameterType * temp
+    = static_cast< CombinationMetricMultiThreaderParameterType * >( infoStruct->UserData );
+  const Self * self = temp->st_Metric;
+
+  const unsigned int numPar  = self->GetNumberOfParameters();
+  const unsigned int subSize = static_cast< unsigned int >(
+    std::ceil( static_cast< double >( numPar )
+    / static_cast< double >( nrOfThreads ) ) );
+  const unsigned int jmin = std::min( threadID * subSize, numPar );
+  const unsigned int jmax = std::min( ( threadID + 1 ) * subSize, numPar );
+
+  /** This thread computes the weighted sum of the derivatives for the
+   * range [ jmin, jmax [, in the same order as the serial code.
+   */
+  DerivativeValueType * derivative = temp->st_DerivativePointer;
+  for( unsigned int j = jmin; j < jmax; ++j )
+  {
+    DerivativeValueType tmp = NumericTraits< DerivativeValueType >::Zero;
+    for( unsigned int i = 0; i < self->m_NumberOfMetrics; i++ )
+    {
+      if( self->m_UseMetric[ i ] )
+      {
+        tmp += self->m_FinalMetricWeights[ i ] * self->m_MetricDerivatives[ i ][ j ];
+      }
+    }
+    derivative[ j ] = tmp;
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end CombineDerivativesThreaderCallback()
+
+
+/**
+ * *********************** LaunchCombineDerivativesThreaderCallback ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::LaunchCombineDerivativesThreaderCallback( DerivativeType & derivative ) const
+{
+  /** Compute the weights once, instead of once per parameter. */
+  this->m_FinalMetricWeights.resize( this->m_NumberOfMetrics );
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    this->m_FinalMetricWeights[ i ] = this->GetFinalMetricWeight( i );
+  }
+
+  derivative.SetSize( this->GetNumberOfParameters() );
+  this->m_CombinationThreaderParameters.st_DerivativePointer = derivative.data_block();
+
+  /** Setup threader and launch. */
+  this->m_Threader->SetSingleMethod( this->CombineDerivativesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >( &this->m_CombinationThreaderParameters ) ) );
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchCombineDerivativesThreaderCallback()
+
+
 /**
  * ********************* GetSelfHessian ****************************
  */
@@ -76,6 +76,14 @@ namespace elastix
  *   <em>Nonrigid registration of dynamic medical imaging data using nD+t B-splines and a
  *   groupwise optimization approach</em>, C.T. Metz, S. Klein, M. Schaap, T. van Walsum and
  *   W.J. Niessen, Medical Image Analysis, in press.
+ * \parameter BSplineTransformUseSinglePrecision: evaluate the transformation and its
+ *   spatial Jacobian on a single precision (float) copy of the B-spline coefficients,
+ *   with single precision weights. This halves the memory traffic for the coefficients,
+ *   which pays off for large, memory-bound registrations. The optimizer and the metric
+ *   accumulation remain in double precision. Not available for the cyclic transform.
+ *   Combine with the BSplineInterpolatorFloat for single precision interpolation. \n
+ *   example: <tt>(BSplineTransformUseSinglePrecision "true")</tt> \n
+ *   Default value: "false".
  *
  *
  * The transform parameters necessary for transformix, additionally defined by this class, are:
@@ -99,6 +107,10 @@ namespace elastix
  *   <em>Nonrigid registration of dynamic medical imaging data using nD+t B-splines and a
  *   groupwise optimization approach</em>, C.T. Metz, S. Klein, M. Schaap, T. van Walsum and
  *   W.J. Niessen, Medical Image Analysis, in press.
+ * \transformparameter BSplineTransformUseSinglePrecision: evaluate the transformation on
+ *   a single precision copy of the B-spline coefficients. \n
+ *   example: <tt>(BSplineTransformUseSinglePrecision "true")</tt> \n
+ *   Default value: "false".
  *
  * \todo It is unsure what happens when one of the image dimensions has length 1.
  *
@@ -307,9 +319,10 @@ private:
   GridScheduleComputerPointer m_GridScheduleComputer;
   GridUpsamplerPointer        m_GridUpsampler;
 
-  /** Variables to remember order and periodicity of B-spline transform. */
+  /** Variables to remember order, periodicity and precision of B-spline transform. */
   unsigned int m_SplineOrder;
   bool         m_Cyclic;
+  bool         m_UseSinglePrecision;
 
   /** Initialize the right B-spline transform based on the spline order and periodicity. */
   unsigned int InitializeBSplineTransform();
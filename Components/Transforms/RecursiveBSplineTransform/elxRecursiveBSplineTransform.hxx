@@ -33,7 +33,11 @@ namespace elastix
 template< class TElastix >
 RecursiveBSplineTransform< TElastix >
 ::RecursiveBSplineTransform()
-{} // end Constructor()
+{
+  this->m_SplineOrder        = 3;
+  this->m_Cyclic             = false;
+  this->m_UseSinglePrecision = false;
+} // end Constructor()
 
 
 /**
@@ -48,6 +52,13 @@ RecursiveBSplineTransform< TElastix >
   /** Initialize the right BSplineTransform and GridScheduleComputer. */
   if( this->m_Cyclic )
   {
+    if( this->m_UseSinglePrecision )
+    {
+      xl::xout[ "warning" ]
+        << "WARNING: BSplineTransformUseSinglePrecision is not supported for the "
+        << "cyclic transform, and is ignored." << std::endl;
+    }
+
     this->m_GridScheduleComputer = CyclicGridScheduleComputerType::New();
     this->m_GridScheduleComputer->SetBSplineOrder( this->m_SplineOrder );
 
@@ -76,15 +87,21 @@ RecursiveBSplineTransform< TElastix >
 
     if( this->m_SplineOrder == 1 )
     {
-      this->m_BSplineTransform = BSplineTransformLinearType::New();
+      typename BSplineTransformLinearType::Pointer transform = BSplineTransformLinearType::New();
+      transform->SetUseSinglePrecision( this->m_UseSinglePrecision );
+      this->m_BSplineTransform = transform;
     }
     else if( this->m_SplineOrder == 2 )
     {
-      this->m_BSplineTransform = BSplineTransformQuadraticType::New();
+      typename BSplineTransformQuadraticType::Pointer transform = BSplineTransformQuadraticType::New();
+      transform->SetUseSinglePrecision( this->m_UseSinglePrecision );
+      this->m_BSplineTransform = transform;
     }
     else if( this->m_SplineOrder == 3 )
     {
-      this->m_BSplineTransform = BSplineTransformCubicType::New();
+      typename BSplineTransformCubicType::Pointer transform = BSplineTransformCubicType::New();
+      transform->SetUseSinglePrecision( this->m_UseSinglePrecision );
+      this->m_BSplineTransform = transform;
     }
     else
     {
@@ -117,6 +134,9 @@ RecursiveBSplineTransform< TElastix >
   this->m_Cyclic = false;
   this->GetConfiguration()->ReadParameter( this->m_Cyclic,
     "UseCyclicTransform", this->GetComponentLabel(), 0, 0, true );
+  this->m_UseSinglePrecision = false;
+  this->GetConfiguration()->ReadParameter( this->m_UseSinglePrecision,
+    "BSplineTransformUseSinglePrecision", this->GetComponentLabel(), 0, 0, true );
 
   return this->InitializeBSplineTransform();
 } // end BeforeAll()
@@ -496,6 +516,9 @@ RecursiveBSplineTransform< TElastix >
   m_Cyclic = false;
   this->GetConfiguration()->ReadParameter( m_Cyclic,
     "UseCyclicTransform", this->GetComponentLabel(), 0, 0 );
+  m_UseSinglePrecision = false;
+  this->GetConfiguration()->ReadParameter( m_UseSinglePrecision,
+    "BSplineTransformUseSinglePrecision", this->GetComponentLabel(), 0, 0 );
   InitializeBSplineTransform();
 
   /** Read and Set the Grid: this is a BSplineTransform specific task. */
@@ -626,6 +649,8 @@ RecursiveBSplineTransform< TElastix >
     m_CyclicString = "true";
   }
   xout[ "transpar" ] << "(UseCyclicTransform \"" << m_CyclicString << "\")" << std::endl;
+  xout[ "transpar" ] << "(BSplineTransformUseSinglePrecision \""
+                     << ( m_UseSinglePrecision ? "true" : "false" ) << "\")" << std::endl;
 
   /** Set the precision back to default value. */
   xout[ "transpar" ] << std::setprecision(
@@ -738,6 +763,11 @@ RecursiveBSplineTransform< TElastix >
   paramsMap->insert( make_pair( parameterName, parameterValues ) );
   parameterValues.clear();
 
+  parameterName = "BSplineTransformUseSinglePrecision";
+  parameterValues.push_back( this->m_UseSinglePrecision ? "true" : "false" );
+  paramsMap->insert( make_pair( parameterName, parameterValues ) );
+  parameterValues.clear();
+
   /** Set the precision back to default value. */
 //  xout["transpar"] << std::setprecision(
 //  this->m_Elastix->GetDefaultOutputPrecision() );
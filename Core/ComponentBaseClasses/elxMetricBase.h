@@ -63,6 +63,18 @@ namespace elastix
  *    CheckNumberOfSamples. \n
  *    example: <tt>(RequiredRatioOfValidSamples 0.1)</tt> \n
  *    The default is 0.25.
+ * \parameter UseEvaluationCache: Whether the metric reuses the value and derivative
+ *    of its last evaluation when it is evaluated again at exactly the same parameters,
+ *    which line search optimizers may do. Can be given for each resolution or for
+ *    all resolutions at once. \n
+ *    example: <tt>(UseEvaluationCache "true")</tt> \n
+ *    The default is false.
+ * \parameter UseSampleChunkStealing: Whether threads that finished their own
+ *    samples take over samples of the other threads. This balances the load, but
+ *    makes the metric value and derivative differ in the last bits between runs.
+ *    Can be given for each resolution or for all resolutions at once. \n
+ *    example: <tt>(UseSampleChunkStealing "true")</tt> \n
+ *    The default is false, which gives reproducible results.
  *
  * \ingroup Metrics
  * \ingroup ComponentBaseClasses
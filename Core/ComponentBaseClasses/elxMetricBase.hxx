@@ -180,6 +180,18 @@ MetricBase< TElastix >
       }
     }
 
+    /** Should the metric reuse the result of an evaluation at the same parameters? */
+    bool useEvaluationCache = false;
+    this->GetConfiguration()->ReadParameter( useEvaluationCache,
+      "UseEvaluationCache", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseEvaluationCache( useEvaluationCache );
+
+    /** Should threads that are done steal samples from the other threads? */
+    bool useSampleChunkStealing = false;
+    this->GetConfiguration()->ReadParameter( useSampleChunkStealing,
+      "UseSampleChunkStealing", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetUseSampleChunkStealing( useSampleChunkStealing );
+
   } // end advanced metric
 
 } // end BeforeEachResolutionBase()
@@ -134,10 +134,10 @@ ComponentDatabase::SetIndex(
 ComponentDatabase::PtrToCreator
 ComponentDatabase::GetCreator(
   const ComponentDescriptionType & name,
-  IndexType i )
+  IndexType i ) const
 {
   /** Get the map */
-  CreatorMapType map = GetCreatorMap();
+  const CreatorMapType & map = this->CreatorMap;
 
   /** Make a key with the input arguments */
   CreatorMapKeyType key( name, i );
@@ -145,7 +145,8 @@ ComponentDatabase::GetCreator(
   /** Check if this key has been defined. If yes, return the 'creator'
    * that is linked to it.
    */
-  if( map.count( key ) == 0 )    // of gewoon !map.count( key ) als boven??
+  const CreatorMapType::const_iterator it = map.find( key );
+  if( it == map.end() )
   {
     xout[ "error" ] << "Error: " << std::endl;
     xout[ "error" ] << name << "(index " << i << ") - This component is not installed!" << std::endl;
@@ -153,7 +154,7 @@ ComponentDatabase::GetCreator(
   }
   else
   {
-    return map[ key ];
+    return it->second;
   }
 
 } // end GetCreator
@@ -168,10 +169,10 @@ ComponentDatabase::GetIndex(
   const PixelTypeDescriptionType & fixedPixelType,
   ImageDimensionType fixedDimension,
   const PixelTypeDescriptionType & movingPixelType,
-  ImageDimensionType movingDimension )
+  ImageDimensionType movingDimension ) const
 {
   /** Get the map */
-  IndexMapType map = GetIndexMap();
+  const IndexMapType & map = this->IndexMap;
 
   /** Make a key with the input arguments */
   ImageTypeDescriptionType fixedImage( fixedPixelType, fixedDimension );
@@ -181,7 +182,8 @@ ComponentDatabase::GetIndex(
   /** Check if this key has been defined. If yes, return the 'index'
    * that is linked to it.
    */
-  if( map.count( key ) == 0 )
+  const IndexMapType::const_iterator it = map.find( key );
+  if( it == map.end() )
   {
     xout[ "error" ] << "ERROR:\n"
                     << "  FixedImageType:  " << fixedDimension << "D " << fixedPixelType << std::endl
@@ -196,7 +198,7 @@ ComponentDatabase::GetIndex(
   }
   else
   {
-    return map[ key ];
+    return it->second;
   }
 
 } // end GetIndex
@@ -125,16 +125,18 @@ public:
     ImageDimensionType movingDimension,
     IndexType i );
 
-  /** Functions to get an entry in a map */
+  /** Functions to get an entry in a map. They do not modify the maps, so
+   * they may be called concurrently once the components are installed.
+   */
   PtrToCreator GetCreator(
     const ComponentDescriptionType & name,
-    IndexType i );
+    IndexType i ) const;
 
   IndexType GetIndex(
     const PixelTypeDescriptionType & fixedPixelType,
     ImageDimensionType fixedDimension,
     const PixelTypeDescriptionType & movingPixelType,
-    ImageDimensionType movingDimension );
+    ImageDimensionType movingDimension ) const;
 
 protected:
 
@@ -27,7 +27,11 @@
 #include "elxElastixMain.h"
 
 #include "elxMacro.h"
-#include "itkPlatformMultiThreader.h"
+#include "itkSharedThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
 
 #ifdef ELASTIX_USE_OPENCL
 #include "itkOpenCLSetup.h"
@@ -39,22 +43,35 @@ namespace elastix
 using namespace xl;
 
 /**
- * ******************* Global variables *************************
+ * ******************* xout targets *************************
  *
- * Some global variables (not part of the ElastixMain class, used
- * by xoutSetup.
+ * The xout objects and the log file that are set up by xoutSetup.
+ * They are kept per thread, so that registrations that run concurrently
+ * in one process, each in their own thread, do not share them.
  */
 
-/** \todo move to ElastixMain class, as static vars? */
+namespace
+{
 
-/** xout TargetCells. */
-xoutbase_type   g_xout;
-xoutsimple_type g_WarningXout;
-xoutsimple_type g_ErrorXout;
-xoutsimple_type g_StandardXout;
-xoutsimple_type g_CoutOnlyXout;
-xoutsimple_type g_LogOnlyXout;
-std::ofstream   g_LogFileStream;
+struct xoutTargets
+{
+  xoutbase_type   Xout;
+  xoutsimple_type WarningXout;
+  xoutsimple_type ErrorXout;
+  xoutsimple_type StandardXout;
+  xoutsimple_type CoutOnlyXout;
+  xoutsimple_type LogOnlyXout;
+  std::ofstream   LogFileStream;
+
+  ~xoutTargets()
+  {
+    release_xout( &this->Xout );
+  }
+};
+
+thread_local std::unique_ptr< xoutTargets > t_xoutTargets;
+
+} // end namespace
 
 /**
  * ********************* xoutSetup ******************************
@@ -69,14 +86,17 @@ xoutSetup( const char * logfilename, bool setupLogging, bool setupCout )
   /** The namespace of xout. */
   using namespace xl;
 
+  /** Replace the targets of a previous call in this thread. */
   int returndummy = 0;
-  set_xout( &g_xout );
+  t_xoutTargets.reset( new xoutTargets );
+  xoutTargets & targets = *t_xoutTargets;
+  set_xout( &targets.Xout );
 
   if( setupLogging )
   {
     /** Open the logfile for writing. */
-    g_LogFileStream.open( logfilename );
-    if( !g_LogFileStream.is_open() )
+    targets.LogFileStream.open( logfilename );
+    if( !targets.LogFileStream.is_open() )
     {
       std::cerr << "ERROR: LogFile cannot be opened!" << std::endl;
       return 1;
@@ -86,7 +106,7 @@ xoutSetup( const char * logfilename, bool setupLogging, bool setupCout )
   /** Set std::cout and the logfile as outputs of xout. */
   if( setupLogging )
   {
-    returndummy |= xout.AddOutput( "log", &g_LogFileStream );
+    returndummy |= xout.AddOutput( "log", &targets.LogFileStream );
   }
   if( setupCout )
   {
@@ -94,24 +114,24 @@ xoutSetup( const char * logfilename, bool setupLogging, bool setupCout )
   }
 
   /** Set outputs of LogOnly and CoutOnly. */
-  returndummy |= g_LogOnlyXout.AddOutput( "log", &g_LogFileStream );
-  returndummy |= g_CoutOnlyXout.AddOutput( "cout", &std::cout );
+  returndummy |= targets.LogOnlyXout.AddOutput( "log", &targets.LogFileStream );
+  returndummy |= targets.CoutOnlyXout.AddOutput( "cout", &std::cout );
 
   /** Copy the outputs to the warning-, error- and standard-xouts. */
-  g_WarningXout.SetOutputs( xout.GetCOutputs() );
-  g_ErrorXout.SetOutputs( xout.GetCOutputs() );
-  g_StandardXout.SetOutputs( xout.GetCOutputs() );
+  targets.WarningXout.SetOutputs( xout.GetCOutputs() );
+  targets.ErrorXout.SetOutputs( xout.GetCOutputs() );
+  targets.StandardXout.SetOutputs( xout.GetCOutputs() );
 
-  g_WarningXout.SetOutputs( xout.GetXOutputs() );
-  g_ErrorXout.SetOutputs( xout.GetXOutputs() );
-  g_StandardXout.SetOutputs( xout.GetXOutputs() );
+  targets.WarningXout.SetOutputs( xout.GetXOutputs() );
+  targets.ErrorXout.SetOutputs( xout.GetXOutputs() );
+  targets.StandardXout.SetOutputs( xout.GetXOutputs() );
 
   /** Link the warning-, error- and standard-xouts to xout. */
-  returndummy |= xout.AddTargetCell( "warning", &g_WarningXout );
-  returndummy |= xout.AddTargetCell( "error", &g_ErrorXout );
-  returndummy |= xout.AddTargetCell( "standard", &g_StandardXout );
-  returndummy |= xout.AddTargetCell( "logonly", &g_LogOnlyXout );
-  returndummy |= xout.AddTargetCell( "coutonly", &g_CoutOnlyXout );
+  returndummy |= xout.AddTargetCell( "warning", &targets.WarningXout );
+  returndummy |= xout.AddTargetCell( "error", &targets.ErrorXout );
+  returndummy |= xout.AddTargetCell( "standard", &targets.StandardXout );
+  returndummy |= xout.AddTargetCell( "logonly", &targets.LogOnlyXout );
+  returndummy |= xout.AddTargetCell( "coutonly", &targets.CoutOnlyXout );
 
   /** Format the output. */
   xout[ "standard" ] << std::fixed;
@@ -165,12 +185,54 @@ ElastixMain::ElastixMain()
 ElastixMain::ComponentDatabasePointer ElastixMain::s_CDB;
 ElastixMain::ComponentLoaderPointer   ElastixMain::s_ComponentLoader;
 
+namespace
+{
+/** Guards s_CDB, s_ComponentLoader and the two variables below. */
+std::mutex componentDatabaseMutex;
+
+/** The number of ElastixMain objects that hold a reference to s_CDB. */
+unsigned int numberOfComponentUsers = 0;
+
+/** Whether UnloadComponents() was called while the components were in use. */
+bool unloadComponentsRequested = false;
+
+/** Close the modules. Must be called with componentDatabaseMutex locked. */
+void
+UnloadComponentsLocked( ElastixMain::ComponentDatabasePointer & cdb,
+  ElastixMain::ComponentLoaderPointer & loader )
+{
+  cdb = 0;
+  if( loader )
+  {
+    loader->SetComponentDatabase( 0 );
+    loader->UnloadComponents();
+  }
+  loader                    = 0;
+  unloadComponentsRequested = false;
+}
+
+}
+
 /**
  * ********************** Destructor ****************************
  */
 
 ElastixMain::~ElastixMain()
 {
+  /** Release the component database, and close the modules if that was
+   * requested while this object was using them.
+   */
+  if( this->m_CDB.IsNotNull() )
+  {
+    std::lock_guard< std::mutex > lock( componentDatabaseMutex );
+    this->m_CDB = 0;
+    --numberOfComponentUsers;
+    if( numberOfComponentUsers == 0 && unloadComponentsRequested )
+    {
+      UnloadComponentsLocked( s_CDB, s_ComponentLoader );
+    }
+  }
+
 #ifdef ELASTIX_USE_OPENCL
   itk::OpenCLContext::Pointer context = itk::OpenCLContext::GetInstance();
   if( context->IsCreated() )
@@ -320,7 +382,7 @@ ElastixMain::Run( void )
 
   /** Set some information in the ElastixBase. */
   this->GetElastixBase()->SetConfiguration( this->m_Configuration );
-  this->GetElastixBase()->SetComponentDatabase( this->s_CDB );
+  this->GetElastixBase()->SetComponentDatabase( this->m_CDB );
   this->GetElastixBase()->SetDBIndex( this->m_DBIndex );
 
   /** Populate the component containers. ImageSampler is not mandatory.
@@ -636,7 +698,7 @@ ElastixMain::InitDBIndex( void )
     }
 
     /** Load the components. */
-    if( this->s_CDB.IsNull() )
+    if( this->m_CDB.IsNull() )
     {
       int loadReturnCode = this->LoadComponents();
       if( loadReturnCode != 0 )
@@ -646,10 +708,10 @@ ElastixMain::InitDBIndex( void )
       }
     }
 
-    if( this->s_CDB.IsNotNull() )
+    if( this->m_CDB.IsNotNull() )
     {
       /** Get the DBIndex from the ComponentDatabase. */
-      this->m_DBIndex = this->s_CDB->GetIndex(
+      this->m_DBIndex = this->m_CDB->GetIndex(
         this->m_FixedImagePixelType,
         this->m_FixedImageDimension,
         this->m_MovingImagePixelType,
@@ -660,7 +722,7 @@ ElastixMain::InitDBIndex( void )
         xout[ "error" ] << "Something went wrong in the ComponentDatabase" << std::endl;
         return 1;
       }
-    } // end if s_CDB!=0
+    } // end if m_CDB!=0
 
   } // end if m_Configuration->Initialized();
   else
@@ -738,25 +800,40 @@ ElastixMain::GetTotalNumberOfElastixLevels( void )
 int
 ElastixMain::LoadComponents( void )
 {
-  /** Create a ComponentDatabase. */
-  if( this->s_CDB.IsNull() )
+  std::lock_guard< std::mutex > lock( componentDatabaseMutex );
+
+  /** Fill the shared ComponentDatabase only once. */
+  if( s_CDB.IsNull() )
   {
-    this->s_CDB = ComponentDatabaseType::New();
+    /** Create a ComponentDatabase and a ComponentLoader. */
+    ComponentDatabasePointer cdb    = ComponentDatabaseType::New();
+    ComponentLoaderPointer   loader = ComponentLoaderType::New();
+    loader->SetComponentDatabase( cdb );
+
+    /** Get the current program. */
+    const std::string argv0
+      = this->m_Configuration->GetCommandLineArgument( "-argv0" );
+
+    /** Load the components. */
+    const int loadReturnCode = loader->LoadComponents( argv0.c_str() );
+    if( loadReturnCode != 0 )
+    {
+      return loadReturnCode;
+    }
+
+    /** Publish the database only after it is complete. */
+    s_CDB             = cdb;
+    s_ComponentLoader = loader;
   }
 
-  /** Create a ComponentLoader and set the database. */
-  if( this->s_ComponentLoader.IsNull() )
+  /** Register this object as a user of the database. */
+  if( this->m_CDB.IsNull() )
   {
-    this->s_ComponentLoader = ComponentLoaderType::New();
-    this->s_ComponentLoader->SetComponentDatabase( s_CDB );
+    ++numberOfComponentUsers;
   }
-
-  /** Get the current program. */
-  const char * argv0
-    = this->m_Configuration->GetCommandLineArgument( "-argv0" ).c_str();
-
-  /** Load the components. */
-  return this->s_ComponentLoader->LoadComponents( argv0 );
+  this->m_CDB               = s_CDB;
+  unloadComponentsRequested = false;
+  return 0;
 
 } // end LoadComponents()
 
@@ -768,19 +845,50 @@ ElastixMain::LoadComponents( void )
 void
 ElastixMain::UnloadComponents( void )
 {
-  s_CDB = 0;
-  s_ComponentLoader->SetComponentDatabase( 0 );
-
-  if( s_ComponentLoader )
+  /** If registrations are still running, the modules are closed when the
+   * last of them releases the database.
+   */
+  std::lock_guard< std::mutex > lock( componentDatabaseMutex );
+  if( numberOfComponentUsers > 0 )
   {
-    s_ComponentLoader->UnloadComponents();
+    unloadComponentsRequested = true;
+    return;
   }
 
-  s_ComponentLoader = 0;
+  UnloadComponentsLocked( s_CDB, s_ComponentLoader );
 
 } // end UnloadComponents()
 
 
+/**
+ * ********************* GetComponentDatabase **************************
+ */
+
+ComponentDatabase *
+ElastixMain::GetComponentDatabase( void )
+{
+  std::lock_guard< std::mutex > lock( componentDatabaseMutex );
+  return s_CDB.GetPointer();
+
+} // end GetComponentDatabase()
+
+
+/**
+ * ********************* SetComponentDatabase **************************
+ */
+
+void
+ElastixMain::SetComponentDatabase( ComponentDatabase * arg )
+{
+  std::lock_guard< std::mutex > lock( componentDatabaseMutex );
+  if( s_CDB != arg )
+  {
+    s_CDB = arg;
+  }
+
+} // end SetComponentDatabase()
+
+
 /**
  * ************************* GetElastixBase ***************************
  */
@@ -812,7 +920,7 @@ ElastixMain::CreateComponent(
 {
   /** A pointer to the New() function. */
   PtrToCreator  testcreator = 0;
-  testcreator = this->s_CDB->GetCreator( name,  this->m_DBIndex );
+  testcreator = this->m_CDB->GetCreator( name,  this->m_DBIndex );
 
   // Note that ObjectPointer() yields a default-constructed SmartPointer (null).
   ObjectPointer testpointer = testcreator ? testcreator() : ObjectPointer();
@@ -978,14 +1086,57 @@ ElastixMain::SetMaximumNumberOfThreads( void ) const
   std::string maximumNumberOfThreadsString
     = this->m_Configuration->GetCommandLineArgument( "-threads" );
 
-  /** If supplied, set the maximum number of threads. */
+  /** Set the maximum number of threads of the shared thread pool that work
+   * for this registration, which runs in the calling thread. It is set on
+   * every run, so that a value of an earlier run in this thread does not
+   * carry over. Registrations that run concurrently in other threads of this
+   * process have their own budget; no process-wide setting is changed here.
+   * The elastix and transformix executables additionally set the global ITK
+   * limit, for the filters that do not use the shared thread pool.
+   */
+  int maximumNumberOfThreads = 0;
   if( maximumNumberOfThreadsString != "" )
   {
-    const int maximumNumberOfThreads
-      = atoi( maximumNumberOfThreadsString.c_str() );
-    itk::MultiThreaderBase::SetGlobalMaximumNumberOfThreads(
-      maximumNumberOfThreads );
+    maximumNumberOfThreads = std::max( atoi( maximumNumberOfThreadsString.c_str() ), 0 );
+  }
+  itk::SharedThreadPool::SetThreadBudget( maximumNumberOfThreads );
+
+  /** Read whether the threads of the pool should be bound to CPUs. */
+  const std::string threadAffinityString
+    = this->m_Configuration->GetCommandLineArgument( "-threadaffinity" );
+  if( threadAffinityString != "" && threadAffinityString != "true"
+    && threadAffinityString != "false" )
+  {
+    xl::xout[ "warning" ]
+      << "Unsupported -threadaffinity value. Specify one of <true, false>." << std::endl;
+  }
+
+  /** The affinity is set once, before the threads of the pool are created,
+   * since it cannot be changed while other registrations use the pool.
+   */
+  itk::SharedThreadPool & pool = itk::SharedThreadPool::GetInstance();
+  static std::once_flag threadAffinityFlag;
+  std::call_once( threadAffinityFlag, [ &pool, &threadAffinityString ]{
+    pool.SetUseCPUAffinity( threadAffinityString == "true" );
+  } );
+  if( threadAffinityString != "" && pool.GetUseCPUAffinity() != ( threadAffinityString == "true" ) )
+  {
+    xl::xout[ "warning" ]
+      << "-threadaffinity is ignored, since the threads were bound by an earlier registration." << std::endl;
+  }
+
+  /** Make sure the shared thread pool can provide the default number of
+   * threads, or the budget of this registration if that is larger. The thread
+   * that starts a job also executes work units of it, so the pool needs one
+   * thread less. The pool only grows; its running threads are not restarted.
+   */
+  const unsigned int numberOfThreads = std::max( static_cast< unsigned int >( maximumNumberOfThreads ),
+    itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads() );
+  if( pool.GetNumberOfThreads() + 1 < numberOfThreads )
+  {
+    pool.SetNumberOfThreads( numberOfThreads - 1 );
   }
+
 } // end SetMaximumNumberOfThreads()
 
 
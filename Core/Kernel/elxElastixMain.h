@@ -48,6 +48,9 @@ namespace elastix
  * for writing messages. The function adds some default fields,
  * such as "warning", "error", "standard", "logonly" and "coutonly",
  * and it sets the outputs to std::cout and/or a logfile.
+ * The configuration applies to the calling thread, so that
+ * registrations in different threads each have their own logfile.
+ * A second call in the same thread replaces the configuration.
  *
  * The method takes a logfile name as its input argument.
  * It returns 0 if everything went ok. 1 otherwise.
@@ -270,30 +273,32 @@ public:
   virtual void SetProcessPriority( void ) const;
 
   /** Set maximum number of threads, which is read from the command line arguments.
+   * The number of threads is the budget of this registration in the shared
+   * thread pool, which applies to the calling thread only. Optionally the
+   * threads of the pool are bound to CPUs, which only the first registration
+   * of the process can set.
    * Syntax:
    * -threads \<int\>
+   * -threadaffinity \<true, false\>
    */
   virtual void SetMaximumNumberOfThreads( void ) const;
 
-  /** Functions to get/set the ComponentDatabase. */
-  static ComponentDatabase * GetComponentDatabase( void )
-  {
-    return s_CDB.GetPointer();
-  }
-
+  /** Functions to get/set the ComponentDatabase that is shared by the
+   * ElastixMain objects of this process. It is filled once by LoadComponents(),
+   * and not modified afterwards, so concurrent registrations can use it.
+   */
+  static ComponentDatabase * GetComponentDatabase( void );
 
-  static void SetComponentDatabase( ComponentDatabase * arg )
-  {
-    if( s_CDB != arg )
-    {
-      s_CDB = arg;
-    }
-  }
+  static void SetComponentDatabase( ComponentDatabase * arg );
 
 
   /** GetTransformParametersMap */
   virtual ParameterMapType GetTransformParametersMap( void ) const;
 
+  /** Close the modules and release the ComponentDatabase. If ElastixMain
+   * objects of other registrations still use the database, this is postponed
+   * until the last of them is destroyed. Thread-safe.
+   */
   static void UnloadComponents( void );
 
 protected:
@@ -340,8 +345,18 @@ protected:
 
   FlatDirectionCosinesType m_OriginalFixedImageDirection;
 
+  /** The shared ComponentDatabase and its loader, which are guarded by a
+   * mutex. Each ElastixMain object keeps its own reference in m_CDB, and is
+   * counted as a user of the database until it is destroyed, so that
+   * UnloadComponents() does not affect registrations that are running.
+   */
   static ComponentDatabasePointer s_CDB;
   static ComponentLoaderPointer   s_ComponentLoader;
+  ComponentDatabasePointer        m_CDB;
+
+  /** Load the components into the shared ComponentDatabase, if that was not
+   * done yet, and set m_CDB. Thread-safe.
+   */
   virtual int LoadComponents( void );
 
   /** InitDBIndex sets m_DBIndex by asking the ImageTypes
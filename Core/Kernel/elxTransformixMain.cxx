@@ -104,7 +104,7 @@ TransformixMain::Run( void )
 
   /** Set some information in the ElastixBase. */
   this->GetElastixBase()->SetConfiguration( this->m_Configuration );
-  this->GetElastixBase()->SetComponentDatabase( this->s_CDB );
+  this->GetElastixBase()->SetComponentDatabase( this->m_CDB );
   this->GetElastixBase()->SetDBIndex( this->m_DBIndex );
 
   /** Populate the component containers. No default is specified for the Transform. */
@@ -286,7 +286,7 @@ TransformixMain::InitDBIndex( void )
     }
 
     /** Load the components. */
-    if( this->s_CDB.IsNull() )
+    if( this->m_CDB.IsNull() )
     {
       int loadReturnCode = this->LoadComponents();
       if( loadReturnCode != 0 )
@@ -296,10 +296,10 @@ TransformixMain::InitDBIndex( void )
       }
     }
 
-    if( this->s_CDB.IsNotNull() )
+    if( this->m_CDB.IsNotNull() )
     {
       /** Get the DBIndex from the ComponentDatabase. */
-      this->m_DBIndex = this->s_CDB->GetIndex(
+      this->m_DBIndex = this->m_CDB->GetIndex(
         this->m_FixedImagePixelType,
         this->m_FixedImageDimension,
         this->m_MovingImagePixelType,
@@ -310,7 +310,7 @@ TransformixMain::InitDBIndex( void )
         xl::xout[ "error" ] << "Something went wrong in the ComponentDatabase." << std::endl;
         return 1;
       }
-    } //end if s_CDB!=0
+    } //end if m_CDB!=0
 
   } // end if m_Configuration->Initialized();
   else
@@ -18,6 +18,7 @@
 
 #include "elastix.h"
 #include "elxElastixMain.h"
+#include "itkMultiThreaderBase.h"
 
 #include <cstddef> // For size_t.
 #include <limits>
@@ -241,6 +242,16 @@ main( int argc, char ** argv )
     return returndummy;
   }
 
+  /** This executable runs one registration per process, so the -threads option
+   * also limits the ITK filters that do not use the shared thread pool, such
+   * as the image readers and writers, the pyramids and the resampler.
+   */
+  if( argMap.count( "-threads" ) )
+  {
+    const int maximumNumberOfThreads = atoi( argMap[ "-threads" ].c_str() );
+    itk::MultiThreaderBase::SetGlobalMaximumNumberOfThreads( maximumNumberOfThreads );
+  }
+
   elxout << std::endl;
 
   /** Declare a timer, start it and print the start time. */
@@ -411,7 +422,8 @@ PrintHelp( void )
   std::cout << "  -t0       parameter file for initial transform\n";
   std::cout << "  -priority set the process priority to high, abovenormal, normal (default),\n"
             << "            belownormal, or idle (Windows only option)\n";
-  std::cout << "  -threads  set the maximum number of threads of elastix\n"
+  std::cout << "  -threads  set the maximum number of threads of elastix\n";
+  std::cout << "  -threadaffinity  bind the threads of elastix to CPUs: true, or false (default)\n"
             << std::endl;
 
   /** The parameter file.*/
@@ -27,6 +27,7 @@
 #endif
 
 #include "elxElastixMain.h"
+#include "itkSharedThreadPool.h"
 #include <iostream>
 #include <string>
 #include <vector>
@@ -240,6 +241,15 @@ ELASTIX::RegisterImages(
   /** The argv0 argument, required for finding the component.dll/so's. */
   argMap.insert( ArgumentMapEntryType( "-argv0", "elastix" ) );
 
+  /** Pass the thread budget of the calling thread on as "-threads", which
+   * is applied again at every run.
+   */
+  const unsigned int threadBudget = itk::SharedThreadPool::GetThreadBudget();
+  if( threadBudget > 0 )
+  {
+    argMap.insert( ArgumentMapEntryType( "-threads", std::to_string( threadBudget ) ) );
+  }
+
   /** Setup xout. */
   returndummy = elx::xoutSetup( logFileName.c_str(), performLogging, performCout );
   if( returndummy && performCout )
@@ -404,7 +414,9 @@ ELASTIX::RegisterImages(
   movingMaskContainer  = nullptr;
   resultImageContainer = nullptr;
 
-  /** Close the modules. */
+  /** Close the modules. This is postponed while concurrent registrations
+   * still use them.
+   */
   ElastixMainType::UnloadComponents();
 
   /** Exit and return the error code. */
@@ -82,6 +82,12 @@ public:
    *    -2 = output folder does not exist
    *    \todo generate file elastix_errors.h containing error codedefines
    *      (e.g. #define ELASTIX_NO_ERROR 0)
+   *  Several ELASTIX objects may register images concurrently, each in its own
+   *  thread. The logging is set up per thread, and the component database is
+   *  shared. Call itk::SharedThreadPool::SetThreadBudget() in the thread to
+   *  limit the number of threads that the registration uses, without affecting
+   *  the others. The modules are closed when the last concurrent registration
+   *  finishes.
    */
   int RegisterImages( ImagePointer fixedImage,
     ImagePointer movingImage,
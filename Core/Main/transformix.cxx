@@ -18,6 +18,7 @@
 
 #include "elastix.h"
 #include "elxTransformixMain.h"
+#include "itkMultiThreaderBase.h"
 
 int
 main( int argc, char ** argv )
@@ -171,6 +172,16 @@ main( int argc, char ** argv )
     return returndummy;
   }
 
+  /** This executable runs one transformation per process, so the -threads option
+   * also limits the ITK filters that do not use the shared thread pool, such
+   * as the image readers and writers and the resampler.
+   */
+  if( argMap.count( "-threads" ) )
+  {
+    const int maximumNumberOfThreads = atoi( argMap[ "-threads" ].c_str() );
+    itk::MultiThreaderBase::SetGlobalMaximumNumberOfThreads( maximumNumberOfThreads );
+  }
+
   elxout << std::endl;
 
   /** Declare a timer, start it and print the start time. */
@@ -269,6 +280,7 @@ PrintHelp( void )
   std::cout << "  -priority set the process priority to high, abovenormal, normal (default),\n"
             << "            belownormal, or idle (Windows only option)\n";
   std::cout << "  -threads  set the maximum number of threads of transformix\n";
+  std::cout << "  -threadaffinity  bind the threads of transformix to CPUs: true, or false (default)\n";
   std::cout << "\nAt least one of the options \"-in\", \"-def\", \"-jac\", or \"-jacmat\" should be given.\n"
             << std::endl;
 
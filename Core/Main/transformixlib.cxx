@@ -25,6 +25,7 @@
 #endif
 
 #include "elxTransformixMain.h"
+#include "itkSharedThreadPool.h"
 #include <iostream>
 #include <string>
 #include <vector>
@@ -171,6 +172,15 @@ TRANSFORMIX::TransformImage(
   /** The argv0 argument, required for finding the component.dll/so's. */
   argMap.insert( ArgumentMapEntryType( "-argv0", "transformix" ) );
 
+  /** Pass the thread budget of the calling thread on as "-threads", which
+   * is applied again at every run.
+   */
+  const unsigned int threadBudget = itk::SharedThreadPool::GetThreadBudget();
+  if( threadBudget > 0 )
+  {
+    argMap.insert( ArgumentMapEntryType( "-threads", std::to_string( threadBudget ) ) );
+  }
+
   /** Setup xout. */
   int returndummy2 = elx::xoutSetup( logFileName.c_str(), performLogging, performCout );
   if( returndummy2 && performCout )
@@ -221,7 +231,9 @@ TRANSFORMIX::TransformImage(
 
   this->m_ResultImage = resultImageContainer->ElementAt( 0 );
 
-  /** Clean up. */
+  /** Clean up. Closing the modules is postponed while concurrent calls
+   * still use them.
+   */
   transformix = nullptr;
   TransformixMainType::UnloadComponents();
 
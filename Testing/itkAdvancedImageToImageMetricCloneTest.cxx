@@ -0,0 +1,357 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Check that gradient measurements on clones of a metric, as done by the
+ automatic parameter estimation of ASGD, give bit-identical results for given
+ seeds, independent of the number of clones that run concurrently.
+ */
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageRandomSampler.h"
+#include "itkSharedPoolMultiThreader.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+const unsigned int Dimension = 2;
+typedef itk::Image< float, Dimension >                                   ImageType;
+typedef itk::AdvancedMeanSquaresImageToImageMetric< ImageType, ImageType > MetricType;
+typedef MetricType::AdvancedTransformType                                AdvancedTransformType;
+typedef MetricType::ParametersType                                       ParametersType;
+typedef MetricType::MeasureType                                          MeasureType;
+typedef MetricType::DerivativeType                                       DerivativeType;
+typedef itk::AdvancedCombinationTransform< double, Dimension >           CombinationTransformType;
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >  BSplineTransformType;
+typedef itk::ImageRandomSampler< ImageType >                             SamplerType;
+typedef itk::ImageRandomSamplerBase< ImageType >                         RandomSamplerBaseType;
+typedef itk::LinearInterpolateImageFunction< ImageType, double >         InterpolatorType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator           RandomNumberGeneratorType;
+typedef itk::SharedPoolMultiThreader                                     ThreaderType;
+
+const double perturbationSigma = 0.5;
+
+//-------------------------------------------------------------------------------------
+
+/** A clone of the metric, with the generator of its perturbations. */
+struct Context
+{
+  MetricType::Pointer                  metric;
+  RandomSamplerBaseType::Pointer       sampler;
+  RandomNumberGeneratorType::Pointer   generator;
+};
+
+/** The measurements, shared by the work units. */
+struct Measurements
+{
+  const ParametersType *            mu0;
+  std::vector< Context >            contexts;
+  std::vector< unsigned int >       perturbationSeeds;
+  std::vector< uint64_t >           samplerSeeds;
+  std::atomic< unsigned int >       next;
+  std::vector< MeasureType >        values;
+  std::vector< DerivativeType >     derivatives;
+  std::vector< std::exception_ptr > exceptions;
+};
+
+/** Do one measurement: perturb mu0 and evaluate at new random samples. */
+void
+Measure( const ParametersType & mu0, const unsigned int perturbationSeed, const uint64_t samplerSeed,
+  const MetricType * metric, RandomSamplerBaseType * sampler, RandomNumberGeneratorType * generator,
+  MeasureType & value, DerivativeType & derivative )
+{
+  ParametersType perturbedMu0 = mu0;
+  generator->SetSeed( perturbationSeed );
+  for( unsigned int p = 0; p < perturbedMu0.GetSize(); ++p )
+  {
+    perturbedMu0[ p ] += perturbationSigma * generator->GetNormalVariate( 0.0, 1.0 );
+  }
+  sampler->SetRandomSeed( samplerSeed );
+  metric->GetValueAndDerivative( perturbedMu0, value, derivative );
+
+} // end Measure()
+
+
+/** Threader callback: every work unit takes the next measurement, on its own clone. */
+ITK_THREAD_RETURN_TYPE
+MeasureThreaderCallback( void * arg )
+{
+  ThreaderType::WorkUnitInfo * infoStruct = static_cast< ThreaderType::WorkUnitInfo * >( arg );
+  Measurements * measurements = static_cast< Measurements * >( infoStruct->UserData );
+  Context &      context      = measurements->contexts[ infoStruct->WorkUnitID ];
+
+  unsigned int i = measurements->next++;
+  while( i < measurements->values.size() )
+  {
+    try
+    {
+      Measure( *measurements->mu0, measurements->perturbationSeeds[ i ], measurements->samplerSeeds[ i ],
+        context.metric, context.sampler, context.generator,
+        measurements->values[ i ], measurements->derivatives[ i ] );
+    }
+    catch( ... )
+    {
+      measurements->exceptions[ i ] = std::current_exception();
+    }
+    i = measurements->next++;
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end MeasureThreaderCallback()
+
+
+/** Do the measurements concurrently on workUnits clones of the metric. */
+bool
+MeasureOnClones( const MetricType * metric, const ParametersType & mu0,
+  const std::vector< unsigned int > & perturbationSeeds, const std::vector< uint64_t > & samplerSeeds,
+  const itk::ThreadIdType workUnits,
+  std::vector< MeasureType > & values, std::vector< DerivativeType > & derivatives )
+{
+  Measurements measurements;
+  measurements.mu0               = &mu0;
+  measurements.perturbationSeeds = perturbationSeeds;
+  measurements.samplerSeeds      = samplerSeeds;
+  measurements.next              = 0;
+  measurements.values.assign( perturbationSeeds.size(), 0.0 );
+  measurements.derivatives.resize( perturbationSeeds.size() );
+  measurements.exceptions.assign( perturbationSeeds.size(), std::exception_ptr() );
+
+  measurements.contexts.resize( workUnits );
+  for( itk::ThreadIdType w = 0; w < workUnits; ++w )
+  {
+    Context & context = measurements.contexts[ w ];
+    MetricType::Superclass::Pointer clone = metric->Clone();
+    context.metric = dynamic_cast< MetricType * >( clone.GetPointer() );
+    if( context.metric.IsNull() )
+    {
+      std::cerr << "ERROR: the metric could not be cloned." << std::endl;
+      return false;
+    }
+    if( context.metric->GetTransform() == metric->GetTransform()
+      || context.metric->GetImageSampler() == metric->GetImageSampler() )
+    {
+      std::cerr << "ERROR: the clone shares the transform or the sampler." << std::endl;
+      return false;
+    }
+    context.sampler = dynamic_cast< RandomSamplerBaseType * >( context.metric->GetImageSampler() );
+    context.sampler->SetUseMultiThread( true );
+    context.sampler->SetNumberOfWorkUnits( 1 );
+    context.metric->SetUseMultiThread( false );
+    context.metric->Initialize();
+    context.generator = RandomNumberGeneratorType::New();
+  }
+
+  ThreaderType::Pointer threader = ThreaderType::New();
+  threader->SetNumberOfWorkUnits( workUnits );
+  threader->SetSingleMethod( MeasureThreaderCallback, &measurements );
+  threader->SingleMethodExecute();
+
+  for( std::size_t i = 0; i < measurements.exceptions.size(); ++i )
+  {
+    if( measurements.exceptions[ i ] )
+    {
+      std::rethrow_exception( measurements.exceptions[ i ] );
+    }
+  }
+  values      = measurements.values;
+  derivatives = measurements.derivatives;
+  return true;
+
+} // end MeasureOnClones()
+
+
+/** Compare two derivatives bit-for-bit. */
+bool
+Identical( const DerivativeType & a, const DerivativeType & b )
+{
+  if( a.GetSize() != b.GetSize() )
+  {
+    return false;
+  }
+  for( unsigned int p = 0; p < a.GetSize(); ++p )
+  {
+    if( a[ p ] != b[ p ] )
+    {
+      return false;
+    }
+  }
+  return true;
+
+} // end Identical()
+
+
+//-------------------------------------------------------------------------------------
+
+int
+main( void )
+{
+  /** Create two smooth random images. */
+  ImageType::SizeType size; size[ 0 ] = 48; size[ 1 ] = 40;
+  ImageType::SpacingType spacing; spacing[ 0 ] = 0.8; spacing[ 1 ] = 1.1;
+  ImageType::RegionType region; region.SetSize( size );
+
+  ImageType::Pointer fixedImage  = ImageType::New();
+  ImageType::Pointer movingImage = ImageType::New();
+  fixedImage->SetRegions( region );
+  fixedImage->SetSpacing( spacing );
+  fixedImage->Allocate();
+  movingImage->SetRegions( region );
+  movingImage->SetSpacing( spacing );
+  movingImage->Allocate();
+
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->SetSeed( 12345 );
+  itk::ImageRegionIteratorWithIndex< ImageType > it( fixedImage, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const double x = it.GetIndex()[ 0 ];
+    const double y = it.GetIndex()[ 1 ];
+    it.Set( static_cast< float >( 100.0 * std::sin( 0.2 * x ) * std::cos( 0.15 * y )
+      + randomNum->GetUniformVariate( 0.0, 5.0 ) ) );
+    movingImage->SetPixel( it.GetIndex(), static_cast< float >( 100.0 * std::sin( 0.2 * x + 0.3 )
+      * std::cos( 0.15 * y - 0.2 ) + randomNum->GetUniformVariate( 0.0, 5.0 ) ) );
+  }
+
+  /** A B-spline transform, wrapped like elastix does. */
+  BSplineTransformType::RegionType gridRegion;
+  BSplineTransformType::SizeType gridSize; gridSize.Fill( 8 );
+  gridRegion.SetSize( gridSize );
+  BSplineTransformType::SpacingType gridSpacing;
+  BSplineTransformType::OriginType gridOrigin;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    gridSpacing[ d ] = ( size[ d ] - 1 ) * spacing[ d ] / ( gridSize[ d ] - 3 );
+    gridOrigin[ d ]  = -gridSpacing[ d ];
+  }
+  BSplineTransformType::DirectionType gridDirection; gridDirection.SetIdentity();
+
+  BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  bsplineTransform->SetGridRegion( gridRegion );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridDirection( gridDirection );
+
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+
+  ParametersType mu0( transform->GetNumberOfParameters() );
+  mu0.Fill( 0.0 );
+  transform->SetParameters( mu0 );
+
+  /** The metric, with a random sampler. */
+  SamplerType::Pointer sampler = SamplerType::New();
+  sampler->SetNumberOfSamples( 500 );
+  sampler->SetUseMultiThread( true );
+
+  MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( region );
+  metric->SetInterpolator( InterpolatorType::New() );
+  metric->SetTransform( transform );
+  metric->SetImageSampler( sampler );
+
+  /** Draw the seeds of the measurements. */
+  const unsigned int           numberOfMeasurements = 9;
+  std::vector< unsigned int >  perturbationSeeds( numberOfMeasurements );
+  std::vector< uint64_t >      samplerSeeds( numberOfMeasurements );
+  randomNum->SetSeed( 20201017 );
+  for( unsigned int i = 0; i < numberOfMeasurements; ++i )
+  {
+    perturbationSeeds[ i ] = randomNum->GetIntegerVariate();
+    const uint64_t high = randomNum->GetIntegerVariate();
+    const uint64_t low  = randomNum->GetIntegerVariate();
+    samplerSeeds[ i ] = ( high << 32 ) | low;
+  }
+
+  bool success = true;
+  try
+  {
+    metric->Initialize();
+
+    /** Measure on 1, 2 and 7 clones concurrently. */
+    const itk::ThreadIdType       workUnits[ 3 ] = { 1, 2, 7 };
+    std::vector< MeasureType >    referenceValues;
+    std::vector< DerivativeType > referenceDerivatives;
+    for( unsigned int w = 0; w < 3; ++w )
+    {
+      std::vector< MeasureType >    values;
+      std::vector< DerivativeType > derivatives;
+      if( !MeasureOnClones( metric, mu0, perturbationSeeds, samplerSeeds, workUnits[ w ], values, derivatives ) )
+      {
+        return EXIT_FAILURE;
+      }
+      if( w == 0 )
+      {
+        referenceValues      = values;
+        referenceDerivatives = derivatives;
+        continue;
+      }
+      for( unsigned int i = 0; i < numberOfMeasurements; ++i )
+      {
+        if( values[ i ] != referenceValues[ i ] || !Identical( derivatives[ i ], referenceDerivatives[ i ] ) )
+        {
+          std::cerr << "ERROR: measurement " << i << " differs for " << workUnits[ w ]
+                    << " and " << workUnits[ 0 ] << " clones." << std::endl;
+          success = false;
+        }
+      }
+    }
+
+    /** The clones should measure exactly what the metric itself measures. */
+    metric->SetUseMultiThread( false );
+    RandomNumberGeneratorType::Pointer generator = RandomNumberGeneratorType::New();
+    for( unsigned int i = 0; i < numberOfMeasurements; ++i )
+    {
+      MeasureType    value = 0.0;
+      DerivativeType derivative;
+      Measure( mu0, perturbationSeeds[ i ], samplerSeeds[ i ], metric, sampler, generator, value, derivative );
+      if( value != referenceValues[ i ] || !Identical( derivative, referenceDerivatives[ i ] ) )
+      {
+        std::cerr << "ERROR: measurement " << i << " on a clone differs from the metric." << std::endl;
+        success = false;
+      }
+    }
+  }
+  catch( itk::ExceptionObject & excp )
+  {
+    std::cerr << "ERROR: " << excp << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -214,6 +214,27 @@ TestInterpolators( void )
     }
   }
 
+  /** Compare the batch evaluation with the evaluation per index. */
+  ContinuousIndexType cindices[ count ];
+  OutputType          valuesBatch[ count ];
+  CovariantVectorType derivsBatch[ count ];
+  for( unsigned int i = 0; i < count; i++ )
+  {
+    cindices[ i ] = ContinuousIndexType( &darray1[ i ][ 0 ] );
+  }
+  linearA->EvaluateValueAndDerivativeAtContinuousIndices( cindices, valuesBatch, derivsBatch, count );
+  for( unsigned int i = 0; i < count; i++ )
+  {
+    linearA->EvaluateValueAndDerivativeAtContinuousIndex( cindices[ i ], valueLinA, derivLinA );
+    if( std::abs( valueLinA - valuesBatch[ i ] ) > 1.0e-10
+      || ( derivLinA - derivsBatch[ i ] ).GetVnlVector().magnitude() > 1.0e-10 )
+    {
+      std::cerr << "ERROR: the batch evaluation of the linear interpolator differs "
+                << "from the evaluation per index, at " << cindices[ i ] << "." << std::endl;
+      return false;
+    }
+  }
+
   /** Measure the run times, but only in release mode. */
 #ifdef NDEBUG
   std::cout << std::endl;
@@ -243,6 +264,16 @@ TestInterpolators( void )
             << 1.0e3 * timer.GetMean() / static_cast< double >( runs )
             << " ms" << std::endl;
 
+  timer.Reset(); timer.Start();
+  for( unsigned int i = 0; i < runs; i += count )
+  {
+    linearA->EvaluateValueAndDerivativeAtContinuousIndices( cindices, valuesBatch, derivsBatch, count );
+  }
+  timer.Stop();
+  std::cout << "linearA (batch) : "
+            << 1.0e3 * timer.GetMean() / static_cast< double >( runs )
+            << " ms" << std::endl;
+
   timer.Reset(); timer.Start();
   for( unsigned int i = 0; i < runs; ++i )
   {
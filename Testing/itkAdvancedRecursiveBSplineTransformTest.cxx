@@ -260,6 +260,7 @@ main( int argc, char * argv[] )
   std::vector< InputPointType >  pointList( N );
   std::vector< OutputPointType > transformedPointList1( N );
   std::vector< OutputPointType > transformedPointList2( N );
+  std::vector< OutputPointType > transformedPointList3( N );
 
   IndexType               dummyIndex;
   CoefficientImagePointer coefficientImage = transform->GetCoefficientImages()[ 0 ];
@@ -287,6 +288,10 @@ main( int argc, char * argv[] )
   }
   timeCollector.Stop(  "TransformPoint recursive         " );
 
+  timeCollector.Start( "TransformPoints recursive batch  " );
+  recursiveTransform->TransformPoints( &pointList[ 0 ], &transformedPointList3[ 0 ], N );
+  timeCollector.Stop(  "TransformPoints recursive batch  " );
+
   /** Time the implementation of the Jacobian. */
   timeCollector.Start( "Jacobian elastix                 " );
   for( unsigned int i = 0; i < N; ++i )
@@ -404,6 +409,16 @@ main( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  /** The batched TransformPoints() should return exactly the same values. */
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    if( transformedPointList2[ i ] != transformedPointList3[ i ] )
+    {
+      std::cerr << "ERROR: Recursive B-spline TransformPoints() returning incorrect result." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   /** Jacobian. */
   JacobianType jacobianElastix; jacobianElastix.SetSize( Dimension, nzji.size() ); jacobianElastix.Fill( 0.0 );
   transform->GetJacobian( inputPoint, jacobianElastix, nzjiElastix );
@@ -498,6 +513,41 @@ main( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  /** Single precision: TransformPoint() and GetSpatialJacobian() on the
+   * float coefficients should agree within single precision accuracy.
+   */
+  recursiveTransform->SetUseSinglePrecision( true );
+  double singlePrecisionDifference = 0.0;
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    const OutputPointType opp = recursiveTransform->TransformPoint( pointList[ i ] );
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      const double difference = std::abs( opp[ j ] - transformedPointList2[ i ][ j ] );
+      if( difference > singlePrecisionDifference )
+      {
+        singlePrecisionDifference = difference;
+      }
+    }
+  }
+  std::cerr << "The single precision TransformPoint() max difference is " << singlePrecisionDifference << std::endl;
+  if( singlePrecisionDifference > 1e-3 )
+  {
+    std::cerr << "ERROR: Single precision TransformPoint() returning incorrect result." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  recursiveTransform->GetSpatialJacobian( inputPoint, sjRecursive );
+  sjDifferenceMatrix = sj - sjRecursive;
+  sjDifference       = sjDifferenceMatrix.GetVnlMatrix().frobenius_norm();
+  std::cerr << "The single precision GetSpatialJacobian() difference is " << sjDifference << std::endl;
+  if( sjDifference > 1e-4 )
+  {
+    std::cerr << "ERROR: Single precision GetSpatialJacobian() returning incorrect result." << std::endl;
+    return EXIT_FAILURE;
+  }
+  recursiveTransform->SetUseSinglePrecision( false );
+
   /** Exercise PrintSelf(). */
   std::cerr << std::endl;
   recursiveTransform->Print( std::cerr );
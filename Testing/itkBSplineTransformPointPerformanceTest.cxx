@@ -16,14 +16,22 @@
  *
  *=========================================================================*/
 #include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkRecursiveBSplineTransformSIMD.h"
+#include "itkRecursiveBSplineTransformImplementation.h"
+#include "itkBSplineKernelFunction2.h"
+#include "itkBSplineDerivativeKernelFunction2.h"
 
 #include "itkImageRegionIterator.h"
 
 // Report timings
 #include "itkTimeProbe.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iomanip>
+#include <vector>
 
 //-------------------------------------------------------------------------------------
 // Create a class that inherits from the B-spline transform,
@@ -163,6 +171,202 @@ public:
 // end class BSplineTransform_TEST
 } // end namespace itk
 
+
+//-------------------------------------------------------------------------------------
+// Compare the vectorised kernels of RecursiveBSplineTransformImplementation,
+// for every instruction set, with the generic recursion.
+
+/** The coefficients and the points at which the kernels are evaluated. */
+template< class TScalar >
+struct KernelTestData
+{
+  std::vector< TScalar >              m_Coefficients[ 3 ];
+  itk::OffsetValueType                m_GridOffsetTable[ 3 ];
+  std::vector< itk::OffsetValueType > m_SupportOffsets;    // one per point
+  std::vector< TScalar >              m_Weights;           // 12 per point
+  std::vector< TScalar >              m_DerivativeWeights; // 12 per point
+  std::vector< TScalar >              m_Gradients;         // 3 per point
+};
+
+/** Evaluate the three kernels at point i. The output sizes are
+ * 3 (tp), 3 * 64 (jac) and 3 * 4 (sj).
+ */
+template< class TImplementation, class TScalar >
+void
+EvaluateKernels( KernelTestData< TScalar > & data, const std::size_t i,
+  TScalar * tp, TScalar * jac, TScalar * sj )
+{
+  TScalar * mu[ 3 ];
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    mu[ j ] = &data.m_Coefficients[ j ][ 0 ] + data.m_SupportOffsets[ i ];
+  }
+  const TScalar * weights           = &data.m_Weights[ 12 * i ];
+  const TScalar * derivativeWeights = &data.m_DerivativeWeights[ 12 * i ];
+
+  TImplementation::TransformPoint( tp, mu, data.m_GridOffsetTable, weights );
+  TScalar * jacPointer = jac;
+  TImplementation::EvaluateJacobianWithImageGradientProduct(
+    jacPointer, &data.m_Gradients[ 3 * i ], weights, 1.0 );
+  TImplementation::GetSpatialJacobian( sj, mu, data.m_GridOffsetTable, weights, derivativeWeights );
+
+} // end EvaluateKernels()
+
+
+/** Time the three kernels over all points. */
+template< class TImplementation, class TScalar >
+void
+TimeKernels( KernelTestData< TScalar > & data, double times[ 3 ], double & sum )
+{
+  const std::size_t N = data.m_SupportOffsets.size();
+  TScalar           tp[ 3 ], jac[ 3 * 64 ], sj[ 3 * 4 ];
+  TScalar *         mu[ 3 ];
+  itk::TimeProbe    timeProbe[ 3 ];
+
+  timeProbe[ 0 ].Start();
+  for( std::size_t i = 0; i < N; ++i )
+  {
+    for( unsigned int j = 0; j < 3; ++j )
+    {
+      mu[ j ] = &data.m_Coefficients[ j ][ 0 ] + data.m_SupportOffsets[ i ];
+    }
+    TImplementation::TransformPoint( tp, mu, data.m_GridOffsetTable, &data.m_Weights[ 12 * i ] );
+    sum += tp[ 0 ] + tp[ 1 ] + tp[ 2 ];
+  }
+  timeProbe[ 0 ].Stop();
+
+  timeProbe[ 1 ].Start();
+  for( std::size_t i = 0; i < N; ++i )
+  {
+    TScalar * jacPointer = jac;
+    TImplementation::EvaluateJacobianWithImageGradientProduct(
+      jacPointer, &data.m_Gradients[ 3 * i ], &data.m_Weights[ 12 * i ], 1.0 );
+    sum += jac[ i % ( 3 * 64 ) ];
+  }
+  timeProbe[ 1 ].Stop();
+
+  timeProbe[ 2 ].Start();
+  for( std::size_t i = 0; i < N; ++i )
+  {
+    for( unsigned int j = 0; j < 3; ++j )
+    {
+      mu[ j ] = &data.m_Coefficients[ j ][ 0 ] + data.m_SupportOffsets[ i ];
+    }
+    TImplementation::GetSpatialJacobian( sj, mu, data.m_GridOffsetTable,
+      &data.m_Weights[ 12 * i ], &data.m_DerivativeWeights[ 12 * i ] );
+    sum += sj[ 0 ] + sj[ 3 ] + sj[ 6 ] + sj[ 9 ];
+  }
+  timeProbe[ 2 ].Stop();
+
+  for( unsigned int k = 0; k < 3; ++k )
+  {
+    times[ k ] = timeProbe[ k ].GetMean();
+  }
+
+} // end TimeKernels()
+
+
+/** Compare TransformPoint, EvaluateJacobianWithImageGradientProduct and
+ * GetSpatialJacobian of every supported instruction set with the generic
+ * recursion, and report the timings relative to the generic recursion.
+ * The kernels sum in a different order, so the results agree up to a
+ * tolerance relative to the magnitude of the inputs.
+ */
+template< class TScalar >
+bool
+CompareKernelsWithRecursion( KernelTestData< TScalar > & data,
+  const char * scalarName, const double tolerance, double & sum )
+{
+  typedef itk::RecursiveBSplineTransformImplementation< 3, 3, 3, TScalar, true >  KernelImplementationType;
+  typedef itk::RecursiveBSplineTransformImplementation< 3, 3, 3, TScalar, false > GenericImplementationType;
+  typedef itk::RecursiveBSplineTransformSIMD                                      SIMDType;
+
+  const char *      kernelNames[ 3 ] = { "TransformPoint", "EvaluateJacobianWithImageGradientProduct", "GetSpatialJacobian" };
+  const std::size_t N                = data.m_SupportOffsets.size();
+
+  double maxCoefficient = 1.0;
+  for( unsigned int j = 0; j < 3; ++j )
+  {
+    for( std::size_t n = 0; n < data.m_Coefficients[ j ].size(); ++n )
+    {
+      maxCoefficient = std::max( maxCoefficient, static_cast< double >( std::abs( data.m_Coefficients[ j ][ n ] ) ) );
+    }
+  }
+  double maxGradient = 1.0;
+  for( std::size_t n = 0; n < data.m_Gradients.size(); ++n )
+  {
+    maxGradient = std::max( maxGradient, static_cast< double >( std::abs( data.m_Gradients[ n ] ) ) );
+  }
+  const double absoluteTolerance[ 3 ] = {
+    tolerance * maxCoefficient, tolerance * maxGradient, tolerance * maxCoefficient
+  };
+
+  /** The baseline: the generic recursion. */
+  double genericTimes[ 3 ];
+  TimeKernels< GenericImplementationType >( data, genericTimes, sum );
+  std::cerr << std::setprecision( 4 );
+  std::cerr << scalarName << " generic recursion: ";
+  for( unsigned int k = 0; k < 3; ++k )
+  {
+    std::cerr << kernelNames[ k ] << " " << genericTimes[ k ] << " s" << ( k < 2 ? ", " : "\n" );
+  }
+
+  bool success = true;
+  const SIMDType::InstructionSetType original  = SIMDType::GetInstructionSet();
+  const SIMDType::InstructionSetType supported = SIMDType::GetSupportedInstructionSet();
+  for( int set = SIMDType::Scalar; set <= supported; ++set )
+  {
+    const SIMDType::InstructionSetType instructionSet = static_cast< SIMDType::InstructionSetType >( set );
+    SIMDType::SetInstructionSet( instructionSet );
+
+    /** Compare with the generic recursion at every point. */
+    double  maxDifference[ 3 ] = { 0.0, 0.0, 0.0 };
+    TScalar tpGeneric[ 3 ], jacGeneric[ 3 * 64 ], sjGeneric[ 3 * 4 ];
+    TScalar tpKernel[ 3 ], jacKernel[ 3 * 64 ], sjKernel[ 3 * 4 ];
+    for( std::size_t i = 0; i < N; ++i )
+    {
+      EvaluateKernels< GenericImplementationType >( data, i, tpGeneric, jacGeneric, sjGeneric );
+      EvaluateKernels< KernelImplementationType >( data, i, tpKernel, jacKernel, sjKernel );
+      for( unsigned int n = 0; n < 3; ++n )
+      {
+        maxDifference[ 0 ] = std::max( maxDifference[ 0 ],
+          static_cast< double >( std::abs( tpKernel[ n ] - tpGeneric[ n ] ) ) );
+      }
+      for( unsigned int n = 0; n < 3 * 64; ++n )
+      {
+        maxDifference[ 1 ] = std::max( maxDifference[ 1 ],
+          static_cast< double >( std::abs( jacKernel[ n ] - jacGeneric[ n ] ) ) );
+      }
+      for( unsigned int n = 0; n < 3 * 4; ++n )
+      {
+        maxDifference[ 2 ] = std::max( maxDifference[ 2 ],
+          static_cast< double >( std::abs( sjKernel[ n ] - sjGeneric[ n ] ) ) );
+      }
+    }
+
+    double times[ 3 ];
+    TimeKernels< KernelImplementationType >( data, times, sum );
+
+    for( unsigned int k = 0; k < 3; ++k )
+    {
+      std::cerr << scalarName << " " << SIMDType::GetInstructionSetName( instructionSet )
+                << " " << kernelNames[ k ] << ": " << times[ k ] << " s, speedup "
+                << genericTimes[ k ] / times[ k ] << ", max difference " << maxDifference[ k ] << std::endl;
+      if( !( maxDifference[ k ] <= absoluteTolerance[ k ] ) )
+      {
+        std::cerr << "ERROR: " << scalarName << " " << kernelNames[ k ] << " with "
+                  << SIMDType::GetInstructionSetName( instructionSet )
+                  << " differs from the generic recursion." << std::endl;
+        success = false;
+      }
+    }
+  }
+  SIMDType::SetInstructionSet( original );
+
+  return success;
+
+} // end CompareKernelsWithRecursion()
+
 //-------------------------------------------------------------------------------------
 
 int
@@ -198,6 +402,10 @@ main( int argc, char * argv[] )
   typedef itk::BSplineTransform_TEST<
     CoordinateRepresentationType, Dimension, SplineOrder >    TransformType;
 
+  typedef itk::RecursiveBSplineTransform<
+    CoordinateRepresentationType, Dimension, SplineOrder >    RecursiveTransformType;
+  typedef itk::RecursiveBSplineTransformSIMD SIMDType;
+
   typedef TransformType::InputPointType  InputPointType;
   typedef TransformType::OutputPointType OutputPointType;
   typedef TransformType::ParametersType  ParametersType;
@@ -211,8 +419,9 @@ main( int argc, char * argv[] )
   typedef InputImageType::PointType     OriginType;
   typedef InputImageType::DirectionType DirectionType;
 
-  /** Create the transform. */
-  TransformType::Pointer transform = TransformType::New();
+  /** Create the transforms. */
+  TransformType::Pointer          transform          = TransformType::New();
+  RecursiveTransformType::Pointer recursiveTransform = RecursiveTransformType::New();
 
   /** Setup the B-spline transform:
    * (GridSize 44 43 35)
@@ -243,6 +452,11 @@ main( int argc, char * argv[] )
   transform->SetGridRegion( gridRegion );
   transform->SetGridDirection( gridDirection );
 
+  recursiveTransform->SetGridOrigin( gridOrigin );
+  recursiveTransform->SetGridSpacing( gridSpacing );
+  recursiveTransform->SetGridRegion( gridRegion );
+  recursiveTransform->SetGridDirection( gridDirection );
+
   /** Now read the parameters as defined in the file par.txt. */
   ParametersType parameters( transform->GetNumberOfParameters() );
   std::ifstream  input( argv[ 1 ] );
@@ -260,6 +474,7 @@ main( int argc, char * argv[] )
     return 1;
   }
   transform->SetParameters( parameters );
+  recursiveTransform->SetParameters( parameters );
 
   /** Declare variables. */
   InputPointType  inputPoint; inputPoint.Fill( 4.1 );
@@ -286,6 +501,81 @@ main( int argc, char * argv[] )
   timeProbeNEW.Stop();
   const double newTime = timeProbeNEW.GetMean();
 
+  /** Compare the kernels of the recursive implementation with the generic
+   * recursion, in double and single precision, at a set of points spread
+   * over the grid, so that the coefficient access is realistic.
+   */
+  typedef itk::BSplineKernelFunction2< SplineOrder >           KernelType;
+  typedef itk::BSplineDerivativeKernelFunction2< SplineOrder > DerivativeKernelType;
+  KernelType::Pointer           kernel           = KernelType::New();
+  DerivativeKernelType::Pointer derivativeKernel = DerivativeKernelType::New();
+
+  KernelTestData< double > doubleData;
+  KernelTestData< float >  floatData;
+  const unsigned long      numberOfParametersPerDimension = parameters.GetSize() / Dimension;
+  for( unsigned int j = 0; j < Dimension; ++j )
+  {
+    doubleData.m_Coefficients[ j ].assign( parameters.begin() + j * numberOfParametersPerDimension,
+      parameters.begin() + ( j + 1 ) * numberOfParametersPerDimension );
+    floatData.m_Coefficients[ j ].assign( doubleData.m_Coefficients[ j ].begin(), doubleData.m_Coefficients[ j ].end() );
+  }
+  doubleData.m_GridOffsetTable[ 0 ] = 1;
+  doubleData.m_GridOffsetTable[ 1 ] = gridSize[ 0 ];
+  doubleData.m_GridOffsetTable[ 2 ] = gridSize[ 0 ] * gridSize[ 1 ];
+  std::copy( doubleData.m_GridOffsetTable, doubleData.m_GridOffsetTable + 3, floatData.m_GridOffsetTable );
+
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    itk::OffsetValueType supportOffset = 0;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double cindex = 2.0 + ( ( i * ( 7 + 13 * d ) ) % 997 ) / 997.0 * ( gridSize[ d ] - 5 );
+      const double start  = std::floor( cindex ) - 1.0;
+      supportOffset += static_cast< itk::OffsetValueType >( start ) * doubleData.m_GridOffsetTable[ d ];
+      for( unsigned int k = 0; k <= SplineOrder; ++k )
+      {
+        doubleData.m_Weights.push_back( kernel->Evaluate( cindex - ( start + k ) ) );
+        doubleData.m_DerivativeWeights.push_back( derivativeKernel->Evaluate( cindex - ( start + k ) ) );
+      }
+      doubleData.m_Gradients.push_back( std::cos( 0.1 * i + d ) * 100.0 );
+    }
+    doubleData.m_SupportOffsets.push_back( supportOffset );
+  }
+  floatData.m_SupportOffsets = doubleData.m_SupportOffsets;
+  floatData.m_Weights.assign( doubleData.m_Weights.begin(), doubleData.m_Weights.end() );
+  floatData.m_DerivativeWeights.assign( doubleData.m_DerivativeWeights.begin(), doubleData.m_DerivativeWeights.end() );
+  floatData.m_Gradients.assign( doubleData.m_Gradients.begin(), doubleData.m_Gradients.end() );
+
+  std::cerr << "Supported instruction set = " << SIMDType::GetInstructionSetName(
+    SIMDType::GetSupportedInstructionSet() ) << std::endl;
+  bool kernelsOk = CompareKernelsWithRecursion( doubleData, "double", 1e-12, sum );
+  kernelsOk &= CompareKernelsWithRecursion( floatData, "float", 1e-5, sum );
+
+  /** Check the recursive transform as a whole against the original one. */
+  double maxDifference = 0.0;
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    InputPointType point;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      point[ d ] = gridOrigin[ d ] + ( 2.0 + ( ( i * ( 7 + 13 * d ) ) % 997 ) / 997.0
+        * ( gridSize[ d ] - 5 ) ) * gridSpacing[ d ];
+    }
+    const OutputPointType expected = transform->TransformPoint( point );
+    const OutputPointType actual   = recursiveTransform->TransformPoint( point );
+    sum += actual[ 0 ];
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      maxDifference = std::max( maxDifference, std::abs( actual[ d ] - expected[ d ] ) );
+    }
+  }
+  std::cerr << "Max difference recursive vs original TransformPoint = " << maxDifference << std::endl;
+  if( maxDifference > 1e-8 )
+  {
+    std::cerr << "ERROR: the recursive and the original TransformPoint differ." << std::endl;
+    kernelsOk = false;
+  }
+
   // Avoid compiler optimizations, so use sum
   std::cerr << sum << std::endl; // works but ugly on screen
   //  volatile double a = sum; // works but gives unused variable warning
@@ -298,6 +588,11 @@ main( int argc, char * argv[] )
   std::cerr << "Time NEW = " << newTime << " " << timeProbeNEW.GetUnit() << std::endl;
   std::cerr << "Speedup factor = " << oldTime / newTime << std::endl;
 
+  if( !kernelsOk )
+  {
+    return 1;
+  }
+
   /** Return a value. */
   return 0;
 
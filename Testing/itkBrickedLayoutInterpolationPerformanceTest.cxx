@@ -0,0 +1,140 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the run time of the linear interpolator with and without the bricked layout.
+
+ The samples are placed randomly in the image, as with a random image sampler,
+ so that in the scanline layout almost every interpolation misses the cache.
+ The image size can be given as the first argument, e.g. 512.
+ */
+
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <cstdlib> // For atoi.
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int argc, char * argv[] )
+{
+  /** The image size and the number of samples. Distinguish between
+   * Debug and Release mode.
+   */
+#ifndef NDEBUG
+  unsigned int imageSize = 64;
+  unsigned int N         = static_cast< unsigned int >( 1e4 );
+#else
+  unsigned int imageSize = 256;
+  unsigned int N         = static_cast< unsigned int >( 1e6 );
+#endif
+  if( argc > 1 )
+  {
+    imageSize = static_cast< unsigned int >( std::atoi( argv[ 1 ] ) );
+  }
+  std::cerr << "image size = " << imageSize << "^3, N = " << N << std::endl;
+
+  /** Typedefs. */
+  const unsigned int Dimension = 3;
+  typedef itk::Image< short, Dimension >                         InputImageType;
+  typedef itk::AdvancedLinearInterpolateImageFunction<
+    InputImageType, double >                                     InterpolatorType;
+  typedef InterpolatorType::ContinuousIndexType                  ContinuousIndexType;
+  typedef InterpolatorType::CovariantVectorType                  CovariantVectorType;
+  typedef InterpolatorType::OutputType                           OutputType;
+  typedef itk::ImageRegionIterator< InputImageType >             IteratorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->SetSeed( 5489 );
+
+  /** Create a random input image. */
+  InputImageType::SizeType size;
+  size.Fill( imageSize );
+  InputImageType::RegionType region;
+  region.SetSize( size );
+  InputImageType::Pointer image = InputImageType::New();
+  image->SetRegions( region );
+  image->Allocate();
+  IteratorType it( image, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    it.Set( static_cast< short >( randomNum->GetUniformVariate( 0, 1000 ) ) );
+  }
+
+  /** Create the interpolators. */
+  InterpolatorType::Pointer scanline = InterpolatorType::New();
+  InterpolatorType::Pointer bricked  = InterpolatorType::New();
+  scanline->SetInputImage( image );
+  bricked->SetUseBrickedLayout( true );
+  bricked->SetInputImage( image );
+
+  /** Create the random samples. */
+  std::vector< ContinuousIndexType > cindices( N );
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      cindices[ i ][ j ] = randomNum->GetUniformVariate( 0.0, imageSize - 1.0 );
+    }
+  }
+  std::vector< OutputType >          valuesScanline( N ), valuesBricked( N );
+  std::vector< CovariantVectorType > derivsScanline( N ), derivsBricked( N );
+
+  /** Time the batch interpolation in both layouts. */
+  itk::TimeProbe timer;
+  timer.Start();
+  scanline->EvaluateValueAndDerivativeAtContinuousIndices(
+    &cindices[ 0 ], &valuesScanline[ 0 ], &derivsScanline[ 0 ], N );
+  timer.Stop();
+  const double timeScanline = timer.GetMean();
+
+  timer.Reset();
+  timer.Start();
+  bricked->EvaluateValueAndDerivativeAtContinuousIndices(
+    &cindices[ 0 ], &valuesBricked[ 0 ], &derivsBricked[ 0 ], N );
+  timer.Stop();
+  const double timeBricked = timer.GetMean();
+
+  std::cerr << "scanline layout: " << 1.0e9 * timeScanline / N << " ns per sample" << std::endl;
+  std::cerr << "bricked layout : " << 1.0e9 * timeBricked / N << " ns per sample" << std::endl;
+  std::cerr << "speedup        : " << timeScanline / timeBricked << std::endl;
+
+  /** The layout may not change the results. */
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    OutputType          value;
+    CovariantVectorType deriv;
+    bricked->EvaluateValueAndDerivativeAtContinuousIndex( cindices[ i ], value, deriv );
+    if( valuesScanline[ i ] != valuesBricked[ i ] || derivsScanline[ i ] != derivsBricked[ i ]
+      || value != valuesBricked[ i ] || deriv != derivsBricked[ i ] )
+    {
+      std::cerr << "ERROR: the bricked layout gives a different result at "
+                << cindices[ i ] << "." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,193 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Check that the multi-threaded random samplers give bit-identical
+ samples for a given seed, independent of the number of work units.
+ */
+
+#include "itkImageRandomSampler.h"
+#include "itkImageRandomCoordinateSampler.h"
+#include "itkImageRandomSamplerSparseMask.h"
+
+#include "itkImage.h"
+#include "itkImageMaskSpatialObject.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+const unsigned int Dimension = 2;
+typedef itk::Image< float, Dimension >                           ImageType;
+typedef itk::ImageMaskSpatialObject< Dimension >                 MaskSpatialObjectType;
+typedef MaskSpatialObjectType::ImageType                         MaskImageType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator   RandomNumberGeneratorType;
+
+//-------------------------------------------------------------------------------------
+
+/** Run the sampler twice, with workUnits work units, starting from a fixed seed
+ * of the global random generator. The samples of both runs are appended to samples.
+ */
+template< class TSampler >
+void
+RunSampler(
+  const ImageType * image,
+  const MaskSpatialObjectType * mask,
+  const itk::ThreadIdType workUnits,
+  std::vector< typename TSampler::ImageSampleType > & samples )
+{
+  RandomNumberGeneratorType::GetInstance()->SetSeed( 20201017 );
+
+  typename TSampler::Pointer sampler = TSampler::New();
+  sampler->SetInput( image );
+  sampler->SetMask( mask );
+  sampler->SetNumberOfSamples( 997 );
+  sampler->SetUseMultiThread( true );
+  sampler->SetNumberOfWorkUnits( workUnits );
+
+  samples.clear();
+  for( unsigned int iteration = 0; iteration < 2; ++iteration )
+  {
+    sampler->SelectNewSamplesOnUpdate();
+    sampler->Update();
+    const typename TSampler::ImageSampleContainerType * output = sampler->GetOutput();
+    for( std::size_t i = 0; i < output->Size(); ++i )
+    {
+      samples.push_back( output->ElementAt( i ) );
+    }
+  }
+
+} // end RunSampler()
+
+
+/** Compare the samples for 1, 2 and 7 work units bit-for-bit. */
+template< class TSampler >
+bool
+TestSampler(
+  const std::string & name,
+  const ImageType * image,
+  const MaskSpatialObjectType * mask )
+{
+  typedef typename TSampler::ImageSampleType ImageSampleType;
+
+  std::cerr << name << ( mask ? " with mask" : " without mask" ) << std::endl;
+
+  const itk::ThreadIdType        workUnits[ 3 ] = { 1, 2, 7 };
+  std::vector< ImageSampleType > reference;
+  std::vector< ImageSampleType > samples;
+  for( unsigned int w = 0; w < 3; ++w )
+  {
+    try
+    {
+      RunSampler< TSampler >( image, mask, workUnits[ w ], w == 0 ? reference : samples );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << "ERROR: " << excp << std::endl;
+      return false;
+    }
+    if( w == 0 ) { continue; }
+
+    if( samples.size() != reference.size() )
+    {
+      std::cerr << "ERROR: " << workUnits[ w ] << " work units give " << samples.size()
+                << " samples instead of " << reference.size() << std::endl;
+      return false;
+    }
+    for( std::size_t i = 0; i < samples.size(); ++i )
+    {
+      bool identical = samples[ i ].m_ImageValue == reference[ i ].m_ImageValue;
+      for( unsigned int d = 0; d < Dimension; ++d )
+      {
+        identical &= samples[ i ].m_ImageCoordinates[ d ] == reference[ i ].m_ImageCoordinates[ d ];
+      }
+      if( !identical )
+      {
+        std::cerr << "ERROR: sample " << i << " differs for " << workUnits[ w ]
+                  << " and " << workUnits[ 0 ] << " work units." << std::endl;
+        return false;
+      }
+    }
+  }
+
+  return true;
+
+} // end TestSampler()
+
+
+//-------------------------------------------------------------------------------------
+
+int
+main( void )
+{
+  typedef itk::ImageRandomSampler< ImageType >           RandomSamplerType;
+  typedef itk::ImageRandomCoordinateSampler< ImageType > RandomCoordinateSamplerType;
+  typedef itk::ImageRandomSamplerSparseMask< ImageType > RandomSamplerSparseMaskType;
+
+  /** Create a random image, and a disk shaped mask. */
+  ImageType::SizeType size; size[ 0 ] = 64; size[ 1 ] = 48;
+  ImageType::SpacingType spacing; spacing[ 0 ] = 0.7; spacing[ 1 ] = 1.3;
+  ImageType::RegionType region; region.SetSize( size );
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( region );
+  image->SetSpacing( spacing );
+  image->Allocate();
+
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->SetRegions( region );
+  maskImage->SetSpacing( spacing );
+  maskImage->Allocate();
+
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->SetSeed( 12345 );
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    it.Set( static_cast< float >( randomNum->GetUniformVariate( 0.0, 100.0 ) ) );
+    const double dx = it.GetIndex()[ 0 ] - 30.0;
+    const double dy = it.GetIndex()[ 1 ] - 20.0;
+    maskImage->SetPixel( it.GetIndex(), dx * dx + dy * dy < 15.0 * 15.0 ? 1 : 0 );
+  }
+
+  MaskSpatialObjectType::Pointer mask = MaskSpatialObjectType::New();
+  mask->SetImage( maskImage );
+  mask->Update();
+
+  /** Test all random samplers, with and without a mask. The sparse mask
+   * sampler requires a mask.
+   */
+  bool success = true;
+  success &= TestSampler< RandomSamplerType >( "ImageRandomSampler", image, nullptr );
+  success &= TestSampler< RandomSamplerType >( "ImageRandomSampler", image, mask );
+  success &= TestSampler< RandomCoordinateSamplerType >( "ImageRandomCoordinateSampler", image, nullptr );
+  success &= TestSampler< RandomCoordinateSamplerType >( "ImageRandomCoordinateSampler", image, mask );
+  success &= TestSampler< RandomSamplerSparseMaskType >( "ImageRandomSamplerSparseMask", image, mask );
+
+  if( !success )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
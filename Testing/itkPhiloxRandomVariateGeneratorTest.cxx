@@ -0,0 +1,105 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkPhiloxRandomVariateGenerator.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+// Checks the Philox4x32-10 generator against the known answers of the
+// reference implementation (Random123), and checks the uniform variates.
+
+int
+main( int argc, char * argv[] )
+{
+  typedef itk::PhiloxRandomVariateGenerator GeneratorType;
+
+  /** The known answer tests: counter, key, expected output. */
+  const itk::uint32_t counters[ 3 ][ 4 ] = {
+    { 0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+    { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+    { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }
+  };
+  const itk::uint32_t keys[ 3 ][ 2 ] = {
+    { 0x00000000, 0x00000000 },
+    { 0xffffffff, 0xffffffff },
+    { 0xa4093822, 0x299f31d0 }
+  };
+  const itk::uint32_t expected[ 3 ][ 4 ] = {
+    { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+    { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+    { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }
+  };
+
+  for( unsigned int t = 0; t < 3; ++t )
+  {
+    itk::uint32_t output[ 4 ];
+    GeneratorType::Generate( counters[ t ], keys[ t ], output );
+    for( unsigned int i = 0; i < 4; ++i )
+    {
+      if( output[ i ] != expected[ t ][ i ] )
+      {
+        std::cerr << "ERROR: known answer test " << t << " failed at word " << i
+                  << ": 0x" << std::hex << output[ i ] << " instead of 0x"
+                  << expected[ t ][ i ] << std::dec << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  std::cerr << "The known answer tests passed." << std::endl;
+
+  /** Check that the variates are in [0,1), and that their mean and variance
+   * are close to 1/2 and 1/12. The tolerance is about 5 standard errors.
+   */
+  const unsigned long N    = 1000000;
+  double              sum  = 0.0;
+  double              sum2 = 0.0;
+  for( unsigned long i = 0; i < N; ++i )
+  {
+    double u0, u1;
+    GeneratorType::GetUniformVariates( 12345, i, 0, 0, u0, u1 );
+    if( u0 < 0.0 || u0 >= 1.0 || u1 < 0.0 || u1 >= 1.0 )
+    {
+      std::cerr << "ERROR: variate out of [0,1): " << u0 << " " << u1 << std::endl;
+      return EXIT_FAILURE;
+    }
+    sum  += u0 + u1;
+    sum2 += u0 * u0 + u1 * u1;
+  }
+  const double mean     = sum / ( 2.0 * N );
+  const double variance = sum2 / ( 2.0 * N ) - mean * mean;
+  std::cerr << std::setprecision( 8 )
+            << "Mean: " << mean << ", variance: " << variance << std::endl;
+  if( std::abs( mean - 0.5 ) > 1e-3 || std::abs( variance - 1.0 / 12.0 ) > 5e-4 )
+  {
+    std::cerr << "ERROR: the mean or variance is not that of a uniform distribution." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** The same counter must give the same number. */
+  if( GeneratorType::GetUniformVariate( 1, 2, 3, 4 ) != GeneratorType::GetUniformVariate( 1, 2, 3, 4 ) )
+  {
+    std::cerr << "ERROR: the generator is not deterministic." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
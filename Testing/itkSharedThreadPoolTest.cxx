@@ -0,0 +1,220 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkSharedThreadPool.h"
+#include "itkSharedPoolMultiThreader.h"
+#include "itkTimeProbe.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+// The number of work units of the outer and the nested calls.
+const itk::ThreadIdType NumberOfOuterWorkUnits = 12;
+const itk::ThreadIdType NumberOfInnerWorkUnits = 16;
+
+std::atomic< unsigned long > Sum( 0 );
+std::atomic< unsigned int >  NumberOfActiveWorkUnits( 0 );
+std::atomic< unsigned int >  MaximumNumberOfActiveWorkUnits( 0 );
+
+ITK_THREAD_RETURN_TYPE
+InnerThreaderCallback( void * arg )
+{
+  const itk::MultiThreaderBase::WorkUnitInfo * info
+    = static_cast< itk::MultiThreaderBase::WorkUnitInfo * >( arg );
+  Sum += info->WorkUnitID + 1;
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+ITK_THREAD_RETURN_TYPE
+OuterThreaderCallback( void * )
+{
+  /** A nested call, as done by the concurrent combination metric. */
+  itk::SharedThreadPool::GetInstance().Execute(
+    InnerThreaderCallback, nullptr, NumberOfInnerWorkUnits );
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+ITK_THREAD_RETURN_TYPE
+ThrowingThreaderCallback( void * arg )
+{
+  const itk::MultiThreaderBase::WorkUnitInfo * info
+    = static_cast< itk::MultiThreaderBase::WorkUnitInfo * >( arg );
+  if( info->WorkUnitID == 3 )
+  {
+    throw std::runtime_error( "work unit 3 failed" );
+  }
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+ITK_THREAD_RETURN_TYPE
+BusyThreaderCallback( void * )
+{
+  const unsigned int active  = ++NumberOfActiveWorkUnits;
+  unsigned int       maximum = MaximumNumberOfActiveWorkUnits;
+  while( active > maximum && !MaximumNumberOfActiveWorkUnits.compare_exchange_weak( maximum, active ) )
+  {
+  }
+  std::this_thread::sleep_for( std::chrono::milliseconds( 2 ) );
+  --NumberOfActiveWorkUnits;
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+ITK_THREAD_RETURN_TYPE
+NestedBusyThreaderCallback( void * )
+{
+  itk::SharedThreadPool::GetInstance().Execute(
+    BusyThreaderCallback, nullptr, NumberOfInnerWorkUnits );
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+ITK_THREAD_RETURN_TYPE
+ResizingThreaderCallback( void * arg )
+{
+  /** Resizing the pool from a work unit must not stop the running threads. */
+  const itk::MultiThreaderBase::WorkUnitInfo * info
+    = static_cast< itk::MultiThreaderBase::WorkUnitInfo * >( arg );
+  itk::SharedThreadPool::GetInstance().SetNumberOfThreads( 1 + info->WorkUnitID % 4 );
+  itk::SharedThreadPool::GetInstance().Execute(
+    InnerThreaderCallback, nullptr, NumberOfInnerWorkUnits );
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+void
+RunResizing( void )
+{
+  for( unsigned int i = 0; i < 100; ++i )
+  {
+    itk::SharedThreadPool::GetInstance().Execute(
+      ResizingThreaderCallback, nullptr, NumberOfOuterWorkUnits );
+  }
+}
+
+
+void
+RunWithThreadBudget( const itk::ThreadIdType threadBudget )
+{
+  itk::SharedThreadPool::SetThreadBudget( threadBudget );
+  itk::SharedThreadPool::GetInstance().Execute(
+    NestedBusyThreaderCallback, nullptr, NumberOfOuterWorkUnits );
+}
+
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int argc, char * argv[] )
+{
+  itk::SharedThreadPool & pool = itk::SharedThreadPool::GetInstance();
+  const unsigned long innerSum = NumberOfInnerWorkUnits * ( NumberOfInnerWorkUnits + 1 ) / 2;
+  const unsigned int  N        = 1000;
+
+  /** Nested calls must neither deadlock nor lose work units. */
+  itk::TimeProbe timer;
+  timer.Start();
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    pool.Execute( OuterThreaderCallback, nullptr, NumberOfOuterWorkUnits );
+  }
+  timer.Stop();
+  std::cerr << "Nested execution on " << pool.GetNumberOfThreads()
+            << " pool threads took " << timer.GetMean() << " s." << std::endl;
+  if( Sum != N * NumberOfOuterWorkUnits * innerSum )
+  {
+    std::cerr << "ERROR: nested execution gave " << Sum << " instead of "
+              << N * NumberOfOuterWorkUnits * innerSum << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** An exception in a work unit must be passed to the caller. */
+  bool caught = false;
+  try
+  {
+    pool.Execute( ThrowingThreaderCallback, nullptr, 8 );
+  }
+  catch( std::exception & )
+  {
+    caught = true;
+  }
+  if( !caught )
+  {
+    std::cerr << "ERROR: the exception of a work unit was not rethrown." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** The pool must keep working after it is resized and bound to CPUs. */
+  pool.SetNumberOfThreads( 3 );
+  pool.SetUseCPUAffinity( true );
+  Sum = 0;
+  itk::SharedPoolMultiThreader::Pointer threader = itk::SharedPoolMultiThreader::New();
+  threader->SetNumberOfWorkUnits( NumberOfInnerWorkUnits );
+  threader->SetSingleMethod( InnerThreaderCallback, nullptr );
+  threader->SingleMethodExecute();
+  if( Sum != innerSum )
+  {
+    std::cerr << "ERROR: the SharedPoolMultiThreader gave " << Sum
+              << " instead of " << innerSum << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Resizing the pool and changing the affinity while other callers use it
+   * must neither lose work units nor deadlock.
+   */
+  Sum = 0;
+  std::thread resizer1( RunResizing );
+  std::thread resizer2( RunResizing );
+  for( unsigned int i = 0; i < 100; ++i )
+  {
+    pool.SetNumberOfThreads( 1 + i % 7 );
+    pool.SetUseCPUAffinity( i % 2 == 0 );
+  }
+  resizer1.join();
+  resizer2.join();
+  if( Sum != 2 * 100 * NumberOfOuterWorkUnits * innerSum )
+  {
+    std::cerr << "ERROR: resizing while busy gave " << Sum << " instead of "
+              << 2 * 100 * NumberOfOuterWorkUnits * innerSum << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Two concurrent callers with a thread budget of 2 each, including their
+   * nested calls, may not use more than 4 threads.
+   */
+  pool.SetNumberOfThreads( 8 );
+  std::thread caller1( RunWithThreadBudget, 2 );
+  std::thread caller2( RunWithThreadBudget, 2 );
+  caller1.join();
+  caller2.join();
+  if( MaximumNumberOfActiveWorkUnits > 4 )
+  {
+    std::cerr << "ERROR: " << MaximumNumberOfActiveWorkUnits
+              << " work units ran concurrently, while the thread budgets allow 4." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
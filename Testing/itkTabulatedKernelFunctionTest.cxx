@@ -0,0 +1,155 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#include "itkTabulatedKernelFunction.h"
+#include "itkBSplineKernelFunction2.h"
+#include "itkBSplineDerivativeKernelFunction2.h"
+
+#include <ctime>
+#include <iomanip>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+// Compares the tabulated Parzen window kernels against the polynomial ones, on the
+// domain where the Parzen window metrics evaluate them, checks the error bound
+// documented in itkTabulatedKernelFunction.h, and times both versions.
+
+namespace
+{
+
+typedef itk::KernelFunctionBase2< double > KernelType;
+
+/** Returns the maximum absolute difference of the weights of two kernels. */
+double
+MaximumDifference( const KernelType * kernel, const KernelType * tabulated,
+  const unsigned int supportSize, const double domainStart )
+{
+  const unsigned int numberOfPoints = 100000;
+  double             maximumDifference = 0.0;
+  double             w1[ 4 ], w2[ 4 ];
+  for( unsigned int i = 0; i < numberOfPoints; ++i )
+  {
+    const double u = domainStart + ( i + 0.5 ) / numberOfPoints;
+    kernel->Evaluate( u, w1 );
+    tabulated->Evaluate( u, w2 );
+    for( unsigned int k = 0; k < supportSize; ++k )
+    {
+      maximumDifference = std::max( maximumDifference, std::abs( w1[ k ] - w2[ k ] ) );
+    }
+  }
+  return maximumDifference;
+
+} // end MaximumDifference()
+
+
+/** Returns the time in ms of N calls to Evaluate( u, weights ). */
+double
+TimeKernel( const KernelType * kernel, const double domainStart,
+  const unsigned int N, double & checksum )
+{
+  double        weights[ 4 ];
+  const clock_t startClock = clock();
+  for( unsigned int i = 0; i < N; ++i )
+  {
+    kernel->Evaluate( domainStart + ( i % 4093 ) / 4093.0, weights );
+    checksum += weights[ 0 ] + weights[ 3 ];
+  }
+  return ( clock() - startClock ) * 1000.0 / CLOCKS_PER_SEC;
+
+} // end TimeKernel()
+
+
+} // end namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int argc, char * argv[] )
+{
+  /** The number of calls to Evaluate(). This number gives reasonably
+   * fast test results in Release mode.
+   * Increase it for real time testing.
+   */
+  const unsigned int N = static_cast< unsigned int >( 1e7 );
+
+  /** The cubic B-spline and its derivative, as used by the Parzen window metrics. */
+  const unsigned int supportSize = 4;
+  const double       domainStart = -2.0; // ParzenTermToIndexOffset - 1 for order 3
+
+  std::vector< KernelType::Pointer > kernels;
+  std::vector< double >              bounds;
+  kernels.push_back( itk::BSplineKernelFunction2< 3 >::New().GetPointer() );
+  bounds.push_back( 2.0 / 8.0 );
+  kernels.push_back( itk::BSplineDerivativeKernelFunction2< 3 >::New().GetPointer() );
+  bounds.push_back( 3.0 / 8.0 );
+  const char * names[] = { "B-spline", "B-spline derivative" };
+
+  std::vector< unsigned int > tableSizes;
+  tableSizes.push_back( 256 );
+  tableSizes.push_back( 1024 );
+  tableSizes.push_back( 4096 );
+
+  std::cout << std::setprecision( 4 );
+  double checksum = 0.0;
+  for( unsigned int k = 0; k < kernels.size(); ++k )
+  {
+    std::cout << "Kernel: " << names[ k ] << std::endl;
+    const double polynomialTime = TimeKernel( kernels[ k ], domainStart, N, checksum );
+    std::cout << "  polynomial:             " << polynomialTime << " ms" << std::endl;
+
+    for( unsigned int t = 0; t < tableSizes.size(); ++t )
+    {
+      itk::TabulatedKernelFunction::Pointer tabulated = itk::TabulatedKernelFunction::New();
+      tabulated->SetNumberOfTableIntervals( tableSizes[ t ] );
+      tabulated->Initialize( kernels[ k ], supportSize, domainStart );
+
+      const double h     = 1.0 / tableSizes[ t ];
+      const double bound = bounds[ k ] * h * h;
+      const double error = MaximumDifference( kernels[ k ], tabulated, supportSize, domainStart );
+      const double time  = TimeKernel( tabulated, domainStart, N, checksum );
+
+      std::cout << "  table of " << std::setw( 4 ) << tableSizes[ t ] << " intervals: "
+                << time << " ms, max error " << error << " (bound " << bound << ")" << std::endl;
+
+      /** Allow some slack for round-off. */
+      if( error > bound + 1e-14 )
+      {
+        std::cerr << "ERROR: the tabulated kernel exceeds the error bound." << std::endl;
+        return EXIT_FAILURE;
+      }
+
+      /** The tabulated weights at the table nodes are exact. */
+      double w1[ 4 ], w2[ 4 ];
+      const double u = domainStart + 3.0 * h;
+      kernels[ k ]->Evaluate( u, w1 );
+      tabulated->Evaluate( u, w2 );
+      for( unsigned int i = 0; i < supportSize; ++i )
+      {
+        if( std::abs( w1[ i ] - w2[ i ] ) > 1e-12 )
+        {
+          std::cerr << "ERROR: the tabulated kernel is not exact at a table node." << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+  std::cout << "(checksum " << checksum << ")" << std::endl;
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,204 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the analytic bending energy with the bending energy sampled on a dense grid.
+ */
+
+#include "BendingEnergyPenalty/itkTransformBendingEnergyPenaltyTerm.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkImageGridSampler.h"
+
+#include "itkImage.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <cmath>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestAnalyticBendingEnergy( const unsigned int cellSize, const unsigned int numberOfCells )
+{
+  /** Typedefs. */
+  typedef itk::Image< float, Dimension >                                    ImageType;
+  typedef typename ImageType::SizeType                                      SizeType;
+  typedef typename ImageType::SpacingType                                   SpacingType;
+  typedef typename ImageType::PointType                                     OriginType;
+  typedef typename ImageType::RegionType                                    RegionType;
+  typedef itk::TransformBendingEnergyPenaltyTerm< ImageType, double >       PenaltyType;
+  typedef typename PenaltyType::MeasureType                                 MeasureType;
+  typedef typename PenaltyType::DerivativeType                              DerivativeType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >   TransformType;
+  typedef typename TransformType::ParametersType                            ParametersType;
+  typedef itk::ImageGridSampler< ImageType >                                SamplerType;
+  typedef itk::LinearInterpolateImageFunction< ImageType, double >          InterpolatorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator            RandomNumberGeneratorType;
+
+  const double tolerance = 1e-2;
+
+  /** Create an anisotropic image, covering exactly numberOfCells B-spline
+   * cells of cellSize voxels in each dimension.
+   */
+  SizeType    imageSize;
+  SpacingType imageSpacing;
+  OriginType  imageOrigin;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    imageSize[ i ]    = cellSize * numberOfCells;
+    imageSpacing[ i ] = 0.5 + 0.25 * i;
+    imageOrigin[ i ]  = 0.0;
+  }
+  RegionType imageRegion; imageRegion.SetSize( imageSize );
+
+  typename ImageType::Pointer image = ImageType::New();
+  image->SetRegions( imageRegion );
+  image->SetSpacing( imageSpacing );
+  image->SetOrigin( imageOrigin );
+  image->Allocate();
+  image->FillBuffer( 0.0f );
+
+  /** Create a cubic B-spline transform with its knots on voxel edges, such
+   * that the valid region of the B-spline coincides with the image domain.
+   */
+  typename TransformType::SizeType    gridSize;
+  typename TransformType::SpacingType gridSpacing;
+  typename TransformType::OriginType  gridOrigin;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    gridSize[ i ]    = numberOfCells + 3;
+    gridSpacing[ i ] = cellSize * imageSpacing[ i ];
+    gridOrigin[ i ]  = imageOrigin[ i ] - 0.5 * imageSpacing[ i ] - gridSpacing[ i ];
+  }
+  typename TransformType::RegionType gridRegion; gridRegion.SetSize( gridSize );
+  typename TransformType::DirectionType gridDirection; gridDirection.SetIdentity();
+
+  typename TransformType::Pointer transform = TransformType::New();
+  transform->SetGridRegion( gridRegion );
+  transform->SetGridSpacing( gridSpacing );
+  transform->SetGridOrigin( gridOrigin );
+  transform->SetGridDirection( gridDirection );
+
+  /** Random coefficients. The transform does not copy the parameters,
+   * so they should outlive it.
+   */
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->SetSeed( 12345 );
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = randomNum->GetUniformVariate( -1.0, 1.0 );
+  }
+  transform->SetParameters( parameters );
+
+  /** Compute the penalty sampled on every voxel, and analytically. */
+  MeasureType    value[ 2 ];
+  MeasureType    valueOnly[ 2 ];
+  DerivativeType derivative[ 2 ];
+  for( unsigned int analytic = 0; analytic < 2; ++analytic )
+  {
+    typename SamplerType::Pointer sampler = SamplerType::New();
+    typename SamplerType::SampleGridSpacingType sampleGridSpacing;
+    sampleGridSpacing.Fill( 1 );
+    sampler->SetSampleGridSpacing( sampleGridSpacing );
+
+    typename PenaltyType::Pointer penalty = PenaltyType::New();
+    penalty->SetFixedImage( image );
+    penalty->SetMovingImage( image );
+    penalty->SetFixedImageRegion( image->GetBufferedRegion() );
+    penalty->SetInterpolator( InterpolatorType::New() );
+    penalty->SetTransform( transform );
+    penalty->SetImageSampler( sampler );
+    penalty->SetUseAnalyticBendingEnergy( analytic == 1 );
+
+    itk::TimeProbe timer;
+    try
+    {
+      penalty->Initialize();
+      timer.Start();
+      penalty->GetValueAndDerivative( parameters, value[ analytic ], derivative[ analytic ] );
+      timer.Stop();
+      valueOnly[ analytic ] = penalty->GetValue( parameters );
+    }
+    catch( itk::ExceptionObject & excp )
+    {
+      std::cerr << "ERROR: " << excp << std::endl;
+      return false;
+    }
+
+    std::cerr << ( analytic ? "  analytic: " : "  sampled:  " )
+              << std::setprecision( 10 ) << value[ analytic ]
+              << " (" << timer.GetMean() << " s)" << std::endl;
+  }
+
+  /** Compare. The sampled value is a midpoint rule of the integral,
+   * so the two only agree within a tolerance.
+   */
+  const double valueError = std::abs( value[ 1 ] - value[ 0 ] ) / std::abs( value[ 0 ] );
+  const double derivativeError
+    = ( derivative[ 1 ] - derivative[ 0 ] ).magnitude() / derivative[ 0 ].magnitude();
+  std::cerr << "  relative error value:      " << valueError << std::endl;
+  std::cerr << "  relative error derivative: " << derivativeError << std::endl;
+
+  bool success = true;
+  if( !( valueError < tolerance ) )
+  {
+    std::cerr << "ERROR: the analytic bending energy differs from the sampled one." << std::endl;
+    success = false;
+  }
+  if( !( derivativeError < tolerance ) )
+  {
+    std::cerr << "ERROR: the analytic bending energy derivative differs from the sampled one." << std::endl;
+    success = false;
+  }
+  for( unsigned int analytic = 0; analytic < 2; ++analytic )
+  {
+    if( std::abs( valueOnly[ analytic ] - value[ analytic ] ) > 1e-10 * std::abs( value[ analytic ] ) )
+    {
+      std::cerr << "ERROR: GetValue() differs from GetValueAndDerivative()." << std::endl;
+      success = false;
+    }
+  }
+
+  return success;
+
+} // end TestAnalyticBendingEnergy()
+
+
+//-------------------------------------------------------------------------------------
+
+int
+main( void )
+{
+  std::cerr << "2D:" << std::endl;
+  const bool success2D = TestAnalyticBendingEnergy< 2 >( 20, 4 );
+  std::cerr << "3D:" << std::endl;
+  const bool success3D = TestAnalyticBendingEnergy< 3 >( 16, 2 );
+
+  if( !success2D || !success3D )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Return a value. */
+  return EXIT_SUCCESS;
+
+} // end main